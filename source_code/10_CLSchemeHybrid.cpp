@@ -0,0 +1,435 @@
+/*
+ * ------------------------------------------------------------------
+ *  Author: Alaa Mroue - 2023
+ *  This code is licensed under GPLv3. See LICENCE for more information.
+ * ------------------------------------------------------------------
+ */
+
+#include "10_CLSchemeHybrid.h"
+#include "9_CLSchemePromaidesImplicit.h"
+
+/*
+ *  Tiles are classified every few steps:
+ *    hyb_Classify    per tile, whether a cell is fast or steep, and the
+ *                    stable explicit diffusive timestep
+ *    hyb_Regime      a tile is dynamic if it or a neighbour is fast, so
+ *                    a fast front has a tile to cross before the next
+ *                    classification
+ *  and every step runs a face pass and a cell pass, one work-item per tile:
+ *    hyb_FaceFluxes  diffusive rate on faces between two diffusive tiles,
+ *                    HLLC elsewhere. On a face between the two regimes
+ *                    the diffusive cell takes the HLLC mass flux of its
+ *                    neighbour, so no water is gained or lost there.
+ *    hyb_FaceUpdate  gts_faceUpdate in dynamic tiles. Diffusive cells
+ *                    update their level from the mass fluxes and keep
+ *                    the mean face discharge as Qx, Qy, which is what the
+ *                    HLLC scheme starts from if the tile turns dynamic.
+ *  Diffusive face rates are those of solverFunctionPromaides, so a domain
+ *  of diffusive tiles steps the same levels.
+ */
+
+/*
+ *  Map for a domain of the given size, every tile starts dynamic
+ */
+sHybridRegime allocateHybridRegime(cl_ulong ulRows, cl_ulong ulCols, cl_uint2 uiTileSize)
+{
+	sHybridRegime pRegime;
+
+	pRegime.TileSize = uiTileSize;
+	pRegime.TilesX = (ulCols + uiTileSize.s[0] - 1) / uiTileSize.s[0];
+	pRegime.TilesY = (ulRows + uiTileSize.s[1] - 1) / uiTileSize.s[1];
+	pRegime.TileCount = pRegime.TilesX * pRegime.TilesY;
+	pRegime.Fast = new cl_uchar[pRegime.TileCount];
+	pRegime.Regime = new cl_uchar[pRegime.TileCount];
+	pRegime.Timestep = new cl_double[pRegime.TileCount];
+
+	std::fill(pRegime.Fast, pRegime.Fast + pRegime.TileCount, (cl_uchar)1);
+	std::fill(pRegime.Regime, pRegime.Regime + pRegime.TileCount, (cl_uchar)HYBRID_DYNAMIC);
+	std::fill(pRegime.Timestep, pRegime.Timestep + pRegime.TileCount, TIMESTEP_MAXIMUM);
+
+	return pRegime;
+}
+
+void freeHybridRegime(sHybridRegime* pRegime)
+{
+	delete[] pRegime->Fast;
+	delete[] pRegime->Regime;
+	delete[] pRegime->Timestep;
+	pRegime->Fast = NULL;
+	pRegime->Regime = NULL;
+	pRegime->Timestep = NULL;
+}
+
+/*
+ *  Share of the tiles in the diffusive regime
+ */
+cl_double getHybridDiffusiveFraction(const sHybridRegime* pRegime)
+{
+	cl_ulong ulDiffusive = std::count(pRegime->Regime, pRegime->Regime + pRegime->TileCount, (cl_uchar)HYBRID_DIFFUSIVE);
+	return (cl_double)ulDiffusive / (cl_double)pRegime->TileCount;
+}
+
+/*
+ *  Longest timestep the diffusive tiles keep stable, the HLLC tiles still
+ *  need their Courant condition
+ */
+cl_double getHybridTimestep(const sHybridRegime* pRegime)
+{
+	cl_double dTimestep = TIMESTEP_MAXIMUM;
+	for (cl_ulong ulTile = 0; ulTile < pRegime->TileCount; ulTile++)
+		if (pRegime->Regime[ulTile] == HYBRID_DIFFUSIVE)
+			dTimestep = std::min(dTimestep, pRegime->Timestep[ulTile]);
+	return dTimestep;
+}
+
+/*
+ *  Regime of the tile holding a cell
+ */
+inline cl_uchar hyb_TileRegime(const sHybridRegime* pRegime, cl_long lIdxX, cl_long lIdxY)
+{
+	return pRegime->Regime[(lIdxY / pRegime->TileSize.s[1]) * pRegime->TilesX + lIdxX / pRegime->TileSize.s[0]];
+}
+
+/*
+ *  Water surface slope of a face that flows, zero otherwise. Dry cells
+ *  count at their bed, as in the diffusive law.
+ */
+inline cl_double hyb_FaceGradient(
+	cl_double dLevelA,
+	cl_double dBedA,
+	cl_double dLevelB,
+	cl_double dBedB,
+	cl_double dDistance
+)
+{
+	bool		bWetA = dLevelA - dBedA >= VERY_SMALL;
+	bool		bWetB = dLevelB - dBedB >= VERY_SMALL;
+	cl_double	dSurfaceA = bWetA ? dLevelA : dBedA;
+	cl_double	dSurfaceB = bWetB ? dLevelB : dBedB;
+
+	if (!(bWetA || bWetB) || std::max(dSurfaceA, dSurfaceB) - std::max(dBedA, dBedB) <= VERY_SMALL)
+		return 0.0;
+
+	return fabs(dSurfaceB - dSurfaceA) / dDistance;
+}
+
+/*
+ *  Whether a tile holds a cell above HYBRID_FROUDE_LIMIT or
+ *  HYBRID_GRADIENT_LIMIT, and its stable explicit diffusive timestep from
+ *  the largest absolute row sum of the face rate Jacobian. One work-item
+ *  per tile, the outer ring is not classified.
+ */
+template <typename TDomain>
+void hyb_Classify(
+	const TDomain& pDomain,
+	sHybridRegime* pRegime,
+	cl_double4* pCellState,
+	cl_double* dBedElevation,
+	cl_double* dManning,
+	GlobalHandlerClass ghc
+)
+{
+	cl_long		lTileX = ghc.get_global_id(0);
+	cl_long		lTileY = ghc.get_global_id(1);
+	cl_long		lCols = pDomain.Cols;
+	cl_long		lRows = pDomain.Rows;
+
+	if (lTileX >= (cl_long)pRegime->TilesX || lTileY >= (cl_long)pRegime->TilesY)
+		return;
+
+	cl_ulong	ulTile = lTileY * pRegime->TilesX + lTileX;
+	cl_long		lStartX = std::max(lTileX * (cl_long)pRegime->TileSize.s[0], (cl_long)1);
+	cl_long		lStartY = std::max(lTileY * (cl_long)pRegime->TileSize.s[1], (cl_long)1);
+	cl_long		lEndX = std::min((lTileX + 1) * (cl_long)pRegime->TileSize.s[0], lCols - 1);
+	cl_long		lEndY = std::min((lTileY + 1) * (cl_long)pRegime->TileSize.s[1], lRows - 1);
+	cl_uchar	ucFast = 0;
+	cl_double	dStiffness = 0.0;
+
+	for (cl_long lIdxY = lStartY; lIdxY < lEndY; lIdxY++)
+	{
+		for (cl_long lIdxX = lStartX; lIdxX < lEndX; lIdxX++)
+		{
+			cl_ulong	ulIdx = getCellID(pDomain, lIdxX, lIdxY);
+			cl_double4	pCellData = pCellState[ulIdx];
+			cl_double	dBed = dBedElevation[ulIdx];
+			cl_double	dDepth = pCellData.x - dBed;
+
+			if (pCellData.y <= -9999.0 || pCellData.x == -9999.0)
+				continue;
+
+			// Froude number of a wet cell
+			if (dDepth >= VERY_SMALL &&
+				sqrt(pCellData.z * pCellData.z + pCellData.w * pCellData.w) > HYBRID_FROUDE_LIMIT * dDepth * sqrt(GRAVITY * dDepth))
+				ucFast = 1;
+
+			// Surface slope and rate derivatives of the four faces
+			cl_ulong	ulNeighbours[4] = { ulIdx + lCols, ulIdx + 1, ulIdx - lCols, ulIdx - 1 };
+			cl_double	dRowSum = 0.0;
+			for (int i = 0; i < 4; i++)
+			{
+				cl_ulong	ulNeig = ulNeighbours[i];
+				cl_double	dSlopeCell, dSlopeNeig;
+
+				if (hyb_FaceGradient(pCellData.x, dBed, pCellState[ulNeig].x, dBedElevation[ulNeig], i % 2 == 0 ? pDomain.DeltaY : pDomain.DeltaX) > HYBRID_GRADIENT_LIMIT)
+					ucFast = 1;
+
+				pim_FaceRate(pCellData.x, dBed, pCellState[ulNeig].x, dBedElevation[ulNeig], 1 / dManning[ulIdx], 1 / dManning[ulNeig], &dSlopeCell, &dSlopeNeig);
+				dRowSum += fabs(dSlopeCell) + fabs(dSlopeNeig);
+			}
+			dStiffness = std::max(dStiffness, dRowSum);
+		}
+	}
+
+	pRegime->Fast[ulTile] = ucFast;
+	pRegime->Timestep[ulTile] = dStiffness > 0.0 ? std::min(HYBRID_DIFFUSIVE_SAFETY * 2.0 / dStiffness, TIMESTEP_MAXIMUM) : TIMESTEP_MAXIMUM;
+}
+
+/*
+ *  New tile regimes from the fast flags, one work-item per tile
+ */
+void hyb_Regime(
+	sHybridRegime* pRegime,
+	GlobalHandlerClass ghc
+)
+{
+	cl_long		lTileX = ghc.get_global_id(0);
+	cl_long		lTileY = ghc.get_global_id(1);
+	cl_long		lTilesX = (cl_long)pRegime->TilesX;
+	cl_long		lTilesY = (cl_long)pRegime->TilesY;
+
+	if (lTileX >= lTilesX || lTileY >= lTilesY)
+		return;
+
+	cl_ulong	ulTile = lTileY * lTilesX + lTileX;
+	cl_uchar*	ucFast = pRegime->Fast;
+	bool		bDynamic = ucFast[ulTile] ||
+		(lTileX > 0 && ucFast[ulTile - 1]) ||
+		(lTileX < lTilesX - 1 && ucFast[ulTile + 1]) ||
+		(lTileY > 0 && ucFast[ulTile - lTilesX]) ||
+		(lTileY < lTilesY - 1 && ucFast[ulTile + lTilesX]);
+
+	pRegime->Regime[ulTile] = bDynamic ? HYBRID_DYNAMIC : HYBRID_DIFFUSIVE;
+}
+
+/*
+ *  Fluxes through one interface for the regimes of its two cells.
+ *  dDistance is the cell size across the face.
+ */
+template <cl_uchar ucDirection>
+inline void hyb_solveFace(
+	cl_double		dDistance,
+	cl_double4		pStateLeft,
+	cl_double		dBedLeft,
+	cl_double		dInvManningLeft,
+	cl_uchar		ucRegimeLeft,
+	cl_double4		pStateRight,
+	cl_double		dBedRight,
+	cl_double		dInvManningRight,
+	cl_uchar		ucRegimeRight,
+	sFaceFlux*		pFace
+)
+{
+	if (ucRegimeLeft == HYBRID_DIFFUSIVE && ucRegimeRight == HYBRID_DIFFUSIVE)
+	{
+		cl_double	dSlopeLeft, dSlopeRight;
+		cl_double	dRate = pim_FaceRate(pStateLeft.x, dBedLeft, pStateRight.x, dBedRight, dInvManningLeft, dInvManningRight, &dSlopeLeft, &dSlopeRight);
+		cl_double4	pFlux = { -dRate * dDistance, 0.0, 0.0, 0.0 };
+
+		pFace->ucDry = (pStateLeft.x - dBedLeft < VERY_SMALL ? 1 : 0) |
+			(pStateRight.x - dBedRight < VERY_SMALL ? 2 : 0);
+		pFace->pFluxL = pFlux;
+		pFace->pFluxR = pFlux;
+		pFace->pViewL = { pStateRight.x, dBedRight };
+		pFace->pViewR = { pStateLeft.x, dBedLeft };
+		pFace->ucStopL = 0;
+		pFace->ucStopR = 0;
+		return;
+	}
+
+	gts_solveFace<ucDirection>(pStateLeft, dBedLeft, pStateRight, dBedRight, pFace);
+
+	// A diffusive cell takes the mass flux its dynamic neighbour sees
+	if (ucRegimeLeft == HYBRID_DIFFUSIVE)
+		pFace->pFluxL.x = pFace->pFluxR.x;
+	if (ucRegimeRight == HYBRID_DIFFUSIVE)
+		pFace->pFluxR.x = pFace->pFluxL.x;
+}
+
+/*
+ *  Face pass: each work-item solves the east and north faces of the cells
+ *  of its tile, faces indexed by the ID of their left (west/south) cell as
+ *  in gts_faceFluxes. Each row of the tile sweeps its east faces, then its
+ *  north faces.
+ */
+template <typename TDomain>
+void hyb_FaceFluxes(
+	const TDomain& pDomain,
+	cl_double* dTimestep,						// Timestep
+	cl_double* dBedElevation,					// Bed elevation
+	cl_double4* pCellStateSrc,					// Current cell state data
+	cl_double* dManning,						// Manning values
+	const sHybridRegime* pRegime,				// Tile regimes
+	sFaceFlux* pFacesE,							// East face of each cell
+	sFaceFlux* pFacesN,							// North face of each cell
+	GlobalHandlerClass ghc
+)
+{
+	cl_long		lTileX = ghc.get_global_id(0);
+	cl_long		lTileY = ghc.get_global_id(1);
+	cl_long		lCols = pDomain.Cols;
+	cl_long		lRows = pDomain.Rows;
+
+	if (lTileX >= (cl_long)pRegime->TilesX || lTileY >= (cl_long)pRegime->TilesY || *dTimestep <= 0.0)
+		return;
+
+	cl_uchar	ucRegime = pRegime->Regime[lTileY * pRegime->TilesX + lTileX];
+	cl_long		lStartX = lTileX * (cl_long)pRegime->TileSize.s[0];
+	cl_long		lStartY = lTileY * (cl_long)pRegime->TileSize.s[1];
+	cl_long		lEndX = std::min(lStartX + (cl_long)pRegime->TileSize.s[0], lCols);
+	cl_long		lEndY = std::min(lStartY + (cl_long)pRegime->TileSize.s[1], lRows);
+
+	for (cl_long lIdxY = lStartY; lIdxY < lEndY; lIdxY++)
+	{
+		// -> East, only interior rows are updated
+		if (lIdxY > 0 && lIdxY < lRows - 1)
+		{
+			for (cl_long lIdxX = lStartX; lIdxX < std::min(lEndX, lCols - 1); lIdxX++)
+			{
+				cl_ulong	ulIdx = getCellID(pDomain, lIdxX, lIdxY);
+				hyb_solveFace<DOMAIN_DIR_E>(
+					pDomain.DeltaX,
+					pCellStateSrc[ulIdx], dBedElevation[ulIdx], 1 / dManning[ulIdx], ucRegime,
+					pCellStateSrc[ulIdx + 1], dBedElevation[ulIdx + 1], 1 / dManning[ulIdx + 1],
+					lIdxX + 1 < lEndX ? ucRegime : hyb_TileRegime(pRegime, lIdxX + 1, lIdxY),
+					&pFacesE[ulIdx]
+				);
+			}
+		}
+
+		// -> North, only interior columns are updated
+		if (lIdxY < lRows - 1)
+		{
+			for (cl_long lIdxX = std::max(lStartX, (cl_long)1); lIdxX < std::min(lEndX, lCols - 1); lIdxX++)
+			{
+				cl_ulong	ulIdx = getCellID(pDomain, lIdxX, lIdxY);
+				hyb_solveFace<DOMAIN_DIR_N>(
+					pDomain.DeltaY,
+					pCellStateSrc[ulIdx], dBedElevation[ulIdx], 1 / dManning[ulIdx], ucRegime,
+					pCellStateSrc[ulIdx + lCols], dBedElevation[ulIdx + lCols], 1 / dManning[ulIdx + lCols],
+					lIdxY + 1 < lEndY ? ucRegime : hyb_TileRegime(pRegime, lIdxX, lIdxY + 1),
+					&pFacesN[ulIdx]
+				);
+			}
+		}
+	}
+}
+
+/*
+ *  Mass balance of the face fluxes of one interior diffusive cell
+ */
+template <typename TDomain>
+inline void hyb_diffusiveUpdate(
+	const TDomain& pDomain,
+	cl_double dLclTimestep,
+	cl_double* dBedElevation,
+	cl_double4* pCellStateSrc,
+	cl_double4* pCellStateDst,
+	sFaceFlux* pFacesE,
+	sFaceFlux* pFacesN,
+	cl_ulong ulIdx
+)
+{
+	cl_double4		pCellData = pCellStateSrc[ulIdx];
+	cl_double		dCellBedElev = dBedElevation[ulIdx];
+
+	// Also don't bother if the cell is disabled
+	if (pCellData.y <= -9999.0 || pCellData.x == -9999.0)
+	{
+		pCellStateDst[ulIdx] = pCellData;
+		return;
+	}
+
+	cl_double		dFluxN = pFacesN[ulIdx].pFluxL.x;
+	cl_double		dFluxE = pFacesE[ulIdx].pFluxL.x;
+	cl_double		dFluxS = pFacesN[ulIdx - pDomain.Cols].pFluxR.x;
+	cl_double		dFluxW = pFacesE[ulIdx - 1].pFluxR.x;
+
+	// Update the flow state, the discharge is the mean of the faces
+	pCellData.x -= dLclTimestep * ((dFluxE - dFluxW) / pDomain.DeltaX + (dFluxN - dFluxS) / pDomain.DeltaY);
+	pCellData.z = 0.5 * (dFluxE + dFluxW);
+	pCellData.w = 0.5 * (dFluxN + dFluxS);
+
+	// New max FSL?
+	if (pCellData.x > pCellData.y && pCellData.y > -9990.0)
+		pCellData.y = pCellData.x;
+
+	// Crazy low depths?
+	if (pCellData.x - dCellBedElev < VERY_SMALL)
+	{
+		pCellData.x = dCellBedElev;
+		pCellData.z = 0.0;
+		pCellData.w = 0.0;
+	}
+
+	pCellStateDst[ulIdx] = pCellData;
+}
+
+/*
+ *  Cell pass: gts_faceUpdate in dynamic tiles, the mass balance of the
+ *  face fluxes in diffusive ones. One work-item per tile.
+ */
+template <typename TDomain>
+void hyb_FaceUpdate(
+	const TDomain& pDomain,
+	cl_double* dTimestep,						// Timestep
+	cl_double* dBedElevation,					// Bed elevation
+	cl_double4* pCellStateSrc,					// Current cell state data
+	cl_double4* pCellStateDst,					// New cell state data
+	cl_double* dManning,						// Manning values
+	const sHybridRegime* pRegime,				// Tile regimes
+	sFaceFlux* pFacesE,							// East face of each cell
+	sFaceFlux* pFacesN,							// North face of each cell
+	GlobalHandlerClass ghc
+)
+{
+	cl_long		lTileX = ghc.get_global_id(0);
+	cl_long		lTileY = ghc.get_global_id(1);
+
+	if (lTileX >= (cl_long)pRegime->TilesX || lTileY >= (cl_long)pRegime->TilesY)
+		return;
+
+	// Only interior cells are updated
+	cl_double	dLclTimestep = *dTimestep;
+	cl_long		lStartX = std::max(lTileX * (cl_long)pRegime->TileSize.s[0], (cl_long)1);
+	cl_long		lStartY = std::max(lTileY * (cl_long)pRegime->TileSize.s[1], (cl_long)1);
+	cl_long		lEndX = std::min((lTileX + 1) * (cl_long)pRegime->TileSize.s[0], (cl_long)pDomain.Cols - 1);
+	cl_long		lEndY = std::min((lTileY + 1) * (cl_long)pRegime->TileSize.s[1], (cl_long)pDomain.Rows - 1);
+
+	if (pRegime->Regime[lTileY * pRegime->TilesX + lTileX] == HYBRID_DYNAMIC)
+	{
+		for (cl_long lIdxY = lStartY; lIdxY < lEndY; lIdxY++)
+			gts_faceUpdateSpan(pDomain, dLclTimestep, dBedElevation, pCellStateSrc, pCellStateDst, dManning, pFacesE, pFacesN, lIdxY, lStartX, lEndX);
+		return;
+	}
+
+	for (cl_long lIdxY = lStartY; lIdxY < lEndY; lIdxY++)
+	{
+		for (cl_long lIdxX = lStartX; lIdxX < lEndX; lIdxX++)
+		{
+			cl_ulong	ulIdx = getCellID(pDomain, lIdxX, lIdxY);
+
+			// Don't bother if we've gone beyond the total simulation time
+			if (dLclTimestep <= 0.0)
+				pCellStateDst[ulIdx] = pCellStateSrc[ulIdx];
+			else
+				hyb_diffusiveUpdate(pDomain, dLclTimestep, dBedElevation, pCellStateSrc, pCellStateDst, pFacesE, pFacesN, ulIdx);
+		}
+	}
+}
+
+template void hyb_Classify<sDomainConfiguration>(const sDomainConfiguration&, sHybridRegime*, cl_double4*, cl_double*, cl_double*, GlobalHandlerClass);
+template void hyb_Classify<sDomainCompiled>(const sDomainCompiled&, sHybridRegime*, cl_double4*, cl_double*, cl_double*, GlobalHandlerClass);
+template void hyb_FaceFluxes<sDomainConfiguration>(const sDomainConfiguration&, cl_double*, cl_double*, cl_double4*, cl_double*, const sHybridRegime*, sFaceFlux*, sFaceFlux*, GlobalHandlerClass);
+template void hyb_FaceFluxes<sDomainCompiled>(const sDomainCompiled&, cl_double*, cl_double*, cl_double4*, cl_double*, const sHybridRegime*, sFaceFlux*, sFaceFlux*, GlobalHandlerClass);
+template void hyb_FaceUpdate<sDomainConfiguration>(const sDomainConfiguration&, cl_double*, cl_double*, cl_double4*, cl_double4*, cl_double*, const sHybridRegime*, sFaceFlux*, sFaceFlux*, GlobalHandlerClass);
+template void hyb_FaceUpdate<sDomainCompiled>(const sDomainCompiled&, cl_double*, cl_double*, cl_double4*, cl_double4*, cl_double*, const sHybridRegime*, sFaceFlux*, sFaceFlux*, GlobalHandlerClass);
@@ -0,0 +1,86 @@
+/*
+ * ------------------------------------------------------------------
+ *  Author: Alaa Mroue - 2023
+ *  This code is licensed under GPLv3. See LICENCE for more information.
+ * ------------------------------------------------------------------
+ */
+
+#pragma once
+#include "definitions.h"
+#include "5_CLSchemeGodunov.h"
+
+//Hybrid scheme, diffusive wave in slow tiles and Godunov HLLC in the others.
+
+// Regime of a tile
+#define HYBRID_DIFFUSIVE			0		// Diffusive faces and cells
+#define HYBRID_DYNAMIC				1		// HLLC faces and cells
+
+// A wet cell above either limit needs the full equations, the Froude
+// number or the water surface slope of a face that flows
+#define HYBRID_FROUDE_LIMIT			0.5
+#define HYBRID_GRADIENT_LIMIT		0.1
+
+// Steps between two classifications of the tiles
+#define HYBRID_CLASSIFY_STEPS		10
+
+// Share of the explicit stability limit of the diffusive tiles a step may take
+#define HYBRID_DIFFUSIVE_SAFETY		0.5
+
+// Regime map, one entry per tile
+typedef struct sHybridRegime
+{
+	cl_uint2		TileSize;
+	cl_ulong		TilesX;
+	cl_ulong		TilesY;
+	cl_ulong		TileCount;
+	cl_uchar*		Fast;					// Tile holds a cell above a limit
+	cl_uchar*		Regime;					// HYBRID_DIFFUSIVE or HYBRID_DYNAMIC
+	cl_double*		Timestep;				// Stable explicit diffusive timestep of the tile
+} sHybridRegime;
+
+sHybridRegime	allocateHybridRegime(cl_ulong, cl_ulong, cl_uint2);
+void			freeHybridRegime(sHybridRegime*);
+cl_double		getHybridDiffusiveFraction(const sHybridRegime*);
+cl_double		getHybridTimestep(const sHybridRegime*);
+
+template <typename TDomain>
+void hyb_Classify(
+	const TDomain&,
+	sHybridRegime*,
+	cl_double4*,
+	cl_double*,
+	cl_double*,
+	GlobalHandlerClass
+);
+
+void hyb_Regime(
+	sHybridRegime*,
+	GlobalHandlerClass
+);
+
+template <typename TDomain>
+void hyb_FaceFluxes(
+	const TDomain&,
+	cl_double*,
+	cl_double*,
+	cl_double4*,
+	cl_double*,
+	const sHybridRegime*,
+	sFaceFlux*,
+	sFaceFlux*,
+	GlobalHandlerClass
+);
+
+template <typename TDomain>
+void hyb_FaceUpdate(
+	const TDomain&,
+	cl_double*,
+	cl_double*,
+	cl_double4*,
+	cl_double4*,
+	cl_double*,
+	const sHybridRegime*,
+	sFaceFlux*,
+	sFaceFlux*,
+	GlobalHandlerClass
+);
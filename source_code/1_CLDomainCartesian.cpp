@@ -6,75 +6,373 @@
  */
 
 #include "1_CLDomainCartesian.h"
+#include <fstream>
+#include <cstdlib>
+#include <map>
+#include <vector>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
 
 //Management functions for a Cartesian domain.
+//The index functions are templates on the domain descriptor, see the header.
 
- /*
-  *  Fetch the ID for a cell using its X and Y indices
-  */
-cl_ulong	getCellID(cl_long lIdxX, cl_long lIdxY)
+/*
+ *  Describe a domain of the given size and resolution
+ */
+sDomainConfiguration	createDomain(cl_ulong ulRows, cl_ulong ulCols, cl_double dDeltaX, cl_double dDeltaY)
 {
-	cl_long	lCols = DOMAIN_COLS;
-	return (lIdxY * lCols) + lIdxX;
+	sDomainConfiguration pDomain;
+	pDomain.Rows = ulRows;
+	pDomain.Cols = ulCols;
+	pDomain.CellCount = ulRows * ulCols;
+	pDomain.DeltaX = dDeltaX;
+	pDomain.DeltaY = dDeltaY;
+	return pDomain;
 }
 
 /*
- *  Fetch the X and Y indices for a cell using its ID
+ *  Load the domain description from a text file: rows cols deltaX deltaY
  */
-void	getCellIndices(cl_ulong ulID, cl_long* lIdxX, cl_long* lIdxY)
+bool	readDomainConfiguration(const char* cFilename, sDomainConfiguration* pDomain)
 {
-	*lIdxX = ulID % DOMAIN_COLS;
-	*lIdxY = (ulID - *lIdxX) / DOMAIN_COLS;
+	std::ifstream	fDomain(cFilename);
+	cl_ulong		ulRows, ulCols;
+	cl_double		dDeltaX, dDeltaY;
+
+	if (!(fDomain >> ulRows >> ulCols >> dDeltaX >> dDeltaY))
+	{
+		std::cout << "readDomainConfiguration error: Could not read " << cFilename << std::endl;
+		return false;
+	}
+
+	// Kernels skip the outer ring, so anything smaller has no computed cells
+	if (ulRows < 3 || ulCols < 3 || dDeltaX <= 0.0 || dDeltaY <= 0.0)
+	{
+		std::cout << "readDomainConfiguration error: Invalid domain in " << cFilename << std::endl;
+		return false;
+	}
+
+	*pDomain = createDomain(ulRows, ulCols, dDeltaX, dDeltaY);
+	return true;
 }
 
 /*
- *  Fetch the ID for a neighbouring cell in the domain
+ *  Does the runtime domain match the compile time fast path?
  */
-cl_ulong	getNeighbourID(cl_ulong ulCellID, cl_uchar ucDirection)
+bool	isDomainCompiled(const sDomainConfiguration& pDomain)
 {
-	cl_long lIdxX = 0;
-	cl_long lIdxY = 0;
-	getCellIndices(ulCellID, &lIdxX, &lIdxY);
+	return pDomain.Rows == sDomainCompiled::Rows && pDomain.Cols == sDomainCompiled::Cols;
+}
 
-	switch (ucDirection)
+/*
+ *  Compile time descriptor for a domain that passed isDomainCompiled
+ */
+sDomainCompiled	getDomainCompiled(const sDomainConfiguration& pDomain)
+{
+	sDomainCompiled pCompiled;
+	pCompiled.DeltaX = pDomain.DeltaX;
+	pCompiled.DeltaY = pDomain.DeltaY;
+	return pCompiled;
+}
+
+/*
+ *  Block of the domain held by one of iRanks ranks. The ranks form the grid
+ *  with the fewest halo cells, each owning a near equal block of the cells
+ *  the kernels update. Fails when there are more ranks than such cells.
+ */
+bool	createDomainPartition(const sDomainConfiguration& pDomain, int iRanks, int iRank, sDomainPartition* pPartition)
+{
+	cl_ulong	ulInnerRows = pDomain.Rows - 2;
+	cl_ulong	ulInnerCols = pDomain.Cols - 2;
+	cl_ulong	ulHaloCells = 0;
+	int			iRanksX = 0;
+	int			iRanksY = 0;
+
+	for (int iX = 1; iX <= iRanks; iX++)
 	{
-	case DOMAIN_DIR_N:
-		++lIdxY;
-		break;
-	case DOMAIN_DIR_E:
-		++lIdxX;
-		break;
-	case DOMAIN_DIR_S:
-		--lIdxY;
-		break;
-	case DOMAIN_DIR_W:
-		--lIdxX;
-		break;
+		int iY = iRanks / iX;
+		if (iX * iY != iRanks || (cl_ulong)iX > ulInnerCols || (cl_ulong)iY > ulInnerRows)
+			continue;
+
+		// Every cut exchanges a row or a column of cells each way
+		cl_ulong ulCutCells = (iX - 1) * ulInnerRows + (iY - 1) * ulInnerCols;
+		if (iRanksX == 0 || ulCutCells < ulHaloCells)
+		{
+			iRanksX = iX;
+			iRanksY = iY;
+			ulHaloCells = ulCutCells;
+		}
+	}
+
+	if (iRanksX == 0 || iRank < 0 || iRank >= iRanks)
+	{
+		std::cout << "createDomainPartition error: Cannot split " << pDomain.Rows << " x " << pDomain.Cols << " cells over " << iRanks << " ranks" << std::endl;
+		return false;
 	}
 
-	return getCellID(lIdxX, lIdxY);
+	int			iRankX = iRank % iRanksX;
+	int			iRankY = iRank / iRanksX;
+	cl_ulong	ulRowStart = 1 + ulInnerRows * iRankY / iRanksY;
+	cl_ulong	ulRowEnd = 1 + ulInnerRows * (iRankY + 1) / iRanksY;
+	cl_ulong	ulColStart = 1 + ulInnerCols * iRankX / iRanksX;
+	cl_ulong	ulColEnd = 1 + ulInnerCols * (iRankX + 1) / iRanksX;
+
+	pPartition->Local = createDomain(ulRowEnd - ulRowStart + 2, ulColEnd - ulColStart + 2, pDomain.DeltaX, pDomain.DeltaY);
+	pPartition->RowOffset = ulRowStart - 1;
+	pPartition->ColOffset = ulColStart - 1;
+	pPartition->OwnedRowStart = iRankY == 0 ? 0 : 1;
+	pPartition->OwnedRowEnd = pPartition->Local.Rows - (iRankY == iRanksY - 1 ? 0 : 1);
+	pPartition->OwnedColStart = iRankX == 0 ? 0 : 1;
+	pPartition->OwnedColEnd = pPartition->Local.Cols - (iRankX == iRanksX - 1 ? 0 : 1);
+	pPartition->Rank = iRank;
+	pPartition->RanksX = iRanksX;
+	pPartition->RanksY = iRanksY;
+	pPartition->Neighbours[DOMAIN_DIR_N] = iRankY + 1 < iRanksY ? iRank + iRanksX : -1;
+	pPartition->Neighbours[DOMAIN_DIR_E] = iRankX + 1 < iRanksX ? iRank + 1 : -1;
+	pPartition->Neighbours[DOMAIN_DIR_S] = iRankY > 0 ? iRank - iRanksX : -1;
+	pPartition->Neighbours[DOMAIN_DIR_W] = iRankX > 0 ? iRank - 1 : -1;
+	return true;
 }
 
 /*
- *  Fetch the ID for a neighbouring cell in the domain
+ *  Allocate memory aligned for full cache lines and vector loads
  */
-cl_ulong	getNeighbourByIndices(cl_long lIdxX, cl_long lIdxY, cl_uchar ucDirection)
+void*	allocateAligned(size_t uiBytes)
 {
-	switch (ucDirection)
+	// Round up so the size is a multiple of the alignment, as C11 requires
+	uiBytes = (uiBytes + CELLSTATE_ALIGNMENT - 1) / CELLSTATE_ALIGNMENT * CELLSTATE_ALIGNMENT;
+	if (uiBytes == 0)
+		uiBytes = CELLSTATE_ALIGNMENT;
+
+	#ifdef _WIN32
+	return _aligned_malloc(uiBytes, CELLSTATE_ALIGNMENT);
+	#else
+	void* pMemory = NULL;
+	if (posix_memalign(&pMemory, CELLSTATE_ALIGNMENT, uiBytes) != 0)
+		return NULL;
+	return pMemory;
+	#endif
+}
+
+void	freeAligned(void* pMemory)
+{
+	#ifdef _WIN32
+	_aligned_free(pMemory);
+	#else
+	free(pMemory);
+	#endif
+}
+
+/*
+ *  Allocate the component arrays of a structure-of-arrays cell state
+ */
+sCellStateSoA	allocateCellStateSoA(cl_ulong ulCellCount)
+{
+	sCellStateSoA pState;
+	pState.Z = (cl_double*)allocateAligned(ulCellCount * sizeof(cl_double));
+	pState.Zmax = (cl_double*)allocateAligned(ulCellCount * sizeof(cl_double));
+	pState.Qx = (cl_double*)allocateAligned(ulCellCount * sizeof(cl_double));
+	pState.Qy = (cl_double*)allocateAligned(ulCellCount * sizeof(cl_double));
+	return pState;
+}
+
+void	freeCellStateSoA(sCellStateSoA* pState)
+{
+	freeAligned(pState->Z);
+	freeAligned(pState->Zmax);
+	freeAligned(pState->Qx);
+	freeAligned(pState->Qy);
+	pState->Z = pState->Zmax = pState->Qx = pState->Qy = NULL;
+}
+
+/*
+ *  Convert between the cl_double4 and structure-of-arrays layouts
+ */
+void	copyCellStateToSoA(cl_double4* pSource, sCellStateSoA pState, cl_ulong ulCellCount)
+{
+	for (cl_ulong i = 0; i < ulCellCount; i++)
+	{
+		pState.Z[i] = pSource[i].x;
+		pState.Zmax[i] = pSource[i].y;
+		pState.Qx[i] = pSource[i].z;
+		pState.Qy[i] = pSource[i].w;
+	}
+}
+
+void	copyCellStateFromSoA(sCellStateSoA pState, cl_double4* pDestination, cl_ulong ulCellCount)
+{
+	for (cl_ulong i = 0; i < ulCellCount; i++)
 	{
-	case DOMAIN_DIR_N:
-		++lIdxY;
-		break;
-	case DOMAIN_DIR_E:
-		++lIdxX;
-		break;
-	case DOMAIN_DIR_S:
-		--lIdxY;
-		break;
-	case DOMAIN_DIR_W:
-		--lIdxX;
-		break;
+		pDestination[i].x = pState.Z[i];
+		pDestination[i].y = pState.Zmax[i];
+		pDestination[i].z = pState.Qx[i];
+		pDestination[i].w = pState.Qy[i];
 	}
+}
 
-	return getCellID(lIdxX, lIdxY);
+/*
+ *  Land-use classes of a per-cell Manning array, one per distinct value.
+ *  False when there are more values than MANNING_CLASSES.
+ */
+bool	createManningTable(const cl_double* dManning, cl_ulong ulCellCount, sManningTable* pTable)
+{
+	std::map<cl_double, cl_uchar>	mClasses;
+
+	pTable->Class = (cl_uchar*)allocateAligned(ulCellCount * sizeof(cl_uchar));
+	pTable->Coefficients = new sManningClass[MANNING_CLASSES];
+	pTable->ClassCount = 0;
+
+	for (cl_ulong i = 0; i < ulCellCount; i++)
+	{
+		std::map<cl_double, cl_uchar>::iterator itClass = mClasses.find(dManning[i]);
+		if (itClass == mClasses.end())
+		{
+			if (pTable->ClassCount == MANNING_CLASSES)
+			{
+				std::cout << "More than " << MANNING_CLASSES << " Manning values, cannot use land-use classes" << std::endl;
+				freeManningTable(pTable);
+				return false;
+			}
+
+			cl_double dN = dManning[i];
+			pTable->Coefficients[pTable->ClassCount] = { dN, 1 / dN, GRAVITY * dN * dN };
+			itClass = mClasses.insert(std::make_pair(dN, (cl_uchar)pTable->ClassCount++)).first;
+		}
+		pTable->Class[i] = itClass->second;
+	}
+
+	return true;
+}
+
+void	freeManningTable(sManningTable* pTable)
+{
+	freeAligned(pTable->Class);
+	delete[] pTable->Coefficients;
+	pTable->Class = NULL;
+	pTable->Coefficients = NULL;
+	pTable->ClassCount = 0;
+}
+
+/*
+ *  Flow state map from the flags of every cell, each tile of uiTileSize
+ *  cells given the cheapest code path valid for all of its interior cells.
+ *  A flow element next to a cell that is not one needs the flags to close
+ *  that face, so its tile takes the general path.
+ *  False when a cell has flags outside the FLOW_ bits.
+ */
+bool	createFlowStates(const sDomainConfiguration& pDomain, const cl_uchar* ucFlags, cl_uint2 uiTileSize, sFlowStates* pStates)
+{
+	pStates->TileSize = uiTileSize;
+	pStates->TilesX = (pDomain.Cols + uiTileSize.s[0] - 1) / uiTileSize.s[0];
+	pStates->TilesY = (pDomain.Rows + uiTileSize.s[1] - 1) / uiTileSize.s[1];
+	pStates->Cell = (cl_uchar*)allocateAligned(pDomain.CellCount * sizeof(cl_uchar));
+	pStates->Tile = new cl_uchar[pStates->TilesX * pStates->TilesY];
+
+	cl_ulong	ulTileCount = pStates->TilesX * pStates->TilesY;
+	std::vector<cl_uchar>	ucFlowCells(ulTileCount, 0), ucOtherCells(ulTileCount, 0);
+
+	for (cl_ulong i = 0; i < pDomain.CellCount; i++)
+	{
+		cl_uchar	ucCell = ucFlags[i];
+		cl_ulong	ulX = i % pDomain.Cols;
+		cl_ulong	ulY = i / pDomain.Cols;
+
+		if (ucCell & ~(FLOW_ELEMENT | FLOW_NOFLOW_X | FLOW_NOFLOW_Y | FLOW_POLDER_X | FLOW_POLDER_Y))
+		{
+			std::cout << "createFlowStates error: Invalid flow state " << (int)ucCell << " of cell " << i << std::endl;
+			freeFlowStates(pStates);
+			return false;
+		}
+		pStates->Cell[i] = ucCell;
+
+		// The outer ring is never updated and leaves the tile path as it is
+		if (ulX == 0 || ulY == 0 || ulX == pDomain.Cols - 1 || ulY == pDomain.Rows - 1)
+			continue;
+
+		cl_ulong	ulTile = (ulY / uiTileSize.s[1]) * pStates->TilesX + ulX / uiTileSize.s[0];
+		ucFlowCells[ulTile] |= (ucCell & FLOW_ELEMENT) ? 1 : 0;
+		ucOtherCells[ulTile] |= ucCell != FLOW_ELEMENT ? 1 : 0;
+		ucOtherCells[ulTile] |= (ucCell & FLOW_ELEMENT) &&
+			!(ucFlags[i - 1] & ucFlags[i + 1] & ucFlags[i - pDomain.Cols] & ucFlags[i + pDomain.Cols] & FLOW_ELEMENT) ? 1 : 0;
+	}
+
+	for (cl_ulong ulTile = 0; ulTile < ulTileCount; ulTile++)
+	{
+		if (!ucFlowCells[ulTile])
+			pStates->Tile[ulTile] = FLOWTILE_NONE;
+		else if (!ucOtherCells[ulTile])
+			pStates->Tile[ulTile] = FLOWTILE_DIFFUSIVE;
+		else
+			pStates->Tile[ulTile] = FLOWTILE_GENERAL;
+	}
+
+	return true;
+}
+
+void	freeFlowStates(sFlowStates* pStates)
+{
+	freeAligned(pStates->Cell);
+	delete[] pStates->Tile;
+	pStates->Cell = NULL;
+	pStates->Tile = NULL;
+}
+
+/*
+ *  Static values of the east and north face of every cell, those past the
+ *  edge of the domain are never read. False for an unknown storage.
+ */
+bool	createFaceGeometry(cl_ulong ulRows, cl_ulong ulCols, const cl_double* dBedElevation, const cl_double* dManning, cl_uchar ucStorage, sFaceGeometry* pGeometry)
+{
+	pGeometry->Storage = ucStorage;
+	pGeometry->InvManningE = NULL;
+	pGeometry->InvManningN = NULL;
+	pGeometry->BedMaxE = NULL;
+	pGeometry->BedMaxN = NULL;
+
+	if (ucStorage > FACE_GEOMETRY_FULL)
+	{
+		std::cout << "createFaceGeometry error: Invalid storage " << (int)ucStorage << std::endl;
+		return false;
+	}
+	if (ucStorage == FACE_GEOMETRY_NONE)
+		return true;
+
+	cl_ulong	ulCellCount = ulRows * ulCols;
+	pGeometry->InvManningE = (cl_double*)allocateAligned(ulCellCount * sizeof(cl_double));
+	pGeometry->InvManningN = (cl_double*)allocateAligned(ulCellCount * sizeof(cl_double));
+	if (ucStorage == FACE_GEOMETRY_FULL)
+	{
+		pGeometry->BedMaxE = (cl_double*)allocateAligned(ulCellCount * sizeof(cl_double));
+		pGeometry->BedMaxN = (cl_double*)allocateAligned(ulCellCount * sizeof(cl_double));
+	}
+
+	for (cl_ulong i = 0; i < ulCellCount; i++)
+	{
+		cl_ulong	ulE = (i % ulCols == ulCols - 1) ? i : i + 1;
+		cl_ulong	ulN = (i / ulCols == ulRows - 1) ? i : i + ulCols;
+
+		pGeometry->InvManningE[i] = 0.5 * (1 / dManning[i] + 1 / dManning[ulE]);
+		pGeometry->InvManningN[i] = 0.5 * (1 / dManning[i] + 1 / dManning[ulN]);
+		if (ucStorage == FACE_GEOMETRY_FULL)
+		{
+			pGeometry->BedMaxE[i] = std::max(dBedElevation[i], dBedElevation[ulE]);
+			pGeometry->BedMaxN[i] = std::max(dBedElevation[i], dBedElevation[ulN]);
+		}
+	}
+
+	return true;
+}
+
+void	freeFaceGeometry(sFaceGeometry* pGeometry)
+{
+	freeAligned(pGeometry->InvManningE);
+	freeAligned(pGeometry->InvManningN);
+	freeAligned(pGeometry->BedMaxE);
+	freeAligned(pGeometry->BedMaxN);
+	pGeometry->InvManningE = NULL;
+	pGeometry->InvManningN = NULL;
+	pGeometry->BedMaxE = NULL;
+	pGeometry->BedMaxN = NULL;
+	pGeometry->Storage = FACE_GEOMETRY_NONE;
 }
@@ -8,8 +8,91 @@
 #pragma once
 #include "definitions.h"
 
+//Management functions for a Cartesian domain.
 
-cl_ulong	getNeighbourID(cl_ulong, cl_uchar);
-cl_ulong	getNeighbourByIndices(cl_long, cl_long, cl_uchar);
-cl_ulong	getCellID(cl_long, cl_long);
-void		getCellIndices(cl_ulong, cl_long*, cl_long*);
\ No newline at end of file
+sDomainConfiguration	createDomain(cl_ulong, cl_ulong, cl_double, cl_double);
+bool					readDomainConfiguration(const char*, sDomainConfiguration*);
+bool					isDomainCompiled(const sDomainConfiguration&);
+sDomainCompiled			getDomainCompiled(const sDomainConfiguration&);
+bool					createDomainPartition(const sDomainConfiguration&, int, int, sDomainPartition*);
+
+void*					allocateAligned(size_t);
+void					freeAligned(void*);
+sCellStateSoA			allocateCellStateSoA(cl_ulong);
+void					freeCellStateSoA(sCellStateSoA*);
+void					copyCellStateToSoA(cl_double4*, sCellStateSoA, cl_ulong);
+void					copyCellStateFromSoA(sCellStateSoA, cl_double4*, cl_ulong);
+bool					createManningTable(const cl_double*, cl_ulong, sManningTable*);
+void					freeManningTable(sManningTable*);
+bool					createFlowStates(const sDomainConfiguration&, const cl_uchar*, cl_uint2, sFlowStates*);
+void					freeFlowStates(sFlowStates*);
+bool					createFaceGeometry(cl_ulong, cl_ulong, const cl_double*, const cl_double*, cl_uchar, sFaceGeometry*);
+void					freeFaceGeometry(sFaceGeometry*);
+
+ /*
+  *  Fetch the ID for a cell using its X and Y indices
+  */
+template <typename TDomain>
+inline cl_ulong	getCellID(const TDomain& pDomain, cl_long lIdxX, cl_long lIdxY)
+{
+	cl_long	lCols = pDomain.Cols;
+	return (lIdxY * lCols) + lIdxX;
+}
+
+/*
+ *  Fetch the X and Y indices for a cell using its ID
+ */
+template <typename TDomain>
+inline void	getCellIndices(const TDomain& pDomain, cl_ulong ulID, cl_long* lIdxX, cl_long* lIdxY)
+{
+	*lIdxX = ulID % pDomain.Cols;
+	*lIdxY = (ulID - *lIdxX) / pDomain.Cols;
+}
+
+/*
+ *  Fetch the ID for a neighbouring cell in the domain
+ */
+template <typename TDomain>
+inline cl_ulong	getNeighbourByIndices(const TDomain& pDomain, cl_long lIdxX, cl_long lIdxY, cl_uchar ucDirection)
+{
+	switch (ucDirection)
+	{
+	case DOMAIN_DIR_N:
+		++lIdxY;
+		break;
+	case DOMAIN_DIR_E:
+		++lIdxX;
+		break;
+	case DOMAIN_DIR_S:
+		--lIdxY;
+		break;
+	case DOMAIN_DIR_W:
+		--lIdxX;
+		break;
+	}
+
+	return getCellID(pDomain, lIdxX, lIdxY);
+}
+
+/*
+ *  Fetch the ID for a neighbouring cell in the domain
+ */
+template <typename TDomain>
+inline cl_ulong	getNeighbourID(const TDomain& pDomain, cl_ulong ulCellID, cl_uchar ucDirection)
+{
+	cl_long lIdxX = 0;
+	cl_long lIdxY = 0;
+	getCellIndices(pDomain, ulCellID, &lIdxX, &lIdxY);
+
+	return getNeighbourByIndices(pDomain, lIdxX, lIdxY, ucDirection);
+}
+
+/*
+ *  State of the tile holding a cell, every tile is active without a map
+ */
+inline cl_uchar	getTileState(const sTileActivity* pActivity, cl_long lIdxX, cl_long lIdxY)
+{
+	if (pActivity == NULL)
+		return TILE_ACTIVE;
+	return pActivity->State[(lIdxY / pActivity->TileSize.s[1]) * pActivity->TilesX + lIdxX / pActivity->TileSize.s[0]];
+}
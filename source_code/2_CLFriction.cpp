@@ -18,6 +18,20 @@ cl_double4 implicitFriction(
 	cl_double		dManningCoefficient,
 	cl_double		dLclTimestep
 )
+{
+	return implicitFrictionCoefficient(pCellState, dBedElevation, GRAVITY * dManningCoefficient * dManningCoefficient, dLclTimestep);
+}
+
+/*
+ *  Point-implicit friction with g * n^2 already computed, as held by the
+ *  Manning class table
+ */
+cl_double4 implicitFrictionCoefficient(
+	cl_double4		pCellState,
+	cl_double		dBedElevation,
+	cl_double		dGravityManning2,
+	cl_double		dLclTimestep
+)
 {
 	cl_double		dDepth, dQ;
 
@@ -29,7 +43,7 @@ cl_double4 implicitFriction(
 	if (dDepth < VERY_SMALL || dQ < VERY_SMALL) return pCellState;
 
 	// Coefficient of friction, etc. See Liang (2010)
-	cl_double		dCf = (GRAVITY * dManningCoefficient * dManningCoefficient) / (pow((cl_double)dDepth, (cl_double)(1.0 / 3.0)));
+	cl_double		dCf = dGravityManning2 / (pow((cl_double)dDepth, (cl_double)(1.0 / 3.0)));
 	cl_double		dSfx = (-dCf / (dDepth * dDepth)) * pCellState.z * dQ;
 	cl_double		dSfy = (-dCf / (dDepth * dDepth)) * pCellState.w * dQ;
 	cl_double		dDx = 1.0 + dLclTimestep * (dCf / (dDepth * dDepth)) * (2 * (pCellState.z * pCellState.z) + (pCellState.w * pCellState.w)) / dQ;
@@ -61,14 +75,18 @@ cl_double4 implicitFriction(
 }
 
 /*
- *  Adjust the discharge with regard to friction
+ *  Adjust the discharge with regard to friction, only in the active tiles
+ *  of pActivity when given, the others hold no wet cell
  */
+template <typename TDomain>
 void per_Friction(
+	const TDomain& pDomain,
 	cl_double* dTimestep,
 	cl_double4* pCellData,
 	cl_double* dBedData,
 	cl_double* dManningData,
 	cl_double* dTime,			// TODO: Remove this, only required for temp rain
+	const sTileActivity* pActivity,
 	GlobalHandlerClass ghc
 )
 {
@@ -82,14 +100,17 @@ void per_Friction(
 	cl_double		dManningCoefficient;
 
 	// Don't bother if we've gone beyond the domain bounds
-	if (lIdxX >= DOMAIN_COLS - 1 || lIdxY >= DOMAIN_ROWS - 1 || lIdxX == 0 || lIdxY == 0)
+	if (lIdxX >= (cl_long)pDomain.Cols - 1 || lIdxY >= (cl_long)pDomain.Rows - 1 || lIdxX == 0 || lIdxY == 0)
 		return;
 
 	// Also don't bother if we've gone beyond the total simulation time
 	if (dLclTimestep <= 0.0)
 		return;
 
-	ulIdx = getCellID(lIdxX, lIdxY);
+	if (getTileState(pActivity, lIdxX, lIdxY) != TILE_ACTIVE)
+		return;
+
+	ulIdx = getCellID(pDomain, lIdxX, lIdxY);
 	pCellState = pCellData[ulIdx];
 	dBedElevation = dBedData[ulIdx];
 	dManningCoefficient = dManningData[ulIdx];
@@ -111,3 +132,106 @@ void per_Friction(
 
 	pCellData[ulIdx] = pCellState;
 }
+
+/*
+ *  Friction for an ensemble state, each member with its own Manning value
+ */
+template <typename TDomain>
+void per_FrictionEnsemble(
+	const TDomain& pDomain,
+	cl_double* dTimestep,
+	cl_uint uiMembers,
+	sCellStateSoA pCellData,
+	cl_double* dBedData,
+	cl_double* dManningData,			// Member-minor, as the state
+	GlobalHandlerClass ghc
+)
+{
+	cl_double		dLclTimestep = *dTimestep;
+	cl_long		lIdxX = ghc.get_global_id(0);
+	cl_long		lIdxY = ghc.get_global_id(1);
+	cl_ulong		ulIdx;
+
+	// Don't bother if we've gone beyond the domain bounds
+	if (lIdxX >= (cl_long)pDomain.Cols - 1 || lIdxY >= (cl_long)pDomain.Rows - 1 || lIdxX == 0 || lIdxY == 0)
+		return;
+
+	// Also don't bother if we've gone beyond the total simulation time
+	if (dLclTimestep <= 0.0)
+		return;
+
+	ulIdx = getCellID(pDomain, lIdxX, lIdxY);
+	cl_double		dBedElevation = dBedData[ulIdx];
+
+	for (cl_uint m = 0; m < uiMembers; m++)
+	{
+		cl_ulong	ulMember = ulIdx * uiMembers + m;
+		cl_double4	pCellState = { pCellData.Z[ulMember], pCellData.Zmax[ulMember], pCellData.Qx[ulMember], pCellData.Qy[ulMember] };
+
+		if (pCellState.x - dBedElevation < VERY_SMALL)
+			continue;
+
+		pCellState = implicitFriction(
+			pCellState,
+			dBedElevation,
+			dManningData[ulMember],
+			dLclTimestep
+		);
+
+		pCellData.Z[ulMember] = pCellState.x;
+		pCellData.Zmax[ulMember] = pCellState.y;
+		pCellData.Qx[ulMember] = pCellState.z;
+		pCellData.Qy[ulMember] = pCellState.w;
+	}
+}
+
+/*
+ *  Friction with the Manning coefficient of each cell's land-use class
+ */
+template <typename TDomain>
+void per_FrictionClasses(
+	const TDomain& pDomain,
+	cl_double* dTimestep,
+	cl_double4* pCellData,
+	cl_double* dBedData,
+	const sManningTable* pManning,
+	GlobalHandlerClass ghc
+)
+{
+	cl_double		dLclTimestep = *dTimestep;
+	cl_long		lIdxX = ghc.get_global_id(0);
+	cl_long		lIdxY = ghc.get_global_id(1);
+	cl_ulong		ulIdx;
+
+	cl_double4	pCellState;
+	cl_double		dBedElevation;
+
+	// Don't bother if we've gone beyond the domain bounds
+	if (lIdxX >= (cl_long)pDomain.Cols - 1 || lIdxY >= (cl_long)pDomain.Rows - 1 || lIdxX == 0 || lIdxY == 0)
+		return;
+
+	// Also don't bother if we've gone beyond the total simulation time
+	if (dLclTimestep <= 0.0)
+		return;
+
+	ulIdx = getCellID(pDomain, lIdxX, lIdxY);
+	pCellState = pCellData[ulIdx];
+	dBedElevation = dBedData[ulIdx];
+
+	if (pCellState.x - dBedElevation < VERY_SMALL)
+		return;
+
+	pCellData[ulIdx] = implicitFrictionCoefficient(
+		pCellState,
+		dBedElevation,
+		pManning->Coefficients[pManning->Class[ulIdx]].GN2,
+		dLclTimestep
+	);
+}
+
+template void per_Friction<sDomainConfiguration>(const sDomainConfiguration&, cl_double*, cl_double4*, cl_double*, cl_double*, cl_double*, const sTileActivity*, GlobalHandlerClass);
+template void per_Friction<sDomainCompiled>(const sDomainCompiled&, cl_double*, cl_double4*, cl_double*, cl_double*, cl_double*, const sTileActivity*, GlobalHandlerClass);
+template void per_FrictionEnsemble<sDomainConfiguration>(const sDomainConfiguration&, cl_double*, cl_uint, sCellStateSoA, cl_double*, cl_double*, GlobalHandlerClass);
+template void per_FrictionEnsemble<sDomainCompiled>(const sDomainCompiled&, cl_double*, cl_uint, sCellStateSoA, cl_double*, cl_double*, GlobalHandlerClass);
+template void per_FrictionClasses<sDomainConfiguration>(const sDomainConfiguration&, cl_double*, cl_double4*, cl_double*, const sManningTable*, GlobalHandlerClass);
+template void per_FrictionClasses<sDomainCompiled>(const sDomainCompiled&, cl_double*, cl_double4*, cl_double*, const sManningTable*, GlobalHandlerClass);
@@ -10,12 +10,37 @@
 
 //Calculate the timestep using a reduction procedure and increment the total model time.
 
+template <typename TDomain>
 void per_Friction(
+	const TDomain&,
 	cl_double*,
 	cl_double4*,
 	cl_double*,
 	cl_double*,
-	cl_double* 
+	cl_double*,
+	const sTileActivity*,
+	GlobalHandlerClass
+);
+
+template <typename TDomain>
+void per_FrictionEnsemble(
+	const TDomain&,
+	cl_double*,
+	cl_uint,
+	sCellStateSoA,
+	cl_double*,
+	cl_double*,
+	GlobalHandlerClass
+);
+
+template <typename TDomain>
+void per_FrictionClasses(
+	const TDomain&,
+	cl_double*,
+	cl_double4*,
+	cl_double*,
+	const sManningTable*,
+	GlobalHandlerClass
 );
 
 cl_double4 implicitFriction(
@@ -23,4 +48,11 @@ cl_double4 implicitFriction(
 	cl_double,
 	cl_double,
 	cl_double
+);
+
+cl_double4 implicitFrictionCoefficient(
+	cl_double4,
+	cl_double,
+	cl_double,
+	cl_double
 );
\ No newline at end of file
@@ -6,133 +6,105 @@
  */
 
 #include "3_CLSolverHLLC.h"
+#include "SimdLanes.h"
 
-#define USE_ALTERNATE_CONSTRUCTS 1
-
-// Calculate an approximate solution to the Riemann problem at the cell interface using the HLLC approach.
-
-cl_double4 riemannSolver(
-	cl_uchar	ucDirection,
+/*
+ *  Flux when both sides are dry, only the bed pressure term remains
+ */
+template <cl_uchar ucDirection>
+inline cl_double4 riemannDryFlux(
 	cl_double8		pLeft,
-	cl_double8		pRight,
-	bool		bDebug
+	cl_double8		pRight
 )
 {
-	cl_uint2	uiDirectionVector;
-	cl_double	FM_L, FM_R, F1_M, F2_M;
-	cl_double	s_L, s_R, s_M, a_Avg, H_star, U_star, A_star;
-	cl_double4	pFluxL, pFluxR, pFlux;
-	cl_double2	dVel, dDis, dA;
-	bool		bLeft, bRight, bMiddle_1, bMiddle_2;
-
-	#ifdef USE_ALTERNATE_CONSTRUCTS
-
-	cl_uint2 trail1 = { 0 , 1 };
-	cl_uint2 trail2 = { 1 , 0 };
-
-	uiDirectionVector = (ucDirection == DOMAIN_DIR_N || ucDirection == DOMAIN_DIR_S) ? trail1 : trail2;
-
-	cl_double a1;
-	cl_double a2;
-	cl_double a3;
-	cl_double a4;
-	cl_double a5;
-	cl_double a6;
-
-	a1 = (pLeft.s[0] + pRight.s[0]) / 2;
-	a2 = (pLeft.s[0] + pRight.s[0]) / 2;
-	a3 = pLeft.s[6] * (pLeft.s[0] + pRight.s[0]);
-	a4 = a2 - a3;
-	a5 = (a1 * a2 - a3) * 0.5 * 9.81;
-	a6 = 0.5 * GRAVITY * (
-		
-		((pLeft.s[0] + pRight.s[0]) / 2)     * (
-													(pLeft.s[0] + pRight.s[0]) / 2) -
-		pLeft.s[6]
-													* (pLeft.s[0] + pRight.s[0])
-		
-		
-		
+	const bool	bAlongY = ucDirection == DOMAIN_DIR_N || ucDirection == DOMAIN_DIR_S;
+	cl_double	dPressure = 0.5 * GRAVITY * (
+		((pLeft.s[0] + pRight.s[0]) / 2) * ((pLeft.s[0] + pRight.s[0]) / 2) -
+		pLeft.s[6] * (pLeft.s[0] + pRight.s[0])
 		);
 
-	// Are both sides dry? Simple solution if so...
-	if (pLeft.s[1] < VERY_SMALL && pRight.s[1] < VERY_SMALL)
-	{
-		pFlux = {
-				0.0,
-				uiDirectionVector.s[0] * 0.5 * GRAVITY * (
-				((pLeft.s[0] + pRight.s[0]) / 2) * ((pLeft.s[0] + pRight.s[0]) / 2) -
-				pLeft.s[6] * (pLeft.s[0] + pRight.s[0])
-				),
-				uiDirectionVector.s[1] * 0.5 * GRAVITY * (
-				((pLeft.s[0] + pRight.s[0]) / 2) * ((pLeft.s[0] + pRight.s[0]) / 2) -
-				pLeft.s[6] * (pLeft.s[0] + pRight.s[0])
-				),
-				0.0
-		};
-
-		return pFlux;
-	}
-	#else
-	uiDirectionVector = ((ucDirection == DOMAIN_DIR_N || ucDirection == DOMAIN_DIR_S) ? cl_uint2({ 0, 1 }) : cl_uint2({ 1, 0 }));
+	cl_double4 pFlux = {
+		0.0,
+		bAlongY ? 0.0 : dPressure,
+		bAlongY ? dPressure : 0.0,
+		0.0
+	};
 
-	// Are both sides dry? Simple solution if so...
-	if (pLeft.s[1] < VERY_SMALL && pRight.s[1] < VERY_SMALL)
-	{
-		pFlux = {
-			0.0,
-			uiDirectionVector.s[0] * 0.5 * GRAVITY * (
-				((pLeft.s[0] + pRight.s[0]) / 2) * ((pLeft.s[0] + pRight.s[0]) / 2) -
-				pLeft.s[6] * (pLeft.s[0] + pRight.s[0])
-				),
-			uiDirectionVector.s[1] * 0.5 * GRAVITY * (
-				((pLeft.s[0] + pRight.s[0]) / 2) * ((pLeft.s[0] + pRight.s[0]) / 2) -
-				pLeft.s[6] * (pLeft.s[0] + pRight.s[0])
-				),
-			0.0
-			};
+	return pFlux;
+}
 
-		return pFlux;
-	}
-	#endif
+/*
+ *  Velocities, normal discharges, celerities and physical fluxes of both sides
+ *  Fills in U, V of the left and right states, zero on a dry side.
+ */
+template <cl_uchar ucDirection>
+inline void riemannSideFluxes(
+	cl_double8*		pLeft,
+	cl_double8*		pRight,
+	cl_double2*		dVel,
+	cl_double2*		dDis,
+	cl_double2*		dA,
+	cl_double4*		pFluxL,
+	cl_double4*		pFluxR
+)
+{
+	const bool	bAlongY = ucDirection == DOMAIN_DIR_N || ucDirection == DOMAIN_DIR_S;
 
 	// Is one side dry?
 	// -> Left
-	pLeft.s[4] = (pLeft.s[1] < VERY_SMALL ? 0.0 : pLeft.s[2] / pLeft.s[1]);
-	pLeft.s[5] = (pLeft.s[1] < VERY_SMALL ? 0.0 : pLeft.s[3] / pLeft.s[1]);
+	pLeft->s[4] = (pLeft->s[1] < VERY_SMALL ? 0.0 : pLeft->s[2] / pLeft->s[1]);
+	pLeft->s[5] = (pLeft->s[1] < VERY_SMALL ? 0.0 : pLeft->s[3] / pLeft->s[1]);
 
 	// -> Right
-	pRight.s[4] = (pRight.s[1] < VERY_SMALL ? 0.0 : pRight.s[2] / pRight.s[1]);
-	pRight.s[5] = (pRight.s[1] < VERY_SMALL ? 0.0 : pRight.s[3] / pRight.s[1]);
+	pRight->s[4] = (pRight->s[1] < VERY_SMALL ? 0.0 : pRight->s[2] / pRight->s[1]);
+	pRight->s[5] = (pRight->s[1] < VERY_SMALL ? 0.0 : pRight->s[3] / pRight->s[1]);
 
 	// Prerequisite calculations
-	#ifdef USE_ALTERNATE_CONSTRUCTS
-	dVel = {
-			uiDirectionVector.s[0] * pLeft.s[4] + uiDirectionVector.s[1] * pLeft.s[5],				// Left
-			uiDirectionVector.s[0] * pRight.s[4] + uiDirectionVector.s[1] * pRight.s[5]				// Right
+	*dVel = {
+		bAlongY ? pLeft->s[5] : pLeft->s[4],										// Left
+		bAlongY ? pRight->s[5] : pRight->s[4]										// Right
 	};
-	dDis = {
-			uiDirectionVector.s[0] * pLeft.s[2] + uiDirectionVector.s[1] * pLeft.s[3],				// Left
-			uiDirectionVector.s[0] * pRight.s[2] + uiDirectionVector.s[1] * pRight.s[3]				// Right
+	*dDis = {
+		bAlongY ? pLeft->s[3] : pLeft->s[2],										// Left
+		bAlongY ? pRight->s[3] : pRight->s[2]										// Right
 	};
-	dA = {
-			sqrt(GRAVITY * pLeft.s[1]),														// Left
-			sqrt(GRAVITY * pRight.s[1])														// Right
+	*dA = {
+		sqrt(GRAVITY * pLeft->s[1]),												// Left
+		sqrt(GRAVITY * pRight->s[1])												// Right
 	};
-	#else
-	dVel = {
-		uiDirectionVector.s[0] * pLeft.s[4] + uiDirectionVector.s[1] * pLeft.s[5],		// Left
-		uiDirectionVector.s[0] * pRight.s[4] + uiDirectionVector.s[1] * pRight.s[5]		// Right
-		};
-	dDis = {
-		uiDirectionVector.s[0] * pLeft.s[2] + uiDirectionVector.s[1] * pLeft.s[3],		// Left
-		uiDirectionVector.s[0] * pRight.s[2] + uiDirectionVector.s[1] * pRight.s[3]		// Right
-		};
-	dA = {
-		sqrt(GRAVITY * pLeft.s[1]),												// Left
-		sqrt(GRAVITY * pRight.s[1])													// Right
-		};
-	#endif
+
+	// Flux on left and right, the pressure term acts on the normal discharge
+	cl_double	dPressureL = 0.5 * GRAVITY * (pLeft->s[0] * pLeft->s[0] - 2 * pLeft->s[6] * pLeft->s[0]);
+	cl_double	dPressureR = 0.5 * GRAVITY * (pRight->s[0] * pRight->s[0] - 2 * pLeft->s[6] * pRight->s[0]);
+
+	*pFluxL = {
+		dDis->s[0],
+		bAlongY ? dVel->s[0] * pLeft->s[2] : dVel->s[0] * pLeft->s[2] + dPressureL,
+		bAlongY ? dVel->s[0] * pLeft->s[3] + dPressureL : dVel->s[0] * pLeft->s[3],
+		0.0
+	};
+	*pFluxR = {
+		dDis->s[1],
+		bAlongY ? dVel->s[1] * pRight->s[2] : dVel->s[1] * pRight->s[2] + dPressureR,
+		bAlongY ? dVel->s[1] * pRight->s[3] + dPressureR : dVel->s[1] * pRight->s[3],
+		0.0
+	};
+}
+
+/*
+ *  Left and right wave speed estimates, two-rarefaction star state with
+ *  the dry-bed front speed on a dry side
+ */
+inline void riemannWaveSpeeds(
+	cl_double8		pLeft,
+	cl_double8		pRight,
+	cl_double2		dVel,
+	cl_double2		dA,
+	cl_double*		s_L,
+	cl_double*		s_R
+)
+{
+	cl_double	a_Avg, H_star, U_star, A_star;
 
 	a_Avg = (dA.s[0] + dA.s[1]) / 2;
 	H_star = ((a_Avg + (dVel.s[0] - dVel.s[1]) / 4) * (a_Avg + (dVel.s[0] - dVel.s[1]) / 4)) / GRAVITY;
@@ -142,49 +114,50 @@ cl_double4 riemannSolver(
 	// Calculate speed estimates
 	if (pLeft.s[1] < VERY_SMALL)
 	{
-		s_L = dVel.s[1] - 2 * dA.s[1];
+		*s_L = dVel.s[1] - 2 * dA.s[1];
 	}
 	else {
-		s_L = (((dVel.s[0] - dA.s[0]) > (U_star - A_star)) ? (U_star - A_star) : (dVel.s[0] - dA.s[0]));
+		*s_L = (((dVel.s[0] - dA.s[0]) > (U_star - A_star)) ? (U_star - A_star) : (dVel.s[0] - dA.s[0]));
 	}
 	if (pRight.s[1] < VERY_SMALL)
 	{
-		s_R = dVel.s[0] + 2 * dA.s[0];
+		*s_R = dVel.s[0] + 2 * dA.s[0];
 	}
 	else {
-		s_R = (((dVel.s[1] + dA.s[1]) < (U_star + A_star)) ? (U_star + A_star) : (dVel.s[1] + dA.s[1]));
+		*s_R = (((dVel.s[1] + dA.s[1]) < (U_star + A_star)) ? (U_star + A_star) : (dVel.s[1] + dA.s[1]));
 	}
-	s_M = (s_L * pRight.s[1] * (dVel.s[1] - s_R) - s_R * pLeft.s[1] * (dVel.s[0] - s_L)) /
-		(pRight.s[1] * (dVel.s[1] - s_R) - pLeft.s[1] * (dVel.s[0] - s_L));
+}
 
-	// Flux on left and right
-	#ifdef USE_ALTERNATE_CONSTRUCTS
-	pFluxL = {
-						dDis.s[0],
-						dVel.s[0] * pLeft.s[2] + uiDirectionVector.s[0] * 0.5 * GRAVITY * (pLeft.s[0] * pLeft.s[0] - 2 * pLeft.s[6] * pLeft.s[0]),
-						dVel.s[0] * pLeft.s[3] + uiDirectionVector.s[1] * 0.5 * GRAVITY * (pLeft.s[0] * pLeft.s[0] - 2 * pLeft.s[6] * pLeft.s[0]),
-						0.0
-	};
-	pFluxR = {
-						dDis.s[1],
-						dVel.s[1] * pRight.s[2] + uiDirectionVector.s[0] * 0.5 * GRAVITY * (pRight.s[0] * pRight.s[0] - 2 * pLeft.s[6] * pRight.s[0]),
-						dVel.s[1] * pRight.s[3] + uiDirectionVector.s[1] * 0.5 * GRAVITY * (pRight.s[0] * pRight.s[0] - 2 * pLeft.s[6] * pRight.s[0]),
-						0.0
-	};
+// Calculate an approximate solution to the Riemann problem at the cell interface using the HLLC approach.
+// The direction is a template parameter, the normal and tangential components are picked at compile time.
+
+template <cl_uchar ucDirection>
+cl_double4 riemannSolver(
+	cl_double8		pLeft,
+	cl_double8		pRight,
+	#ifdef DEBUG_OUTPUT
+	bool		bDebug
 	#else
-	pFluxL = {
-		dDis.s[0],
-		dVel.s[0] * pLeft.s[2] + uiDirectionVector.s[0] * 0.5 * GRAVITY * (pLeft.s[0] * pLeft.s[0] - 2 * pLeft.s[6] * pLeft.s[0]),
-		dVel.s[0] * pLeft.s[3] + uiDirectionVector.s[1] * 0.5 * GRAVITY * (pLeft.s[0] * pLeft.s[0] - 2 * pLeft.s[6] * pLeft.s[0]),
-		0.0
-		};
-	pFluxR = {
-		dDis.s[1],
-		dVel.s[1] * pRight.s[2] + uiDirectionVector.s[0] * 0.5 * GRAVITY * (pRight.s[0] * pRight.s[0] - 2 * pLeft.s[6] * pRight.s[0]),
-		dVel.s[1] * pRight.s[3] + uiDirectionVector.s[1] * 0.5 * GRAVITY * (pRight.s[0] * pRight.s[0] - 2 * pLeft.s[6] * pRight.s[0]),
-		0.0
-		};
+	bool		/*bDebug*/
 	#endif
+)
+{
+	const bool	bAlongY = ucDirection == DOMAIN_DIR_N || ucDirection == DOMAIN_DIR_S;
+	cl_double	FM_L, FM_R, F1_M, F2_M;
+	cl_double	s_L, s_R, s_M;
+	cl_double4	pFluxL, pFluxR, pFlux;
+	cl_double2	dVel, dDis, dA;
+	bool		bLeft, bRight, bMiddle_1, bMiddle_2;
+
+	// Are both sides dry? Simple solution if so...
+	if (pLeft.s[1] < VERY_SMALL && pRight.s[1] < VERY_SMALL)
+		return riemannDryFlux<ucDirection>(pLeft, pRight);
+
+	riemannSideFluxes<ucDirection>(&pLeft, &pRight, &dVel, &dDis, &dA, &pFluxL, &pFluxR);
+	riemannWaveSpeeds(pLeft, pRight, dVel, dA, &s_L, &s_R);
+
+	s_M = (s_L * pRight.s[1] * (dVel.s[1] - s_R) - s_R * pLeft.s[1] * (dVel.s[0] - s_L)) /
+		(pRight.s[1] * (dVel.s[1] - s_R) - pLeft.s[1] * (dVel.s[0] - s_L));
 
 	// Selection of the final result
 	bLeft = s_L >= 0.0;
@@ -213,53 +186,342 @@ cl_double4 riemannSolver(
 		return pFluxR;
 	}
 
-	FM_L = uiDirectionVector.s[0] * pFluxL.y + uiDirectionVector.s[1] * pFluxL.z;
-	FM_R = uiDirectionVector.s[0] * pFluxR.y + uiDirectionVector.s[1] * pFluxR.z;
+	FM_L = bAlongY ? pFluxL.z : pFluxL.y;
+	FM_R = bAlongY ? pFluxR.z : pFluxR.y;
 	F1_M = (s_R * pFluxL.x - s_L * pFluxR.x + s_L * s_R * (pRight.s[0] - pLeft.s[0])) / (s_R - s_L);
 	F2_M = (s_R * FM_L - s_L * FM_R + s_L * s_R * (dDis.s[1] - dDis.s[0])) / (s_R - s_L);
 
-	#ifdef USE_ALTERNATE_CONSTRUCTS
 	if (bMiddle_1)
 	{
 		pFlux = {
 			F1_M,
-			uiDirectionVector.s[0] * F2_M + uiDirectionVector.s[1] * F1_M * pLeft.s[4],
-			uiDirectionVector.s[0] * F1_M * pLeft.s[5] + uiDirectionVector.s[1] * F2_M,
+			bAlongY ? F1_M * pLeft.s[4] : F2_M,
+			bAlongY ? F2_M : F1_M * pLeft.s[5],
 			0.0
-		};
+			};
 	}
-
-	if (bMiddle_2)
-	{
+	else {
 		pFlux = {
 			F1_M,
-			uiDirectionVector.s[0] * F2_M + uiDirectionVector.s[1] * F1_M * pRight.s[4],
-			uiDirectionVector.s[0] * F1_M * pRight.s[5] + uiDirectionVector.s[1] * F2_M,
+			bAlongY ? F1_M * pRight.s[4] : F2_M,
+			bAlongY ? F2_M : F1_M * pRight.s[5],
 			0.0
-		};
+			};
 	}
-	#else
-	if (bMiddle_1)
+
+	return pFlux;
+}
+
+/*
+ *  HLL solution, a single star state between the HLLC wave speeds
+ *  Diffuses the tangential discharge across contact waves but skips the
+ *  middle wave speed and the two-way star selection.
+ */
+template <cl_uchar ucDirection>
+cl_double4 riemannSolverHLL(
+	cl_double8		pLeft,
+	cl_double8		pRight,
+	bool			/*bDebug*/
+)
+{
+	cl_double	s_L, s_R;
+	cl_double4	pFluxL, pFluxR, pFlux;
+	cl_double2	dVel, dDis, dA;
+
+	if (pLeft.s[1] < VERY_SMALL && pRight.s[1] < VERY_SMALL)
+		return riemannDryFlux<ucDirection>(pLeft, pRight);
+
+	riemannSideFluxes<ucDirection>(&pLeft, &pRight, &dVel, &dDis, &dA, &pFluxL, &pFluxR);
+	riemannWaveSpeeds(pLeft, pRight, dVel, dA, &s_L, &s_R);
+
+	if (s_L >= 0.0)
+		return pFluxL;
+	if (s_R < 0.0)
+		return pFluxR;
+
+	pFlux = {
+		(s_R * pFluxL.x - s_L * pFluxR.x + s_L * s_R * (pRight.s[0] - pLeft.s[0])) / (s_R - s_L),
+		(s_R * pFluxL.y - s_L * pFluxR.y + s_L * s_R * (pRight.s[2] - pLeft.s[2])) / (s_R - s_L),
+		(s_R * pFluxL.z - s_L * pFluxR.z + s_L * s_R * (pRight.s[3] - pLeft.s[3])) / (s_R - s_L),
+		0.0
+	};
+
+	return pFlux;
+}
+
+/*
+ *  Rusanov (local Lax-Friedrichs) solution, central flux plus dissipation
+ *  scaled by the fastest wave on either side
+ */
+template <cl_uchar ucDirection>
+cl_double4 riemannSolverRusanov(
+	cl_double8		pLeft,
+	cl_double8		pRight,
+	bool			/*bDebug*/
+)
+{
+	cl_double	s_Max;
+	cl_double4	pFluxL, pFluxR, pFlux;
+	cl_double2	dVel, dDis, dA;
+
+	if (pLeft.s[1] < VERY_SMALL && pRight.s[1] < VERY_SMALL)
+		return riemannDryFlux<ucDirection>(pLeft, pRight);
+
+	riemannSideFluxes<ucDirection>(&pLeft, &pRight, &dVel, &dDis, &dA, &pFluxL, &pFluxR);
+
+	s_Max = std::max(fabs(dVel.s[0]) + dA.s[0], fabs(dVel.s[1]) + dA.s[1]);
+
+	pFlux = {
+		0.5 * (pFluxL.x + pFluxR.x) - 0.5 * s_Max * (pRight.s[0] - pLeft.s[0]),
+		0.5 * (pFluxL.y + pFluxR.y) - 0.5 * s_Max * (pRight.s[2] - pLeft.s[2]),
+		0.5 * (pFluxL.z + pFluxR.z) - 0.5 * s_Max * (pRight.s[3] - pLeft.s[3]),
+		0.0
+	};
+
+	return pFlux;
+}
+
+/*
+ *  Solvers for a direction only known at run time
+ */
+cl_double4 riemannSolver(
+	cl_uchar		ucDirection,
+	cl_double8		pLeft,
+	cl_double8		pRight,
+	bool			bDebug
+)
+{
+	switch (ucDirection)
 	{
-		pFlux = {
-			F1_M,
-			uiDirectionVector.s[0] * F2_M + uiDirectionVector.s[1] * F1_M * pLeft.s[4],
-			uiDirectionVector.s[0] * F1_M * pLeft.s[5] + uiDirectionVector.s[1] * F2_M,
-			0.0
-			};
+	case DOMAIN_DIR_N: return riemannSolver<DOMAIN_DIR_N>(pLeft, pRight, bDebug);
+	case DOMAIN_DIR_E: return riemannSolver<DOMAIN_DIR_E>(pLeft, pRight, bDebug);
+	case DOMAIN_DIR_S: return riemannSolver<DOMAIN_DIR_S>(pLeft, pRight, bDebug);
+	default: return riemannSolver<DOMAIN_DIR_W>(pLeft, pRight, bDebug);
 	}
+}
 
-	if (bMiddle_2)
+cl_double4 riemannSolverHLL(
+	cl_uchar		ucDirection,
+	cl_double8		pLeft,
+	cl_double8		pRight,
+	bool			bDebug
+)
+{
+	switch (ucDirection)
 	{
-		pFlux = {
-			F1_M,
-			uiDirectionVector.s[0] * F2_M + uiDirectionVector.s[1] * F1_M * pRight.s[4],
-			uiDirectionVector.s[0] * F1_M * pRight.s[5] + uiDirectionVector.s[1] * F2_M,
-			0.0
-			};
+	case DOMAIN_DIR_N: return riemannSolverHLL<DOMAIN_DIR_N>(pLeft, pRight, bDebug);
+	case DOMAIN_DIR_E: return riemannSolverHLL<DOMAIN_DIR_E>(pLeft, pRight, bDebug);
+	case DOMAIN_DIR_S: return riemannSolverHLL<DOMAIN_DIR_S>(pLeft, pRight, bDebug);
+	default: return riemannSolverHLL<DOMAIN_DIR_W>(pLeft, pRight, bDebug);
 	}
+}
+
+cl_double4 riemannSolverRusanov(
+	cl_uchar		ucDirection,
+	cl_double8		pLeft,
+	cl_double8		pRight,
+	bool			bDebug
+)
+{
+	switch (ucDirection)
+	{
+	case DOMAIN_DIR_N: return riemannSolverRusanov<DOMAIN_DIR_N>(pLeft, pRight, bDebug);
+	case DOMAIN_DIR_E: return riemannSolverRusanov<DOMAIN_DIR_E>(pLeft, pRight, bDebug);
+	case DOMAIN_DIR_S: return riemannSolverRusanov<DOMAIN_DIR_S>(pLeft, pRight, bDebug);
+	default: return riemannSolverRusanov<DOMAIN_DIR_W>(pLeft, pRight, bDebug);
+	}
+}
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+
+/*
+ *  HLLC solution for TLanes::Width interfaces at once
+ *  Follows riemannSolver operation by operation, every branch is evaluated and
+ *  the result is picked per lane. The Qn/Qt arrays are the discharges normal
+ *  and tangential to the interface.
+ */
+template <typename TLanes>
+inline void riemannSolverLanes(
+	sRiemannStateSoA	pLeft,
+	sRiemannStateSoA	pRight,
+	const cl_double*	dLeftQn,
+	const cl_double*	dLeftQt,
+	const cl_double*	dRightQn,
+	const cl_double*	dRightQt,
+	cl_double*			dFluxZ,
+	cl_double*			dFluxQn,
+	cl_double*			dFluxQt,
+	cl_ulong			ulIdx
+)
+{
+	typedef typename TLanes::Value	V;
+	typedef typename TLanes::Mask	M;
+
+	const V vZero = TLanes::set(0.0);
+	const V vHalf = TLanes::set(0.5);
+	const V vTwo = TLanes::set(2.0);
+	const V vGravity = TLanes::set(GRAVITY);
+	const V vPressure = TLanes::set(0.5 * GRAVITY);
+
+	V vZL = TLanes::load(pLeft.Z + ulIdx);
+	V vHL = TLanes::load(pLeft.H + ulIdx);
+	V vQnL = TLanes::load(dLeftQn + ulIdx);
+	V vQtL = TLanes::load(dLeftQt + ulIdx);
+	V vZbL = TLanes::load(pLeft.Zb + ulIdx);
+	V vZR = TLanes::load(pRight.Z + ulIdx);
+	V vHR = TLanes::load(pRight.H + ulIdx);
+	V vQnR = TLanes::load(dRightQn + ulIdx);
+	V vQtR = TLanes::load(dRightQt + ulIdx);
+
+	M mDryL = TLanes::lt(vHL, TLanes::set(VERY_SMALL));
+	M mDryR = TLanes::lt(vHR, TLanes::set(VERY_SMALL));
+
+	// Both sides dry
+	V vZSum = TLanes::add(vZL, vZR);
+	V vZAvg = TLanes::mul(vZSum, vHalf);
+	V vDryQn = TLanes::mul(vPressure, TLanes::sub(TLanes::mul(vZAvg, vZAvg), TLanes::mul(vZbL, vZSum)));
+
+	// Velocities, zero on a dry side
+	V vVelL = TLanes::select(mDryL, vZero, TLanes::div(vQnL, vHL));
+	V vTanL = TLanes::select(mDryL, vZero, TLanes::div(vQtL, vHL));
+	V vVelR = TLanes::select(mDryR, vZero, TLanes::div(vQnR, vHR));
+	V vTanR = TLanes::select(mDryR, vZero, TLanes::div(vQtR, vHR));
+	V vAL = TLanes::sqrt(TLanes::mul(vGravity, vHL));
+	V vAR = TLanes::sqrt(TLanes::mul(vGravity, vHR));
+
+	V vAAvg = TLanes::mul(TLanes::add(vAL, vAR), vHalf);
+	V vStar = TLanes::add(vAAvg, TLanes::mul(TLanes::sub(vVelL, vVelR), TLanes::set(0.25)));
+	V vHStar = TLanes::div(TLanes::mul(vStar, vStar), vGravity);
+	V vUStar = TLanes::sub(TLanes::add(TLanes::mul(TLanes::add(vVelL, vVelR), vHalf), vAL), vAR);
+	V vAStar = TLanes::sqrt(TLanes::mul(vGravity, vHStar));
+
+	// Speed estimates
+	V vWaveL = TLanes::sub(vVelL, vAL);
+	V vStarL = TLanes::sub(vUStar, vAStar);
+	V vSL = TLanes::select(
+		mDryL,
+		TLanes::sub(vVelR, TLanes::mul(vTwo, vAR)),
+		TLanes::select(TLanes::gt(vWaveL, vStarL), vStarL, vWaveL)
+	);
+	V vWaveR = TLanes::add(vVelR, vAR);
+	V vStarR = TLanes::add(vUStar, vAStar);
+	V vSR = TLanes::select(
+		mDryR,
+		TLanes::add(vVelL, TLanes::mul(vTwo, vAL)),
+		TLanes::select(TLanes::lt(vWaveR, vStarR), vStarR, vWaveR)
+	);
+	V vRelL = TLanes::sub(vVelL, vSL);
+	V vRelR = TLanes::sub(vVelR, vSR);
+	V vSM = TLanes::div(
+		TLanes::sub(TLanes::mul(TLanes::mul(vSL, vHR), vRelR), TLanes::mul(TLanes::mul(vSR, vHL), vRelL)),
+		TLanes::sub(TLanes::mul(vHR, vRelR), TLanes::mul(vHL, vRelL))
+	);
+
+	// Flux on left and right
+	V vTwoZbL = TLanes::mul(vTwo, vZbL);
+	V vFluxLQn = TLanes::add(TLanes::mul(vVelL, vQnL), TLanes::mul(vPressure, TLanes::sub(TLanes::mul(vZL, vZL), TLanes::mul(vTwoZbL, vZL))));
+	V vFluxLQt = TLanes::mul(vVelL, vQtL);
+	V vFluxRQn = TLanes::add(TLanes::mul(vVelR, vQnR), TLanes::mul(vPressure, TLanes::sub(TLanes::mul(vZR, vZR), TLanes::mul(vTwoZbL, vZR))));
+	V vFluxRQt = TLanes::mul(vVelR, vQtR);
+
+	// Star region
+	V vSpan = TLanes::sub(vSR, vSL);
+	V vSLSR = TLanes::mul(vSL, vSR);
+	V vF1M = TLanes::div(
+		TLanes::add(TLanes::sub(TLanes::mul(vSR, vQnL), TLanes::mul(vSL, vQnR)), TLanes::mul(vSLSR, TLanes::sub(vZR, vZL))),
+		vSpan
+	);
+	V vF2M = TLanes::div(
+		TLanes::add(TLanes::sub(TLanes::mul(vSR, vFluxLQn), TLanes::mul(vSL, vFluxRQn)), TLanes::mul(vSLSR, TLanes::sub(vQnR, vQnL))),
+		vSpan
+	);
+
+	// Selection of the final result
+	M mLeft = TLanes::ge(vSL, vZero);
+	M mMiddle = TLanes::both(TLanes::lt(vSL, vZero), TLanes::ge(vSR, vZero));
+	M mMiddle_1 = TLanes::both(mMiddle, TLanes::ge(vSM, vZero));
+	M mDry = TLanes::both(mDryL, mDryR);
+
+	V vResultZ = TLanes::select(mMiddle, vF1M, vQnR);
+	V vResultQn = TLanes::select(mMiddle, vF2M, vFluxRQn);
+	V vResultQt = TLanes::select(mMiddle, TLanes::mul(vF1M, TLanes::select(mMiddle_1, vTanL, vTanR)), vFluxRQt);
+
+	vResultZ = TLanes::select(mLeft, vQnL, vResultZ);
+	vResultQn = TLanes::select(mLeft, vFluxLQn, vResultQn);
+	vResultQt = TLanes::select(mLeft, vFluxLQt, vResultQt);
+
+	vResultZ = TLanes::select(mDry, vZero, vResultZ);
+	vResultQn = TLanes::select(mDry, vDryQn, vResultQn);
+	vResultQt = TLanes::select(mDry, vZero, vResultQt);
+
+	TLanes::store(dFluxZ + ulIdx, vResultZ);
+	TLanes::store(dFluxQn + ulIdx, vResultQn);
+	TLanes::store(dFluxQt + ulIdx, vResultQt);
+}
+
+#endif
+
+/*
+ *  Solve ulCount interfaces facing ucDirection
+ *  Full lanes go through the widest instruction set compiled in, the
+ *  remainder and builds without AVX2 go through riemannSolver.
+ */
+void riemannSolverBatch(
+	cl_uchar			ucDirection,
+	sRiemannStateSoA	pLeft,
+	sRiemannStateSoA	pRight,
+	sRiemannFluxSoA		pFlux,
+	cl_ulong			ulCount
+)
+{
+	cl_ulong ulIdx = 0;
+
+	#if defined(__AVX512F__) || defined(__AVX2__)
+	// The normal discharge is Qx on east/west faces and Qy on north/south faces
+	bool bAlongY = ucDirection == DOMAIN_DIR_N || ucDirection == DOMAIN_DIR_S;
+	const cl_double* dLeftQn = bAlongY ? pLeft.Qy : pLeft.Qx;
+	const cl_double* dLeftQt = bAlongY ? pLeft.Qx : pLeft.Qy;
+	const cl_double* dRightQn = bAlongY ? pRight.Qy : pRight.Qx;
+	const cl_double* dRightQt = bAlongY ? pRight.Qx : pRight.Qy;
+	cl_double* dFluxQn = bAlongY ? pFlux.Qy : pFlux.Qx;
+	cl_double* dFluxQt = bAlongY ? pFlux.Qx : pFlux.Qy;
+
+	for (; ulIdx + sLanesNative::Width <= ulCount; ulIdx += sLanesNative::Width)
+		riemannSolverLanes<sLanesNative>(pLeft, pRight, dLeftQn, dLeftQt, dRightQn, dRightQt, pFlux.Z, dFluxQn, dFluxQt, ulIdx);
 	#endif
 
-	return pFlux;
+	for (; ulIdx < ulCount; ulIdx++)
+	{
+		cl_double8 pStateLeft = { pLeft.Z[ulIdx], pLeft.H[ulIdx], pLeft.Qx[ulIdx], pLeft.Qy[ulIdx], 0.0, 0.0, pLeft.Zb[ulIdx], 0.0 };
+		cl_double8 pStateRight = { pRight.Z[ulIdx], pRight.H[ulIdx], pRight.Qx[ulIdx], pRight.Qy[ulIdx], 0.0, 0.0, pLeft.Zb[ulIdx], 0.0 };
+		cl_double4 pFluxLane = riemannSolver(ucDirection, pStateLeft, pStateRight, false);
+		pFlux.Z[ulIdx] = pFluxLane.x;
+		pFlux.Qx[ulIdx] = pFluxLane.y;
+		pFlux.Qy[ulIdx] = pFluxLane.z;
+	}
+}
+
+/*
+ *  Number of interfaces riemannSolverBatch solves per instruction
+ */
+cl_uint riemannSolverBatchWidth()
+{
+	#if defined(__AVX512F__) || defined(__AVX2__)
+	return sLanesNative::Width;
+	#else
+	return 1;
+	#endif
 }
 
+template cl_double4 riemannSolver<DOMAIN_DIR_N>(cl_double8, cl_double8, bool);
+template cl_double4 riemannSolver<DOMAIN_DIR_E>(cl_double8, cl_double8, bool);
+template cl_double4 riemannSolver<DOMAIN_DIR_S>(cl_double8, cl_double8, bool);
+template cl_double4 riemannSolver<DOMAIN_DIR_W>(cl_double8, cl_double8, bool);
+template cl_double4 riemannSolverHLL<DOMAIN_DIR_N>(cl_double8, cl_double8, bool);
+template cl_double4 riemannSolverHLL<DOMAIN_DIR_E>(cl_double8, cl_double8, bool);
+template cl_double4 riemannSolverHLL<DOMAIN_DIR_S>(cl_double8, cl_double8, bool);
+template cl_double4 riemannSolverHLL<DOMAIN_DIR_W>(cl_double8, cl_double8, bool);
+template cl_double4 riemannSolverRusanov<DOMAIN_DIR_N>(cl_double8, cl_double8, bool);
+template cl_double4 riemannSolverRusanov<DOMAIN_DIR_E>(cl_double8, cl_double8, bool);
+template cl_double4 riemannSolverRusanov<DOMAIN_DIR_S>(cl_double8, cl_double8, bool);
+template cl_double4 riemannSolverRusanov<DOMAIN_DIR_W>(cl_double8, cl_double8, bool);
@@ -8,7 +8,8 @@
 #pragma once
 #include "definitions.h"
 
-//Implementation of the approximate HLLC Riemann solver for the GPU.
+//Implementation of the approximate HLLC Riemann solver for the GPU,
+//with HLL and Rusanov alternatives for low Froude number flows.
 
 #ifdef USE_FUNCTION_STUBS
 
@@ -20,4 +21,67 @@ cl_double4	riemannSolver(
 	bool
 );
 
-#endif
\ No newline at end of file
+#endif
+
+cl_double4 riemannSolverHLL(cl_uchar, cl_double8, cl_double8, bool);
+cl_double4 riemannSolverRusanov(cl_uchar, cl_double8, cl_double8, bool);
+
+// Solvers specialised on the DOMAIN_DIR_ of the interface
+template <cl_uchar ucDirection> cl_double4 riemannSolver(cl_double8, cl_double8, bool);
+template <cl_uchar ucDirection> cl_double4 riemannSolverHLL(cl_double8, cl_double8, bool);
+template <cl_uchar ucDirection> cl_double4 riemannSolverRusanov(cl_double8, cl_double8, bool);
+
+// Riemann solvers the scheme can be instantiated with, selected per run
+#define RIEMANN_SOLVER_HLLC				0
+#define RIEMANN_SOLVER_HLL				1
+#define RIEMANN_SOLVER_RUSANOV			2
+
+/*
+ *  Solver policies, solve() has the signature of riemannSolver, solve<ucDirection>()
+ *  that of its specialisation on the direction
+ */
+struct sRiemannHLLC {
+	static const cl_uchar Type = RIEMANN_SOLVER_HLLC;
+	static cl_double4 solve(cl_uchar ucDirection, cl_double8 pLeft, cl_double8 pRight, bool bDebug) { return riemannSolver(ucDirection, pLeft, pRight, bDebug); }
+	template <cl_uchar ucDirection> static cl_double4 solve(cl_double8 pLeft, cl_double8 pRight, bool bDebug) { return riemannSolver<ucDirection>(pLeft, pRight, bDebug); }
+};
+
+struct sRiemannHLL {
+	static const cl_uchar Type = RIEMANN_SOLVER_HLL;
+	static cl_double4 solve(cl_uchar ucDirection, cl_double8 pLeft, cl_double8 pRight, bool bDebug) { return riemannSolverHLL(ucDirection, pLeft, pRight, bDebug); }
+	template <cl_uchar ucDirection> static cl_double4 solve(cl_double8 pLeft, cl_double8 pRight, bool bDebug) { return riemannSolverHLL<ucDirection>(pLeft, pRight, bDebug); }
+};
+
+struct sRiemannRusanov {
+	static const cl_uchar Type = RIEMANN_SOLVER_RUSANOV;
+	static cl_double4 solve(cl_uchar ucDirection, cl_double8 pLeft, cl_double8 pRight, bool bDebug) { return riemannSolverRusanov(ucDirection, pLeft, pRight, bDebug); }
+	template <cl_uchar ucDirection> static cl_double4 solve(cl_double8 pLeft, cl_double8 pRight, bool bDebug) { return riemannSolverRusanov<ucDirection>(pLeft, pRight, bDebug); }
+};
+
+/*
+ *  Interface states stored as separate arrays, one entry per interface
+ *  Only the bed elevation of the left side is read, as in riemannSolver
+ */
+typedef struct sRiemannStateSoA {
+	cl_double* Z;
+	cl_double* H;
+	cl_double* Qx;
+	cl_double* Qy;
+	cl_double* Zb;
+} sRiemannStateSoA;
+
+typedef struct sRiemannFluxSoA {
+	cl_double* Z;
+	cl_double* Qx;
+	cl_double* Qy;
+} sRiemannFluxSoA;
+
+void riemannSolverBatch(
+	cl_uchar,
+	sRiemannStateSoA,
+	sRiemannStateSoA,
+	sRiemannFluxSoA,
+	cl_ulong
+);
+
+cl_uint riemannSolverBatchWidth();
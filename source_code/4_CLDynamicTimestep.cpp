@@ -6,6 +6,7 @@
  */
 
 #include "4_CLDynamicTimestep.h"
+#include <cstring>
 
 //Calculate the timestep using a reduction procedure and increment the total model time.
 
@@ -13,11 +14,21 @@
  *  Advance the total model time by the timestep specified
  */
 //__kernel  __attribute__((reqd_work_group_size(1, 1, 1)))
+template <typename TDomain>
 void tst_Advance_Normal(
+	#ifdef TIMESTEP_DYNAMIC
+	const TDomain& pDomain,
+	#else
+	const TDomain& /*pDomain*/,
+	#endif
 	cl_double * dTime,
 	cl_double * dTimestep,
 	cl_double * dTimeHydrological,
+	#ifdef TIMESTEP_DYNAMIC
 	cl_double * pReductionData,
+	#else
+	cl_double * /*pReductionData*/,
+	#endif
 	cl_double4 * pCellData,
 	cl_double * dBedData,
 	cl_double * dTimeSync,
@@ -71,7 +82,7 @@ void tst_Advance_Normal(
 
 	// Convert velocity to a time (assumes domain deltaX=deltaY here)
 	// Force progression at the start of a simulation.
-	dMinTime = DOMAIN_DELTAX / dMaxSpeed;
+	dMinTime = pDomain.DeltaX / dMaxSpeed;
 	if (dLclTime < TIMESTEP_START_MINIMUM_DURATION && dMinTime < TIMESTEP_START_MINIMUM)
 		dMinTime = TIMESTEP_START_MINIMUM;
 
@@ -150,97 +161,151 @@ void tst_ResetCounters(
 	*dBatchTimesteps = 0.0;
 }
 
+/*
+ *  Funnel the work-items' speeds and store the group's maximum
+ */
+inline void tst_ReduceGroup(
+	cl_double	dMaxSpeed,
+	cl_double*	pReductionData,
+	GlobalHandlerClass& ghc
+)
+{
+	// Shared by the work-group, TIMESTEP_GROUPSIZE entries
+	cl_double*	pScratchData = (cl_double*)ghc.get_local_memory();
+	cl_uint		uiLocalID = ghc.get_local_id(0);
+	cl_uint		uiLocalSize = ghc.get_local_size(0);
+
+	// Commit to local memory
+	pScratchData[uiLocalID] = dMaxSpeed;
+
+	// No progression until scratch memory is fully populated
+	ghc.barrier(CLK_LOCAL_MEM_FENCE);
+
+	// 2nd stage of the reduction process
+	// Funnelling style operation from the center
+	for (int iOffset = uiLocalSize / 2;
+		iOffset > 0;
+		iOffset = iOffset / 2)
+	{
+		if (uiLocalID < iOffset)
+		{
+			cl_double	dComparison = pScratchData[uiLocalID + iOffset];
+			cl_double	dMine = pScratchData[uiLocalID];
+			pScratchData[uiLocalID] = (dMine < dComparison) ? dComparison : dMine;
+		}
+
+		ghc.barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	// Only one workgroup to update the time
+	if (uiLocalID == 0)
+		pReductionData[ghc.get_group_id(0)] = pScratchData[0];
+}
+
 /*
  *  Reduce the timestep by calculating for each workgroup
  */
 //__kernel  REQD_WG_SIZE_LINE
+template <typename TDomain>
 void tst_Reduce(
+	const TDomain& pDomain,
 	cl_double4* pCellData,
 	cl_double* dBedData,
 	cl_double* pReductionData,
 	GlobalHandlerClass ghc
 )
 {
-	cl_double pScratchData[TIMESTEP_GROUPSIZE];
-
-	// Get global ID for cell
-	cl_uint		uiLocalID = ghc.get_local_id(0);
-	cl_uint		uiLocalSize = ghc.get_local_size(0);
-
 	cl_ulong	ulCellID = ghc.get_global_id(0);
-	cl_double4	pCellState;
-	cl_double	dBedElevation;
-	cl_double	dCellSpeed, dDepth, dVelX, dVelY;
+	cl_double	dCellSpeed;
 	cl_double	dMaxSpeed = 0.0;
 
-	while (ulCellID < DOMAIN_CELLCOUNT)
+	while (ulCellID < pDomain.CellCount)
 	{
 		// Calculate the velocity...
-		pCellState = pCellData[ulCellID];
-		dBedElevation = dBedData[ulCellID];
-
-		dDepth = pCellState.x - dBedElevation;
-
-		if (dDepth > QUITE_SMALL && pCellState.y > -9999.0)
-		{
-			#ifndef TIMESTEP_SIMPLIFIED
-
-			dVelX = pCellState.z / dDepth;
-			dVelY = pCellState.w / dDepth;
-			if (dVelX < 0.0) dVelX = -dVelX;
-			if (dVelY < 0.0) dVelY = -dVelY;
-
-			dVelX += sqrt(GRAVITY * dDepth);
-			dVelY += sqrt(GRAVITY * dDepth);
+		dCellSpeed = tst_CellSpeed(pCellData[ulCellID], dBedData[ulCellID]);
 
-			#else
+		// Is this velocity higher, therefore a greater time constraint?
+		if (dCellSpeed > dMaxSpeed)
+			dMaxSpeed = dCellSpeed;
 
-			dVelX = sqrt(GRAVITY * dDepth);
-			dVelY = sqrt(GRAVITY * dDepth);
+		// Move on to the next cell
+		ulCellID += ghc.get_global_size(0);
+	}
 
-			#endif
-			dCellSpeed = (dVelX < dVelY) ? dVelY : dVelX;
+	tst_ReduceGroup(dMaxSpeed, pReductionData, ghc);
+}
 
-		}
-		else {
-			dCellSpeed = 0.0;
-		}
+/*
+ *  Same reduction from the primitives of gts_Primitives, without the
+ *  divisions and square root of each cell
+ */
+template <typename TDomain>
+void tst_ReducePrimitives(
+	const TDomain& pDomain,
+	const cl_double4* pPrimitives,
+	cl_double* pReductionData,
+	GlobalHandlerClass ghc
+)
+{
+	cl_ulong	ulCellID = ghc.get_global_id(0);
+	cl_double	dCellSpeed;
+	cl_double	dMaxSpeed = 0.0;
 
-		// Is this velocity higher, therefore a greater time constraint?
+	while (ulCellID < pDomain.CellCount)
+	{
+		dCellSpeed = tst_PrimitiveSpeed(pPrimitives[ulCellID]);
 		if (dCellSpeed > dMaxSpeed)
 			dMaxSpeed = dCellSpeed;
-
-		// Move on to the next cell
 		ulCellID += ghc.get_global_size(0);
 	}
 
-	// Commit to local memory
-	pScratchData[uiLocalID] = dMaxSpeed;
+	tst_ReduceGroup(dMaxSpeed, pReductionData, ghc);
+}
 
-	//Alaa
-	// No progression until scratch memory is fully populated
-	//barrier(CLK_LOCAL_MEM_FENCE);
+/*
+ *  Reduce the timestep over the active tiles only, the work-items stride
+ *  over tiles instead of cells. Other tiles are dry and impose no limit.
+ */
+template <typename TDomain>
+void tst_ReduceActive(
+	const TDomain& pDomain,
+	cl_double4* pCellData,
+	cl_double* dBedData,
+	cl_double* pReductionData,
+	const sTileActivity* pActivity,
+	GlobalHandlerClass ghc
+)
+{
+	cl_ulong	ulTile = ghc.get_global_id(0);
+	cl_double	dCellSpeed;
+	cl_double	dMaxSpeed = 0.0;
 
-	// 2nd stage of the reduction process
-	// Funnelling style operation from the center
-	for (int iOffset = uiLocalSize / 2;
-		iOffset > 0;
-		iOffset = iOffset / 2)
+	while (ulTile < pActivity->TileCount)
 	{
-		if (uiLocalID < iOffset)
+		if (pActivity->State[ulTile] == TILE_ACTIVE)
 		{
-			cl_double	dComparison = pScratchData[uiLocalID + iOffset];
-			cl_double	dMine = pScratchData[uiLocalID];
-			pScratchData[uiLocalID] = (dMine < dComparison) ? dComparison : dMine;
+			cl_long lStartX = (ulTile % pActivity->TilesX) * pActivity->TileSize.s[0];
+			cl_long lStartY = (ulTile / pActivity->TilesX) * pActivity->TileSize.s[1];
+			cl_long lEndX = std::min(lStartX + (cl_long)pActivity->TileSize.s[0], (cl_long)pDomain.Cols);
+			cl_long lEndY = std::min(lStartY + (cl_long)pActivity->TileSize.s[1], (cl_long)pDomain.Rows);
+
+			for (cl_long lIdxY = lStartY; lIdxY < lEndY; lIdxY++)
+			{
+				for (cl_long lIdxX = lStartX; lIdxX < lEndX; lIdxX++)
+				{
+					cl_ulong ulCellID = getCellID(pDomain, lIdxX, lIdxY);
+					dCellSpeed = tst_CellSpeed(pCellData[ulCellID], dBedData[ulCellID]);
+					if (dCellSpeed > dMaxSpeed)
+						dMaxSpeed = dCellSpeed;
+				}
+			}
 		}
 
-		//Alaa
-		//barrier(CLK_LOCAL_MEM_FENCE);
+		// Move on to the next tile
+		ulTile += ghc.get_global_size(0);
 	}
 
-	// Only one workgroup to update the time
-	if (uiLocalID == 0)
-		pReductionData[ghc.get_group_id(0)] = pScratchData[0];
+	tst_ReduceGroup(dMaxSpeed, pReductionData, ghc);
 }
 
 /*
@@ -248,7 +313,9 @@ void tst_Reduce(
  *  Reduction will have been carried out again first.
  */
 //__kernel  __attribute__((reqd_work_group_size(1, 1, 1)))
+template <typename TDomain>
 void tst_UpdateTimestep(
+	const TDomain& pDomain,
 	cl_double* dTime,
 	cl_double* dTimestep,
 	cl_double* pReductionData,
@@ -278,7 +345,7 @@ void tst_UpdateTimestep(
 
 	// Convert velocity to a time (assumes domain deltaX=deltaY here)
 	// Force progression at the start of a simulation.
-	dMinTime = DOMAIN_DELTAX / dMaxSpeed;
+	dMinTime = pDomain.DeltaX / dMaxSpeed;
 
 	if (dLclTime < TIMESTEP_START_MINIMUM_DURATION && dMinTime < TIMESTEP_START_MINIMUM)
 		dMinTime = TIMESTEP_START_MINIMUM;
@@ -310,3 +377,131 @@ void tst_UpdateTimestep(
 	*dTimestep = dLclTimestep;
 	*dBatchTimesteps = dLclBatchTimesteps;
 }
+
+/*
+ *  Flag a state gone unstable after a step of dTimestep, as judged by
+ *  tst_CellUnstable. Disabled cells are left out.
+ */
+template <typename TDomain>
+void tst_CheckState(
+	const TDomain& pDomain,
+	cl_double* dTimestep,
+	cl_double4* pCellData,
+	cl_double* dBedData,
+	std::atomic<cl_uint>* uiUnstable,
+	GlobalHandlerClass ghc
+)
+{
+	cl_long		lIdxX = ghc.get_global_id(0);
+	cl_long		lIdxY = ghc.get_global_id(1);
+	cl_double	dLclTimestep = *dTimestep;
+	cl_ulong	ulIdx;
+	cl_double4	pCellState;
+	cl_double	dBedElevation;
+
+	if (lIdxX >= (cl_long)pDomain.Cols || lIdxY >= (cl_long)pDomain.Rows)
+		return;
+
+	// A suspended step left the state as it was
+	if (dLclTimestep <= 0.0)
+		return;
+
+	ulIdx = getCellID(pDomain, lIdxX, lIdxY);
+	pCellState = pCellData[ulIdx];
+	dBedElevation = dBedData[ulIdx];
+
+	if (pCellState.y <= -9999.0 || pCellState.x == -9999.0)
+		return;
+
+	if (tst_CellUnstable(pCellState, dBedElevation))
+		uiUnstable->store(1, std::memory_order_relaxed);
+}
+
+/*
+ *  Suspend the rest of a batch once it went unstable, with the negative
+ *  timestep a sync point uses, otherwise hold the timestep to the limit
+ *  the driver set after a rollback. Single work-item.
+ */
+void tst_LimitTimestep(
+	cl_double* dTimestep,
+	cl_double* dTimestepLimit,
+	std::atomic<cl_uint>* uiUnstable
+)
+{
+	cl_double	dLclTimestep = *dTimestep;
+
+	if (uiUnstable->load(std::memory_order_relaxed) != 0)
+	{
+		dLclTimestep = -fabs(dLclTimestep);
+	}
+	else if (dLclTimestep > *dTimestepLimit) {
+		dLclTimestep = *dTimestepLimit;
+	}
+
+	*dTimestep = dLclTimestep;
+}
+
+/*
+ *  Fastest wave speed over a block of rows and columns, the cells of a
+ *  partition its rank owns. Halo cells are left to the rank owning them.
+ */
+template <typename TDomain>
+cl_double tst_ReduceBlock(
+	const TDomain& pDomain,
+	cl_double4* pCellData,
+	cl_double* dBedData,
+	cl_ulong ulRowStart,
+	cl_ulong ulRowEnd,
+	cl_ulong ulColStart,
+	cl_ulong ulColEnd
+)
+{
+	cl_double	dCellSpeed;
+	cl_double	dMaxSpeed = 0.0;
+
+	for (cl_ulong ulRow = ulRowStart; ulRow < ulRowEnd; ulRow++)
+	{
+		for (cl_ulong ulCellID = ulRow * pDomain.Cols + ulColStart; ulCellID < ulRow * pDomain.Cols + ulColEnd; ulCellID++)
+		{
+			dCellSpeed = tst_CellSpeed(pCellData[ulCellID], dBedData[ulCellID]);
+			if (dCellSpeed > dMaxSpeed)
+				dMaxSpeed = dCellSpeed;
+		}
+	}
+
+	return dMaxSpeed;
+}
+
+/*
+ *  Hand the maximum speed folded in by the scheme to the timestep kernels
+ *  and clear it for the next sweep, single work-item
+ */
+void tst_CollectSpeed(
+	std::atomic<cl_ulong>* ulMaxSpeed,
+	cl_double* pReductionData
+)
+{
+	cl_ulong	ulSpeedBits = ulMaxSpeed->exchange(0);
+	cl_double	dMaxSpeed;
+
+	memcpy(&dMaxSpeed, &ulSpeedBits, sizeof(cl_double));
+
+	pReductionData[0] = dMaxSpeed;
+	for (unsigned int i = 1; i < TIMESTEP_WORKERS; i++)
+		pReductionData[i] = 0.0;
+}
+
+template void tst_Advance_Normal<sDomainConfiguration>(const sDomainConfiguration&, cl_double*, cl_double*, cl_double*, cl_double*, cl_double4*, cl_double*, cl_double*, cl_double*, cl_uint*, cl_uint*);
+template void tst_Advance_Normal<sDomainCompiled>(const sDomainCompiled&, cl_double*, cl_double*, cl_double*, cl_double*, cl_double4*, cl_double*, cl_double*, cl_double*, cl_uint*, cl_uint*);
+template void tst_Reduce<sDomainConfiguration>(const sDomainConfiguration&, cl_double4*, cl_double*, cl_double*, GlobalHandlerClass);
+template void tst_Reduce<sDomainCompiled>(const sDomainCompiled&, cl_double4*, cl_double*, cl_double*, GlobalHandlerClass);
+template void tst_ReducePrimitives<sDomainConfiguration>(const sDomainConfiguration&, const cl_double4*, cl_double*, GlobalHandlerClass);
+template void tst_ReducePrimitives<sDomainCompiled>(const sDomainCompiled&, const cl_double4*, cl_double*, GlobalHandlerClass);
+template void tst_ReduceActive<sDomainConfiguration>(const sDomainConfiguration&, cl_double4*, cl_double*, cl_double*, const sTileActivity*, GlobalHandlerClass);
+template void tst_ReduceActive<sDomainCompiled>(const sDomainCompiled&, cl_double4*, cl_double*, cl_double*, const sTileActivity*, GlobalHandlerClass);
+template cl_double tst_ReduceBlock<sDomainConfiguration>(const sDomainConfiguration&, cl_double4*, cl_double*, cl_ulong, cl_ulong, cl_ulong, cl_ulong);
+template cl_double tst_ReduceBlock<sDomainCompiled>(const sDomainCompiled&, cl_double4*, cl_double*, cl_ulong, cl_ulong, cl_ulong, cl_ulong);
+template void tst_CheckState<sDomainConfiguration>(const sDomainConfiguration&, cl_double*, cl_double4*, cl_double*, std::atomic<cl_uint>*, GlobalHandlerClass);
+template void tst_CheckState<sDomainCompiled>(const sDomainCompiled&, cl_double*, cl_double4*, cl_double*, std::atomic<cl_uint>*, GlobalHandlerClass);
+template void tst_UpdateTimestep<sDomainConfiguration>(const sDomainConfiguration&, cl_double*, cl_double*, cl_double*, cl_double*, cl_double*);
+template void tst_UpdateTimestep<sDomainCompiled>(const sDomainCompiled&, cl_double*, cl_double*, cl_double*, cl_double*, cl_double*);
@@ -7,6 +7,7 @@
 
 #pragma once
 #include "definitions.h"
+#include <cstring>
 
 //Calculate the timestep using a reduction procedure and increment the total model time.
 
@@ -51,3 +52,204 @@ void tst_Reduce(
 );
 
 #endif
+
+template <typename TDomain>
+void tst_Advance_Normal(
+	const TDomain&,
+	cl_double*,
+	cl_double*,
+	cl_double*,
+	cl_double*,
+	cl_double4*,
+	cl_double*,
+	cl_double*,
+	cl_double*,
+	cl_uint*,
+	cl_uint*
+);
+
+void tst_ResetCounters(
+	cl_double*,
+	cl_uint*,
+	cl_uint*
+);
+
+template <typename TDomain>
+void tst_UpdateTimestep(
+	const TDomain&,
+	cl_double*,
+	cl_double*,
+	cl_double*,
+	cl_double*,
+	cl_double*
+);
+
+template <typename TDomain>
+void tst_Reduce(
+	const TDomain&,
+	cl_double4*,
+	cl_double*,
+	cl_double*,
+	GlobalHandlerClass
+);
+
+template <typename TDomain>
+void tst_ReducePrimitives(
+	const TDomain&,
+	const cl_double4*,
+	cl_double*,
+	GlobalHandlerClass
+);
+
+template <typename TDomain>
+void tst_ReduceActive(
+	const TDomain&,
+	cl_double4*,
+	cl_double*,
+	cl_double*,
+	const sTileActivity*,
+	GlobalHandlerClass
+);
+
+template <typename TDomain>
+cl_double tst_ReduceBlock(
+	const TDomain&,
+	cl_double4*,
+	cl_double*,
+	cl_ulong,
+	cl_ulong,
+	cl_ulong,
+	cl_ulong
+);
+
+template <typename TDomain>
+void tst_CheckState(
+	const TDomain&,
+	cl_double*,
+	cl_double4*,
+	cl_double*,
+	std::atomic<cl_uint>*,
+	GlobalHandlerClass
+);
+
+void tst_LimitTimestep(
+	cl_double*,
+	cl_double*,
+	std::atomic<cl_uint>*
+);
+
+void tst_CollectSpeed(
+	std::atomic<cl_ulong>*,
+	cl_double*
+);
+
+/*
+ *  Fastest wave speed in a cell, zero for dry or disabled cells
+ */
+inline cl_double tst_CellSpeed(
+	cl_double4	pCellState,
+	cl_double	dBedElevation
+)
+{
+	cl_double	dDepth, dVelX, dVelY;
+
+	dDepth = pCellState.x - dBedElevation;
+
+	if (dDepth > QUITE_SMALL && pCellState.y > -9999.0)
+	{
+		#ifndef TIMESTEP_SIMPLIFIED
+
+		dVelX = pCellState.z / dDepth;
+		dVelY = pCellState.w / dDepth;
+		if (dVelX < 0.0) dVelX = -dVelX;
+		if (dVelY < 0.0) dVelY = -dVelY;
+
+		dVelX += sqrt(GRAVITY * dDepth);
+		dVelY += sqrt(GRAVITY * dDepth);
+
+		#else
+
+		dVelX = sqrt(GRAVITY * dDepth);
+		dVelY = sqrt(GRAVITY * dDepth);
+
+		#endif
+		return (dVelX < dVelY) ? dVelY : dVelX;
+	}
+
+	return 0.0;
+}
+
+/*
+ *  An enabled cell gone unstable after a step: a negative depth or a value
+ *  that is not a number. A fast wave is left to the next timestep, it only
+ *  breaks a step that has yet to be taken. Written as negations so a NaN
+ *  fails them too.
+ */
+inline bool tst_CellUnstable(
+	cl_double4	pCellState,
+	cl_double	dBedElevation
+)
+{
+	return !(pCellState.x - dBedElevation >= -QUITE_SMALL) ||
+		!(pCellState.z == pCellState.z && pCellState.w == pCellState.w);
+}
+
+/*
+ *  Speed of tst_CellSpeed from the H, U, V and celerity of gts_Primitives,
+ *  the celerity being zero for a cell that sets no limit
+ */
+inline cl_double tst_PrimitiveSpeed(
+	cl_double4	pPrimitive
+)
+{
+	cl_double	dVelX, dVelY;
+
+	if (pPrimitive.w > 0.0)
+	{
+		#ifndef TIMESTEP_SIMPLIFIED
+
+		dVelX = pPrimitive.y;
+		dVelY = pPrimitive.z;
+		if (dVelX < 0.0) dVelX = -dVelX;
+		if (dVelY < 0.0) dVelY = -dVelY;
+
+		dVelX += pPrimitive.w;
+		dVelY += pPrimitive.w;
+
+		#else
+
+		dVelX = pPrimitive.w;
+		dVelY = pPrimitive.w;
+
+		#endif
+		return (dVelX < dVelY) ? dVelY : dVelX;
+	}
+
+	return 0.0;
+}
+
+/*
+ *  Lock-free maximum, as the OpenCL atom_max on 64-bit integers
+ */
+inline cl_ulong atom_max(std::atomic<cl_ulong>* ulTarget, cl_ulong ulValue)
+{
+	cl_ulong ulCurrent = ulTarget->load(std::memory_order_relaxed);
+	while (ulValue > ulCurrent && !ulTarget->compare_exchange_weak(ulCurrent, ulValue, std::memory_order_relaxed))
+		;
+	return ulCurrent;
+}
+
+/*
+ *  Fold a speed into the maximum shared by a sweep. Speeds are never
+ *  negative, so their bit patterns order like the values.
+ */
+inline void tst_FoldSpeed(std::atomic<cl_ulong>* ulMaxSpeed, cl_double dSpeed)
+{
+	cl_ulong ulSpeedBits;
+
+	if (!(dSpeed > 0.0))
+		return;
+
+	memcpy(&ulSpeedBits, &dSpeed, sizeof(cl_double));
+	atom_max(ulMaxSpeed, ulSpeedBits);
+}
@@ -6,25 +6,51 @@
  */
 
 #include "5_CLSchemeGodunov.h"
+#include "2_CLFriction.h"
+#include "4_CLDynamicTimestep.h"
 
 //Implementation of the 1st order accurate Godunov-type scheme
 
 
+ //Depth and velocities of a cell, H, U, V, zero velocities on a dry cell
+inline cl_double4 gts_cellPrimitives(
+	cl_double4		pCellState,						// Z, Zmax, Qx, Qy
+	cl_double		dBedElevation
+)
+{
+	cl_double		dDepth = pCellState.x - dBedElevation;
+	cl_double4		pPrimitive = {
+		dDepth,
+		(dDepth < VERY_SMALL ? 0.0 : pCellState.z / dDepth),
+		(dDepth < VERY_SMALL ? 0.0 : pCellState.w / dDepth),
+		0.0
+	};
+
+	return pPrimitive;
+}
+
  //Reconstruct the cell data in a non-negative way (depth positivity preserving)
-cl_uchar reconstructInterface(
+ //dBedMaximum is the higher of the two beds, static for a given DEM. The
+ //direction under consideration is a template parameter, its stopping
+ //conditions are picked at compile time. The primitives H, U, V of both
+ //sides are those of gts_cellPrimitives.
+template <cl_uchar ucDirection>
+inline cl_uchar reconstructInterface(
 	cl_double4		pStateLeft,						// Left current state		Z, Zmax, Qx, Qy
 	cl_double		dBedLeft,						// Left bed elevation
+	cl_double4		pPrimitiveLeft,					// Left primitives			H, U, V
 	cl_double4		pStateRight,					// Right current state
 	cl_double		dBedRight,						// Right bed elevation
+	cl_double4		pPrimitiveRight,				// Right primitives
+	cl_double		dBedMaximum,					// Maximum bed elevation
 	cl_double8* pOutputLeft,						// Output data for LHS of Riemann
-	cl_double8* pOutputRight,						// Output data for RHS of Riemann
-	cl_uchar		ucDirection						// Direction under consideration
+	cl_double8* pOutputRight						// Output data for RHS of Riemann
 )
 {
 	cl_uchar		ucStop = 0;
 	cl_double8		pReconstructionLeft, pReconstructionRight;
-	cl_double		dDepthL = pStateLeft.x - dBedLeft;
-	cl_double		dDepthR = pStateRight.x - dBedRight;
+	cl_double		dDepthL = pPrimitiveLeft.x;
+	cl_double		dDepthR = pPrimitiveRight.x;
 
 	// Initial values before reconstruction
 	pReconstructionLeft = {
@@ -32,8 +58,8 @@ cl_uchar reconstructInterface(
 			dDepthL,																			// H	S1
 			pStateLeft.s[2],																	// Qx	S2
 			pStateLeft.s[3],																	// Qy	S3
-			(dDepthL < VERY_SMALL ? 0.0 : pStateLeft.s[2] / dDepthL),							// U	S4
-			(dDepthL < VERY_SMALL ? 0.0 : pStateLeft.s[3] / dDepthL),							// V	S5
+			pPrimitiveLeft.y,																	// U	S4
+			pPrimitiveLeft.z,																	// V	S5
 			dBedLeft,																			// Zb	S6
 			0.0 };																			//		S7
 	pReconstructionRight = {
@@ -41,13 +67,12 @@ cl_uchar reconstructInterface(
 			dDepthR,																			// H	S1
 			pStateRight.s[2],																	// Qx	S2
 			pStateRight.s[3],																	// Qy	S3
-			(dDepthR < VERY_SMALL ? 0.0 : pStateRight.s[2] / dDepthR),							// U	S4
-			(dDepthR < VERY_SMALL ? 0.0 : pStateRight.s[3] / dDepthR),							// V	S5
+			pPrimitiveRight.y,																	// U	S4
+			pPrimitiveRight.z,																	// V	S5
 			dBedRight,																			// Zb	S6
 			0.0};																				//		S7
 
-	// Maximum bed elevation and vertical shift factor
-	cl_double	dBedMaximum = (pReconstructionLeft.s[6] > pReconstructionRight.s[6] ? pReconstructionLeft.s[6] : pReconstructionRight.s[6]);
+	// Vertical shift factor
 	cl_double	dShiftV = dBedMaximum - (ucDirection < DOMAIN_DIR_S ? pStateLeft : pStateRight).s[0];
 	if (dShiftV < 0.0) dShiftV = 0.0;
 
@@ -112,16 +137,337 @@ cl_uchar reconstructInterface(
 	return ucStop;
 }
 
+template <cl_uchar ucDirection>
+inline cl_uchar reconstructInterface(
+	cl_double4		pStateLeft,
+	cl_double		dBedLeft,
+	cl_double4		pStateRight,
+	cl_double		dBedRight,
+	cl_double		dBedMaximum,
+	cl_double8* pOutputLeft,
+	cl_double8* pOutputRight
+)
+{
+	return reconstructInterface<ucDirection>(
+		pStateLeft, dBedLeft, gts_cellPrimitives(pStateLeft, dBedLeft),
+		pStateRight, dBedRight, gts_cellPrimitives(pStateRight, dBedRight),
+		dBedMaximum, pOutputLeft, pOutputRight
+	);
+}
+
+cl_uchar reconstructInterface(
+	cl_double4		pStateLeft,
+	cl_double		dBedLeft,
+	cl_double4		pStateRight,
+	cl_double		dBedRight,
+	cl_double8* pOutputLeft,
+	cl_double8* pOutputRight,
+	cl_uchar		ucDirection
+)
+{
+	cl_double		dBedMaximum = (dBedLeft > dBedRight ? dBedLeft : dBedRight);
+
+	switch (ucDirection)
+	{
+	case DOMAIN_DIR_N: return reconstructInterface<DOMAIN_DIR_N>(pStateLeft, dBedLeft, pStateRight, dBedRight, dBedMaximum, pOutputLeft, pOutputRight);
+	case DOMAIN_DIR_E: return reconstructInterface<DOMAIN_DIR_E>(pStateLeft, dBedLeft, pStateRight, dBedRight, dBedMaximum, pOutputLeft, pOutputRight);
+	case DOMAIN_DIR_S: return reconstructInterface<DOMAIN_DIR_S>(pStateLeft, dBedLeft, pStateRight, dBedRight, dBedMaximum, pOutputLeft, pOutputRight);
+	default: return reconstructInterface<DOMAIN_DIR_W>(pStateLeft, dBedLeft, pStateRight, dBedRight, dBedMaximum, pOutputLeft, pOutputRight);
+	}
+}
+
+/*
+ *  Source terms and state update of a cell from the fluxes through its faces.
+ *  The neighbour levels and bed are those of the reconstructed interfaces.
+ */
+template <typename TDomain>
+inline cl_double4 gts_applyFluxes(
+	const TDomain&	pDomain,
+	cl_double		dLclTimestep,
+	cl_double4		pCellData,						// Z, Zmax, Qx, Qy
+	cl_double		dCellBedElev,
+	#if defined(FRICTION_ENABLED) && defined(FRICTION_IN_FLUX_KERNEL)
+	cl_double		dManningCoef,
+	#else
+	cl_double		/*dManningCoef*/,					// Only read by the friction in the flux kernel
+	#endif
+	const cl_double4* pFlux,						// Z, Qx, Qy for N, E, S, W
+	cl_double		dNeigFslN,
+	cl_double		dNeigBedElevN,
+	cl_double		dNeigFslE,
+	cl_double		dNeigBedElevE,
+	cl_double		dNeigFslS,
+	cl_double		dNeigBedElevS,
+	cl_double		dNeigFslW,
+	cl_double		dNeigBedElevW,
+	cl_uchar		ucStop
+)
+{
+	cl_double4	pSourceTerms, dDeltaValues;										// Z, Qx, Qy
+
+	// Source term vector
+	// TODO: Somehow get these sorted too...
+	pSourceTerms.x = 0.0;
+	pSourceTerms.y = -1 * GRAVITY * ((dNeigFslE + dNeigFslW) / 2) * ((dNeigBedElevE - dNeigBedElevW) / pDomain.DeltaX);
+	pSourceTerms.z = -1 * GRAVITY * ((dNeigFslN + dNeigFslS) / 2) * ((dNeigBedElevN - dNeigBedElevS) / pDomain.DeltaY);
+
+	// Calculation of change values per timestep and spatial dimension
+	dDeltaValues.x = (pFlux[1].x - pFlux[3].x) / pDomain.DeltaX +
+		(pFlux[0].x - pFlux[2].x) / pDomain.DeltaY -
+		pSourceTerms.x;
+	dDeltaValues.z = (pFlux[1].y - pFlux[3].y) / pDomain.DeltaX +
+		(pFlux[0].y - pFlux[2].y) / pDomain.DeltaY -
+		pSourceTerms.y;
+	dDeltaValues.w = (pFlux[1].z - pFlux[3].z) / pDomain.DeltaX +
+		(pFlux[0].z - pFlux[2].z) / pDomain.DeltaY -
+		pSourceTerms.z;
+
+	// Round delta values to zero if small
+	// TODO: Explore whether this can be rewritten as some form of clamp operation?
+	if ((dDeltaValues.x > 0.0 && dDeltaValues.x < VERY_SMALL) ||
+		(dDeltaValues.x < 0.0 && dDeltaValues.x > -VERY_SMALL))
+		dDeltaValues.x = 0.0;
+	if ((dDeltaValues.z > 0.0 && dDeltaValues.z < VERY_SMALL) ||
+		(dDeltaValues.z < 0.0 && dDeltaValues.z > -VERY_SMALL))
+		dDeltaValues.z = 0.0;
+	if ((dDeltaValues.w > 0.0 && dDeltaValues.w < VERY_SMALL) ||
+		(dDeltaValues.w < 0.0 && dDeltaValues.w > -VERY_SMALL))
+		dDeltaValues.w = 0.0;
+
+	// Stopping conditions
+	if (ucStop > 0)
+	{
+		pCellData.z = 0.0;
+		pCellData.w = 0.0;
+	}
+
+	// Update the flow state
+	pCellData.x = pCellData.x - dLclTimestep * dDeltaValues.x;
+	pCellData.z = pCellData.z - dLclTimestep * dDeltaValues.z;
+	pCellData.w = pCellData.w - dLclTimestep * dDeltaValues.w;
+
+	#ifdef FRICTION_ENABLED
+	#ifdef FRICTION_IN_FLUX_KERNEL
+	// Calculate the friction effects
+	pCellData = implicitFriction(
+		pCellData,
+		dCellBedElev,
+		dManningCoef,
+		dLclTimestep
+	);
+	#endif
+	#endif
+
+	// New max FSL?
+	if (pCellData.x > pCellData.y && pCellData.y > -9990.0)
+		pCellData.y = pCellData.x;
+
+	// Crazy low depths?
+	if (pCellData.x - dCellBedElev < VERY_SMALL)
+		pCellData.x = dCellBedElev;
+
+	return pCellData;
+}
+
+/*
+ *  Flux and source term update of a single cell from its four neighbours.
+ *  Shared by the kernels for each state layout, returns the new cell state.
+ *  TRiemann is the solver policy used on the four interfaces, dBedMax the
+ *  higher bed of the cell and each neighbour, the primitives those of
+ *  gts_cellPrimitives with the neighbours by DOMAIN_DIR_.
+ */
+template <typename TRiemann, typename TDomain>
+inline cl_double4 gts_updateCell(
+	const TDomain&	pDomain,
+	cl_double		dLclTimestep,
+	cl_double4		pCellData,						// Z, Zmax, Qx, Qy
+	cl_double		dCellBedElev,
+	cl_double		dManningCoef,
+	cl_double4		pNeigDataN,						// Z, -, Qx, Qy
+	cl_double		dNeigBedElevN,
+	cl_double4		pNeigDataE,
+	cl_double		dNeigBedElevE,
+	cl_double4		pNeigDataS,
+	cl_double		dNeigBedElevS,
+	cl_double4		pNeigDataW,
+	cl_double		dNeigBedElevW,
+	cl_double		dBedMaxN,
+	cl_double		dBedMaxE,
+	cl_double		dBedMaxS,
+	cl_double		dBedMaxW,
+	cl_double4		pPrimitiveCell,					// H, U, V
+	const cl_double4* pPrimitiveNeig,
+	#ifdef DEBUG_OUTPUT
+	bool			bDebug
+	#else
+	bool			/*bDebug*/
+	#endif
+)
+{
+	cl_double4	pFlux[4];																// Z, Qx, Qy
+	cl_double8	pLeft, pRight;												// Z, H, Qx, Qy, U, V, Zb
+	cl_uchar		ucStop = 0;
+	cl_uchar		ucDryCount = 0;
+
+	if (pCellData.x - dCellBedElev < VERY_SMALL) ucDryCount++;
+	if (pNeigDataN.x - dNeigBedElevN < VERY_SMALL) ucDryCount++;
+	if (pNeigDataE.x - dNeigBedElevE < VERY_SMALL) ucDryCount++;
+	if (pNeigDataS.x - dNeigBedElevS < VERY_SMALL) ucDryCount++;
+	if (pNeigDataW.x - dNeigBedElevW < VERY_SMALL) ucDryCount++;
+
+	// All neighbours are dry? Don't bother calculating
+	if (ucDryCount >= 5)
+		return pCellData;
+
+	// Reconstruct interfaces
+	// -> North
+	ucStop += reconstructInterface<DOMAIN_DIR_N>(
+		pCellData,							// Left cell data
+		dCellBedElev,						// Left bed elevation
+		pPrimitiveCell,						// Left primitives
+		pNeigDataN,							// Right cell data
+		dNeigBedElevN,						// Right bed elevation
+		pPrimitiveNeig[DOMAIN_DIR_N],		// Right primitives
+		dBedMaxN,							// Maximum bed elevation
+		&pLeft,								// Output for left
+		&pRight							// Output for right
+	);
+	pNeigDataN.x = pRight.s[0];
+	dNeigBedElevN = pRight.s[6];
+	#ifdef DEBUG_OUTPUT
+	if (bDebug)
+	{
+		printf( "Reconstruct NL:{ %f, %f, %f, %f )\n", pLeft.s[0], pLeft.s[6], pLeft.s[2], pLeft.s[3] );
+		printf( "Reconstruct NR:{ %f, %f, %f, %f )\n", pRight.s[0], pRight.s[6], pRight.s[2], pRight.s[3] );
+	}
+	#endif
+	pFlux[DOMAIN_DIR_N] = TRiemann::template solve<DOMAIN_DIR_N>(pLeft, pRight, false);
+
+	// -> South
+	ucStop += reconstructInterface<DOMAIN_DIR_S>(
+		pNeigDataS,							// Left cell data
+		dNeigBedElevS,						// Left bed elevation
+		pPrimitiveNeig[DOMAIN_DIR_S],		// Left primitives
+		pCellData,							// Right cell data
+		dCellBedElev,						// Right bed elevation
+		pPrimitiveCell,						// Right primitives
+		dBedMaxS,							// Maximum bed elevation
+		&pLeft,								// Output for left
+		&pRight							// Output for right
+	);
+	pNeigDataS.x = pLeft.s[0];
+	dNeigBedElevS = pLeft.s[6];
+	pFlux[DOMAIN_DIR_S] = TRiemann::template solve<DOMAIN_DIR_S>(pLeft, pRight, false);
+
+	// -> East
+	ucStop += reconstructInterface<DOMAIN_DIR_E>(
+		pCellData,							// Left cell data
+		dCellBedElev,						// Left bed elevation
+		pPrimitiveCell,						// Left primitives
+		pNeigDataE,							// Right cell data
+		dNeigBedElevE,						// Right bed elevation
+		pPrimitiveNeig[DOMAIN_DIR_E],		// Right primitives
+		dBedMaxE,							// Maximum bed elevation
+		&pLeft,								// Output for left
+		&pRight							// Output for right
+	);
+	pNeigDataE.x = pRight.s[0];
+	dNeigBedElevE = pRight.s[6];
+	pFlux[DOMAIN_DIR_E] = TRiemann::template solve<DOMAIN_DIR_E>(pLeft, pRight, false);
+
+	// -> West
+	ucStop += reconstructInterface<DOMAIN_DIR_W>(
+		pNeigDataW,							// Left cell data
+		dNeigBedElevW,						// Left bed elevation
+		pPrimitiveNeig[DOMAIN_DIR_W],		// Left primitives
+		pCellData,							// Right cell data
+		dCellBedElev,						// Right bed elevation
+		pPrimitiveCell,						// Right primitives
+		dBedMaxW,							// Maximum bed elevation
+		&pLeft,								// Output for left
+		&pRight							// Output for right
+	);
+	pNeigDataW.x = pLeft.s[0];
+	dNeigBedElevW = pLeft.s[6];
+	pFlux[DOMAIN_DIR_W] = TRiemann::template solve<DOMAIN_DIR_W>(pLeft, pRight, false);
+
+	return gts_applyFluxes(
+		pDomain,
+		dLclTimestep,
+		pCellData, dCellBedElev, dManningCoef,
+		pFlux,
+		pNeigDataN.x, dNeigBedElevN,
+		pNeigDataE.x, dNeigBedElevE,
+		pNeigDataS.x, dNeigBedElevS,
+		pNeigDataW.x, dNeigBedElevW,
+		ucStop
+	);
+}
+
+/*
+ *  Same update with the bed maxima taken from the neighbour beds and the
+ *  primitives computed from the states
+ */
+template <typename TRiemann, typename TDomain>
+inline cl_double4 gts_updateCell(
+	const TDomain&	pDomain,
+	cl_double		dLclTimestep,
+	cl_double4		pCellData,						// Z, Zmax, Qx, Qy
+	cl_double		dCellBedElev,
+	cl_double		dManningCoef,
+	cl_double4		pNeigDataN,						// Z, -, Qx, Qy
+	cl_double		dNeigBedElevN,
+	cl_double4		pNeigDataE,
+	cl_double		dNeigBedElevE,
+	cl_double4		pNeigDataS,
+	cl_double		dNeigBedElevS,
+	cl_double4		pNeigDataW,
+	cl_double		dNeigBedElevW,
+	bool			bDebug
+)
+{
+	cl_double4		pPrimitiveNeig[4];
+
+	pPrimitiveNeig[DOMAIN_DIR_N] = gts_cellPrimitives(pNeigDataN, dNeigBedElevN);
+	pPrimitiveNeig[DOMAIN_DIR_E] = gts_cellPrimitives(pNeigDataE, dNeigBedElevE);
+	pPrimitiveNeig[DOMAIN_DIR_S] = gts_cellPrimitives(pNeigDataS, dNeigBedElevS);
+	pPrimitiveNeig[DOMAIN_DIR_W] = gts_cellPrimitives(pNeigDataW, dNeigBedElevW);
+
+	return gts_updateCell<TRiemann>(
+		pDomain,
+		dLclTimestep,
+		pCellData, dCellBedElev, dManningCoef,
+		pNeigDataN, dNeigBedElevN,
+		pNeigDataE, dNeigBedElevE,
+		pNeigDataS, dNeigBedElevS,
+		pNeigDataW, dNeigBedElevW,
+		(dCellBedElev > dNeigBedElevN ? dCellBedElev : dNeigBedElevN),
+		(dCellBedElev > dNeigBedElevE ? dCellBedElev : dNeigBedElevE),
+		(dNeigBedElevS > dCellBedElev ? dNeigBedElevS : dCellBedElev),
+		(dNeigBedElevW > dCellBedElev ? dNeigBedElevW : dCellBedElev),
+		gts_cellPrimitives(pCellData, dCellBedElev),
+		pPrimitiveNeig,
+		bDebug
+	);
+}
+
 /*
  *  Calculate everything without using LDS caching
+ *  TRiemann picks the Riemann solver, sRiemannHLLC unless stated.
  */
 //__kernel REQD_WG_SIZE_FULL_TS
+template <typename TDomain, typename TRiemann>
 void gts_cacheDisabled(
+	const TDomain& pDomain,
 	cl_double* dTimestep,						// Timestep
 	cl_double* dBedElevation,					// Bed elevation
 	cl_double4* pCellStateSrc,					// Current cell state data
 	cl_double4* pCellStateDst,					// Current cell state data
 	cl_double* dManning,						// Manning values
+	const sTileActivity* pActivity,				// Tile activity map, NULL updates every tile
+	const sFaceGeometry* pGeometry,				// Precomputed bed maxima, or NULL
+	const cl_double4* pPrimitives,				// Primitives of the current state from gts_Primitives, or NULL
+	std::atomic<cl_ulong>* ulMaxSpeed,			// Fastest wave speed of the new state, or NULL
 	GlobalHandlerClass ghc
 )
 {
@@ -135,25 +481,35 @@ void gts_cacheDisabled(
 	cl_ulong					ulIdx, ulIdxNeig;
 	cl_uchar					ucDirection;
 
-	ulIdx = getCellID(lIdxX, lIdxY);
+	ulIdx = getCellID(pDomain, lIdxX, lIdxY);
 
 	// Don't bother if we've gone beyond the domain bounds
-	if (lIdxX >= DOMAIN_COLS - 1 ||
-		lIdxY >= DOMAIN_ROWS - 1 ||
+	if (lIdxX >= (cl_long)pDomain.Cols - 1 ||
+		lIdxY >= (cl_long)pDomain.Rows - 1 ||
 		lIdxX <= 0 ||
 		lIdxY <= 0)
+	{
 		//printf("Went Beyoooond {%i, %i} {%ld,%ld}\n",DOMAIN_COLS,DOMAIN_ROWS,lIdxX,lIdxY);
+		// Edge cells keep their state but still limit the timestep
+		if (ulMaxSpeed != NULL && lIdxX < (cl_long)pDomain.Cols && lIdxY < (cl_long)pDomain.Rows)
+			tst_FoldSpeed(ulMaxSpeed, tst_CellSpeed(pCellStateSrc[ulIdx], dBedElevation[ulIdx]));
+		return;
+	}
+
+	// Tile and its neighbours dry? Nothing to load
+	cl_uchar		ucTileState = getTileState(pActivity, lIdxX, lIdxY);
+	if (ucTileState == TILE_DRY)
 		return;
+	if (ucTileState == TILE_DRAINED)
+	{
+		pCellStateDst[ulIdx] = pCellStateSrc[ulIdx];
+		return;
+	}
 
 	cl_double		dLclTimestep = *dTimestep;
 	cl_double		dManningCoef;
 	cl_double		dCellBedElev, dNeigBedElevN, dNeigBedElevE, dNeigBedElevS, dNeigBedElevW;
 	cl_double4	pCellData, pNeigDataN, pNeigDataE, pNeigDataS, pNeigDataW;					// Z, Zmax, Qx, Qy
-	cl_double4	pSourceTerms, dDeltaValues;										// Z, Qx, Qy
-	cl_double4	pFlux[4];																// Z, Qx, Qy
-	cl_double8	pLeft, pRight;												// Z, H, Qx, Qy, U, V, Zb
-	cl_uchar		ucStop = 0;
-	cl_uchar		ucDryCount = 0;
 
 
 	// Also don't bother if we've gone beyond the total simulation time
@@ -161,6 +517,8 @@ void gts_cacheDisabled(
 	{
 		// TODO: Is there a way of avoiding this?!
 		pCellStateDst[ulIdx] = pCellStateSrc[ulIdx];
+		if (ulMaxSpeed != NULL)
+			tst_FoldSpeed(ulMaxSpeed, tst_CellSpeed(pCellStateSrc[ulIdx], dBedElevation[ulIdx]));
 		return;
 	}
 
@@ -177,19 +535,19 @@ void gts_cacheDisabled(
 	}
 
 	ucDirection = DOMAIN_DIR_W;
-	ulIdxNeig = getNeighbourByIndices(lIdxX, lIdxY, ucDirection);
+	ulIdxNeig = getNeighbourByIndices(pDomain, lIdxX, lIdxY, ucDirection);
 	dNeigBedElevW = dBedElevation[ulIdxNeig];
 	pNeigDataW = pCellStateSrc[ulIdxNeig];
 	ucDirection = DOMAIN_DIR_S;
-	ulIdxNeig = getNeighbourByIndices(lIdxX, lIdxY, ucDirection);
+	ulIdxNeig = getNeighbourByIndices(pDomain, lIdxX, lIdxY, ucDirection);
 	dNeigBedElevS = dBedElevation[ulIdxNeig];
 	pNeigDataS = pCellStateSrc[ulIdxNeig];
 	ucDirection = DOMAIN_DIR_N;
-	ulIdxNeig = getNeighbourByIndices(lIdxX, lIdxY, ucDirection);
+	ulIdxNeig = getNeighbourByIndices(pDomain, lIdxX, lIdxY, ucDirection);
 	dNeigBedElevN = dBedElevation[ulIdxNeig];
 	pNeigDataN = pCellStateSrc[ulIdxNeig];
 	ucDirection = DOMAIN_DIR_E;
-	ulIdxNeig = getNeighbourByIndices(lIdxX, lIdxY, ucDirection);
+	ulIdxNeig = getNeighbourByIndices(pDomain, lIdxX, lIdxY, ucDirection);
 	dNeigBedElevE = dBedElevation[ulIdxNeig];
 	pNeigDataE = pCellStateSrc[ulIdxNeig];
 
@@ -230,144 +588,1117 @@ void gts_cacheDisabled(
 	}
 	#endif
 
-	if (pCellData.x - dCellBedElev < VERY_SMALL) ucDryCount++;
-	if (pNeigDataN.x - dNeigBedElevN < VERY_SMALL) ucDryCount++;
-	if (pNeigDataE.x - dNeigBedElevE < VERY_SMALL) ucDryCount++;
-	if (pNeigDataS.x - dNeigBedElevS < VERY_SMALL) ucDryCount++;
-	if (pNeigDataW.x - dNeigBedElevW < VERY_SMALL) ucDryCount++;
+	cl_double		dBedMaxN, dBedMaxE, dBedMaxS, dBedMaxW;
+	cl_double4		pPrimitiveCell, pPrimitiveNeig[4];
 
-	// All neighbours are dry? Don't bother calculating
-	if (ucDryCount >= 5) return;
+	// Higher bed of each face, precomputed or from the neighbour beds
+	if (pGeometry != NULL && pGeometry->BedMaxE != NULL)
+	{
+		dBedMaxN = pGeometry->BedMaxN[ulIdx];
+		dBedMaxE = pGeometry->BedMaxE[ulIdx];
+		dBedMaxS = pGeometry->BedMaxN[ulIdx - pDomain.Cols];
+		dBedMaxW = pGeometry->BedMaxE[ulIdx - 1];
+	}
+	else {
+		dBedMaxN = (dCellBedElev > dNeigBedElevN ? dCellBedElev : dNeigBedElevN);
+		dBedMaxE = (dCellBedElev > dNeigBedElevE ? dCellBedElev : dNeigBedElevE);
+		dBedMaxS = (dNeigBedElevS > dCellBedElev ? dNeigBedElevS : dCellBedElev);
+		dBedMaxW = (dNeigBedElevW > dCellBedElev ? dNeigBedElevW : dCellBedElev);
+	}
 
-	// Reconstruct interfaces
-	// -> North
-	ucStop += reconstructInterface(
-		pCellData,							// Left cell data
-		dCellBedElev,						// Left bed elevation
-		pNeigDataN,							// Right cell data
-		dNeigBedElevN,						// Right bed elevation
-		&pLeft,								// Output for left
-		&pRight,							// Output for right
-		DOMAIN_DIR_N
-	);
-	pNeigDataN.x = pRight.s[0];
-	dNeigBedElevN = pRight.s[6];
-	#ifdef DEBUG_OUTPUT
-	if (lIdxX == DEBUG_CELLX && lIdxY == DEBUG_CELLY)
+	// Depths and velocities, cached for the step or divided out here
+	if (pPrimitives != NULL)
 	{
-		printf( "Reconstruct NL:{ %f, %f, %f, %f )\n", pLeft.s[0], pLeft.s[6], pLeft.s[2], pLeft.s[3] );
-		printf( "Reconstruct NR:{ %f, %f, %f, %f )\n", pRight.s[0], pRight.s[6], pRight.s[2], pRight.s[3] );
+		pPrimitiveCell = pPrimitives[ulIdx];
+		pPrimitiveNeig[DOMAIN_DIR_N] = pPrimitives[ulIdx + pDomain.Cols];
+		pPrimitiveNeig[DOMAIN_DIR_E] = pPrimitives[ulIdx + 1];
+		pPrimitiveNeig[DOMAIN_DIR_S] = pPrimitives[ulIdx - pDomain.Cols];
+		pPrimitiveNeig[DOMAIN_DIR_W] = pPrimitives[ulIdx - 1];
+	}
+	else {
+		pPrimitiveCell = gts_cellPrimitives(pCellData, dCellBedElev);
+		pPrimitiveNeig[DOMAIN_DIR_N] = gts_cellPrimitives(pNeigDataN, dNeigBedElevN);
+		pPrimitiveNeig[DOMAIN_DIR_E] = gts_cellPrimitives(pNeigDataE, dNeigBedElevE);
+		pPrimitiveNeig[DOMAIN_DIR_S] = gts_cellPrimitives(pNeigDataS, dNeigBedElevS);
+		pPrimitiveNeig[DOMAIN_DIR_W] = gts_cellPrimitives(pNeigDataW, dNeigBedElevW);
 	}
-	#endif
-	pFlux[DOMAIN_DIR_N] = riemannSolver(DOMAIN_DIR_N, pLeft, pRight, false);
 
-	// -> South
-	ucStop += reconstructInterface(
-		pNeigDataS,							// Left cell data
-		dNeigBedElevS,						// Left bed elevation
-		pCellData,							// Right cell data
-		dCellBedElev,						// Right bed elevation
-		&pLeft,								// Output for left
-		&pRight,							// Output for right
-		DOMAIN_DIR_S
+	pCellData = gts_updateCell<TRiemann>(
+		pDomain,
+		dLclTimestep,
+		pCellData, dCellBedElev, dManningCoef,
+		pNeigDataN, dNeigBedElevN,
+		pNeigDataE, dNeigBedElevE,
+		pNeigDataS, dNeigBedElevS,
+		pNeigDataW, dNeigBedElevW,
+		dBedMaxN, dBedMaxE, dBedMaxS, dBedMaxW,
+		pPrimitiveCell, pPrimitiveNeig,
+		lIdxX == DEBUG_CELLX && lIdxY == DEBUG_CELLY
 	);
-	pNeigDataS.x = pLeft.s[0];
-	dNeigBedElevS = pLeft.s[6];
-	pFlux[DOMAIN_DIR_S] = riemannSolver(DOMAIN_DIR_S, pLeft, pRight, false);
+	pCellStateDst[ulIdx] = pCellData;
 
-	// -> East
-	ucStop += reconstructInterface(
-		pCellData,							// Left cell data
-		dCellBedElev,						// Left bed elevation
-		pNeigDataE,							// Right cell data
-		dNeigBedElevE,						// Right bed elevation
-		&pLeft,								// Output for left
-		&pRight,							// Output for right
-		DOMAIN_DIR_E
-	);
-	pNeigDataE.x = pRight.s[0];
-	dNeigBedElevE = pRight.s[6];
-	pFlux[DOMAIN_DIR_E] = riemannSolver(DOMAIN_DIR_E, pLeft, pRight, false);
+	// Wave speed of the new state for the next timestep
+	if (ulMaxSpeed != NULL)
+		tst_FoldSpeed(ulMaxSpeed, tst_CellSpeed(pCellData, dCellBedElev));
+}
 
-	// -> West
-	ucStop += reconstructInterface(
-		pNeigDataW,							// Left cell data
-		dNeigBedElevW,						// Left bed elevation
-		pCellData,							// Right cell data
-		dCellBedElev,						// Right bed elevation
-		&pLeft,								// Output for left
-		&pRight,							// Output for right
-		DOMAIN_DIR_W
-	);
-	pNeigDataW.x = pLeft.s[0];
-	dNeigBedElevW = pLeft.s[6];
-	pFlux[DOMAIN_DIR_W] = riemannSolver(DOMAIN_DIR_W, pLeft, pRight, false);
+/*
+ *  Primitives of every cell for gts_cacheDisabled and tst_ReducePrimitives,
+ *  H, U, V and the celerity sqrt(gH). Run on the state a step reads, once
+ *  the boundaries have written to it. The celerity is zero for the cells
+ *  tst_CellSpeed gives no speed.
+ */
+template <typename TDomain>
+void gts_Primitives(
+	const TDomain& pDomain,
+	cl_double4* pCellState,						// Current cell state data
+	cl_double* dBedElevation,					// Bed elevation
+	cl_double4* pPrimitives,					// H, U, V, sqrt(gH) of each cell
+	GlobalHandlerClass ghc
+)
+{
+	cl_long		lIdxX = ghc.get_global_id(0);
+	cl_long		lIdxY = ghc.get_global_id(1);
 
-	// Source term vector
-	// TODO: Somehow get these sorted too...
-	pSourceTerms.x = 0.0;
-	pSourceTerms.y = -1 * GRAVITY * ((pNeigDataE.x + pNeigDataW.x) / 2) * ((dNeigBedElevE - dNeigBedElevW) / DOMAIN_DELTAX);
-	pSourceTerms.z = -1 * GRAVITY * ((pNeigDataN.x + pNeigDataS.x) / 2) * ((dNeigBedElevN - dNeigBedElevS) / DOMAIN_DELTAY);
+	if (lIdxX >= (cl_long)pDomain.Cols || lIdxY >= (cl_long)pDomain.Rows)
+		return;
 
-	// Calculation of change values per timestep and spatial dimension
-	dDeltaValues.x = (pFlux[1].x - pFlux[3].x) / DOMAIN_DELTAX +
-		(pFlux[0].x - pFlux[2].x) / DOMAIN_DELTAY -
-		pSourceTerms.x;
-	dDeltaValues.z = (pFlux[1].y - pFlux[3].y) / DOMAIN_DELTAX +
-		(pFlux[0].y - pFlux[2].y) / DOMAIN_DELTAY -
-		pSourceTerms.y;
-	dDeltaValues.w = (pFlux[1].z - pFlux[3].z) / DOMAIN_DELTAX +
-		(pFlux[0].z - pFlux[2].z) / DOMAIN_DELTAY -
-		pSourceTerms.z;
+	cl_ulong	ulIdx = getCellID(pDomain, lIdxX, lIdxY);
+	cl_double4	pCellData = pCellState[ulIdx];
+	cl_double4	pPrimitive = gts_cellPrimitives(pCellData, dBedElevation[ulIdx]);
 
-	// Round delta values to zero if small
-	// TODO: Explore whether this can be rewritten as some form of clamp operation?
-	if ((dDeltaValues.x > 0.0 && dDeltaValues.x < VERY_SMALL) ||
-		(dDeltaValues.x < 0.0 && dDeltaValues.x > -VERY_SMALL))
-		dDeltaValues.x = 0.0;
-	if ((dDeltaValues.z > 0.0 && dDeltaValues.z < VERY_SMALL) ||
-		(dDeltaValues.z < 0.0 && dDeltaValues.z > -VERY_SMALL))
-		dDeltaValues.z = 0.0;
-	if ((dDeltaValues.w > 0.0 && dDeltaValues.w < VERY_SMALL) ||
-		(dDeltaValues.w < 0.0 && dDeltaValues.w > -VERY_SMALL))
-		dDeltaValues.w = 0.0;
+	if (pPrimitive.x > QUITE_SMALL && pCellData.y > -9999.0)
+		pPrimitive.w = sqrt(GRAVITY * pPrimitive.x);
 
-	// Stopping conditions
-	if (ucStop > 0)
-	{
-		pCellData.z = 0.0;
-		pCellData.w = 0.0;
+	pPrimitives[ulIdx] = pPrimitive;
+}
+
+/*
+ *  Interior cells only, one work-item per row of the domain
+ *  The outer ring is the ghost ring, filled by bdy_GhostRing and never
+ *  updated, so every interior cell has its four neighbours at constant
+ *  offsets and the sweep has no per-cell bounds or direction checks.
+ *  Matches gts_cacheDisabled without an activity map.
+ */
+template <typename TDomain, typename TRiemann>
+void gts_interior(
+	const TDomain& pDomain,
+	cl_double* dTimestep,						// Timestep
+	cl_double* dBedElevation,					// Bed elevation
+	cl_double4* pCellStateSrc,					// Current cell state data
+	cl_double4* pCellStateDst,					// New cell state data
+	cl_double* dManning,						// Manning values
+	std::atomic<cl_ulong>* ulMaxSpeed,			// Fastest wave speed of the new state, or NULL
+	GlobalHandlerClass ghc
+)
+{
+	cl_long		lIdxY = ghc.get_global_id(1);
+	cl_long		lRows = pDomain.Rows;
+	cl_long		lCols = pDomain.Cols;
+	cl_double	dLclTimestep = *dTimestep;
+	cl_double	dRowSpeed = 0.0;
+
+	if (lIdxY >= lRows)
+		return;
+
+	// Ghost cells keep their state but still limit the timestep
+	if (lIdxY == 0 || lIdxY == lRows - 1)
+	{
+		if (ulMaxSpeed == NULL)
+			return;
+		for (cl_ulong ulIdx = getCellID(pDomain, 0, lIdxY); ulIdx <= getCellID(pDomain, lCols - 1, lIdxY); ulIdx++)
+			dRowSpeed = std::max(dRowSpeed, tst_CellSpeed(pCellStateSrc[ulIdx], dBedElevation[ulIdx]));
+		tst_FoldSpeed(ulMaxSpeed, dRowSpeed);
+		return;
 	}
 
-	// Update the flow state
-	pCellData.x = pCellData.x - dLclTimestep * dDeltaValues.x;
-	pCellData.z = pCellData.z - dLclTimestep * dDeltaValues.z;
-	pCellData.w = pCellData.w - dLclTimestep * dDeltaValues.w;
+	const cl_long	lStride = lCols;
+	cl_ulong		ulFirst = getCellID(pDomain, 1, lIdxY);
+	cl_ulong		ulLast = getCellID(pDomain, lCols - 2, lIdxY);
 
-	#ifdef FRICTION_ENABLED
-	#ifdef FRICTION_IN_FLUX_KERNEL
-	// Calculate the friction effects
-	pCellData = implicitFriction(
-		pCellData,
-		dCellBedElev,
-		dManningCoef,
-		dLclTimestep
+	if (ulMaxSpeed != NULL)
+		dRowSpeed = std::max(
+			tst_CellSpeed(pCellStateSrc[ulFirst - 1], dBedElevation[ulFirst - 1]),
+			tst_CellSpeed(pCellStateSrc[ulLast + 1], dBedElevation[ulLast + 1])
+		);
+
+	for (cl_ulong ulIdx = ulFirst; ulIdx <= ulLast; ulIdx++)
+	{
+		cl_double4	pCellData = pCellStateSrc[ulIdx];
+		cl_double	dCellBedElev = dBedElevation[ulIdx];
+
+		// Beyond the total simulation time the state is copied
+		if (dLclTimestep <= 0.0)
+		{
+			pCellStateDst[ulIdx] = pCellData;
+		}
+		// Cell disabled?
+		else if (pCellData.y <= -9999.0 || pCellData.x == -9999.0)
+		{
+			pCellStateDst[ulIdx] = pCellData;
+			continue;
+		}
+		else {
+			pCellData = gts_updateCell<TRiemann>(
+				pDomain,
+				dLclTimestep,
+				pCellData, dCellBedElev, dManning[ulIdx],
+				pCellStateSrc[ulIdx + lStride], dBedElevation[ulIdx + lStride],
+				pCellStateSrc[ulIdx + 1], dBedElevation[ulIdx + 1],
+				pCellStateSrc[ulIdx - lStride], dBedElevation[ulIdx - lStride],
+				pCellStateSrc[ulIdx - 1], dBedElevation[ulIdx - 1],
+				false
+			);
+			pCellStateDst[ulIdx] = pCellData;
+		}
+
+		if (ulMaxSpeed != NULL)
+			dRowSpeed = std::max(dRowSpeed, tst_CellSpeed(pCellData, dCellBedElev));
+	}
+
+	if (ulMaxSpeed != NULL)
+		tst_FoldSpeed(ulMaxSpeed, dRowSpeed);
+}
+
+/*
+ *  Calculate everything without using LDS caching, structure-of-arrays state.
+ *  Neighbour loads only touch Z, Qx and Qy, Zmax is read for this cell alone.
+ */
+template <typename TDomain>
+void gts_cacheDisabledSoA(
+	const TDomain& pDomain,
+	cl_double* dTimestep,						// Timestep
+	cl_double* dBedElevation,					// Bed elevation
+	sCellStateSoA pCellStateSrc,				// Current cell state data
+	sCellStateSoA pCellStateDst,				// Current cell state data
+	cl_double* dManning,						// Manning values
+	std::atomic<cl_ulong>* ulMaxSpeed,			// Fastest wave speed of the new state, or NULL
+	GlobalHandlerClass ghc
+)
+{
+	cl_long					lIdxX = ghc.get_global_id(0);
+	cl_long					lIdxY = ghc.get_global_id(1);
+	cl_ulong				ulIdx, ulIdxN, ulIdxE, ulIdxS, ulIdxW;
+
+	// Out of the domain entirely?
+	if (lIdxX >= (cl_long)pDomain.Cols || lIdxY >= (cl_long)pDomain.Rows)
+		return;
+
+	ulIdx = getCellID(pDomain, lIdxX, lIdxY);
+
+	cl_double		dLclTimestep = *dTimestep;
+	cl_double4		pCellData = { pCellStateSrc.Z[ulIdx], pCellStateSrc.Zmax[ulIdx], pCellStateSrc.Qx[ulIdx], pCellStateSrc.Qy[ulIdx] };
+
+	// Edge cells keep their state but still limit the timestep
+	if (lIdxX == (cl_long)pDomain.Cols - 1 ||
+		lIdxY == (cl_long)pDomain.Rows - 1 ||
+		lIdxX <= 0 ||
+		lIdxY <= 0)
+	{
+		if (ulMaxSpeed != NULL)
+			tst_FoldSpeed(ulMaxSpeed, tst_CellSpeed(pCellData, dBedElevation[ulIdx]));
+		return;
+	}
+
+	// Also don't bother if we've gone beyond the total simulation time,
+	// or the cell is disabled
+	if (dLclTimestep <= 0.0 || pCellData.y <= -9999.0 || pCellData.x == -9999.0)
+	{
+		pCellStateDst.Z[ulIdx] = pCellData.x;
+		pCellStateDst.Zmax[ulIdx] = pCellData.y;
+		pCellStateDst.Qx[ulIdx] = pCellData.z;
+		pCellStateDst.Qy[ulIdx] = pCellData.w;
+		if (ulMaxSpeed != NULL)
+			tst_FoldSpeed(ulMaxSpeed, tst_CellSpeed(pCellData, dBedElevation[ulIdx]));
+		return;
+	}
+
+	ulIdxN = ulIdx + pDomain.Cols;
+	ulIdxE = ulIdx + 1;
+	ulIdxS = ulIdx - pDomain.Cols;
+	ulIdxW = ulIdx - 1;
+
+	cl_double4		pNeigDataN = { pCellStateSrc.Z[ulIdxN], 0.0, pCellStateSrc.Qx[ulIdxN], pCellStateSrc.Qy[ulIdxN] };
+	cl_double4		pNeigDataE = { pCellStateSrc.Z[ulIdxE], 0.0, pCellStateSrc.Qx[ulIdxE], pCellStateSrc.Qy[ulIdxE] };
+	cl_double4		pNeigDataS = { pCellStateSrc.Z[ulIdxS], 0.0, pCellStateSrc.Qx[ulIdxS], pCellStateSrc.Qy[ulIdxS] };
+	cl_double4		pNeigDataW = { pCellStateSrc.Z[ulIdxW], 0.0, pCellStateSrc.Qx[ulIdxW], pCellStateSrc.Qy[ulIdxW] };
+
+	pCellData = gts_updateCell<sRiemannHLLC>(
+		pDomain,
+		dLclTimestep,
+		pCellData, dBedElevation[ulIdx], dManning[ulIdx],
+		pNeigDataN, dBedElevation[ulIdxN],
+		pNeigDataE, dBedElevation[ulIdxE],
+		pNeigDataS, dBedElevation[ulIdxS],
+		pNeigDataW, dBedElevation[ulIdxW],
+		lIdxX == DEBUG_CELLX && lIdxY == DEBUG_CELLY
 	);
-	#endif
-	#endif
 
-	// New max FSL?
-	if (pCellData.x > pCellData.y && pCellData.y > -9990.0)
-		pCellData.y = pCellData.x;
+	// Commit to global memory
+	pCellStateDst.Z[ulIdx] = pCellData.x;
+	pCellStateDst.Zmax[ulIdx] = pCellData.y;
+	pCellStateDst.Qx[ulIdx] = pCellData.z;
+	pCellStateDst.Qy[ulIdx] = pCellData.w;
 
-	// Crazy low depths?
-	if (pCellData.x - dCellBedElev < VERY_SMALL)
-		pCellData.x = dCellBedElev;
+	// Wave speed of the new state for the next timestep
+	if (ulMaxSpeed != NULL)
+		tst_FoldSpeed(ulMaxSpeed, tst_CellSpeed(pCellData, dBedElevation[ulIdx]));
+}
+
+/*
+ *  Calculate everything without using LDS caching, with the state, bed and
+ *  Manning stored in the precision of TPrecision. The cell is updated in
+ *  double, only its loads and the final store convert.
+ */
+template <typename TDomain, typename TPrecision>
+void gts_cacheDisabledPrecision(
+	const TDomain& pDomain,
+	cl_double* dTimestep,								// Timestep
+	typename TPrecision::Real* dBedElevation,			// Bed elevation
+	typename TPrecision::State* pCellStateSrc,			// Current cell state data
+	typename TPrecision::State* pCellStateDst,			// Current cell state data
+	typename TPrecision::Real* dManning,				// Manning values
+	GlobalHandlerClass ghc
+)
+{
+	cl_long					lIdxX = ghc.get_global_id(0);
+	cl_long					lIdxY = ghc.get_global_id(1);
+	cl_ulong				ulIdx, ulIdxN, ulIdxE, ulIdxS, ulIdxW;
+
+	// Don't bother if we've gone beyond the domain bounds
+	if (lIdxX >= (cl_long)pDomain.Cols - 1 ||
+		lIdxY >= (cl_long)pDomain.Rows - 1 ||
+		lIdxX <= 0 ||
+		lIdxY <= 0)
+		return;
+
+	ulIdx = getCellID(pDomain, lIdxX, lIdxY);
+
+	cl_double		dLclTimestep = *dTimestep;
+	cl_double4		pCellData = TPrecision::load(pCellStateSrc[ulIdx], (cl_double)dBedElevation[ulIdx]);
+
+	// Also don't bother if we've gone beyond the total simulation time,
+	// or the cell is disabled
+	if (dLclTimestep <= 0.0 || pCellData.y <= -9999.0 || pCellData.x == -9999.0)
+	{
+		pCellStateDst[ulIdx] = pCellStateSrc[ulIdx];
+		return;
+	}
+
+	ulIdxN = ulIdx + pDomain.Cols;
+	ulIdxE = ulIdx + 1;
+	ulIdxS = ulIdx - pDomain.Cols;
+	ulIdxW = ulIdx - 1;
+
+	pCellData = gts_updateCell<sRiemannHLLC>(
+		pDomain,
+		dLclTimestep,
+		pCellData, (cl_double)dBedElevation[ulIdx], (cl_double)dManning[ulIdx],
+		TPrecision::load(pCellStateSrc[ulIdxN], (cl_double)dBedElevation[ulIdxN]), (cl_double)dBedElevation[ulIdxN],
+		TPrecision::load(pCellStateSrc[ulIdxE], (cl_double)dBedElevation[ulIdxE]), (cl_double)dBedElevation[ulIdxE],
+		TPrecision::load(pCellStateSrc[ulIdxS], (cl_double)dBedElevation[ulIdxS]), (cl_double)dBedElevation[ulIdxS],
+		TPrecision::load(pCellStateSrc[ulIdxW], (cl_double)dBedElevation[ulIdxW]), (cl_double)dBedElevation[ulIdxW],
+		lIdxX == DEBUG_CELLX && lIdxY == DEBUG_CELLY
+	);
 
 	// Commit to global memory
-	pCellStateDst[ulIdx] = pCellData;
+	pCellStateDst[ulIdx] = TPrecision::store(pCellData, (cl_double)dBedElevation[ulIdx]);
+}
+
+/*
+ *  Calculate everything for every member of an ensemble, member-minor
+ *  structure-of-arrays state over one bed. The bed and neighbour indices
+ *  are loaded once per cell. Each chunk of members is reconstructed member
+ *  by member, then every face is solved for the whole chunk at once with
+ *  one member per SIMD lane.
+ */
+template <typename TDomain>
+void gts_ensemble(
+	const TDomain& pDomain,
+	cl_double* dTimestep,						// Timestep
+	cl_double* dBedElevation,					// Bed elevation, shared by the members
+	cl_uint uiMembers,							// Members per cell
+	sCellStateSoA pCellStateSrc,				// Current cell state data, member-minor
+	sCellStateSoA pCellStateDst,				// Current cell state data, member-minor
+	cl_double* dManning,						// Manning values, member-minor
+	GlobalHandlerClass ghc
+)
+{
+	cl_long					lIdxX = ghc.get_global_id(0);
+	cl_long					lIdxY = ghc.get_global_id(1);
+	cl_ulong				ulIdx, ulIdxN, ulIdxE, ulIdxS, ulIdxW;
+
+	// Don't bother if we've gone beyond the domain bounds
+	if (lIdxX >= (cl_long)pDomain.Cols - 1 ||
+		lIdxY >= (cl_long)pDomain.Rows - 1 ||
+		lIdxX <= 0 ||
+		lIdxY <= 0)
+		return;
+
+	ulIdx = getCellID(pDomain, lIdxX, lIdxY);
+	ulIdxN = ulIdx + pDomain.Cols;
+	ulIdxE = ulIdx + 1;
+	ulIdxS = ulIdx - pDomain.Cols;
+	ulIdxW = ulIdx - 1;
+
+	cl_double		dLclTimestep = *dTimestep;
+	cl_double		dCellBedElev = dBedElevation[ulIdx];
+	cl_double		dNeigBedElev[4];
+	cl_ulong		ulNeigIdx[4];
+
+	ulNeigIdx[DOMAIN_DIR_N] = ulIdxN;
+	ulNeigIdx[DOMAIN_DIR_E] = ulIdxE;
+	ulNeigIdx[DOMAIN_DIR_S] = ulIdxS;
+	ulNeigIdx[DOMAIN_DIR_W] = ulIdxW;
+	for (int iDir = 0; iDir < 4; iDir++)
+		dNeigBedElev[iDir] = dBedElevation[ulNeigIdx[iDir]];
+
+	// Interfaces of a chunk, per direction and member
+	cl_double		dLeftZ[4][ENSEMBLE_CHUNK], dLeftH[4][ENSEMBLE_CHUNK], dLeftQx[4][ENSEMBLE_CHUNK], dLeftQy[4][ENSEMBLE_CHUNK], dLeftZb[4][ENSEMBLE_CHUNK];
+	cl_double		dRightZ[4][ENSEMBLE_CHUNK], dRightH[4][ENSEMBLE_CHUNK], dRightQx[4][ENSEMBLE_CHUNK], dRightQy[4][ENSEMBLE_CHUNK];
+	cl_double		dFluxZ[4][ENSEMBLE_CHUNK], dFluxQx[4][ENSEMBLE_CHUNK], dFluxQy[4][ENSEMBLE_CHUNK];
+	cl_double		dViewZ[4][ENSEMBLE_CHUNK], dViewZb[4][ENSEMBLE_CHUNK];		// Reconstructed neighbour Z, Zb
+	cl_uchar		ucStop[ENSEMBLE_CHUNK];
+	bool			bSkip[ENSEMBLE_CHUNK];
+
+	for (cl_uint uiBase = 0; uiBase < uiMembers; uiBase += ENSEMBLE_CHUNK)
+	{
+		cl_uint		uiCount = std::min((cl_uint)ENSEMBLE_CHUNK, uiMembers - uiBase);
+
+		for (cl_uint m = 0; m < uiCount; m++)
+		{
+			cl_ulong	ulMember = ulIdx * uiMembers + uiBase + m;
+			cl_double4	pCellData = { pCellStateSrc.Z[ulMember], pCellStateSrc.Zmax[ulMember], pCellStateSrc.Qx[ulMember], pCellStateSrc.Qy[ulMember] };
+			cl_double4	pNeigData[4];
+			cl_double8	pLeft, pRight;
+			cl_uchar	ucDryCount = 0;
+
+			for (int iDir = 0; iDir < 4; iDir++)
+			{
+				cl_ulong ulNeigMember = ulNeigIdx[iDir] * uiMembers + uiBase + m;
+				pNeigData[iDir] = { pCellStateSrc.Z[ulNeigMember], 0.0, pCellStateSrc.Qx[ulNeigMember], pCellStateSrc.Qy[ulNeigMember] };
+				if (pNeigData[iDir].x - dNeigBedElev[iDir] < VERY_SMALL) ucDryCount++;
+			}
+			if (pCellData.x - dCellBedElev < VERY_SMALL) ucDryCount++;
+
+			// Beyond the simulation time, disabled, or all neighbours dry? Keeps its state
+			bSkip[m] = dLclTimestep <= 0.0 || pCellData.y <= -9999.0 || pCellData.x == -9999.0 || ucDryCount >= 5;
+			ucStop[m] = 0;
+
+			// The cell is on the left of its north and east faces
+			for (int iDir = 0; iDir < 4; iDir++)
+			{
+				bool bCellLeft = iDir == DOMAIN_DIR_N || iDir == DOMAIN_DIR_E;
+				ucStop[m] += reconstructInterface(
+					bCellLeft ? pCellData : pNeigData[iDir],
+					bCellLeft ? dCellBedElev : dNeigBedElev[iDir],
+					bCellLeft ? pNeigData[iDir] : pCellData,
+					bCellLeft ? dNeigBedElev[iDir] : dCellBedElev,
+					&pLeft,
+					&pRight,
+					(cl_uchar)iDir
+				);
+
+				dLeftZ[iDir][m] = pLeft.s[0];
+				dLeftH[iDir][m] = pLeft.s[1];
+				dLeftQx[iDir][m] = pLeft.s[2];
+				dLeftQy[iDir][m] = pLeft.s[3];
+				dLeftZb[iDir][m] = pLeft.s[6];
+				dRightZ[iDir][m] = pRight.s[0];
+				dRightH[iDir][m] = pRight.s[1];
+				dRightQx[iDir][m] = pRight.s[2];
+				dRightQy[iDir][m] = pRight.s[3];
+				dViewZ[iDir][m] = bCellLeft ? pRight.s[0] : pLeft.s[0];
+				dViewZb[iDir][m] = bCellLeft ? pRight.s[6] : pLeft.s[6];
+			}
+		}
+
+		// Both sides share the reconstructed bed, the solver reads the left one
+		for (int iDir = 0; iDir < 4; iDir++)
+		{
+			sRiemannStateSoA pLeftSoA = { dLeftZ[iDir], dLeftH[iDir], dLeftQx[iDir], dLeftQy[iDir], dLeftZb[iDir] };
+			sRiemannStateSoA pRightSoA = { dRightZ[iDir], dRightH[iDir], dRightQx[iDir], dRightQy[iDir], dLeftZb[iDir] };
+			sRiemannFluxSoA pFluxSoA = { dFluxZ[iDir], dFluxQx[iDir], dFluxQy[iDir] };
+			riemannSolverBatch((cl_uchar)iDir, pLeftSoA, pRightSoA, pFluxSoA, uiCount);
+		}
+
+		for (cl_uint m = 0; m < uiCount; m++)
+		{
+			cl_ulong	ulMember = ulIdx * uiMembers + uiBase + m;
+			cl_double4	pCellData = { pCellStateSrc.Z[ulMember], pCellStateSrc.Zmax[ulMember], pCellStateSrc.Qx[ulMember], pCellStateSrc.Qy[ulMember] };
+
+			if (!bSkip[m])
+			{
+				cl_double4 pFlux[4];
+				for (int iDir = 0; iDir < 4; iDir++)
+					pFlux[iDir] = { dFluxZ[iDir][m], dFluxQx[iDir][m], dFluxQy[iDir][m], 0.0 };
+
+				pCellData = gts_applyFluxes(
+					pDomain,
+					dLclTimestep,
+					pCellData, dCellBedElev, dManning[ulMember],
+					pFlux,
+					dViewZ[DOMAIN_DIR_N][m], dViewZb[DOMAIN_DIR_N][m],
+					dViewZ[DOMAIN_DIR_E][m], dViewZb[DOMAIN_DIR_E][m],
+					dViewZ[DOMAIN_DIR_S][m], dViewZb[DOMAIN_DIR_S][m],
+					dViewZ[DOMAIN_DIR_W][m], dViewZb[DOMAIN_DIR_W][m],
+					ucStop[m]
+				);
+			}
+
+			// Commit to global memory
+			pCellStateDst.Z[ulMember] = pCellData.x;
+			pCellStateDst.Zmax[ulMember] = pCellData.y;
+			pCellStateDst.Qx[ulMember] = pCellData.z;
+			pCellStateDst.Qy[ulMember] = pCellData.w;
+		}
+	}
 }
 
+/*
+ *  Bytes of local memory gts_cacheEnabled needs for one tile and its halo
+ */
+size_t gts_cacheEnabledScratchSize(cl_uint2 uiTileSize)
+{
+	return (size_t)(uiTileSize.s[0] + 2) * (uiTileSize.s[1] + 2) * (sizeof(cl_double4) + sizeof(cl_double));
+}
+
+/*
+ *  Fastest wave speed among the domain edge cells of a tile, these are
+ *  never updated by the scheme
+ */
+template <typename TDomain>
+inline cl_double gts_edgeSpeed(
+	const TDomain& pDomain,
+	cl_double4* pCellState,
+	cl_double* dBedElevation,
+	cl_long lTileX,
+	cl_long lTileY,
+	cl_uint2 uiTileSize
+)
+{
+	cl_long		lCols = (cl_long)pDomain.Cols;
+	cl_long		lRows = (cl_long)pDomain.Rows;
+	cl_long		lEndX = std::min(lTileX + (cl_long)uiTileSize.s[0], lCols);
+	cl_long		lEndY = std::min(lTileY + (cl_long)uiTileSize.s[1], lRows);
+	cl_double	dMaxSpeed = 0.0;
+
+	for (cl_long lIdxY = lTileY; lIdxY < lEndY; lIdxY++)
+	{
+		bool bEdgeRow = lIdxY == 0 || lIdxY == lRows - 1;
+		for (cl_long lIdxX = lTileX; lIdxX < lEndX; lIdxX++)
+		{
+			if (!bEdgeRow && lIdxX != 0 && lIdxX != lCols - 1)
+				continue;
+			cl_ulong ulIdx = getCellID(pDomain, lIdxX, lIdxY);
+			dMaxSpeed = std::max(dMaxSpeed, tst_CellSpeed(pCellState[ulIdx], dBedElevation[ulIdx]));
+		}
+	}
+
+	return dMaxSpeed;
+}
+
+/*
+ *  Calculate everything from a tile cached in local memory, CPU variant.
+ *  Each work-item owns a tile of uiTileSize cells, copies it with a one cell
+ *  halo into a contiguous scratch block and updates the tile from there.
+ *  Enqueue one work-item per tile, with gts_cacheEnabledScratchSize bytes of
+ *  local memory per work-group of one.
+ */
+template <typename TDomain>
+void gts_cacheEnabled(
+	const TDomain& pDomain,
+	cl_double* dTimestep,						// Timestep
+	cl_double* dBedElevation,					// Bed elevation
+	cl_double4* pCellStateSrc,					// Current cell state data
+	cl_double4* pCellStateDst,					// Current cell state data
+	cl_double* dManning,						// Manning values
+	cl_uint2 uiTileSize,						// Cells per tile in x and y
+	const sTileActivity* pActivity,				// Tile activity map of the same tile size, or NULL
+	std::atomic<cl_ulong>* ulMaxSpeed,			// Fastest wave speed of the new state, or NULL
+	GlobalHandlerClass ghc
+)
+{
+	cl_long		lTileX = ghc.get_global_id(0) * (cl_long)uiTileSize.s[0];
+	cl_long		lTileY = ghc.get_global_id(1) * (cl_long)uiTileSize.s[1];
+	cl_long		lCols = (cl_long)pDomain.Cols;
+	cl_long		lRows = (cl_long)pDomain.Rows;
+
+	if (lTileX >= lCols || lTileY >= lRows)
+		return;
+
+	// Tile clipped to the cells the scheme updates, halo clipped to the domain
+	cl_long		lStartX = std::max(lTileX, (cl_long)1);
+	cl_long		lStartY = std::max(lTileY, (cl_long)1);
+	cl_long		lEndX = std::min(lTileX + (cl_long)uiTileSize.s[0], lCols - 1);
+	cl_long		lEndY = std::min(lTileY + (cl_long)uiTileSize.s[1], lRows - 1);
+	cl_double	dLclTimestep = *dTimestep;
+	cl_double	dMaxSpeed = 0.0;
+
+	// Dry tiles hold no wet cell, so they impose no timestep limit either
+	cl_uchar	ucTileState = getTileState(pActivity, lTileX, lTileY);
+	if (ucTileState == TILE_DRY)
+		return;
+
+	// Per-tile maximum, shared with the other tiles once at the end
+	if (ulMaxSpeed != NULL)
+		dMaxSpeed = gts_edgeSpeed(pDomain, pCellStateSrc, dBedElevation, lTileX, lTileY, uiTileSize);
+
+	// Also don't bother if we've gone beyond the total simulation time,
+	// or the tile and its neighbours are dry, or it only holds edge cells
+	if (dLclTimestep <= 0.0 || ucTileState == TILE_DRAINED || lStartX >= lEndX || lStartY >= lEndY)
+	{
+		for (cl_long lIdxY = lStartY; lIdxY < lEndY && lStartX < lEndX; lIdxY++)
+		{
+			cl_ulong ulIdx = getCellID(pDomain, lStartX, lIdxY);
+			std::copy(pCellStateSrc + ulIdx, pCellStateSrc + ulIdx + (lEndX - lStartX), pCellStateDst + ulIdx);
+			for (cl_long lIdxX = lStartX; ulMaxSpeed != NULL && lIdxX < lEndX; lIdxX++, ulIdx++)
+				dMaxSpeed = std::max(dMaxSpeed, tst_CellSpeed(pCellStateSrc[ulIdx], dBedElevation[ulIdx]));
+		}
+		if (ulMaxSpeed != NULL)
+			tst_FoldSpeed(ulMaxSpeed, dMaxSpeed);
+		return;
+	}
+
+	// Scratch rows are the tile width plus the halo on either side
+	cl_long		lStride = (cl_long)uiTileSize.s[0] + 2;
+	cl_long		lHaloX = lStartX - 1;
+	cl_long		lHaloY = lStartY - 1;
+	cl_long		lHaloWidth = lEndX - lStartX + 2;
+	cl_double4*	pLclState = (cl_double4*)ghc.get_local_memory();
+	cl_double*	dLclBed = (cl_double*)(pLclState + lStride * ((cl_long)uiTileSize.s[1] + 2));
+
+	for (cl_long lIdxY = lHaloY; lIdxY <= lEndY; lIdxY++)
+	{
+		cl_ulong ulIdx = getCellID(pDomain, lHaloX, lIdxY);
+		cl_long lLclIdx = (lIdxY - lHaloY) * lStride;
+		std::copy(pCellStateSrc + ulIdx, pCellStateSrc + ulIdx + lHaloWidth, pLclState + lLclIdx);
+		std::copy(dBedElevation + ulIdx, dBedElevation + ulIdx + lHaloWidth, dLclBed + lLclIdx);
+	}
+
+	for (cl_long lIdxY = lStartY; lIdxY < lEndY; lIdxY++)
+	{
+		for (cl_long lIdxX = lStartX; lIdxX < lEndX; lIdxX++)
+		{
+			cl_ulong	ulIdx = getCellID(pDomain, lIdxX, lIdxY);
+			cl_long		lLclIdx = (lIdxY - lHaloY) * lStride + (lIdxX - lHaloX);
+			cl_double4	pCellData = pLclState[lLclIdx];
+
+			// Cell disabled?
+			if (pCellData.y <= -9999.0 || pCellData.x == -9999.0)
+			{
+				pCellStateDst[ulIdx] = pCellData;
+				continue;
+			}
+
+			pCellData = gts_updateCell<sRiemannHLLC>(
+				pDomain,
+				dLclTimestep,
+				pCellData, dLclBed[lLclIdx], dManning[ulIdx],
+				pLclState[lLclIdx + lStride], dLclBed[lLclIdx + lStride],
+				pLclState[lLclIdx + 1], dLclBed[lLclIdx + 1],
+				pLclState[lLclIdx - lStride], dLclBed[lLclIdx - lStride],
+				pLclState[lLclIdx - 1], dLclBed[lLclIdx - 1],
+				lIdxX == DEBUG_CELLX && lIdxY == DEBUG_CELLY
+			);
+			pCellStateDst[ulIdx] = pCellData;
+
+			if (ulMaxSpeed != NULL)
+				dMaxSpeed = std::max(dMaxSpeed, tst_CellSpeed(pCellData, dLclBed[lLclIdx]));
+		}
+	}
+
+	if (ulMaxSpeed != NULL)
+		tst_FoldSpeed(ulMaxSpeed, dMaxSpeed);
+}
+
+/*
+ *  One whole step of a tile in a single sweep, CPU variant. The tile is
+ *  copied with a one cell halo into scratch with the source terms of
+ *  bdy_Uniform and bdy_Gridded applied, then each cell is updated as by
+ *  gts_cacheDisabled, given the friction of per_Friction, checked as by
+ *  tst_CheckState and folded into the maximum of tst_Reduce while still in
+ *  cache. The source state is left without the source terms. Enqueue like
+ *  gts_cacheEnabled.
+ */
+template <typename TDomain, typename TRiemann>
+void gts_fusedStep(
+	const TDomain& pDomain,
+	cl_double* dTime,							// Model time
+	cl_double* dTimestep,						// Timestep
+	cl_double* dTimeHydrological,				// Time since the last hydrological step
+	const sBdyUniformConfiguration* pUniform,	// Uniform source term, or NULL
+	const cl_double2* pUniformSeries,			// Its series
+	const sBdyGriddedConfiguration* pGridded,	// Gridded source term, or NULL
+	const cl_double* pGriddedSeries,			// Its grids
+	cl_double* dBedElevation,					// Bed elevation
+	cl_double4* pCellStateSrc,					// Current cell state data
+	cl_double4* pCellStateDst,					// New cell state data
+	cl_double* dManning,						// Manning values
+	cl_uint2 uiTileSize,						// Cells per tile in x and y
+	std::atomic<cl_uint>* uiUnstable,			// Set when the new state is unstable, or NULL
+	std::atomic<cl_ulong>* ulMaxSpeed,			// Fastest wave speed of the new state, or NULL
+	GlobalHandlerClass ghc
+)
+{
+	cl_long		lTileX = ghc.get_global_id(0) * (cl_long)uiTileSize.s[0];
+	cl_long		lTileY = ghc.get_global_id(1) * (cl_long)uiTileSize.s[1];
+	cl_long		lCols = (cl_long)pDomain.Cols;
+	cl_long		lRows = (cl_long)pDomain.Rows;
+
+	if (lTileX >= lCols || lTileY >= lRows)
+		return;
+
+	// Tile clipped to the cells the scheme updates, halo clipped to the domain
+	cl_long		lStartX = std::max(lTileX, (cl_long)1);
+	cl_long		lStartY = std::max(lTileY, (cl_long)1);
+	cl_long		lEndX = std::min(lTileX + (cl_long)uiTileSize.s[0], lCols - 1);
+	cl_long		lEndY = std::min(lTileY + (cl_long)uiTileSize.s[1], lRows - 1);
+	cl_double	dLclTime = *dTime;
+	cl_double	dLclTimestep = *dTimestep;
+	cl_double	dLclTimeHydrological = *dTimeHydrological;
+	cl_double	dMaxSpeed = 0.0;
+	bool		bUnstable = false;
+
+	// Domain edge cells are never updated, only checked and reduced
+	for (cl_long lIdxY = lTileY; lIdxY < std::min(lTileY + (cl_long)uiTileSize.s[1], lRows); lIdxY++)
+	{
+		bool bEdgeRow = lIdxY == 0 || lIdxY == lRows - 1;
+		for (cl_long lIdxX = lTileX; lIdxX < std::min(lTileX + (cl_long)uiTileSize.s[0], lCols); lIdxX++)
+		{
+			if (!bEdgeRow && lIdxX != 0 && lIdxX != lCols - 1)
+				continue;
+			cl_ulong	ulIdx = getCellID(pDomain, lIdxX, lIdxY);
+			cl_double4	pCellData = pCellStateDst[ulIdx];
+			if (ulMaxSpeed != NULL)
+				dMaxSpeed = std::max(dMaxSpeed, tst_CellSpeed(pCellData, dBedElevation[ulIdx]));
+			if (uiUnstable != NULL && dLclTimestep > 0.0 && !(pCellData.y <= -9999.0 || pCellData.x == -9999.0))
+				bUnstable |= tst_CellUnstable(pCellData, dBedElevation[ulIdx]);
+		}
+	}
+
+	// Source terms of this step, as their kernels decide for every cell
+	bool		bUniform = pUniform != NULL && dLclTimeHydrological >= TIMESTEP_HYDROLOGICAL && dLclTimestep > 0.0 && dLclTime < pUniform->TimeseriesLength;
+	bool		bGridded = pGridded != NULL && dLclTimeHydrological >= TIMESTEP_HYDROLOGICAL;
+	cl_double2	dRecord = { 0.0, 0.0 };
+	cl_ulong	ulGridTimestep = 0;
+
+	if (bUniform)
+		dRecord = pUniformSeries[(cl_ulong)floor(dLclTime / pUniform->TimeseriesInterval)];
+	if (bGridded)
+		ulGridTimestep = std::min((cl_ulong)floor(dLclTime / pGridded->TimeseriesInterval), pGridded->TimeseriesEntries);
+
+	// Scratch rows are the tile width plus the halo on either side
+	cl_long		lStride = (cl_long)uiTileSize.s[0] + 2;
+	cl_long		lHaloX = lStartX - 1;
+	cl_long		lHaloY = lStartY - 1;
+	cl_long		lHaloWidth = lEndX - lStartX + 2;
+	cl_double4*	pLclState = (cl_double4*)ghc.get_local_memory();
+	cl_double*	dLclBed = (cl_double*)(pLclState + lStride * ((cl_long)uiTileSize.s[1] + 2));
+
+	// Tiles of edge cells only load nothing
+	for (cl_long lIdxY = lHaloY; lIdxY <= lEndY && lStartX < lEndX && lStartY < lEndY; lIdxY++)
+	{
+		cl_ulong ulIdx = getCellID(pDomain, lHaloX, lIdxY);
+		cl_long lLclIdx = (lIdxY - lHaloY) * lStride;
+		std::copy(pCellStateSrc + ulIdx, pCellStateSrc + ulIdx + lHaloWidth, pLclState + lLclIdx);
+		std::copy(dBedElevation + ulIdx, dBedElevation + ulIdx + lHaloWidth, dLclBed + lLclIdx);
+
+		// The halo gets the same source terms its own tile applies
+		if (!(bUniform || bGridded) || lIdxY == 0 || lIdxY == lRows - 1)
+			continue;
+		for (cl_long lIdxX = std::max(lHaloX, (cl_long)1); lIdxX < std::min(lHaloX + lHaloWidth, lCols - 1); lIdxX++)
+		{
+			cl_long		lLclCell = lLclIdx + lIdxX - lHaloX;
+			cl_double4	pCellData = pLclState[lLclCell];
+
+			if (bUniform && pCellData.y > -9999.0)
+				pCellData = bdy_UniformCell(*pUniform, dRecord, dLclTimeHydrological, pCellData, dLclBed[lLclCell]);
+			if (bGridded && !(pCellData.y <= -9999.0 || pCellData.x == -9999.0))
+				pCellData = bdy_GriddedCell(pDomain, *pGridded, pGriddedSeries, ulGridTimestep, dLclTimeHydrological, lIdxX, lIdxY, pCellData);
+			pLclState[lLclCell] = pCellData;
+		}
+	}
+
+	for (cl_long lIdxY = lStartY; lIdxY < lEndY; lIdxY++)
+	{
+		for (cl_long lIdxX = lStartX; lIdxX < lEndX; lIdxX++)
+		{
+			cl_ulong	ulIdx = getCellID(pDomain, lIdxX, lIdxY);
+			cl_long		lLclIdx = (lIdxY - lHaloY) * lStride + (lIdxX - lHaloX);
+			cl_double4	pCellData = pLclState[lLclIdx];
+			cl_double	dCellBedElev = dLclBed[lLclIdx];
+
+			// A suspended step only hands the state on
+			if (dLclTimestep > 0.0)
+			{
+				cl_double dManningCoef = dManning[ulIdx];
+
+				if (!(pCellData.y <= -9999.0 || pCellData.x == -9999.0))
+					pCellData = gts_updateCell<TRiemann>(
+						pDomain,
+						dLclTimestep,
+						pCellData, dCellBedElev, dManningCoef,
+						pLclState[lLclIdx + lStride], dLclBed[lLclIdx + lStride],
+						pLclState[lLclIdx + 1], dLclBed[lLclIdx + 1],
+						pLclState[lLclIdx - lStride], dLclBed[lLclIdx - lStride],
+						pLclState[lLclIdx - 1], dLclBed[lLclIdx - 1],
+						lIdxX == DEBUG_CELLX && lIdxY == DEBUG_CELLY
+					);
+
+				// Friction applies to disabled cells too, as in per_Friction
+				if (!(pCellData.x - dCellBedElev < VERY_SMALL))
+					pCellData = implicitFriction(pCellData, dCellBedElev, dManningCoef, dLclTimestep);
+
+				if (uiUnstable != NULL && !(pCellData.y <= -9999.0 || pCellData.x == -9999.0))
+					bUnstable |= tst_CellUnstable(pCellData, dCellBedElev);
+			}
+			pCellStateDst[ulIdx] = pCellData;
+
+			if (ulMaxSpeed != NULL)
+				dMaxSpeed = std::max(dMaxSpeed, tst_CellSpeed(pCellData, dCellBedElev));
+		}
+	}
+
+	if (bUnstable)
+		uiUnstable->store(1, std::memory_order_relaxed);
+	if (ulMaxSpeed != NULL)
+		tst_FoldSpeed(ulMaxSpeed, dMaxSpeed);
+}
+
+/*
+ *  Solve the Riemann problem at one interface for both adjacent cells.
+ *  ucDirection is DOMAIN_DIR_E or DOMAIN_DIR_N, as seen from the left cell.
+ */
+template <cl_uchar ucDirection>
+void gts_solveFace(
+	cl_double4		pStateLeft,
+	cl_double		dBedLeft,
+	cl_double4		pStateRight,
+	cl_double		dBedRight,
+	sFaceFlux*		pFace
+)
+{
+	const cl_uchar	ucDirectionRight = (ucDirection == DOMAIN_DIR_E ? DOMAIN_DIR_W : DOMAIN_DIR_S);
+	cl_double8		pLeft, pRight;
+	cl_double		dBedMaximum = (dBedLeft > dBedRight ? dBedLeft : dBedRight);
+
+	pFace->ucDry = (pStateLeft.x - dBedLeft < VERY_SMALL ? 1 : 0) |
+		(pStateRight.x - dBedRight < VERY_SMALL ? 2 : 0);
+
+	pFace->ucStopL = reconstructInterface<ucDirection>(pStateLeft, dBedLeft, pStateRight, dBedRight, dBedMaximum, &pLeft, &pRight);
+	pFace->pViewL.s[0] = pRight.s[0];
+	pFace->pViewL.s[1] = pRight.s[6];
+	pFace->pFluxL = riemannSolver<ucDirection>(pLeft, pRight, false);
+
+	// Each side shifts the interface by its own level, see reconstructInterface
+	cl_double	dShiftL = dBedMaximum - pStateLeft.s[0];
+	cl_double	dShiftR = dBedMaximum - pStateRight.s[0];
+	if (dShiftL < 0.0) dShiftL = 0.0;
+	if (dShiftR < 0.0) dShiftR = 0.0;
+
+	if (dShiftL == dShiftR)
+	{
+		// Same Riemann problem, only the first stopping condition is one-sided
+		cl_double	dDischargeL = (ucDirection == DOMAIN_DIR_E ? pStateLeft.z : pStateLeft.w);
+		cl_double	dDischargeR = (ucDirection == DOMAIN_DIR_E ? pStateRight.z : pStateRight.w);
+		cl_uchar	ucFirstL = (pLeft.s[1] <= VERY_SMALL && dDischargeL > 0.0) ? 1 : 0;
+		cl_uchar	ucFirstR = (pRight.s[1] <= VERY_SMALL && dDischargeR < 0.0) ? 1 : 0;
+
+		pFace->ucStopR = pFace->ucStopL - ucFirstL + ucFirstR;
+		pFace->pViewR.s[0] = pLeft.s[0];
+		pFace->pViewR.s[1] = pLeft.s[6];
+		pFace->pFluxR = pFace->pFluxL;
+		return;
+	}
+
+	pFace->ucStopR = reconstructInterface<ucDirectionRight>(pStateLeft, dBedLeft, pStateRight, dBedRight, dBedMaximum, &pLeft, &pRight);
+	pFace->pViewR.s[0] = pLeft.s[0];
+	pFace->pViewR.s[1] = pLeft.s[6];
+	pFace->pFluxR = riemannSolver<ucDirectionRight>(pLeft, pRight, false);
+}
+
+/*
+ *  Same for a direction only known at run time
+ */
+void gts_solveFace(
+	cl_uchar		ucDirection,
+	cl_double4		pStateLeft,
+	cl_double		dBedLeft,
+	cl_double4		pStateRight,
+	cl_double		dBedRight,
+	sFaceFlux*		pFace
+)
+{
+	if (ucDirection == DOMAIN_DIR_E)
+		gts_solveFace<DOMAIN_DIR_E>(pStateLeft, dBedLeft, pStateRight, dBedRight, pFace);
+	else
+		gts_solveFace<DOMAIN_DIR_N>(pStateLeft, dBedLeft, pStateRight, dBedRight, pFace);
+}
+
+/*
+ *  Face pass: each work-item solves the east and north faces of its cell,
+ *  so every interior interface is solved once. Faces are indexed by the
+ *  ID of their left (west/south) cell.
+ */
+template <typename TDomain>
+void gts_faceFluxes(
+	const TDomain& pDomain,
+	cl_double* dTimestep,						// Timestep
+	cl_double* dBedElevation,					// Bed elevation
+	cl_double4* pCellStateSrc,					// Current cell state data
+	sFaceFlux* pFacesE,							// East face of each cell
+	sFaceFlux* pFacesN,							// North face of each cell
+	GlobalHandlerClass ghc
+)
+{
+	cl_long					lIdxX = ghc.get_global_id(0);
+	cl_long					lIdxY = ghc.get_global_id(1);
+	cl_long					lCols = pDomain.Cols;
+	cl_long					lRows = pDomain.Rows;
+	cl_ulong				ulIdx;
+
+	if (lIdxX >= lCols || lIdxY >= lRows || *dTimestep <= 0.0)
+		return;
+
+	ulIdx = getCellID(pDomain, lIdxX, lIdxY);
+
+	// -> East, only interior rows are updated
+	if (lIdxX < lCols - 1 && lIdxY > 0 && lIdxY < lRows - 1)
+		gts_solveFace<DOMAIN_DIR_E>(
+			pCellStateSrc[ulIdx], dBedElevation[ulIdx],
+			pCellStateSrc[ulIdx + 1], dBedElevation[ulIdx + 1],
+			&pFacesE[ulIdx]
+		);
+
+	// -> North, only interior columns are updated
+	if (lIdxY < lRows - 1 && lIdxX > 0 && lIdxX < lCols - 1)
+		gts_solveFace<DOMAIN_DIR_N>(
+			pCellStateSrc[ulIdx], dBedElevation[ulIdx],
+			pCellStateSrc[ulIdx + lCols], dBedElevation[ulIdx + lCols],
+			&pFacesN[ulIdx]
+		);
+}
+
+/*
+ *  Solve ulCount faces of one direction along a row, the right cell of
+ *  each face ulStride cells after its left one
+ */
+template <cl_uchar ucDirection>
+inline void gts_faceSweep(
+	cl_double* dBedElevation,
+	cl_double4* pCellStateSrc,
+	sFaceFlux* pFaces,
+	cl_ulong ulFirst,							// Left cell of the first face
+	cl_ulong ulCount,							// Faces along the row
+	cl_ulong ulStride							// Right cell - left cell
+)
+{
+	for (cl_ulong ulIdx = ulFirst; ulIdx < ulFirst + ulCount; ulIdx++)
+		gts_solveFace<ucDirection>(
+			pCellStateSrc[ulIdx], dBedElevation[ulIdx],
+			pCellStateSrc[ulIdx + ulStride], dBedElevation[ulIdx + ulStride],
+			&pFaces[ulIdx]
+		);
+}
+
+/*
+ *  Face pass of gts_faceFluxes, one work-item per row. The east faces of
+ *  the row are swept first, then its north faces, each sweep in a single
+ *  direction.
+ */
+template <typename TDomain>
+void gts_faceFluxesRows(
+	const TDomain& pDomain,
+	cl_double* dTimestep,						// Timestep
+	cl_double* dBedElevation,					// Bed elevation
+	cl_double4* pCellStateSrc,					// Current cell state data
+	sFaceFlux* pFacesE,							// East face of each cell
+	sFaceFlux* pFacesN,							// North face of each cell
+	GlobalHandlerClass ghc
+)
+{
+	cl_long		lIdxY = ghc.get_global_id(1);
+	cl_long		lRows = pDomain.Rows;
+	cl_long		lCols = pDomain.Cols;
+
+	if (lIdxY >= lRows - 1 || *dTimestep <= 0.0)
+		return;
+
+	cl_ulong	ulRow = getCellID(pDomain, 0, lIdxY);
+
+	// -> East, interior rows from the western ring to the last interior cell
+	if (lIdxY > 0)
+		gts_faceSweep<DOMAIN_DIR_E>(dBedElevation, pCellStateSrc, pFacesE, ulRow, lCols - 1, 1);
+
+	// -> North, interior columns
+	gts_faceSweep<DOMAIN_DIR_N>(dBedElevation, pCellStateSrc, pFacesN, ulRow + 1, lCols - 2, lCols);
+}
+
+/*
+ *  Divergence of the face fluxes and the source terms of one interior cell
+ */
+template <typename TDomain>
+inline void gts_faceUpdateCell(
+	const TDomain& pDomain,
+	cl_double dLclTimestep,
+	cl_double* dBedElevation,
+	cl_double4* pCellStateSrc,
+	cl_double4* pCellStateDst,
+	cl_double* dManning,
+	sFaceFlux* pFacesE,
+	sFaceFlux* pFacesN,
+	cl_ulong ulIdx
+)
+{
+	cl_double4		pCellData = pCellStateSrc[ulIdx];
+
+	// Also don't bother if we've gone beyond the total simulation time,
+	// or the cell is disabled
+	if (dLclTimestep <= 0.0 || pCellData.y <= -9999.0 || pCellData.x == -9999.0)
+	{
+		pCellStateDst[ulIdx] = pCellData;
+		return;
+	}
+
+	const sFaceFlux&	pFaceN = pFacesN[ulIdx];
+	const sFaceFlux&	pFaceE = pFacesE[ulIdx];
+	const sFaceFlux&	pFaceS = pFacesN[ulIdx - pDomain.Cols];
+	const sFaceFlux&	pFaceW = pFacesE[ulIdx - 1];
+
+	// All neighbours are dry? Don't bother calculating
+	if ((pFaceN.ucDry & pFaceE.ucDry & pFaceS.ucDry & pFaceW.ucDry) == 3)
+	{
+		pCellStateDst[ulIdx] = pCellData;
+		return;
+	}
+
+	cl_double4	pFlux[4];
+	pFlux[DOMAIN_DIR_N] = pFaceN.pFluxL;
+	pFlux[DOMAIN_DIR_E] = pFaceE.pFluxL;
+	pFlux[DOMAIN_DIR_S] = pFaceS.pFluxR;
+	pFlux[DOMAIN_DIR_W] = pFaceW.pFluxR;
+
+	pCellStateDst[ulIdx] = gts_applyFluxes(
+		pDomain,
+		dLclTimestep,
+		pCellData, dBedElevation[ulIdx], dManning[ulIdx],
+		pFlux,
+		pFaceN.pViewL.s[0], pFaceN.pViewL.s[1],
+		pFaceE.pViewL.s[0], pFaceE.pViewL.s[1],
+		pFaceS.pViewR.s[0], pFaceS.pViewR.s[1],
+		pFaceW.pViewR.s[0], pFaceW.pViewR.s[1],
+		pFaceN.ucStopL + pFaceE.ucStopL + pFaceS.ucStopR + pFaceW.ucStopR
+	);
+}
+
+/*
+ *  Cell pass: divergence of the face fluxes and the source terms.
+ *  Gives the same result as gts_cacheDisabled.
+ */
+template <typename TDomain>
+void gts_faceUpdate(
+	const TDomain& pDomain,
+	cl_double* dTimestep,						// Timestep
+	cl_double* dBedElevation,					// Bed elevation
+	cl_double4* pCellStateSrc,					// Current cell state data
+	cl_double4* pCellStateDst,					// Current cell state data
+	cl_double* dManning,						// Manning values
+	sFaceFlux* pFacesE,							// East face of each cell
+	sFaceFlux* pFacesN,							// North face of each cell
+	std::atomic<cl_ulong>* ulMaxSpeed,			// Fastest wave speed of the new state, or NULL
+	GlobalHandlerClass ghc
+)
+{
+	cl_long					lIdxX = ghc.get_global_id(0);
+	cl_long					lIdxY = ghc.get_global_id(1);
+	cl_ulong				ulIdx = getCellID(pDomain, lIdxX, lIdxY);
+
+	// Don't bother if we've gone beyond the domain bounds
+	if (lIdxX >= (cl_long)pDomain.Cols - 1 ||
+		lIdxY >= (cl_long)pDomain.Rows - 1 ||
+		lIdxX <= 0 ||
+		lIdxY <= 0)
+	{
+		// Edge cells keep their state but still limit the timestep
+		if (ulMaxSpeed != NULL && lIdxX < (cl_long)pDomain.Cols && lIdxY < (cl_long)pDomain.Rows)
+			tst_FoldSpeed(ulMaxSpeed, tst_CellSpeed(pCellStateSrc[ulIdx], dBedElevation[ulIdx]));
+		return;
+	}
+
+	gts_faceUpdateCell(pDomain, *dTimestep, dBedElevation, pCellStateSrc, pCellStateDst, dManning, pFacesE, pFacesN, ulIdx);
+
+	// Wave speed of the new state for the next timestep
+	if (ulMaxSpeed != NULL)
+		tst_FoldSpeed(ulMaxSpeed, tst_CellSpeed(pCellStateDst[ulIdx], dBedElevation[ulIdx]));
+}
+
+/*
+ *  Cell pass over the cells lStartX to lEndX (excluded) of interior row
+ *  lIdxY, for kernels that sweep their own ranges of cells
+ */
+template <typename TDomain>
+void gts_faceUpdateSpan(
+	const TDomain& pDomain,
+	cl_double dTimestep,						// Timestep
+	cl_double* dBedElevation,					// Bed elevation
+	cl_double4* pCellStateSrc,					// Current cell state data
+	cl_double4* pCellStateDst,					// Current cell state data
+	cl_double* dManning,						// Manning values
+	sFaceFlux* pFacesE,							// East face of each cell
+	sFaceFlux* pFacesN,							// North face of each cell
+	cl_long lIdxY,
+	cl_long lStartX,
+	cl_long lEndX
+)
+{
+	cl_ulong	ulIdx = getCellID(pDomain, lStartX, lIdxY);
+
+	for (cl_long lIdxX = lStartX; lIdxX < lEndX; lIdxX++, ulIdx++)
+		gts_faceUpdateCell(pDomain, dTimestep, dBedElevation, pCellStateSrc, pCellStateDst, dManning, pFacesE, pFacesN, ulIdx);
+}
+
+template void gts_cacheDisabled<sDomainConfiguration, sRiemannHLLC>(const sDomainConfiguration&, cl_double*, cl_double*, cl_double4*, cl_double4*, cl_double*, const sTileActivity*, const sFaceGeometry*, const cl_double4*, std::atomic<cl_ulong>*, GlobalHandlerClass);
+template void gts_cacheDisabled<sDomainCompiled, sRiemannHLLC>(const sDomainCompiled&, cl_double*, cl_double*, cl_double4*, cl_double4*, cl_double*, const sTileActivity*, const sFaceGeometry*, const cl_double4*, std::atomic<cl_ulong>*, GlobalHandlerClass);
+template void gts_cacheDisabled<sDomainConfiguration, sRiemannHLL>(const sDomainConfiguration&, cl_double*, cl_double*, cl_double4*, cl_double4*, cl_double*, const sTileActivity*, const sFaceGeometry*, const cl_double4*, std::atomic<cl_ulong>*, GlobalHandlerClass);
+template void gts_cacheDisabled<sDomainCompiled, sRiemannHLL>(const sDomainCompiled&, cl_double*, cl_double*, cl_double4*, cl_double4*, cl_double*, const sTileActivity*, const sFaceGeometry*, const cl_double4*, std::atomic<cl_ulong>*, GlobalHandlerClass);
+template void gts_cacheDisabled<sDomainConfiguration, sRiemannRusanov>(const sDomainConfiguration&, cl_double*, cl_double*, cl_double4*, cl_double4*, cl_double*, const sTileActivity*, const sFaceGeometry*, const cl_double4*, std::atomic<cl_ulong>*, GlobalHandlerClass);
+template void gts_cacheDisabled<sDomainCompiled, sRiemannRusanov>(const sDomainCompiled&, cl_double*, cl_double*, cl_double4*, cl_double4*, cl_double*, const sTileActivity*, const sFaceGeometry*, const cl_double4*, std::atomic<cl_ulong>*, GlobalHandlerClass);
+template void gts_Primitives<sDomainConfiguration>(const sDomainConfiguration&, cl_double4*, cl_double*, cl_double4*, GlobalHandlerClass);
+template void gts_Primitives<sDomainCompiled>(const sDomainCompiled&, cl_double4*, cl_double*, cl_double4*, GlobalHandlerClass);
+template void gts_interior<sDomainConfiguration, sRiemannHLLC>(const sDomainConfiguration&, cl_double*, cl_double*, cl_double4*, cl_double4*, cl_double*, std::atomic<cl_ulong>*, GlobalHandlerClass);
+template void gts_interior<sDomainCompiled, sRiemannHLLC>(const sDomainCompiled&, cl_double*, cl_double*, cl_double4*, cl_double4*, cl_double*, std::atomic<cl_ulong>*, GlobalHandlerClass);
+template void gts_interior<sDomainConfiguration, sRiemannHLL>(const sDomainConfiguration&, cl_double*, cl_double*, cl_double4*, cl_double4*, cl_double*, std::atomic<cl_ulong>*, GlobalHandlerClass);
+template void gts_interior<sDomainCompiled, sRiemannHLL>(const sDomainCompiled&, cl_double*, cl_double*, cl_double4*, cl_double4*, cl_double*, std::atomic<cl_ulong>*, GlobalHandlerClass);
+template void gts_interior<sDomainConfiguration, sRiemannRusanov>(const sDomainConfiguration&, cl_double*, cl_double*, cl_double4*, cl_double4*, cl_double*, std::atomic<cl_ulong>*, GlobalHandlerClass);
+template void gts_interior<sDomainCompiled, sRiemannRusanov>(const sDomainCompiled&, cl_double*, cl_double*, cl_double4*, cl_double4*, cl_double*, std::atomic<cl_ulong>*, GlobalHandlerClass);
+template void gts_cacheDisabledSoA<sDomainConfiguration>(const sDomainConfiguration&, cl_double*, cl_double*, sCellStateSoA, sCellStateSoA, cl_double*, std::atomic<cl_ulong>*, GlobalHandlerClass);
+template void gts_cacheDisabledSoA<sDomainCompiled>(const sDomainCompiled&, cl_double*, cl_double*, sCellStateSoA, sCellStateSoA, cl_double*, std::atomic<cl_ulong>*, GlobalHandlerClass);
+template void gts_cacheDisabledPrecision<sDomainConfiguration, sPrecisionDouble>(const sDomainConfiguration&, cl_double*, cl_double*, cl_double4*, cl_double4*, cl_double*, GlobalHandlerClass);
+template void gts_cacheDisabledPrecision<sDomainCompiled, sPrecisionDouble>(const sDomainCompiled&, cl_double*, cl_double*, cl_double4*, cl_double4*, cl_double*, GlobalHandlerClass);
+template void gts_cacheDisabledPrecision<sDomainConfiguration, sPrecisionFloat>(const sDomainConfiguration&, cl_double*, cl_float*, cl_float4*, cl_float4*, cl_float*, GlobalHandlerClass);
+template void gts_cacheDisabledPrecision<sDomainCompiled, sPrecisionFloat>(const sDomainCompiled&, cl_double*, cl_float*, cl_float4*, cl_float4*, cl_float*, GlobalHandlerClass);
+template void gts_ensemble<sDomainConfiguration>(const sDomainConfiguration&, cl_double*, cl_double*, cl_uint, sCellStateSoA, sCellStateSoA, cl_double*, GlobalHandlerClass);
+template void gts_ensemble<sDomainCompiled>(const sDomainCompiled&, cl_double*, cl_double*, cl_uint, sCellStateSoA, sCellStateSoA, cl_double*, GlobalHandlerClass);
+template void gts_cacheEnabled<sDomainConfiguration>(const sDomainConfiguration&, cl_double*, cl_double*, cl_double4*, cl_double4*, cl_double*, cl_uint2, const sTileActivity*, std::atomic<cl_ulong>*, GlobalHandlerClass);
+template void gts_cacheEnabled<sDomainCompiled>(const sDomainCompiled&, cl_double*, cl_double*, cl_double4*, cl_double4*, cl_double*, cl_uint2, const sTileActivity*, std::atomic<cl_ulong>*, GlobalHandlerClass);
+template void gts_fusedStep<sDomainConfiguration, sRiemannHLLC>(const sDomainConfiguration&, cl_double*, cl_double*, cl_double*, const sBdyUniformConfiguration*, const cl_double2*, const sBdyGriddedConfiguration*, const cl_double*, cl_double*, cl_double4*, cl_double4*, cl_double*, cl_uint2, std::atomic<cl_uint>*, std::atomic<cl_ulong>*, GlobalHandlerClass);
+template void gts_fusedStep<sDomainCompiled, sRiemannHLLC>(const sDomainCompiled&, cl_double*, cl_double*, cl_double*, const sBdyUniformConfiguration*, const cl_double2*, const sBdyGriddedConfiguration*, const cl_double*, cl_double*, cl_double4*, cl_double4*, cl_double*, cl_uint2, std::atomic<cl_uint>*, std::atomic<cl_ulong>*, GlobalHandlerClass);
+template void gts_fusedStep<sDomainConfiguration, sRiemannHLL>(const sDomainConfiguration&, cl_double*, cl_double*, cl_double*, const sBdyUniformConfiguration*, const cl_double2*, const sBdyGriddedConfiguration*, const cl_double*, cl_double*, cl_double4*, cl_double4*, cl_double*, cl_uint2, std::atomic<cl_uint>*, std::atomic<cl_ulong>*, GlobalHandlerClass);
+template void gts_fusedStep<sDomainCompiled, sRiemannHLL>(const sDomainCompiled&, cl_double*, cl_double*, cl_double*, const sBdyUniformConfiguration*, const cl_double2*, const sBdyGriddedConfiguration*, const cl_double*, cl_double*, cl_double4*, cl_double4*, cl_double*, cl_uint2, std::atomic<cl_uint>*, std::atomic<cl_ulong>*, GlobalHandlerClass);
+template void gts_fusedStep<sDomainConfiguration, sRiemannRusanov>(const sDomainConfiguration&, cl_double*, cl_double*, cl_double*, const sBdyUniformConfiguration*, const cl_double2*, const sBdyGriddedConfiguration*, const cl_double*, cl_double*, cl_double4*, cl_double4*, cl_double*, cl_uint2, std::atomic<cl_uint>*, std::atomic<cl_ulong>*, GlobalHandlerClass);
+template void gts_fusedStep<sDomainCompiled, sRiemannRusanov>(const sDomainCompiled&, cl_double*, cl_double*, cl_double*, const sBdyUniformConfiguration*, const cl_double2*, const sBdyGriddedConfiguration*, const cl_double*, cl_double*, cl_double4*, cl_double4*, cl_double*, cl_uint2, std::atomic<cl_uint>*, std::atomic<cl_ulong>*, GlobalHandlerClass);
+template void gts_faceFluxes<sDomainConfiguration>(const sDomainConfiguration&, cl_double*, cl_double*, cl_double4*, sFaceFlux*, sFaceFlux*, GlobalHandlerClass);
+template void gts_faceFluxes<sDomainCompiled>(const sDomainCompiled&, cl_double*, cl_double*, cl_double4*, sFaceFlux*, sFaceFlux*, GlobalHandlerClass);
+template void gts_faceFluxesRows<sDomainConfiguration>(const sDomainConfiguration&, cl_double*, cl_double*, cl_double4*, sFaceFlux*, sFaceFlux*, GlobalHandlerClass);
+template void gts_faceFluxesRows<sDomainCompiled>(const sDomainCompiled&, cl_double*, cl_double*, cl_double4*, sFaceFlux*, sFaceFlux*, GlobalHandlerClass);
+template void gts_faceUpdate<sDomainConfiguration>(const sDomainConfiguration&, cl_double*, cl_double*, cl_double4*, cl_double4*, cl_double*, sFaceFlux*, sFaceFlux*, std::atomic<cl_ulong>*, GlobalHandlerClass);
+template void gts_faceUpdate<sDomainCompiled>(const sDomainCompiled&, cl_double*, cl_double*, cl_double4*, cl_double4*, cl_double*, sFaceFlux*, sFaceFlux*, std::atomic<cl_ulong>*, GlobalHandlerClass);
+template void gts_faceUpdateSpan<sDomainConfiguration>(const sDomainConfiguration&, cl_double, cl_double*, cl_double4*, cl_double4*, cl_double*, sFaceFlux*, sFaceFlux*, cl_long, cl_long, cl_long);
+template void gts_faceUpdateSpan<sDomainCompiled>(const sDomainCompiled&, cl_double, cl_double*, cl_double4*, cl_double4*, cl_double*, sFaceFlux*, sFaceFlux*, cl_long, cl_long, cl_long);
+template void gts_solveFace<DOMAIN_DIR_E>(cl_double4, cl_double, cl_double4, cl_double, sFaceFlux*);
+template void gts_solveFace<DOMAIN_DIR_N>(cl_double4, cl_double, cl_double4, cl_double, sFaceFlux*);
+
 void rp(cl_double8 d1, cl_double8 d2) {
 
 	cl_double4 alaa = riemannSolver(
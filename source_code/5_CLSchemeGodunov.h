@@ -7,6 +7,7 @@
 
 #pragma once
 #include "definitions.h"
+#include "3_CLSolverHLLC.h"
 
 //Implementation of the 1st order accurate Godunov - type scheme for execution on the GPU.
 
@@ -51,3 +52,153 @@ cl_uchar reconstructInterface(
 
 #endif
 
+template <typename TDomain, typename TRiemann = sRiemannHLLC>
+void gts_interior(
+	const TDomain&,
+	cl_double*,
+	cl_double*,
+	cl_double4*,
+	cl_double4*,
+	cl_double*,
+	std::atomic<cl_ulong>*,
+	GlobalHandlerClass
+);
+
+template <typename TDomain>
+void gts_cacheEnabled(
+	const TDomain&,
+	cl_double*,
+	cl_double*,
+	cl_double4*,
+	cl_double4*,
+	cl_double*,
+	cl_uint2,
+	const sTileActivity*,
+	std::atomic<cl_ulong>*,
+	GlobalHandlerClass
+);
+
+template <typename TDomain, typename TRiemann = sRiemannHLLC>
+void gts_fusedStep(
+	const TDomain&,
+	cl_double*,
+	cl_double*,
+	cl_double*,
+	const sBdyUniformConfiguration*,
+	const cl_double2*,
+	const sBdyGriddedConfiguration*,
+	const cl_double*,
+	cl_double*,
+	cl_double4*,
+	cl_double4*,
+	cl_double*,
+	cl_uint2,
+	std::atomic<cl_uint>*,
+	std::atomic<cl_ulong>*,
+	GlobalHandlerClass
+);
+
+template <typename TDomain, typename TPrecision>
+void gts_cacheDisabledPrecision(
+	const TDomain&,
+	cl_double*,
+	typename TPrecision::Real*,
+	typename TPrecision::State*,
+	typename TPrecision::State*,
+	typename TPrecision::Real*,
+	GlobalHandlerClass
+);
+
+size_t gts_cacheEnabledScratchSize(
+	cl_uint2
+);
+
+template <typename TDomain>
+void gts_Primitives(
+	const TDomain&,
+	cl_double4*,
+	cl_double*,
+	cl_double4*,
+	GlobalHandlerClass
+);
+
+// Fluxes through one interface as seen from either side. The left cell is
+// the west/south one. Both sides only differ when their vertical shifts do.
+typedef struct sFaceFlux {
+	cl_double4	pFluxL;			// Z, Qx, Qy flux for the left cell
+	cl_double4	pFluxR;			// Z, Qx, Qy flux for the right cell
+	cl_double2	pViewL;			// Reconstructed Z, Zb of the right cell, seen from the left
+	cl_double2	pViewR;			// Reconstructed Z, Zb of the left cell, seen from the right
+	cl_uchar	ucStopL;		// Stopping conditions raised for the left cell
+	cl_uchar	ucStopR;		// Stopping conditions raised for the right cell
+	cl_uchar	ucDry;			// Bit 0 left cell dry, bit 1 right cell dry
+} sFaceFlux;
+
+void gts_solveFace(
+	cl_uchar,
+	cl_double4,
+	cl_double,
+	cl_double4,
+	cl_double,
+	sFaceFlux*
+);
+
+template <cl_uchar ucDirection>
+void gts_solveFace(
+	cl_double4,
+	cl_double,
+	cl_double4,
+	cl_double,
+	sFaceFlux*
+);
+
+template <typename TDomain>
+void gts_faceFluxes(
+	const TDomain&,
+	cl_double*,
+	cl_double*,
+	cl_double4*,
+	sFaceFlux*,
+	sFaceFlux*,
+	GlobalHandlerClass
+);
+
+template <typename TDomain>
+void gts_faceFluxesRows(
+	const TDomain&,
+	cl_double*,
+	cl_double*,
+	cl_double4*,
+	sFaceFlux*,
+	sFaceFlux*,
+	GlobalHandlerClass
+);
+
+template <typename TDomain>
+void gts_faceUpdate(
+	const TDomain&,
+	cl_double*,
+	cl_double*,
+	cl_double4*,
+	cl_double4*,
+	cl_double*,
+	sFaceFlux*,
+	sFaceFlux*,
+	std::atomic<cl_ulong>*,
+	GlobalHandlerClass
+);
+
+template <typename TDomain>
+void gts_faceUpdateSpan(
+	const TDomain&,
+	cl_double,
+	cl_double*,
+	cl_double4*,
+	cl_double4*,
+	cl_double*,
+	sFaceFlux*,
+	sFaceFlux*,
+	cl_long,
+	cl_long,
+	cl_long
+);
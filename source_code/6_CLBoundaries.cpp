@@ -10,7 +10,9 @@
 
 //Management functions for a domain boundaries.
 
+template <typename TDomain>
 void bdy_Cell(
+	const TDomain& pDomain,
 	sBdyCellConfiguration* pConfiguration,
 	cl_ulong* pRelations,
 	cl_double4* pTimeseries,
@@ -75,7 +77,7 @@ void bdy_Cell(
 			pConfig.DefinitionDischarge == BOUNDARY_DISCHARGE_IS_VOLUME)
 		{
 			// Calculate a suitable depth based
-			cl_double dDepth = (fabs(pTSInterp.z) * dLocalTimestep) / DOMAIN_DELTAY + (fabs(pTSInterp.w) * dLocalTimestep) / DOMAIN_DELTAX;
+			cl_double dDepth = (fabs(pTSInterp.z) * dLocalTimestep) / pDomain.DeltaY + (fabs(pTSInterp.w) * dLocalTimestep) / pDomain.DeltaX;
 			cl_double dNormalDepth = fmax(pow(pTSInterp.z, 2) / GRAVITY, pow(pTSInterp.w, 2) / GRAVITY);
 			cl_double dCriticalDepth = fmax(pow(pow(pTSInterp.z, 2) / GRAVITY, 1.0 / 3.0), pow(pow(pTSInterp.w, 2) / GRAVITY, 1.0 / 3.0));
 
@@ -85,7 +87,7 @@ void bdy_Cell(
 			{
 				// In the case of volume boundaries, no scaling has taken place
 				dNormalDepth = 0.0;
-				dDepth = (fabs(pTSInterp.z) * dLocalTimestep) / (DOMAIN_DELTAX * DOMAIN_DELTAY);
+				dDepth = (fabs(pTSInterp.z) * dLocalTimestep) / (pDomain.DeltaX * pDomain.DeltaY);
 				dCriticalDepth = 0.0;
 				pTSInterp.z = 0.0;
 				pTSInterp.w = 0.0;
@@ -126,7 +128,9 @@ void bdy_Cell(
 	pCellState[ulCellID] = pCellData;
 }
 
+template <typename TDomain>
 void bdy_Uniform(
+	const TDomain& pDomain,
 	sBdyUniformConfiguration* pConfiguration,
 	cl_double2* pTimeseries,
 	cl_double* pTime,
@@ -145,13 +149,13 @@ void bdy_Uniform(
 	cl_ulong		ulIdx;
 
 	// Don't bother if we've gone beyond the domain bounds
-	if (lIdxX >= DOMAIN_COLS - 1 ||
-		lIdxY >= DOMAIN_ROWS - 1 ||
+	if (lIdxX >= (cl_long)pDomain.Cols - 1 ||
+		lIdxY >= (cl_long)pDomain.Rows - 1 ||
 		lIdxX <= 0 ||
 		lIdxY <= 0)
 		return;
 
-	ulIdx = getCellID(lIdxX, lIdxY);
+	ulIdx = getCellID(pDomain, lIdxX, lIdxY);
 
 	// How far in to the simulation are we? And current cell data
 	sBdyUniformConfiguration	pConfig = *pConfiguration;
@@ -172,18 +176,257 @@ void bdy_Uniform(
 	cl_ulong ulTimestep = (cl_ulong)floor(dLclTime / pConfig.TimeseriesInterval);
 	cl_double2 dRecord = pTimeseries[ulTimestep];
 
-	// Apply the value...
+	// Apply the value and return to global memory
+	pCellState[ulIdx] = bdy_UniformCell(pConfig, dRecord, dLclTimestep, pCellData, dCellBedElev);
+}
+
+/*
+ *  Uniform boundary for the structure-of-arrays state, only Z is written
+ */
+template <typename TDomain>
+void bdy_UniformSoA(
+	const TDomain& pDomain,
+	sBdyUniformConfiguration* pConfiguration,
+	cl_double2* pTimeseries,
+	cl_double* pTime,
+	cl_double* pTimestep,
+	cl_double* pTimeHydrological,
+	sCellStateSoA pCellState,
+	cl_double* pCellBed,
+	GlobalHandlerClass ghc
+)
+{
+	cl_long		lIdxX = ghc.get_global_id(0);
+	cl_long		lIdxY = ghc.get_global_id(1);
+	cl_ulong		ulIdx;
+
+	// Don't bother if we've gone beyond the domain bounds
+	if (lIdxX >= (cl_long)pDomain.Cols - 1 ||
+		lIdxY >= (cl_long)pDomain.Rows - 1 ||
+		lIdxX <= 0 ||
+		lIdxY <= 0)
+		return;
+
+	ulIdx = getCellID(pDomain, lIdxX, lIdxY);
+
+	sBdyUniformConfiguration	pConfig = *pConfiguration;
+	cl_double					dLclTime = *pTime;
+	cl_double					dLclRealTimestep = *pTimestep;
+	cl_double					dLclTimestep = *pTimeHydrological;
+
+	// Hydrological processes have their own timesteps
+	if (dLclTimestep < TIMESTEP_HYDROLOGICAL || dLclRealTimestep <= 0.0)
+		return;
+
+	if (dLclTime >= pConfig.TimeseriesLength || pCellState.Zmax[ulIdx] <= -9999.0)
+		return;
+
+	cl_ulong ulTimestep = (cl_ulong)floor(dLclTime / pConfig.TimeseriesInterval);
+	cl_double2 dRecord = pTimeseries[ulTimestep];
+
+	if (pConfig.Definition == BOUNDARY_UNIFORM_RAIN_INTENSITY)
+		pCellState.Z[ulIdx] += dRecord.y / 3600000.0 * dLclTimestep;
+
+	if (pConfig.Definition == BOUNDARY_UNIFORM_LOSS_RATE)
+		pCellState.Z[ulIdx] = std::max(pCellBed[ulIdx], pCellState.Z[ulIdx] - dRecord.y / 3600000.0 * dLclTimestep);
+}
+
+/*
+ *  Uniform boundary for a state stored in the precision of TPrecision,
+ *  the level is updated in double and rounded once on the store
+ */
+template <typename TDomain, typename TPrecision>
+void bdy_UniformPrecision(
+	const TDomain& pDomain,
+	sBdyUniformConfiguration* pConfiguration,
+	cl_double2* pTimeseries,
+	cl_double* pTime,
+	cl_double* pTimestep,
+	cl_double* pTimeHydrological,
+	typename TPrecision::State* pCellState,
+	typename TPrecision::Real* pCellBed,
+	GlobalHandlerClass ghc
+)
+{
+	cl_long		lIdxX = ghc.get_global_id(0);
+	cl_long		lIdxY = ghc.get_global_id(1);
+	cl_ulong		ulIdx;
+
+	// Don't bother if we've gone beyond the domain bounds
+	if (lIdxX >= (cl_long)pDomain.Cols - 1 ||
+		lIdxY >= (cl_long)pDomain.Rows - 1 ||
+		lIdxX <= 0 ||
+		lIdxY <= 0)
+		return;
+
+	ulIdx = getCellID(pDomain, lIdxX, lIdxY);
+
+	sBdyUniformConfiguration	pConfig = *pConfiguration;
+	cl_double					dLclTime = *pTime;
+	cl_double					dLclRealTimestep = *pTimestep;
+	cl_double					dLclTimestep = *pTimeHydrological;
+	cl_double4					pCellData = TPrecision::load(pCellState[ulIdx], (cl_double)pCellBed[ulIdx]);
+
+	// Hydrological processes have their own timesteps
+	if (dLclTimestep < TIMESTEP_HYDROLOGICAL || dLclRealTimestep <= 0.0)
+		return;
+
+	if (dLclTime >= pConfig.TimeseriesLength || pCellData.y <= -9999.0)
+		return;
+
+	cl_ulong ulTimestep = (cl_ulong)floor(dLclTime / pConfig.TimeseriesInterval);
+	cl_double2 dRecord = pTimeseries[ulTimestep];
+
 	if (pConfig.Definition == BOUNDARY_UNIFORM_RAIN_INTENSITY)
 		pCellData.x += dRecord.y / 3600000.0 * dLclTimestep;
 
 	if (pConfig.Definition == BOUNDARY_UNIFORM_LOSS_RATE)
-		pCellData.x = std::max(dCellBedElev, pCellData.x - dRecord.y / 3600000.0 * dLclTimestep);
+		pCellData.x = std::max((cl_double)pCellBed[ulIdx], pCellData.x - dRecord.y / 3600000.0 * dLclTimestep);
 
-	// Return to global memory
-	pCellState[ulIdx] = pCellData;
+	pCellState[ulIdx] = TPrecision::store(pCellData, (cl_double)pCellBed[ulIdx]);
 }
 
+/*
+ *  Uniform boundary for an ensemble state. Every member has its own series,
+ *  interleaved by record (record * Members + member) over the same times.
+ */
+template <typename TDomain>
+void bdy_UniformEnsemble(
+	const TDomain& pDomain,
+	sBdyUniformConfiguration* pConfiguration,
+	cl_double2* pTimeseries,
+	cl_double* pTime,
+	cl_double* pTimestep,
+	cl_double* pTimeHydrological,
+	cl_uint uiMembers,
+	sCellStateSoA pCellState,
+	cl_double* pCellBed,
+	GlobalHandlerClass ghc
+)
+{
+	cl_long		lIdxX = ghc.get_global_id(0);
+	cl_long		lIdxY = ghc.get_global_id(1);
+	cl_ulong		ulIdx;
+
+	// Don't bother if we've gone beyond the domain bounds
+	if (lIdxX >= (cl_long)pDomain.Cols - 1 ||
+		lIdxY >= (cl_long)pDomain.Rows - 1 ||
+		lIdxX <= 0 ||
+		lIdxY <= 0)
+		return;
+
+	ulIdx = getCellID(pDomain, lIdxX, lIdxY);
+
+	sBdyUniformConfiguration	pConfig = *pConfiguration;
+	cl_double					dLclTime = *pTime;
+	cl_double					dLclRealTimestep = *pTimestep;
+	cl_double					dLclTimestep = *pTimeHydrological;
+	cl_double					dBed = pCellBed[ulIdx];
+
+	// Hydrological processes have their own timesteps
+	if (dLclTimestep < TIMESTEP_HYDROLOGICAL || dLclRealTimestep <= 0.0)
+		return;
+
+	if (dLclTime >= pConfig.TimeseriesLength)
+		return;
+
+	cl_ulong ulTimestep = (cl_ulong)floor(dLclTime / pConfig.TimeseriesInterval);
+	cl_double2* pRecords = &pTimeseries[ulTimestep * uiMembers];
+
+	for (cl_uint m = 0; m < uiMembers; m++)
+	{
+		cl_ulong ulMember = ulIdx * uiMembers + m;
+		if (pCellState.Zmax[ulMember] <= -9999.0)
+			continue;
+
+		if (pConfig.Definition == BOUNDARY_UNIFORM_RAIN_INTENSITY)
+			pCellState.Z[ulMember] += pRecords[m].y / 3600000.0 * dLclTimestep;
+
+		if (pConfig.Definition == BOUNDARY_UNIFORM_LOSS_RATE)
+			pCellState.Z[ulMember] = std::max(dBed, pCellState.Z[ulMember] - pRecords[m].y / 3600000.0 * dLclTimestep);
+	}
+}
+
+/*
+ *  Uniform boundary swept by tiles of the activity map, one work-item per tile
+ *  Losses skip dry tiles, their cells are within VERY_SMALL of the bed.
+ *  Rain flags every tile it falls on so the scheme carries it into the
+ *  other buffer, even while no cell is wet yet.
+ */
+template <typename TDomain>
+void bdy_UniformTiled(
+	const TDomain& pDomain,
+	sBdyUniformConfiguration* pConfiguration,
+	cl_double2* pTimeseries,
+	cl_double* pTime,
+	cl_double* pTimestep,
+	cl_double* pTimeHydrological,
+	cl_double4* pCellState,
+	cl_double* pCellBed,
+	sTileActivity* pActivity,
+	GlobalHandlerClass ghc
+)
+{
+	cl_long		lTileX = ghc.get_global_id(0);
+	cl_long		lTileY = ghc.get_global_id(1);
+
+	if (lTileX >= (cl_long)pActivity->TilesX || lTileY >= (cl_long)pActivity->TilesY)
+		return;
+
+	sBdyUniformConfiguration	pConfig = *pConfiguration;
+	cl_double					dLclTime = *pTime;
+	cl_double					dLclRealTimestep = *pTimestep;
+	cl_double					dLclTimestep = *pTimeHydrological;
+	cl_ulong					ulTile = lTileY * pActivity->TilesX + lTileX;
+
+	// Hydrological processes have their own timesteps
+	if (dLclTimestep < TIMESTEP_HYDROLOGICAL || dLclRealTimestep <= 0.0)
+		return;
+
+	if (dLclTime >= pConfig.TimeseriesLength)
+		return;
+
+	if (pConfig.Definition == BOUNDARY_UNIFORM_LOSS_RATE && pActivity->State[ulTile] == TILE_DRY)
+		return;
+
+	cl_ulong	ulTimestep = (cl_ulong)floor(dLclTime / pConfig.TimeseriesInterval);
+	cl_double2	dRecord = pTimeseries[ulTimestep];
+	cl_long		lStartX = std::max(lTileX * (cl_long)pActivity->TileSize.s[0], (cl_long)1);
+	cl_long		lStartY = std::max(lTileY * (cl_long)pActivity->TileSize.s[1], (cl_long)1);
+	cl_long		lEndX = std::min((lTileX + 1) * (cl_long)pActivity->TileSize.s[0], (cl_long)pDomain.Cols - 1);
+	cl_long		lEndY = std::min((lTileY + 1) * (cl_long)pActivity->TileSize.s[1], (cl_long)pDomain.Rows - 1);
+	bool		bWetted = false;
+
+	for (cl_long lIdxY = lStartY; lIdxY < lEndY; lIdxY++)
+	{
+		for (cl_long lIdxX = lStartX; lIdxX < lEndX; lIdxX++)
+		{
+			cl_ulong	ulIdx = getCellID(pDomain, lIdxX, lIdxY);
+			cl_double4	pCellData = pCellState[ulIdx];
+
+			if (pCellData.y <= -9999.0)
+				continue;
+
+			if (pConfig.Definition == BOUNDARY_UNIFORM_RAIN_INTENSITY)
+			{
+				pCellData.x += dRecord.y / 3600000.0 * dLclTimestep;
+				bWetted |= dRecord.y > 0.0;
+			}
+
+			if (pConfig.Definition == BOUNDARY_UNIFORM_LOSS_RATE)
+				pCellData.x = std::max(pCellBed[ulIdx], pCellData.x - dRecord.y / 3600000.0 * dLclTimestep);
+
+			pCellState[ulIdx] = pCellData;
+		}
+	}
+
+	if (bWetted)
+		pActivity->Wet[ulTile] = 1;
+}
+
+template <typename TDomain>
 void bdy_Gridded(
+	const TDomain& pDomain,
 	sBdyGriddedConfiguration* pConfiguration,
 	cl_double* pTimeseries,
 	cl_double* pTime,
@@ -202,13 +445,13 @@ void bdy_Gridded(
 	cl_ulong		ulIdx;
 
 	// Don't bother if we've gone beyond the domain bounds
-	if (lIdxX >= DOMAIN_COLS - 1 ||
-		lIdxY >= DOMAIN_ROWS - 1 ||
+	if (lIdxX >= (cl_long)pDomain.Cols - 1 ||
+		lIdxY >= (cl_long)pDomain.Rows - 1 ||
 		lIdxX <= 0 ||
 		lIdxY <= 0)
 		return;
 
-	ulIdx = getCellID(lIdxX, lIdxY);
+	ulIdx = getCellID(pDomain, lIdxX, lIdxY);
 
 	// How far in to the simulation are we? And current cell data
 	sBdyGriddedConfiguration	pConfig = *pConfiguration;
@@ -229,19 +472,145 @@ void bdy_Gridded(
 	cl_ulong ulTimestep = (cl_ulong)floor(dLclTime / pConfig.TimeseriesInterval);
 	if (ulTimestep >= pConfig.TimeseriesEntries) ulTimestep = pConfig.TimeseriesEntries;
 
-	cl_double ulColumn = floor((((cl_double)lIdxX * (cl_double)DOMAIN_DELTAX) - pConfig.GridOffsetX) / pConfig.GridResolution);
-	cl_double ulRow = floor((((cl_double)lIdxY * (cl_double)DOMAIN_DELTAY) - pConfig.GridOffsetY) / pConfig.GridResolution);
-	cl_ulong ulBdyCell = (pConfig.GridRows * pConfig.GridCols) * ulTimestep +
-		(pConfig.GridCols * (cl_ulong)ulRow) + (cl_ulong)ulColumn;
-	cl_double dRate = pTimeseries[ulBdyCell];
+	// Apply the value and return to global memory
+	pCellState[ulIdx] = bdy_GriddedCell(pDomain, pConfig, pTimeseries, ulTimestep, dLclTimestep, lIdxX, lIdxY, pCellData);
+}
+
+/*
+ *  Gridded boundary over the tiles of an activity map, one work-item per
+ *  tile. Tiles it changes are flagged so tac_Activate updates them this step.
+ */
+template <typename TDomain>
+void bdy_GriddedTiled(
+	const TDomain& pDomain,
+	sBdyGriddedConfiguration* pConfiguration,
+	cl_double* pTimeseries,
+	cl_double* pTime,
+	cl_double* pTimestep,
+	cl_double* pTimeHydrological,
+	cl_double4* pCellState,
+	sTileActivity* pActivity,
+	GlobalHandlerClass ghc
+)
+{
+	cl_long		lTileX = ghc.get_global_id(0);
+	cl_long		lTileY = ghc.get_global_id(1);
+
+	if (lTileX >= (cl_long)pActivity->TilesX || lTileY >= (cl_long)pActivity->TilesY)
+		return;
 
-	// Apply the value...
-	if (pConfig.Definition == BOUNDARY_GRIDDED_RAIN_INTENSITY)
-		pCellData.x += dRate / 3600000.0 * dLclTimestep;
+	sBdyGriddedConfiguration	pConfig = *pConfiguration;
+	cl_double					dLclTime = *pTime;
+	cl_double					dLclRealTimestep = *pTimestep;
+	cl_double					dLclTimestep = *pTimeHydrological;
+	cl_ulong					ulTile = lTileY * pActivity->TilesX + lTileX;
+
+	// Hydrological processes have their own timesteps, a suspended step takes none
+	if (dLclTimestep < TIMESTEP_HYDROLOGICAL || dLclRealTimestep <= 0.0)
+		return;
 
-	if (pConfig.Definition == BOUNDARY_GRIDDED_MASS_FLUX)
-		pCellData.x += dRate / ((cl_double)DOMAIN_DELTAX * (cl_double)DOMAIN_DELTAY) * dLclTimestep;
+	cl_ulong	ulTimestep = (cl_ulong)floor(dLclTime / pConfig.TimeseriesInterval);
+	if (ulTimestep >= pConfig.TimeseriesEntries) ulTimestep = pConfig.TimeseriesEntries;
 
-	// Return to global memory
-	pCellState[ulIdx] = pCellData;
+	cl_long		lStartX = std::max(lTileX * (cl_long)pActivity->TileSize.s[0], (cl_long)1);
+	cl_long		lStartY = std::max(lTileY * (cl_long)pActivity->TileSize.s[1], (cl_long)1);
+	cl_long		lEndX = std::min((lTileX + 1) * (cl_long)pActivity->TileSize.s[0], (cl_long)pDomain.Cols - 1);
+	cl_long		lEndY = std::min((lTileY + 1) * (cl_long)pActivity->TileSize.s[1], (cl_long)pDomain.Rows - 1);
+	bool		bWetted = false;
+
+	for (cl_long lIdxY = lStartY; lIdxY < lEndY; lIdxY++)
+	{
+		for (cl_long lIdxX = lStartX; lIdxX < lEndX; lIdxX++)
+		{
+			cl_ulong	ulIdx = getCellID(pDomain, lIdxX, lIdxY);
+			cl_double4	pCellData = pCellState[ulIdx];
+
+			if (pCellData.y <= -9999.0 || pCellData.x == -9999.0)
+				continue;
+
+			cl_double4	pNewData = bdy_GriddedCell(pDomain, pConfig, pTimeseries, ulTimestep, dLclTimestep, lIdxX, lIdxY, pCellData);
+			bWetted |= pNewData.x != pCellData.x;
+			pCellState[ulIdx] = pNewData;
+		}
+	}
+
+	if (bWetted)
+		pActivity->Wet[ulTile] = 1;
 }
+
+/*
+ *  Fill the ghost ring from the cells next to it, one work-item per column
+ *  and row. Corners are not read by the schemes and keep their state.
+ *  The water level is mirrored, so a lake at rest stays at rest.
+ */
+template <typename TDomain>
+void bdy_GhostRing(
+	const TDomain& pDomain,
+	cl_uchar ucType,
+	cl_double4* pCellState,
+	cl_double* dBedElevation,
+	GlobalHandlerClass ghc
+)
+{
+	cl_long		lIdx = ghc.get_global_id(0);
+	cl_long		lCols = pDomain.Cols;
+	cl_long		lRows = pDomain.Rows;
+	cl_double	dReflect = ucType == BOUNDARY_GHOST_REFLECTIVE ? -1.0 : 1.0;
+	cl_ulong	ulGhost, ulInner;
+
+	if (ucType == BOUNDARY_GHOST_FROZEN)
+		return;
+
+	// South and north rows, the normal discharge is Qy
+	if (lIdx > 0 && lIdx < lCols - 1)
+	{
+		ulGhost = getCellID(pDomain, lIdx, 0);
+		ulInner = getCellID(pDomain, lIdx, 1);
+		pCellState[ulGhost].x = std::max(pCellState[ulInner].x, dBedElevation[ulGhost]);
+		pCellState[ulGhost].z = pCellState[ulInner].z;
+		pCellState[ulGhost].w = dReflect * pCellState[ulInner].w;
+
+		ulGhost = getCellID(pDomain, lIdx, lRows - 1);
+		ulInner = getCellID(pDomain, lIdx, lRows - 2);
+		pCellState[ulGhost].x = std::max(pCellState[ulInner].x, dBedElevation[ulGhost]);
+		pCellState[ulGhost].z = pCellState[ulInner].z;
+		pCellState[ulGhost].w = dReflect * pCellState[ulInner].w;
+	}
+
+	// West and east columns, the normal discharge is Qx
+	if (lIdx > 0 && lIdx < lRows - 1)
+	{
+		ulGhost = getCellID(pDomain, 0, lIdx);
+		ulInner = getCellID(pDomain, 1, lIdx);
+		pCellState[ulGhost].x = std::max(pCellState[ulInner].x, dBedElevation[ulGhost]);
+		pCellState[ulGhost].z = dReflect * pCellState[ulInner].z;
+		pCellState[ulGhost].w = pCellState[ulInner].w;
+
+		ulGhost = getCellID(pDomain, lCols - 1, lIdx);
+		ulInner = getCellID(pDomain, lCols - 2, lIdx);
+		pCellState[ulGhost].x = std::max(pCellState[ulInner].x, dBedElevation[ulGhost]);
+		pCellState[ulGhost].z = dReflect * pCellState[ulInner].z;
+		pCellState[ulGhost].w = pCellState[ulInner].w;
+	}
+}
+
+template void bdy_Cell<sDomainConfiguration>(const sDomainConfiguration&, sBdyCellConfiguration*, cl_ulong*, cl_double4*, cl_double*, cl_double*, cl_double*, cl_double4*, cl_double*, cl_double*, GlobalHandlerClass);
+template void bdy_Cell<sDomainCompiled>(const sDomainCompiled&, sBdyCellConfiguration*, cl_ulong*, cl_double4*, cl_double*, cl_double*, cl_double*, cl_double4*, cl_double*, cl_double*, GlobalHandlerClass);
+template void bdy_Uniform<sDomainConfiguration>(const sDomainConfiguration&, sBdyUniformConfiguration*, cl_double2*, cl_double*, cl_double*, cl_double*, cl_double4*, cl_double*, cl_double*, GlobalHandlerClass);
+template void bdy_Uniform<sDomainCompiled>(const sDomainCompiled&, sBdyUniformConfiguration*, cl_double2*, cl_double*, cl_double*, cl_double*, cl_double4*, cl_double*, cl_double*, GlobalHandlerClass);
+template void bdy_UniformSoA<sDomainConfiguration>(const sDomainConfiguration&, sBdyUniformConfiguration*, cl_double2*, cl_double*, cl_double*, cl_double*, sCellStateSoA, cl_double*, GlobalHandlerClass);
+template void bdy_UniformSoA<sDomainCompiled>(const sDomainCompiled&, sBdyUniformConfiguration*, cl_double2*, cl_double*, cl_double*, cl_double*, sCellStateSoA, cl_double*, GlobalHandlerClass);
+template void bdy_UniformPrecision<sDomainConfiguration, sPrecisionDouble>(const sDomainConfiguration&, sBdyUniformConfiguration*, cl_double2*, cl_double*, cl_double*, cl_double*, cl_double4*, cl_double*, GlobalHandlerClass);
+template void bdy_UniformPrecision<sDomainCompiled, sPrecisionDouble>(const sDomainCompiled&, sBdyUniformConfiguration*, cl_double2*, cl_double*, cl_double*, cl_double*, cl_double4*, cl_double*, GlobalHandlerClass);
+template void bdy_UniformPrecision<sDomainConfiguration, sPrecisionFloat>(const sDomainConfiguration&, sBdyUniformConfiguration*, cl_double2*, cl_double*, cl_double*, cl_double*, cl_float4*, cl_float*, GlobalHandlerClass);
+template void bdy_UniformPrecision<sDomainCompiled, sPrecisionFloat>(const sDomainCompiled&, sBdyUniformConfiguration*, cl_double2*, cl_double*, cl_double*, cl_double*, cl_float4*, cl_float*, GlobalHandlerClass);
+template void bdy_UniformEnsemble<sDomainConfiguration>(const sDomainConfiguration&, sBdyUniformConfiguration*, cl_double2*, cl_double*, cl_double*, cl_double*, cl_uint, sCellStateSoA, cl_double*, GlobalHandlerClass);
+template void bdy_UniformEnsemble<sDomainCompiled>(const sDomainCompiled&, sBdyUniformConfiguration*, cl_double2*, cl_double*, cl_double*, cl_double*, cl_uint, sCellStateSoA, cl_double*, GlobalHandlerClass);
+template void bdy_UniformTiled<sDomainConfiguration>(const sDomainConfiguration&, sBdyUniformConfiguration*, cl_double2*, cl_double*, cl_double*, cl_double*, cl_double4*, cl_double*, sTileActivity*, GlobalHandlerClass);
+template void bdy_UniformTiled<sDomainCompiled>(const sDomainCompiled&, sBdyUniformConfiguration*, cl_double2*, cl_double*, cl_double*, cl_double*, cl_double4*, cl_double*, sTileActivity*, GlobalHandlerClass);
+template void bdy_Gridded<sDomainConfiguration>(const sDomainConfiguration&, sBdyGriddedConfiguration*, cl_double*, cl_double*, cl_double*, cl_double*, cl_double4*, cl_double*, cl_double*, GlobalHandlerClass);
+template void bdy_Gridded<sDomainCompiled>(const sDomainCompiled&, sBdyGriddedConfiguration*, cl_double*, cl_double*, cl_double*, cl_double*, cl_double4*, cl_double*, cl_double*, GlobalHandlerClass);
+template void bdy_GriddedTiled<sDomainConfiguration>(const sDomainConfiguration&, sBdyGriddedConfiguration*, cl_double*, cl_double*, cl_double*, cl_double*, cl_double4*, sTileActivity*, GlobalHandlerClass);
+template void bdy_GriddedTiled<sDomainCompiled>(const sDomainCompiled&, sBdyGriddedConfiguration*, cl_double*, cl_double*, cl_double*, cl_double*, cl_double4*, sTileActivity*, GlobalHandlerClass);
+template void bdy_GhostRing<sDomainConfiguration>(const sDomainConfiguration&, cl_uchar, cl_double4*, cl_double*, GlobalHandlerClass);
+template void bdy_GhostRing<sDomainCompiled>(const sDomainCompiled&, cl_uchar, cl_double4*, cl_double*, GlobalHandlerClass);
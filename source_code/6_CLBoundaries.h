@@ -43,7 +43,9 @@ typedef struct sBdyUniformConfiguration
 	cl_uint			Definition;
 } sBdyUniformConfiguration;
 
+template <typename TDomain>
 void bdy_Cell(
+	const TDomain&,
 	sBdyCellConfiguration*,
 	cl_ulong*,
 	cl_double4*,
@@ -52,10 +54,13 @@ void bdy_Cell(
 	cl_double*,
 	cl_double4*,
 	cl_double*,
-	cl_double*
+	cl_double*,
+	GlobalHandlerClass
 );
 
+template <typename TDomain>
 void bdy_Gridded(
+	const TDomain&,
 	sBdyGriddedConfiguration*,
 	cl_double*,
 	cl_double*,
@@ -63,10 +68,40 @@ void bdy_Gridded(
 	cl_double*,
 	cl_double4*,
 	cl_double*,
-	cl_double*
+	cl_double*,
+	GlobalHandlerClass
 );
 
+template <typename TDomain>
 void bdy_Uniform(
+	const TDomain&,
+	sBdyUniformConfiguration*,
+	cl_double2*,
+	cl_double*,
+	cl_double*,
+	cl_double*,
+	cl_double4*,
+	cl_double*,
+	cl_double*,
+	GlobalHandlerClass
+);
+
+template <typename TDomain>
+void bdy_GriddedTiled(
+	const TDomain&,
+	sBdyGriddedConfiguration*,
+	cl_double*,
+	cl_double*,
+	cl_double*,
+	cl_double*,
+	cl_double4*,
+	sTileActivity*,
+	GlobalHandlerClass
+);
+
+template <typename TDomain>
+void bdy_UniformTiled(
+	const TDomain&,
 	sBdyUniformConfiguration*,
 	cl_double2*,
 	cl_double*,
@@ -74,8 +109,109 @@ void bdy_Uniform(
 	cl_double*,
 	cl_double4*,
 	cl_double*,
+	sTileActivity*,
+	GlobalHandlerClass
+);
+
+template <typename TDomain>
+void bdy_UniformSoA(
+	const TDomain&,
+	sBdyUniformConfiguration*,
+	cl_double2*,
+	cl_double*,
+	cl_double*,
+	cl_double*,
+	sCellStateSoA,
 	cl_double*,
 	GlobalHandlerClass
 );
 
+template <typename TDomain, typename TPrecision>
+void bdy_UniformPrecision(
+	const TDomain&,
+	sBdyUniformConfiguration*,
+	cl_double2*,
+	cl_double*,
+	cl_double*,
+	cl_double*,
+	typename TPrecision::State*,
+	typename TPrecision::Real*,
+	GlobalHandlerClass
+);
+
+template <typename TDomain>
+void bdy_UniformEnsemble(
+	const TDomain&,
+	sBdyUniformConfiguration*,
+	cl_double2*,
+	cl_double*,
+	cl_double*,
+	cl_double*,
+	cl_uint,
+	sCellStateSoA,
+	cl_double*,
+	GlobalHandlerClass
+);
+
+template <typename TDomain>
+void bdy_GhostRing(
+	const TDomain&,
+	cl_uchar,
+	cl_double4*,
+	cl_double*,
+	GlobalHandlerClass
+);
+
+/*
+ *  Uniform source term of an enabled cell with the series record of the
+ *  current time, dLclTimestep being the hydrological timestep
+ */
+inline cl_double4 bdy_UniformCell(
+	const sBdyUniformConfiguration& pConfig,
+	cl_double2			dRecord,
+	cl_double			dLclTimestep,
+	cl_double4			pCellData,
+	cl_double			dCellBedElev
+)
+{
+	if (pConfig.Definition == BOUNDARY_UNIFORM_RAIN_INTENSITY)
+		pCellData.x += dRecord.y / 3600000.0 * dLclTimestep;
+
+	if (pConfig.Definition == BOUNDARY_UNIFORM_LOSS_RATE)
+		pCellData.x = std::max(dCellBedElev, pCellData.x - dRecord.y / 3600000.0 * dLclTimestep);
+
+	return pCellData;
+}
+
+/*
+ *  Gridded source term of an enabled cell from the grid of series entry
+ *  ulTimestep, dLclTimestep being the hydrological timestep
+ */
+template <typename TDomain>
+inline cl_double4 bdy_GriddedCell(
+	const TDomain&		pDomain,
+	const sBdyGriddedConfiguration& pConfig,
+	const cl_double*	pTimeseries,
+	cl_ulong			ulTimestep,
+	cl_double			dLclTimestep,
+	cl_long				lIdxX,
+	cl_long				lIdxY,
+	cl_double4			pCellData
+)
+{
+	cl_double ulColumn = floor((((cl_double)lIdxX * pDomain.DeltaX) - pConfig.GridOffsetX) / pConfig.GridResolution);
+	cl_double ulRow = floor((((cl_double)lIdxY * pDomain.DeltaY) - pConfig.GridOffsetY) / pConfig.GridResolution);
+	cl_ulong ulBdyCell = (pConfig.GridRows * pConfig.GridCols) * ulTimestep +
+		(pConfig.GridCols * (cl_ulong)ulRow) + (cl_ulong)ulColumn;
+	cl_double dRate = pTimeseries[ulBdyCell];
+
+	if (pConfig.Definition == BOUNDARY_GRIDDED_RAIN_INTENSITY)
+		pCellData.x += dRate / 3600000.0 * dLclTimestep;
+
+	if (pConfig.Definition == BOUNDARY_GRIDDED_MASS_FLUX)
+		pCellData.x += dRate / (pDomain.DeltaX * pDomain.DeltaY) * dLclTimestep;
+
+	return pCellData;
+}
+
 //#endif
\ No newline at end of file
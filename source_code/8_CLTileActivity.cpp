@@ -0,0 +1,137 @@
+/*
+ * ------------------------------------------------------------------
+ *  Author: Alaa Mroue - 2023
+ *  This code is licensed under GPLv3. See LICENCE for more information.
+ * ------------------------------------------------------------------
+ */
+
+#include "8_CLTileActivity.h"
+
+/*
+ *  The wet front moves at most one cell per step, so a tile only needs the
+ *  scheme while it or one of its four neighbours holds a wet cell. Per step:
+ *    boundaries      flag tiles they wet
+ *    tac_Activate    tile states from the wet flags
+ *    scheme          skips dry tiles, copies drained ones
+ *    tac_Mark        wet flags of the tiles the scheme touched
+ */
+
+/*
+ *  Map for a domain of the given size, every tile starts active
+ */
+sTileActivity allocateTileActivity(cl_ulong ulRows, cl_ulong ulCols, cl_uint2 uiTileSize)
+{
+	sTileActivity pActivity;
+
+	pActivity.TileSize = uiTileSize;
+	pActivity.TilesX = (ulCols + uiTileSize.s[0] - 1) / uiTileSize.s[0];
+	pActivity.TilesY = (ulRows + uiTileSize.s[1] - 1) / uiTileSize.s[1];
+	pActivity.TileCount = pActivity.TilesX * pActivity.TilesY;
+	pActivity.State = new cl_uchar[pActivity.TileCount];
+	pActivity.Wet = new cl_uchar[pActivity.TileCount];
+
+	std::fill(pActivity.State, pActivity.State + pActivity.TileCount, (cl_uchar)TILE_ACTIVE);
+	std::fill(pActivity.Wet, pActivity.Wet + pActivity.TileCount, (cl_uchar)1);
+
+	return pActivity;
+}
+
+void freeTileActivity(sTileActivity* pActivity)
+{
+	delete[] pActivity->State;
+	delete[] pActivity->Wet;
+	pActivity->State = NULL;
+	pActivity->Wet = NULL;
+}
+
+/*
+ *  Share of the tiles the scheme updates this step
+ */
+cl_double getTileActiveFraction(const sTileActivity* pActivity)
+{
+	cl_ulong ulActive = std::count(pActivity->State, pActivity->State + pActivity->TileCount, (cl_uchar)TILE_ACTIVE);
+	return (cl_double)ulActive / (cl_double)pActivity->TileCount;
+}
+
+/*
+ *  Flag the tiles holding a wet cell, one work-item per tile
+ *  Dry tiles were not touched by the scheme and keep their flag.
+ */
+template <typename TDomain>
+void tac_Mark(
+	const TDomain& pDomain,
+	sTileActivity* pActivity,
+	cl_double4* pCellState,
+	cl_double* dBedElevation,
+	GlobalHandlerClass ghc
+)
+{
+	cl_long		lTileX = ghc.get_global_id(0);
+	cl_long		lTileY = ghc.get_global_id(1);
+
+	if (lTileX >= (cl_long)pActivity->TilesX || lTileY >= (cl_long)pActivity->TilesY)
+		return;
+
+	cl_ulong	ulTile = lTileY * pActivity->TilesX + lTileX;
+
+	if (pActivity->State[ulTile] == TILE_DRY)
+		return;
+
+	cl_long		lStartX = lTileX * pActivity->TileSize.s[0];
+	cl_long		lStartY = lTileY * pActivity->TileSize.s[1];
+	cl_long		lEndX = std::min(lStartX + (cl_long)pActivity->TileSize.s[0], (cl_long)pDomain.Cols);
+	cl_long		lEndY = std::min(lStartY + (cl_long)pActivity->TileSize.s[1], (cl_long)pDomain.Rows);
+	cl_uchar	ucWet = 0;
+
+	for (cl_long lIdxY = lStartY; lIdxY < lEndY && !ucWet; lIdxY++)
+	{
+		cl_ulong ulIdx = getCellID(pDomain, lStartX, lIdxY);
+		for (cl_long lIdxX = lStartX; lIdxX < lEndX; lIdxX++, ulIdx++)
+		{
+			// Same test the scheme uses to find dry cells
+			if (!(pCellState[ulIdx].x - dBedElevation[ulIdx] < VERY_SMALL))
+			{
+				ucWet = 1;
+				break;
+			}
+		}
+	}
+
+	pActivity->Wet[ulTile] = ucWet;
+}
+
+/*
+ *  New tile states from the wet flags, one work-item per tile
+ */
+void tac_Activate(
+	sTileActivity* pActivity,
+	GlobalHandlerClass ghc
+)
+{
+	cl_long		lTileX = ghc.get_global_id(0);
+	cl_long		lTileY = ghc.get_global_id(1);
+	cl_long		lTilesX = (cl_long)pActivity->TilesX;
+	cl_long		lTilesY = (cl_long)pActivity->TilesY;
+
+	if (lTileX >= lTilesX || lTileY >= lTilesY)
+		return;
+
+	cl_ulong	ulTile = lTileY * lTilesX + lTileX;
+	cl_uchar*	ucWet = pActivity->Wet;
+	bool		bActive = ucWet[ulTile] ||
+		(lTileX > 0 && ucWet[ulTile - 1]) ||
+		(lTileX < lTilesX - 1 && ucWet[ulTile + 1]) ||
+		(lTileY > 0 && ucWet[ulTile - lTilesX]) ||
+		(lTileY < lTilesY - 1 && ucWet[ulTile + lTilesX]);
+
+	if (bActive)
+	{
+		pActivity->State[ulTile] = TILE_ACTIVE;
+	}
+	else {
+		pActivity->State[ulTile] = pActivity->State[ulTile] == TILE_ACTIVE ? TILE_DRAINED : TILE_DRY;
+	}
+}
+
+template void tac_Mark<sDomainConfiguration>(const sDomainConfiguration&, sTileActivity*, cl_double4*, cl_double*, GlobalHandlerClass);
+template void tac_Mark<sDomainCompiled>(const sDomainCompiled&, sTileActivity*, cl_double4*, cl_double*, GlobalHandlerClass);
@@ -0,0 +1,29 @@
+/*
+ * ------------------------------------------------------------------
+ *  Author: Alaa Mroue - 2023
+ *  This code is licensed under GPLv3. See LICENCE for more information.
+ * ------------------------------------------------------------------
+ */
+
+#pragma once
+#include "definitions.h"
+
+//Tile activity map that lets the kernels skip dry regions of the domain.
+
+sTileActivity	allocateTileActivity(cl_ulong, cl_ulong, cl_uint2);
+void			freeTileActivity(sTileActivity*);
+cl_double		getTileActiveFraction(const sTileActivity*);
+
+template <typename TDomain>
+void tac_Mark(
+	const TDomain&,
+	sTileActivity*,
+	cl_double4*,
+	cl_double*,
+	GlobalHandlerClass
+);
+
+void tac_Activate(
+	sTileActivity*,
+	GlobalHandlerClass
+);
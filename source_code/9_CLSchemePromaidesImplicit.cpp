@@ -0,0 +1,723 @@
+/*
+ * ------------------------------------------------------------------
+ *  Author: Alaa Mroue - 2023
+ *  This code is licensed under GPLv3. See LICENCE for more information.
+ * ------------------------------------------------------------------
+ */
+
+#include "9_CLSchemePromaidesImplicit.h"
+
+/*
+ *  A step solves Z - Zstart - dt * R(Z) = 0 for the levels of the interior
+ *  cells, R the sum of the diffusive face rates of solverFunctionPromaides.
+ *  Damped Newton iterations use the full 5-point Jacobian, the derivative of
+ *  every face rate by both of its levels including the growth of the flow
+ *  depth on the upstream side. That term dominates at wetting fronts but
+ *  makes the Jacobian non-symmetric, so each iteration runs Jacobi
+ *  preconditioned BiCGStab, one work-item per row.
+ */
+
+/*
+ *  Work arrays for a domain of the given size
+ */
+sPromaidesImplicit allocatePromaidesImplicit(const sDomainConfiguration& pDomain)
+{
+	sPromaidesImplicit	pImplicit;
+	size_t				uiBytes = pDomain.CellCount * sizeof(cl_double);
+	size_t				uiRowBytes = pDomain.Rows * sizeof(cl_double);
+
+	pImplicit.Rows = pDomain.Rows;
+	pImplicit.Cols = pDomain.Cols;
+	pImplicit.Cell = (cl_uchar*)allocateAligned(pDomain.CellCount * sizeof(cl_uchar));
+	pImplicit.Start = (cl_double*)allocateAligned(uiBytes);
+	pImplicit.Iterate = (cl_double*)allocateAligned(uiBytes);
+	pImplicit.Previous = (cl_double*)allocateAligned(uiBytes);
+	pImplicit.RateE = (cl_double*)allocateAligned(uiBytes);
+	pImplicit.RateN = (cl_double*)allocateAligned(uiBytes);
+	pImplicit.SlopeEL = (cl_double*)allocateAligned(uiBytes);
+	pImplicit.SlopeER = (cl_double*)allocateAligned(uiBytes);
+	pImplicit.SlopeNL = (cl_double*)allocateAligned(uiBytes);
+	pImplicit.SlopeNR = (cl_double*)allocateAligned(uiBytes);
+	pImplicit.Diagonal = (cl_double*)allocateAligned(uiBytes);
+	pImplicit.Update = (cl_double*)allocateAligned(uiBytes);
+	pImplicit.Residual = (cl_double*)allocateAligned(uiBytes);
+	pImplicit.Shadow = (cl_double*)allocateAligned(uiBytes);
+	pImplicit.Direction = (cl_double*)allocateAligned(uiBytes);
+	pImplicit.Search = (cl_double*)allocateAligned(uiBytes);
+	pImplicit.SearchProduct = (cl_double*)allocateAligned(uiBytes);
+	pImplicit.Correction = (cl_double*)allocateAligned(uiBytes);
+	pImplicit.CorrectionProduct = (cl_double*)allocateAligned(uiBytes);
+	pImplicit.RowDot = (cl_double*)allocateAligned(uiRowBytes);
+	pImplicit.RowSquare = (cl_double*)allocateAligned(uiRowBytes);
+	pImplicit.RowMax = (cl_double*)allocateAligned(uiRowBytes);
+	pImplicit.NewtonIterations = 0;
+	pImplicit.KrylovIterations = 0;
+
+	// Faces to the outer ring or between ring cells are never written, nor
+	// are the reductions of the ring rows
+	cl_double* dZeroed[] = {
+		pImplicit.RateE, pImplicit.RateN, pImplicit.SlopeEL, pImplicit.SlopeER, pImplicit.SlopeNL, pImplicit.SlopeNR
+	};
+	for (size_t i = 0; i < sizeof(dZeroed) / sizeof(dZeroed[0]); i++)
+		std::fill(dZeroed[i], dZeroed[i] + pDomain.CellCount, 0.0);
+	std::fill(pImplicit.RowDot, pImplicit.RowDot + pDomain.Rows, 0.0);
+	std::fill(pImplicit.RowSquare, pImplicit.RowSquare + pDomain.Rows, 0.0);
+	std::fill(pImplicit.RowMax, pImplicit.RowMax + pDomain.Rows, 0.0);
+
+	return pImplicit;
+}
+
+void freePromaidesImplicit(sPromaidesImplicit* pImplicit)
+{
+	cl_double** dArrays[] = {
+		&pImplicit->Start, &pImplicit->Iterate, &pImplicit->Previous, &pImplicit->RateE, &pImplicit->RateN,
+		&pImplicit->SlopeEL, &pImplicit->SlopeER, &pImplicit->SlopeNL, &pImplicit->SlopeNR,
+		&pImplicit->Diagonal, &pImplicit->Update, &pImplicit->Residual, &pImplicit->Shadow, &pImplicit->Direction,
+		&pImplicit->Search, &pImplicit->SearchProduct, &pImplicit->Correction, &pImplicit->CorrectionProduct,
+		&pImplicit->RowDot, &pImplicit->RowSquare, &pImplicit->RowMax
+	};
+
+	for (size_t i = 0; i < sizeof(dArrays) / sizeof(dArrays[0]); i++)
+	{
+		freeAligned(*dArrays[i]);
+		*dArrays[i] = NULL;
+	}
+	freeAligned(pImplicit->Cell);
+	pImplicit->Cell = NULL;
+}
+
+/*
+ *  Start of a step: levels, cell states and zero Krylov vectors
+ */
+template <typename TDomain>
+void pim_Start(
+	const TDomain& pDomain,
+	cl_double4* pCellState,
+	sPromaidesImplicit* pImplicit,
+	GlobalHandlerClass ghc
+)
+{
+	cl_long		lIdxY = ghc.get_global_id(1);
+	cl_long		lRows = pDomain.Rows;
+	cl_long		lCols = pDomain.Cols;
+
+	if (lIdxY >= lRows)
+		return;
+
+	for (cl_long lIdxX = 0; lIdxX < lCols; lIdxX++)
+	{
+		cl_ulong	ulIdx = getCellID(pDomain, lIdxX, lIdxY);
+		cl_double4	pCellData = pCellState[ulIdx];
+
+		pImplicit->Start[ulIdx] = pCellData.x;
+		pImplicit->Iterate[ulIdx] = pCellData.x;
+		pImplicit->Update[ulIdx] = 0.0;
+		pImplicit->Search[ulIdx] = 0.0;
+		pImplicit->Correction[ulIdx] = 0.0;
+
+		if (pCellData.y <= -9999.0 || pCellData.x == -9999.0)
+			pImplicit->Cell[ulIdx] = PIM_CELL_DISABLED;
+		else if (lIdxX == 0 || lIdxY == 0 || lIdxX == lCols - 1 || lIdxY == lRows - 1)
+			pImplicit->Cell[ulIdx] = PIM_CELL_FIXED;
+		else
+			pImplicit->Cell[ulIdx] = PIM_CELL_FREE;
+	}
+}
+
+/*
+ *  Rates and derivatives of the faces of the current iterate, indexed by
+ *  the ID of their west/south cell. Faces of disabled cells are closed.
+ */
+template <typename TDomain>
+void pim_Faces(
+	const TDomain& pDomain,
+	cl_double* dBedElevation,
+	cl_double* dManning,
+	sPromaidesImplicit* pImplicit,
+	GlobalHandlerClass ghc
+)
+{
+	cl_long		lIdxY = ghc.get_global_id(1);
+	cl_long		lRows = pDomain.Rows;
+	cl_long		lCols = pDomain.Cols;
+	cl_double*	dLevel = pImplicit->Iterate;
+	cl_uchar*	ucCell = pImplicit->Cell;
+
+	if (lIdxY >= lRows - 1)
+		return;
+
+	cl_ulong	ulRow = getCellID(pDomain, 0, lIdxY);
+
+	// -> East, interior rows
+	if (lIdxY > 0)
+	{
+		for (cl_ulong ulIdx = ulRow; ulIdx < ulRow + lCols - 1; ulIdx++)
+		{
+			if (ucCell[ulIdx] == PIM_CELL_DISABLED || ucCell[ulIdx + 1] == PIM_CELL_DISABLED)
+			{
+				pImplicit->RateE[ulIdx] = 0.0;
+				pImplicit->SlopeEL[ulIdx] = 0.0;
+				pImplicit->SlopeER[ulIdx] = 0.0;
+				continue;
+			}
+			pImplicit->RateE[ulIdx] = pim_FaceRate(
+				dLevel[ulIdx], dBedElevation[ulIdx],
+				dLevel[ulIdx + 1], dBedElevation[ulIdx + 1],
+				1 / dManning[ulIdx], 1 / dManning[ulIdx + 1],
+				&pImplicit->SlopeEL[ulIdx], &pImplicit->SlopeER[ulIdx]
+			);
+		}
+	}
+
+	// -> North, interior columns
+	for (cl_ulong ulIdx = ulRow + 1; ulIdx < ulRow + lCols - 1; ulIdx++)
+	{
+		if (ucCell[ulIdx] == PIM_CELL_DISABLED || ucCell[ulIdx + lCols] == PIM_CELL_DISABLED)
+		{
+			pImplicit->RateN[ulIdx] = 0.0;
+			pImplicit->SlopeNL[ulIdx] = 0.0;
+			pImplicit->SlopeNR[ulIdx] = 0.0;
+			continue;
+		}
+		pImplicit->RateN[ulIdx] = pim_FaceRate(
+			dLevel[ulIdx], dBedElevation[ulIdx],
+			dLevel[ulIdx + lCols], dBedElevation[ulIdx + lCols],
+			1 / dManning[ulIdx], 1 / dManning[ulIdx + lCols],
+			&pImplicit->SlopeNL[ulIdx], &pImplicit->SlopeNR[ulIdx]
+		);
+	}
+}
+
+/*
+ *  Newton residual of the free cells, stored negated as the Krylov residual
+ *  of a zero update, and the Jacobian diagonal. Per row the largest residual.
+ */
+template <typename TDomain>
+void pim_Residual(
+	const TDomain& pDomain,
+	cl_double dTimestep,
+	sPromaidesImplicit* pImplicit,
+	GlobalHandlerClass ghc
+)
+{
+	cl_long		lIdxY = ghc.get_global_id(1);
+	cl_long		lRows = pDomain.Rows;
+	cl_long		lCols = pDomain.Cols;
+	cl_double	dRowMax = 0.0;
+
+	if (lIdxY >= lRows)
+		return;
+
+	cl_ulong	ulRow = getCellID(pDomain, 0, lIdxY);
+
+	for (cl_ulong ulIdx = ulRow; ulIdx < ulRow + lCols; ulIdx++)
+	{
+		if (pImplicit->Cell[ulIdx] != PIM_CELL_FREE)
+		{
+			pImplicit->Diagonal[ulIdx] = 1.0;
+			pImplicit->Residual[ulIdx] = 0.0;
+			continue;
+		}
+
+		cl_double	dRate = 0.0;
+		dRate += pImplicit->RateE[ulIdx];
+		dRate -= pImplicit->RateE[ulIdx - 1];
+		dRate += pImplicit->RateN[ulIdx];
+		dRate -= pImplicit->RateN[ulIdx - lCols];
+
+		cl_double	dSlope = 0.0;
+		dSlope += pImplicit->SlopeEL[ulIdx];
+		dSlope -= pImplicit->SlopeER[ulIdx - 1];
+		dSlope += pImplicit->SlopeNL[ulIdx];
+		dSlope -= pImplicit->SlopeNR[ulIdx - lCols];
+
+		cl_double	dResidual = pImplicit->Iterate[ulIdx] - pImplicit->Start[ulIdx] - dTimestep * dRate;
+
+		pImplicit->Diagonal[ulIdx] = 1.0 - dTimestep * dSlope;
+		pImplicit->Residual[ulIdx] = -dResidual;
+
+		dRowMax = std::max(dRowMax, fabs(dResidual));
+	}
+
+	pImplicit->RowMax[lIdxY] = dRowMax;
+}
+
+/*
+ *  Start BiCGStab from a zero update, the shadow residual the residual.
+ *  Keeps the iterate for the line search. Per row the residual squared.
+ */
+template <typename TDomain>
+void pim_Krylov(
+	const TDomain& pDomain,
+	sPromaidesImplicit* pImplicit,
+	GlobalHandlerClass ghc
+)
+{
+	cl_long		lIdxY = ghc.get_global_id(1);
+	cl_long		lRows = pDomain.Rows;
+	cl_long		lCols = pDomain.Cols;
+	cl_double	dRowDot = 0.0;
+
+	if (lIdxY >= lRows)
+		return;
+
+	cl_ulong	ulRow = getCellID(pDomain, 0, lIdxY);
+
+	for (cl_ulong ulIdx = ulRow; ulIdx < ulRow + lCols; ulIdx++)
+	{
+		cl_double	dResidual = pImplicit->Residual[ulIdx];
+
+		pImplicit->Previous[ulIdx] = pImplicit->Iterate[ulIdx];
+		pImplicit->Update[ulIdx] = 0.0;
+		pImplicit->Shadow[ulIdx] = dResidual;
+		pImplicit->Direction[ulIdx] = 0.0;
+		pImplicit->SearchProduct[ulIdx] = 0.0;
+		dRowDot += dResidual * dResidual;
+	}
+
+	pImplicit->RowDot[lIdxY] = dRowDot;
+}
+
+/*
+ *  Next search direction and its preconditioned form
+ */
+template <typename TDomain>
+void pim_Direction(
+	const TDomain& pDomain,
+	cl_double dBeta,
+	cl_double dOmega,
+	sPromaidesImplicit* pImplicit,
+	GlobalHandlerClass ghc
+)
+{
+	cl_long		lIdxY = ghc.get_global_id(1);
+	cl_long		lRows = pDomain.Rows;
+	cl_long		lCols = pDomain.Cols;
+
+	if (lIdxY <= 0 || lIdxY >= lRows - 1)
+		return;
+
+	cl_ulong	ulRow = getCellID(pDomain, 0, lIdxY);
+
+	for (cl_ulong ulIdx = ulRow + 1; ulIdx < ulRow + lCols - 1; ulIdx++)
+	{
+		if (pImplicit->Cell[ulIdx] != PIM_CELL_FREE)
+			continue;
+
+		cl_double	dDirection = pImplicit->Residual[ulIdx] + dBeta * (pImplicit->Direction[ulIdx] - dOmega * pImplicit->SearchProduct[ulIdx]);
+
+		pImplicit->Direction[ulIdx] = dDirection;
+		pImplicit->Search[ulIdx] = dDirection / pImplicit->Diagonal[ulIdx];
+	}
+}
+
+/*
+ *  Jacobian times dIn into dOut, per row dOut dot dWith and dOut squared.
+ *  dIn is zero on cells that are not free.
+ */
+template <typename TDomain>
+void pim_Apply(
+	const TDomain& pDomain,
+	cl_double dTimestep,
+	cl_double* dIn,
+	cl_double* dOut,
+	cl_double* dWith,
+	sPromaidesImplicit* pImplicit,
+	GlobalHandlerClass ghc
+)
+{
+	cl_long		lIdxY = ghc.get_global_id(1);
+	cl_long		lRows = pDomain.Rows;
+	cl_long		lCols = pDomain.Cols;
+	cl_double	dRowDot = 0.0;
+	cl_double	dRowSquare = 0.0;
+
+	if (lIdxY <= 0 || lIdxY >= lRows - 1)
+		return;
+
+	cl_ulong	ulRow = getCellID(pDomain, 0, lIdxY);
+
+	for (cl_ulong ulIdx = ulRow + 1; ulIdx < ulRow + lCols - 1; ulIdx++)
+	{
+		if (pImplicit->Cell[ulIdx] != PIM_CELL_FREE)
+		{
+			dOut[ulIdx] = 0.0;
+			continue;
+		}
+
+		cl_double	dProduct = pImplicit->Diagonal[ulIdx] * dIn[ulIdx] - dTimestep * (
+			pImplicit->SlopeER[ulIdx] * dIn[ulIdx + 1] -
+			pImplicit->SlopeEL[ulIdx - 1] * dIn[ulIdx - 1] +
+			pImplicit->SlopeNR[ulIdx] * dIn[ulIdx + lCols] -
+			pImplicit->SlopeNL[ulIdx - lCols] * dIn[ulIdx - lCols]
+		);
+
+		dOut[ulIdx] = dProduct;
+		dRowDot += dProduct * dWith[ulIdx];
+		dRowSquare += dProduct * dProduct;
+	}
+
+	pImplicit->RowDot[lIdxY] = dRowDot;
+	pImplicit->RowSquare[lIdxY] = dRowSquare;
+}
+
+/*
+ *  Intermediate residual, held in the residual, and its preconditioned
+ *  form. Per row the largest intermediate residual.
+ */
+template <typename TDomain>
+void pim_Intermediate(
+	const TDomain& pDomain,
+	cl_double dAlpha,
+	sPromaidesImplicit* pImplicit,
+	GlobalHandlerClass ghc
+)
+{
+	cl_long		lIdxY = ghc.get_global_id(1);
+	cl_long		lRows = pDomain.Rows;
+	cl_long		lCols = pDomain.Cols;
+	cl_double	dRowMax = 0.0;
+
+	if (lIdxY <= 0 || lIdxY >= lRows - 1)
+		return;
+
+	cl_ulong	ulRow = getCellID(pDomain, 0, lIdxY);
+
+	for (cl_ulong ulIdx = ulRow + 1; ulIdx < ulRow + lCols - 1; ulIdx++)
+	{
+		if (pImplicit->Cell[ulIdx] != PIM_CELL_FREE)
+			continue;
+
+		cl_double	dResidual = pImplicit->Residual[ulIdx] - dAlpha * pImplicit->SearchProduct[ulIdx];
+
+		pImplicit->Residual[ulIdx] = dResidual;
+		pImplicit->Correction[ulIdx] = dResidual / pImplicit->Diagonal[ulIdx];
+		dRowMax = std::max(dRowMax, fabs(dResidual));
+	}
+
+	pImplicit->RowMax[lIdxY] = dRowMax;
+}
+
+/*
+ *  BiCGStab update of the solution and residual, per row the residual dot
+ *  the shadow residual and the largest residual
+ */
+template <typename TDomain>
+void pim_Advance(
+	const TDomain& pDomain,
+	cl_double dAlpha,
+	cl_double dOmega,
+	sPromaidesImplicit* pImplicit,
+	GlobalHandlerClass ghc
+)
+{
+	cl_long		lIdxY = ghc.get_global_id(1);
+	cl_long		lRows = pDomain.Rows;
+	cl_long		lCols = pDomain.Cols;
+	cl_double	dRowDot = 0.0;
+	cl_double	dRowMax = 0.0;
+
+	if (lIdxY <= 0 || lIdxY >= lRows - 1)
+		return;
+
+	cl_ulong	ulRow = getCellID(pDomain, 0, lIdxY);
+
+	for (cl_ulong ulIdx = ulRow + 1; ulIdx < ulRow + lCols - 1; ulIdx++)
+	{
+		if (pImplicit->Cell[ulIdx] != PIM_CELL_FREE)
+			continue;
+
+		pImplicit->Update[ulIdx] += dAlpha * pImplicit->Search[ulIdx] + dOmega * pImplicit->Correction[ulIdx];
+		cl_double dResidual = pImplicit->Residual[ulIdx] - dOmega * pImplicit->CorrectionProduct[ulIdx];
+		pImplicit->Residual[ulIdx] = dResidual;
+
+		dRowDot += dResidual * pImplicit->Shadow[ulIdx];
+		dRowMax = std::max(dRowMax, fabs(dResidual));
+	}
+
+	pImplicit->RowDot[lIdxY] = dRowDot;
+	pImplicit->RowMax[lIdxY] = dRowMax;
+}
+
+/*
+ *  Iterate a share of the Newton update from the last one, levels held at
+ *  or above the bed
+ */
+template <typename TDomain>
+void pim_Iterate(
+	const TDomain& pDomain,
+	cl_double dLength,
+	cl_double* dBedElevation,
+	sPromaidesImplicit* pImplicit,
+	GlobalHandlerClass ghc
+)
+{
+	cl_long		lIdxY = ghc.get_global_id(1);
+	cl_long		lRows = pDomain.Rows;
+	cl_long		lCols = pDomain.Cols;
+
+	if (lIdxY <= 0 || lIdxY >= lRows - 1)
+		return;
+
+	cl_ulong	ulRow = getCellID(pDomain, 0, lIdxY);
+
+	for (cl_ulong ulIdx = ulRow + 1; ulIdx < ulRow + lCols - 1; ulIdx++)
+		if (pImplicit->Cell[ulIdx] == PIM_CELL_FREE)
+			pImplicit->Iterate[ulIdx] = std::max(pImplicit->Previous[ulIdx] + dLength * pImplicit->Update[ulIdx], dBedElevation[ulIdx]);
+}
+
+/*
+ *  New state from the converged levels, as solverFunctionPromaides commits it
+ */
+template <typename TDomain>
+void pim_Finish(
+	const TDomain& pDomain,
+	cl_double* dBedElevation,
+	cl_double4* pCellStateSrc,
+	cl_double4* pCellStateDst,
+	sPromaidesImplicit* pImplicit,
+	GlobalHandlerClass ghc
+)
+{
+	cl_long		lIdxY = ghc.get_global_id(1);
+	cl_long		lRows = pDomain.Rows;
+	cl_long		lCols = pDomain.Cols;
+
+	if (lIdxY <= 0 || lIdxY >= lRows - 1)
+		return;
+
+	cl_ulong	ulRow = getCellID(pDomain, 0, lIdxY);
+
+	for (cl_ulong ulIdx = ulRow + 1; ulIdx < ulRow + lCols - 1; ulIdx++)
+	{
+		cl_double4	pCellData = pCellStateSrc[ulIdx];
+
+		if (pImplicit->Cell[ulIdx] == PIM_CELL_FREE)
+		{
+			pCellData.x = pImplicit->Iterate[ulIdx];
+
+			// New max FSL?
+			if (pCellData.x > pCellData.y && pCellData.y > -9990.0)
+				pCellData.y = pCellData.x;
+
+			// Crazy low depths?
+			if (pCellData.x - dBedElevation[ulIdx] < VERY_SMALL)
+				pCellData.x = dBedElevation[ulIdx];
+		}
+
+		pCellStateDst[ulIdx] = pCellData;
+	}
+}
+
+/*
+ *  Largest absolute row sum of the rate Jacobian, per row
+ */
+template <typename TDomain>
+void pim_Stiffness(
+	const TDomain& pDomain,
+	sPromaidesImplicit* pImplicit,
+	GlobalHandlerClass ghc
+)
+{
+	cl_long		lIdxY = ghc.get_global_id(1);
+	cl_long		lRows = pDomain.Rows;
+	cl_long		lCols = pDomain.Cols;
+	cl_double	dRowMax = 0.0;
+
+	if (lIdxY >= lRows)
+		return;
+
+	cl_ulong	ulRow = getCellID(pDomain, 0, lIdxY);
+
+	// Derivatives by the west/south level are never positive, those by the
+	// east/north level never negative
+	if (lIdxY > 0 && lIdxY < lRows - 1)
+		for (cl_ulong ulIdx = ulRow + 1; ulIdx < ulRow + lCols - 1; ulIdx++)
+			if (pImplicit->Cell[ulIdx] == PIM_CELL_FREE)
+				dRowMax = std::max(dRowMax,
+					pImplicit->SlopeER[ulIdx] - pImplicit->SlopeEL[ulIdx] + pImplicit->SlopeER[ulIdx - 1] - pImplicit->SlopeEL[ulIdx - 1] +
+					pImplicit->SlopeNR[ulIdx] - pImplicit->SlopeNL[ulIdx] + pImplicit->SlopeNR[ulIdx - lCols] - pImplicit->SlopeNL[ulIdx - lCols]
+				);
+
+	pImplicit->RowMax[lIdxY] = dRowMax;
+}
+
+/*
+ *  Sums and maximum of the row reductions, in row order so the result does
+ *  not depend on the thread count
+ */
+inline void pim_Reduce(const sPromaidesImplicit* pImplicit, cl_double* dDot, cl_double* dSquare, cl_double* dMax)
+{
+	*dDot = 0.0;
+	*dSquare = 0.0;
+	*dMax = 0.0;
+	for (cl_ulong ulRow = 0; ulRow < pImplicit->Rows; ulRow++)
+	{
+		*dDot += pImplicit->RowDot[ulRow];
+		*dSquare += pImplicit->RowSquare[ulRow];
+		*dMax = std::max(*dMax, pImplicit->RowMax[ulRow]);
+	}
+}
+
+/*
+ *  One backward Euler step of dTimestep from pCellStateSrc into
+ *  pCellStateDst. False when the Newton iterations do not converge, the
+ *  destination is then not written and the step should be retried shorter.
+ */
+template <typename TDomain>
+bool pim_Step(
+	const TDomain& pDomain,
+	NDRangeExecutor& executor,
+	cl_double dTimestep,						// Timestep
+	cl_double* dBedElevation,					// Bed elevation
+	cl_double4* pCellStateSrc,					// Current cell state data
+	cl_double4* pCellStateDst,					// New cell state data
+	cl_double* dManning,						// Manning values
+	sPromaidesImplicit* pImplicit				// Work arrays
+)
+{
+	int			iRows = (int)pDomain.Rows;
+	cl_double	dDot, dSquare, dResidual;
+
+	pImplicit->NewtonIterations = 0;
+	pImplicit->KrylovIterations = 0;
+
+	executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+		pim_Start(pDomain, pCellStateSrc, pImplicit, ghc);
+	}, 1, iRows, 1, GTS_DIM2);
+
+	executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+		pim_Faces(pDomain, dBedElevation, dManning, pImplicit, ghc);
+	}, 1, iRows, 1, GTS_DIM2);
+	executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+		pim_Residual(pDomain, dTimestep, pImplicit, ghc);
+	}, 1, iRows, 1, GTS_DIM2);
+	pim_Reduce(pImplicit, &dDot, &dSquare, &dResidual);
+
+	while (dResidual > PIM_NEWTON_TOLERANCE)
+	{
+		if (pImplicit->NewtonIterations == PIM_NEWTON_ITERATIONS)
+			return false;
+		pImplicit->NewtonIterations++;
+
+		// Preconditioned BiCGStab for the Newton update
+		cl_double dRho, dMax;
+		cl_double dAlpha, dOmega = 1.0, dBeta = 0.0;
+		cl_double dTarget = std::max(PIM_KRYLOV_TOLERANCE * dResidual, 0.1 * PIM_NEWTON_TOLERANCE);
+
+		executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+			pim_Krylov(pDomain, pImplicit, ghc);
+		}, 1, iRows, 1, GTS_DIM2);
+		pim_Reduce(pImplicit, &dRho, &dSquare, &dMax);
+
+		for (cl_uint uiIteration = 0; uiIteration < PIM_KRYLOV_ITERATIONS && dRho != 0.0; uiIteration++)
+		{
+			executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+				pim_Direction(pDomain, dBeta, dOmega, pImplicit, ghc);
+			}, 1, iRows, 1, GTS_DIM2);
+			executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+				pim_Apply(pDomain, dTimestep, pImplicit->Search, pImplicit->SearchProduct, pImplicit->Shadow, pImplicit, ghc);
+			}, 1, iRows, 1, GTS_DIM2);
+			pim_Reduce(pImplicit, &dDot, &dSquare, &dMax);
+			if (dDot == 0.0)
+				break;
+
+			dAlpha = dRho / dDot;
+			executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+				pim_Intermediate(pDomain, dAlpha, pImplicit, ghc);
+			}, 1, iRows, 1, GTS_DIM2);
+			pim_Reduce(pImplicit, &dDot, &dSquare, &dMax);
+			pImplicit->KrylovIterations++;
+
+			// Converged half way, the stabilising step is skipped
+			if (dMax <= dTarget)
+			{
+				dOmega = 0.0;
+			}
+			else {
+				executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+					pim_Apply(pDomain, dTimestep, pImplicit->Correction, pImplicit->CorrectionProduct, pImplicit->Residual, pImplicit, ghc);
+				}, 1, iRows, 1, GTS_DIM2);
+				pim_Reduce(pImplicit, &dDot, &dSquare, &dMax);
+				dOmega = dSquare > 0.0 ? dDot / dSquare : 0.0;
+			}
+
+			executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+				pim_Advance(pDomain, dAlpha, dOmega, pImplicit, ghc);
+			}, 1, iRows, 1, GTS_DIM2);
+
+			cl_double dRhoNext;
+			pim_Reduce(pImplicit, &dRhoNext, &dSquare, &dMax);
+			if (dMax <= dTarget || dOmega == 0.0)
+				break;
+
+			dBeta = (dRhoNext / dRho) * (dAlpha / dOmega);
+			dRho = dRhoNext;
+		}
+
+		// Halve the update until the residual falls, the face law is
+		// concave in the level difference so full updates overshoot
+		cl_double dLength = 1.0;
+		cl_double dLastResidual = dResidual;
+		for (;;)
+		{
+			executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+				pim_Iterate(pDomain, dLength, dBedElevation, pImplicit, ghc);
+			}, 1, iRows, 1, GTS_DIM2);
+			executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+				pim_Faces(pDomain, dBedElevation, dManning, pImplicit, ghc);
+			}, 1, iRows, 1, GTS_DIM2);
+			executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+				pim_Residual(pDomain, dTimestep, pImplicit, ghc);
+			}, 1, iRows, 1, GTS_DIM2);
+			pim_Reduce(pImplicit, &dDot, &dSquare, &dResidual);
+
+			if (dResidual < (1.0 - 1E-4 * dLength) * dLastResidual || dLength <= PIM_LINE_SEARCH_MINIMUM)
+				break;
+			dLength *= 0.5;
+		}
+	}
+
+	executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+		pim_Finish(pDomain, dBedElevation, pCellStateSrc, pCellStateDst, pImplicit, ghc);
+	}, 1, iRows, 1, GTS_DIM2);
+
+	return true;
+}
+
+/*
+ *  Timestep the explicit solverFunctionPromaides keeps stable on a state,
+ *  PIM_EXPLICIT_SAFETY of the forward Euler limit 2 / r, r the largest
+ *  absolute row sum of the rate Jacobian
+ */
+template <typename TDomain>
+cl_double pim_ExplicitTimestep(
+	const TDomain& pDomain,
+	NDRangeExecutor& executor,
+	cl_double* dBedElevation,					// Bed elevation
+	cl_double4* pCellState,						// Current cell state data
+	cl_double* dManning,						// Manning values
+	sPromaidesImplicit* pImplicit				// Work arrays
+)
+{
+	int			iRows = (int)pDomain.Rows;
+	cl_double	dDot, dSquare, dMax;
+
+	executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+		pim_Start(pDomain, pCellState, pImplicit, ghc);
+	}, 1, iRows, 1, GTS_DIM2);
+	executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+		pim_Faces(pDomain, dBedElevation, dManning, pImplicit, ghc);
+	}, 1, iRows, 1, GTS_DIM2);
+	executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+		pim_Stiffness(pDomain, pImplicit, ghc);
+	}, 1, iRows, 1, GTS_DIM2);
+	pim_Reduce(pImplicit, &dDot, &dSquare, &dMax);
+
+	return dMax > 0.0 ? std::min(PIM_EXPLICIT_SAFETY * 2.0 / dMax, TIMESTEP_MAXIMUM) : TIMESTEP_MAXIMUM;
+}
+
+template bool pim_Step<sDomainConfiguration>(const sDomainConfiguration&, NDRangeExecutor&, cl_double, cl_double*, cl_double4*, cl_double4*, cl_double*, sPromaidesImplicit*);
+template bool pim_Step<sDomainCompiled>(const sDomainCompiled&, NDRangeExecutor&, cl_double, cl_double*, cl_double4*, cl_double4*, cl_double*, sPromaidesImplicit*);
+template cl_double pim_ExplicitTimestep<sDomainConfiguration>(const sDomainConfiguration&, NDRangeExecutor&, cl_double*, cl_double4*, cl_double*, sPromaidesImplicit*);
+template cl_double pim_ExplicitTimestep<sDomainCompiled>(const sDomainCompiled&, NDRangeExecutor&, cl_double*, cl_double4*, cl_double*, sPromaidesImplicit*);
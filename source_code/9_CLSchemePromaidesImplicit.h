@@ -0,0 +1,142 @@
+/*
+ * ------------------------------------------------------------------
+ *  Author: Alaa Mroue - 2023
+ *  This code is licensed under GPLv3. See LICENCE for more information.
+ * ------------------------------------------------------------------
+ */
+
+#pragma once
+#include "definitions.h"
+
+//Implicit (backward Euler) time integration of the diffusive Promaides scheme.
+
+// Newton iterations of a step, and the level residual that ends them (m)
+#define PIM_NEWTON_ITERATIONS		30
+#define PIM_NEWTON_TOLERANCE		1E-7
+
+// Shortest share of a Newton update the line search tries
+#define PIM_LINE_SEARCH_MINIMUM		(1.0 / 64.0)
+
+// BiCGStab iterations of a Newton iteration, and the reduction of the
+// residual that ends them
+#define PIM_KRYLOV_ITERATIONS		400
+#define PIM_KRYLOV_TOLERANCE		1E-3
+
+// Share of the explicit stability limit pim_ExplicitTimestep returns
+#define PIM_EXPLICIT_SAFETY			0.5
+
+// What a cell takes part in
+#define PIM_CELL_FREE				0		// Solved for
+#define PIM_CELL_FIXED				1		// Outer ring, level held but faces flow
+#define PIM_CELL_DISABLED			2		// Neither solved for nor flowing
+
+// Work arrays of the implicit step, a value per cell unless noted
+typedef struct sPromaidesImplicit
+{
+	cl_ulong		Rows;
+	cl_ulong		Cols;
+	cl_uchar*		Cell;					// PIM_CELL_ state
+	cl_double*		Start;					// Level at the start of the step
+	cl_double*		Iterate;				// Level of the current Newton iterate
+	cl_double*		Previous;				// Level of the last Newton iterate
+	cl_double*		RateE;					// Rate through the east face
+	cl_double*		RateN;					// Rate through the north face
+	cl_double*		SlopeEL;				// East face rate derivative by the level of the west cell
+	cl_double*		SlopeER;				// East face rate derivative by the level of the east cell
+	cl_double*		SlopeNL;				// North face rate derivative by the level of the south cell
+	cl_double*		SlopeNR;				// North face rate derivative by the level of the north cell
+	cl_double*		Diagonal;				// Jacobian diagonal, the preconditioner
+	cl_double*		Update;					// Newton update
+	cl_double*		Residual;				// Krylov residual
+	cl_double*		Shadow;					// Krylov shadow residual
+	cl_double*		Direction;				// Krylov search direction
+	cl_double*		Search;					// Preconditioned search direction
+	cl_double*		SearchProduct;			// Jacobian times Search
+	cl_double*		Correction;				// Preconditioned intermediate residual
+	cl_double*		CorrectionProduct;		// Jacobian times Correction
+	cl_double*		RowDot;					// A value per row, reductions
+	cl_double*		RowSquare;				// A value per row, reductions
+	cl_double*		RowMax;					// A value per row, reductions
+	cl_uint			NewtonIterations;		// Of the last step
+	cl_uint			KrylovIterations;		// Of the last step, all Newton iterations
+} sPromaidesImplicit;
+
+/*
+ *  Diffusive rate from cell A into cell B's direction, the rate of change of
+ *  level in A, and its derivatives by the levels of A and B. The law of
+ *  solverFunctionPromaides with the dry level of both cells at their bed.
+ *  The derivatives keep the smoothed values inside the VERY_SMALL dead band.
+ */
+inline cl_double pim_FaceRate(
+	cl_double dLevelA,
+	cl_double dBedA,
+	cl_double dLevelB,
+	cl_double dBedB,
+	cl_double dInvManningA,
+	cl_double dInvManningB,
+	cl_double* dSlopeA,
+	cl_double* dSlopeB
+)
+{
+	bool		bWetA = dLevelA - dBedA >= VERY_SMALL;
+	bool		bWetB = dLevelB - dBedB >= VERY_SMALL;
+	cl_double	dSurfaceA = bWetA ? dLevelA : dBedA;
+	cl_double	dSurfaceB = bWetB ? dLevelB : dBedB;
+	cl_double	dBedMax = std::max(dBedA, dBedB);
+	cl_double	dFlowDepth = std::max(std::max(dSurfaceA - dBedMax, dSurfaceB - dBedMax), 0.0);
+
+	*dSlopeA = 0.0;
+	*dSlopeB = 0.0;
+	if (!(dLevelA - dBedA > VERY_SMALL || dLevelB - dBedB > VERY_SMALL) || dFlowDepth <= VERY_SMALL)
+		return 0.0;
+
+	cl_double	dDelta = dSurfaceB - dSurfaceA;
+	cl_double	dAbsDelta = fabs(dDelta);
+	cl_double	dConveyance = 0.5 * (dInvManningA + dInvManningB) * pow(dFlowDepth, 5.0 / 3.0);
+	cl_double	dRate, dSlope;
+
+	if (dAbsDelta <= 0.005078) {
+		cl_double t = 159.877741951379 * dDelta;
+		dRate = dConveyance * 0.10449968880528 * atan(t);
+		dSlope = dConveyance * 0.10449968880528 * 159.877741951379 / (1.0 + t * t);
+	}
+	else {
+		dRate = dConveyance * dDelta / sqrt(dAbsDelta);
+		dSlope = 0.5 * dConveyance / sqrt(dAbsDelta);
+	}
+
+	// The flow depth is set by the higher surface
+	cl_double	dDepthSlope = 5.0 / 3.0 * dRate / dFlowDepth;
+
+	if (bWetA)
+		*dSlopeA = -dSlope + (dSurfaceA >= dSurfaceB ? dDepthSlope : 0.0);
+	if (bWetB)
+		*dSlopeB = dSlope + (dSurfaceB > dSurfaceA ? dDepthSlope : 0.0);
+
+	return dAbsDelta > VERY_SMALL ? dRate : 0.0;
+}
+
+sPromaidesImplicit	allocatePromaidesImplicit(const sDomainConfiguration&);
+void				freePromaidesImplicit(sPromaidesImplicit*);
+
+template <typename TDomain>
+bool pim_Step(
+	const TDomain&,
+	NDRangeExecutor&,
+	cl_double,
+	cl_double*,
+	cl_double4*,
+	cl_double4*,
+	cl_double*,
+	sPromaidesImplicit*
+);
+
+template <typename TDomain>
+cl_double pim_ExplicitTimestep(
+	const TDomain&,
+	NDRangeExecutor&,
+	cl_double*,
+	cl_double4*,
+	cl_double*,
+	sPromaidesImplicit*
+);
@@ -7,29 +7,91 @@
 
 #include "GlobalHandlerClass.h"
 
+WorkGroupBarrier::WorkGroupBarrier(unsigned int uiCount) {
+	this->uiCount = uiCount;
+	this->uiWaiting = 0;
+	this->ulGeneration = 0;
+}
+
+void WorkGroupBarrier::wait() {
+	std::unique_lock<std::mutex> lock(this->mLock);
+	unsigned long long ulMyGeneration = this->ulGeneration;
+
+	// Last one in releases everyone and resets for the next barrier
+	if (++this->uiWaiting == this->uiCount) {
+		this->uiWaiting = 0;
+		this->ulGeneration++;
+		this->cvRelease.notify_all();
+		return;
+	}
+
+	this->cvRelease.wait(lock, [&] { return this->ulGeneration != ulMyGeneration; });
+}
+
+/*
+ *  A single work-item run on its own, the work-group is 1x1
+ */
 GlobalHandlerClass::GlobalHandlerClass(int globalintX, int globalintY) {
 	this->globalintX = globalintX;
 	this->globalintY = globalintY;
+	this->localintX = 0;
+	this->localintY = 0;
+	this->groupintX = globalintX;
+	this->groupintY = globalintY;
+	this->globalSizeX = globalintX + 1;
+	this->globalSizeY = globalintY + 1;
+	this->localSizeX = 1;
+	this->localSizeY = 1;
+	this->localMemory = NULL;
+	this->groupBarrier = NULL;
+}
 
+/*
+ *  First work-item of the group, the executor moves it through the group
+ */
+GlobalHandlerClass::GlobalHandlerClass(int groupintX, int groupintY, int globalSizeX, int globalSizeY, int localSizeX, int localSizeY) {
+	this->groupintX = groupintX;
+	this->groupintY = groupintY;
+	this->globalSizeX = globalSizeX;
+	this->globalSizeY = globalSizeY;
+	this->localSizeX = localSizeX;
+	this->localSizeY = localSizeY;
+	this->localintX = 0;
+	this->localintY = 0;
+	this->globalintX = groupintX * localSizeX;
+	this->globalintY = groupintY * localSizeY;
+	this->localMemory = NULL;
+	this->groupBarrier = NULL;
 }
 
 int GlobalHandlerClass::get_group_id(int index) {
 	if (index == 0 ){
-		return this->globalintX;
+		return this->groupintX;
 	}
 	else if (index == 1){
-		return this->globalintY;
+		return this->groupintY;
 	}
 
 	std::cout << "get_group_id error: Index is not valid" << std::endl;
 	return 0;
 }
+int GlobalHandlerClass::get_num_groups(int index) {
+	if (index == 0) {
+		return this->globalSizeX / this->localSizeX;
+	}
+	else if (index == 1) {
+		return this->globalSizeY / this->localSizeY;
+	}
+
+	std::cout << "get_num_groups error: Index is not valid" << std::endl;
+	return 0;
+}
 int GlobalHandlerClass::get_global_size(int index) {
 	if (index == 0) {
-		return this->globalintX;
+		return this->globalSizeX;
 	}
 	else if (index == 1) {
-		return this->globalintY;
+		return this->globalSizeY;
 	}
 
 	std::cout << "get_global_size error: Index is not valid" << std::endl;
@@ -48,10 +110,10 @@ int GlobalHandlerClass::get_global_id(int index) {
 }
 int GlobalHandlerClass::get_local_id(int index) {
 	if (index == 0) {
-		return this->globalintX;
+		return this->localintX;
 	}
 	else if (index == 1) {
-		return this->globalintY;
+		return this->localintY;
 	}
 
 	std::cout << "get_local_id error: Index is not valid" << std::endl;
@@ -59,12 +121,25 @@ int GlobalHandlerClass::get_local_id(int index) {
 }
 int GlobalHandlerClass::get_local_size(int index) {
 	if (index == 0) {
-		return this->globalintX;
+		return this->localSizeX;
 	}
 	else if (index == 1) {
-		return this->globalintY;
+		return this->localSizeY;
 	}
 
 	std::cout << "get_local_size error: Index is not valid" << std::endl;
 	return 0;
-}
\ No newline at end of file
+}
+void* GlobalHandlerClass::get_local_memory() {
+	return this->localMemory;
+}
+void GlobalHandlerClass::barrier(int /*flags*/) {
+	if (this->groupBarrier != NULL) {
+		this->groupBarrier->wait();
+		return;
+	}
+
+	// Work-items of a non-cooperative group run one after another
+	if (this->localSizeX * this->localSizeY > 1)
+		std::cout << "barrier error: Kernel was not enqueued as cooperative" << std::endl;
+}
@@ -6,17 +6,54 @@
  */
 
 #include <iostream>
+#include <mutex>
+#include <condition_variable>
 
 #pragma once
+
+#ifndef CLK_LOCAL_MEM_FENCE
+#define CLK_LOCAL_MEM_FENCE		1
+#define CLK_GLOBAL_MEM_FENCE	2
+#endif
+
+// Barrier shared by the work-items of one work-group
+class WorkGroupBarrier {
+public:
+	WorkGroupBarrier(unsigned int);
+	void wait();
+
+private:
+	std::mutex				mLock;
+	std::condition_variable	cvRelease;
+	unsigned int			uiCount;
+	unsigned int			uiWaiting;
+	unsigned long long		ulGeneration;
+};
+
+// Work-item view of an ND-range, mirrors the OpenCL work-item functions
 class GlobalHandlerClass {
 public:
 	int globalintX;
 	int globalintY;
+	int localintX;
+	int localintY;
+	int groupintX;
+	int groupintY;
+	int globalSizeX;
+	int globalSizeY;
+	int localSizeX;
+	int localSizeY;
+	void* localMemory;
+	WorkGroupBarrier* groupBarrier;
 
 	GlobalHandlerClass(int, int);
+	GlobalHandlerClass(int, int, int, int, int, int);
 	int get_group_id(int index);
+	int get_num_groups(int index);
 	int get_global_size(int index);
 	int get_global_id(int index);
 	int get_local_id(int index);
 	int get_local_size(int index);
-};
\ No newline at end of file
+	void* get_local_memory();
+	void barrier(int flags);
+};
@@ -0,0 +1,212 @@
+/*
+ * ------------------------------------------------------------------
+ *  Author: Alaa Mroue - 2023
+ *  This code is licensed under GPLv3. See LICENCE for more information.
+ * ------------------------------------------------------------------
+ */
+
+#include "HaloTransport.h"
+#include <cstring>
+
+SharedMemoryWorld::SharedMemoryWorld(int iRanks)
+	: iRanks(iRanks), iReduceArrived(0), dReduceValue(0.0), dReduceResult(0.0), ulReduceGeneration(0)
+{
+}
+
+SharedMemoryTransport::SharedMemoryTransport(SharedMemoryWorld* pWorld, int iRank)
+	: pWorld(pWorld), iRank(iRank)
+{
+}
+
+int SharedMemoryTransport::getRank() {
+	return this->iRank;
+}
+
+int SharedMemoryTransport::getRankCount() {
+	return this->pWorld->iRanks;
+}
+
+cl_ulong SharedMemoryTransport::getMailbox(int iSource, int iDestination, int iTag) {
+	return ((cl_ulong)iSource * this->pWorld->iRanks + iDestination) * 8 + iTag;
+}
+
+void SharedMemoryTransport::postSend(int iRank, int iTag, const void* pData, size_t uiBytes) {
+	std::vector<char> vMessage((const char*)pData, (const char*)pData + uiBytes);
+
+	std::lock_guard<std::mutex> lock(this->pWorld->mLock);
+	this->pWorld->mMailboxes[this->getMailbox(this->iRank, iRank, iTag)].push_back(std::move(vMessage));
+	this->pWorld->cvPosted.notify_all();
+}
+
+void SharedMemoryTransport::postReceive(int iRank, int iTag, void* pData, size_t uiBytes) {
+	sPendingReceive pReceive = { this->getMailbox(iRank, this->iRank, iTag), pData, uiBytes };
+	this->vPending.push_back(pReceive);
+}
+
+/*
+ *  Sends completed when posted, so only the receives are waited for
+ */
+void SharedMemoryTransport::waitAll() {
+	std::unique_lock<std::mutex> lock(this->pWorld->mLock);
+
+	for (size_t i = 0; i < this->vPending.size(); i++)
+	{
+		std::deque<std::vector<char>>& qMailbox = this->pWorld->mMailboxes[this->vPending[i].Mailbox];
+		this->pWorld->cvPosted.wait(lock, [&] { return !qMailbox.empty(); });
+		memcpy(this->vPending[i].Data, qMailbox.front().data(), std::min(this->vPending[i].Bytes, qMailbox.front().size()));
+		qMailbox.pop_front();
+	}
+
+	this->vPending.clear();
+}
+
+/*
+ *  The last rank to arrive publishes the maximum. A rank can only start
+ *  the next reduction once this one is published, so one result suffices.
+ */
+cl_double SharedMemoryTransport::allReduceMax(cl_double dValue) {
+	std::unique_lock<std::mutex> lock(this->pWorld->mLock);
+	unsigned long long ulGeneration = this->pWorld->ulReduceGeneration;
+
+	if (this->pWorld->iReduceArrived == 0 || dValue > this->pWorld->dReduceValue)
+		this->pWorld->dReduceValue = dValue;
+
+	if (++this->pWorld->iReduceArrived == this->pWorld->iRanks)
+	{
+		this->pWorld->dReduceResult = this->pWorld->dReduceValue;
+		this->pWorld->iReduceArrived = 0;
+		this->pWorld->ulReduceGeneration++;
+		this->pWorld->cvPosted.notify_all();
+	}
+	else {
+		this->pWorld->cvPosted.wait(lock, [&] { return this->pWorld->ulReduceGeneration != ulGeneration; });
+	}
+
+	return this->pWorld->dReduceResult;
+}
+
+HaloExchange::HaloExchange(const sDomainPartition& pPartition, HaloTransport* pTransport)
+	: pPartition(pPartition), pTransport(pTransport)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		if (i == DOMAIN_DIR_E || i == DOMAIN_DIR_W)
+		{
+			this->vSendColumns[i].resize(pPartition.Local.Rows);
+			this->vReceiveColumns[i].resize(pPartition.Local.Rows);
+		}
+	}
+}
+
+/*
+ *  Post the halo exchange of a state. Until finish, the ring may still be
+ *  written and the cells next to it must not be.
+ */
+void HaloExchange::begin(cl_double4* pCellState) {
+	const int*	iNeighbours = this->pPartition.Neighbours;
+	cl_ulong	ulRows = this->pPartition.Local.Rows;
+	cl_ulong	ulCols = this->pPartition.Local.Cols;
+	size_t		uiRowBytes = ulCols * sizeof(cl_double4);
+	size_t		uiColumnBytes = ulRows * sizeof(cl_double4);
+
+	// Receive into the ring, tagged with the direction the message travels
+	if (iNeighbours[DOMAIN_DIR_N] >= 0)
+		this->pTransport->postReceive(iNeighbours[DOMAIN_DIR_N], DOMAIN_DIR_S, &pCellState[(ulRows - 1) * ulCols], uiRowBytes);
+	if (iNeighbours[DOMAIN_DIR_S] >= 0)
+		this->pTransport->postReceive(iNeighbours[DOMAIN_DIR_S], DOMAIN_DIR_N, &pCellState[0], uiRowBytes);
+	if (iNeighbours[DOMAIN_DIR_E] >= 0)
+		this->pTransport->postReceive(iNeighbours[DOMAIN_DIR_E], DOMAIN_DIR_W, this->vReceiveColumns[DOMAIN_DIR_E].data(), uiColumnBytes);
+	if (iNeighbours[DOMAIN_DIR_W] >= 0)
+		this->pTransport->postReceive(iNeighbours[DOMAIN_DIR_W], DOMAIN_DIR_E, this->vReceiveColumns[DOMAIN_DIR_W].data(), uiColumnBytes);
+
+	// Rows are contiguous, columns are packed
+	if (iNeighbours[DOMAIN_DIR_N] >= 0)
+		this->pTransport->postSend(iNeighbours[DOMAIN_DIR_N], DOMAIN_DIR_N, &pCellState[(ulRows - 2) * ulCols], uiRowBytes);
+	if (iNeighbours[DOMAIN_DIR_S] >= 0)
+		this->pTransport->postSend(iNeighbours[DOMAIN_DIR_S], DOMAIN_DIR_S, &pCellState[ulCols], uiRowBytes);
+	if (iNeighbours[DOMAIN_DIR_E] >= 0)
+	{
+		for (cl_ulong ulRow = 0; ulRow < ulRows; ulRow++)
+			this->vSendColumns[DOMAIN_DIR_E][ulRow] = pCellState[ulRow * ulCols + ulCols - 2];
+		this->pTransport->postSend(iNeighbours[DOMAIN_DIR_E], DOMAIN_DIR_E, this->vSendColumns[DOMAIN_DIR_E].data(), uiColumnBytes);
+	}
+	if (iNeighbours[DOMAIN_DIR_W] >= 0)
+	{
+		for (cl_ulong ulRow = 0; ulRow < ulRows; ulRow++)
+			this->vSendColumns[DOMAIN_DIR_W][ulRow] = pCellState[ulRow * ulCols + 1];
+		this->pTransport->postSend(iNeighbours[DOMAIN_DIR_W], DOMAIN_DIR_W, this->vSendColumns[DOMAIN_DIR_W].data(), uiColumnBytes);
+	}
+}
+
+void HaloExchange::finish(cl_double4* pCellState) {
+	const int*	iNeighbours = this->pPartition.Neighbours;
+	cl_ulong	ulRows = this->pPartition.Local.Rows;
+	cl_ulong	ulCols = this->pPartition.Local.Cols;
+
+	this->pTransport->waitAll();
+
+	// Only the ring rows are filled, the corners belong to neither face
+	if (iNeighbours[DOMAIN_DIR_E] >= 0)
+		for (cl_ulong ulRow = 1; ulRow < ulRows - 1; ulRow++)
+			pCellState[ulRow * ulCols + ulCols - 1] = this->vReceiveColumns[DOMAIN_DIR_E][ulRow];
+	if (iNeighbours[DOMAIN_DIR_W] >= 0)
+		for (cl_ulong ulRow = 1; ulRow < ulRows - 1; ulRow++)
+			pCellState[ulRow * ulCols] = this->vReceiveColumns[DOMAIN_DIR_W][ulRow];
+}
+
+/*
+ *  Collect the cells every rank owns into the global state on rank 0
+ */
+void gatherPartitions(HaloTransport* pTransport, const sDomainConfiguration& pDomain, const sDomainPartition& pPartition, cl_double4* pLocalState, cl_double4* pGlobalState) {
+	std::vector<cl_double4>	vBlock;
+
+	if (pTransport->getRank() != 0)
+	{
+		for (cl_ulong ulRow = pPartition.OwnedRowStart; ulRow < pPartition.OwnedRowEnd; ulRow++)
+			for (cl_ulong ulCol = pPartition.OwnedColStart; ulCol < pPartition.OwnedColEnd; ulCol++)
+				vBlock.push_back(pLocalState[ulRow * pPartition.Local.Cols + ulCol]);
+		pTransport->postSend(0, TRANSPORT_TAG_GATHER, vBlock.data(), vBlock.size() * sizeof(cl_double4));
+		pTransport->waitAll();
+		return;
+	}
+
+	for (int iRank = 0; iRank < pTransport->getRankCount(); iRank++)
+	{
+		sDomainPartition	pBlock;
+		cl_ulong			ulCell = 0;
+
+		createDomainPartition(pDomain, pTransport->getRankCount(), iRank, &pBlock);
+		if (iRank != 0)
+		{
+			vBlock.resize((pBlock.OwnedRowEnd - pBlock.OwnedRowStart) * (pBlock.OwnedColEnd - pBlock.OwnedColStart));
+			pTransport->postReceive(iRank, TRANSPORT_TAG_GATHER, vBlock.data(), vBlock.size() * sizeof(cl_double4));
+			pTransport->waitAll();
+		}
+
+		for (cl_ulong ulRow = pBlock.OwnedRowStart; ulRow < pBlock.OwnedRowEnd; ulRow++)
+		{
+			for (cl_ulong ulCol = pBlock.OwnedColStart; ulCol < pBlock.OwnedColEnd; ulCol++)
+			{
+				cl_ulong ulGlobal = (pBlock.RowOffset + ulRow) * pDomain.Cols + pBlock.ColOffset + ulCol;
+				pGlobalState[ulGlobal] = iRank == 0 ? pLocalState[ulRow * pPartition.Local.Cols + ulCol] : vBlock[ulCell++];
+			}
+		}
+	}
+}
+
+/*
+ *  Hand a count read on rank 0 to every rank
+ */
+unsigned long long broadcastCount(HaloTransport* pTransport, unsigned long long ulCount) {
+	if (pTransport->getRank() == 0)
+	{
+		for (int iRank = 1; iRank < pTransport->getRankCount(); iRank++)
+			pTransport->postSend(iRank, TRANSPORT_TAG_BROADCAST, &ulCount, sizeof(ulCount));
+	}
+	else {
+		pTransport->postReceive(0, TRANSPORT_TAG_BROADCAST, &ulCount, sizeof(ulCount));
+	}
+
+	pTransport->waitAll();
+	return ulCount;
+}
@@ -0,0 +1,96 @@
+/*
+ * ------------------------------------------------------------------
+ *  Author: Alaa Mroue - 2023
+ *  This code is licensed under GPLv3. See LICENCE for more information.
+ * ------------------------------------------------------------------
+ */
+
+#pragma once
+#include <vector>
+#include <map>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include "definitions.h"
+
+// Message tags, halo messages are tagged with the direction they travel
+#define TRANSPORT_TAG_GATHER		4
+#define TRANSPORT_TAG_BROADCAST		5
+
+// Moves bytes between the ranks of a distributed run. Sends and receives
+// are only posted, waitAll completes them, so work placed in between
+// overlaps the communication.
+class HaloTransport {
+public:
+	virtual ~HaloTransport() {}
+	virtual int getRank() = 0;
+	virtual int getRankCount() = 0;
+	virtual void postSend(int iRank, int iTag, const void* pData, size_t uiBytes) = 0;
+	virtual void postReceive(int iRank, int iTag, void* pData, size_t uiBytes) = 0;
+	virtual void waitAll() = 0;
+	virtual cl_double allReduceMax(cl_double dValue) = 0;
+};
+
+// Mailboxes shared by the ranks of one process, see SharedMemoryTransport
+class SharedMemoryWorld {
+public:
+	SharedMemoryWorld(int);
+
+private:
+	friend class SharedMemoryTransport;
+
+	int										iRanks;
+	std::mutex								mLock;
+	std::condition_variable					cvPosted;
+	std::map<cl_ulong, std::deque<std::vector<char>>>	mMailboxes;		// Keyed by source, destination and tag
+	int										iReduceArrived;
+	cl_double								dReduceValue;
+	cl_double								dReduceResult;
+	unsigned long long						ulReduceGeneration;
+};
+
+// Ranks as threads of one process, each holding its own copy of its block.
+// Sends are copied into the receiver's mailbox at once, receives complete
+// in waitAll. Runs several ranks on one machine without MPI.
+class SharedMemoryTransport : public HaloTransport {
+public:
+	SharedMemoryTransport(SharedMemoryWorld*, int);
+	int getRank();
+	int getRankCount();
+	void postSend(int, int, const void*, size_t);
+	void postReceive(int, int, void*, size_t);
+	void waitAll();
+	cl_double allReduceMax(cl_double);
+
+private:
+	typedef struct sPendingReceive {
+		cl_ulong	Mailbox;
+		void*		Data;
+		size_t		Bytes;
+	} sPendingReceive;
+
+	cl_ulong getMailbox(int, int, int);
+
+	SharedMemoryWorld*				pWorld;
+	int								iRank;
+	std::vector<sPendingReceive>	vPending;
+};
+
+// Halo rows and columns of a partition's state. begin posts the exchange
+// of the cells next to the ring, finish waits for it and fills the ring.
+// Corners are not exchanged, the kernels only read the four faces.
+class HaloExchange {
+public:
+	HaloExchange(const sDomainPartition&, HaloTransport*);
+	void begin(cl_double4*);
+	void finish(cl_double4*);
+
+private:
+	sDomainPartition			pPartition;
+	HaloTransport*				pTransport;
+	std::vector<cl_double4>		vSendColumns[4];
+	std::vector<cl_double4>		vReceiveColumns[4];
+};
+
+void gatherPartitions(HaloTransport*, const sDomainConfiguration&, const sDomainPartition&, cl_double4*, cl_double4*);
+unsigned long long broadcastCount(HaloTransport*, unsigned long long);
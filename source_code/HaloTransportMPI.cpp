@@ -0,0 +1,47 @@
+/*
+ * ------------------------------------------------------------------
+ *  Author: Alaa Mroue - 2023
+ *  This code is licensed under GPLv3. See LICENCE for more information.
+ * ------------------------------------------------------------------
+ */
+
+#include "HaloTransportMPI.h"
+
+MPITransport::MPITransport(MPI_Comm pCommunicator)
+	: pCommunicator(pCommunicator)
+{
+	MPI_Comm_rank(pCommunicator, &this->iRank);
+	MPI_Comm_size(pCommunicator, &this->iRanks);
+}
+
+int MPITransport::getRank() {
+	return this->iRank;
+}
+
+int MPITransport::getRankCount() {
+	return this->iRanks;
+}
+
+void MPITransport::postSend(int iRank, int iTag, const void* pData, size_t uiBytes) {
+	MPI_Request pRequest;
+	MPI_Isend(const_cast<void*>(pData), (int)uiBytes, MPI_BYTE, iRank, iTag, this->pCommunicator, &pRequest);
+	this->vRequests.push_back(pRequest);
+}
+
+void MPITransport::postReceive(int iRank, int iTag, void* pData, size_t uiBytes) {
+	MPI_Request pRequest;
+	MPI_Irecv(pData, (int)uiBytes, MPI_BYTE, iRank, iTag, this->pCommunicator, &pRequest);
+	this->vRequests.push_back(pRequest);
+}
+
+void MPITransport::waitAll() {
+	if (!this->vRequests.empty())
+		MPI_Waitall((int)this->vRequests.size(), this->vRequests.data(), MPI_STATUSES_IGNORE);
+	this->vRequests.clear();
+}
+
+cl_double MPITransport::allReduceMax(cl_double dValue) {
+	cl_double dResult;
+	MPI_Allreduce(&dValue, &dResult, 1, MPI_DOUBLE, MPI_MAX, this->pCommunicator);
+	return dResult;
+}
@@ -0,0 +1,29 @@
+/*
+ * ------------------------------------------------------------------
+ *  Author: Alaa Mroue - 2023
+ *  This code is licensed under GPLv3. See LICENCE for more information.
+ * ------------------------------------------------------------------
+ */
+
+#pragma once
+#include <mpi.h>
+#include "HaloTransport.h"
+
+// Ranks as MPI processes, one block of the domain in each. Sends and
+// receives are non-blocking and complete together in waitAll.
+class MPITransport : public HaloTransport {
+public:
+	MPITransport(MPI_Comm);
+	int getRank();
+	int getRankCount();
+	void postSend(int, int, const void*, size_t);
+	void postReceive(int, int, void*, size_t);
+	void waitAll();
+	cl_double allReduceMax(cl_double);
+
+private:
+	MPI_Comm					pCommunicator;
+	int							iRank;
+	int							iRanks;
+	std::vector<MPI_Request>	vRequests;
+};
@@ -0,0 +1,111 @@
+/*
+ * ------------------------------------------------------------------
+ *  Author: Alaa Mroue - 2023
+ *  This code is licensed under GPLv3. See LICENCE for more information.
+ * ------------------------------------------------------------------
+ */
+
+#include "NDRangeExecutor.h"
+#include <algorithm>
+
+/*
+ *  Start the pool, zero threads means one per hardware thread.
+ *  The calling thread works too, so N threads means N-1 workers.
+ */
+NDRangeExecutor::NDRangeExecutor(unsigned int uiThreads) {
+	if (uiThreads == 0)
+		uiThreads = std::max(1u, std::thread::hardware_concurrency());
+
+	this->bShutdown = false;
+	this->ulJobCounter = 0;
+	this->uiFinished = 0;
+	this->pJobRunner = NULL;
+	this->iJobGroups = 0;
+	this->uiJobLocalMemory = 0;
+	this->iJobNextGroup = 0;
+
+	for (unsigned int i = 1; i < uiThreads; i++)
+		this->vWorkers.push_back(std::thread(&NDRangeExecutor::workerLoop, this));
+}
+
+NDRangeExecutor::~NDRangeExecutor() {
+	{
+		std::lock_guard<std::mutex> lock(this->mJob);
+		this->bShutdown = true;
+	}
+	this->cvJob.notify_all();
+	for (size_t i = 0; i < this->vWorkers.size(); i++)
+		this->vWorkers[i].join();
+}
+
+unsigned int NDRangeExecutor::getThreadCount() {
+	return (unsigned int)this->vWorkers.size() + 1;
+}
+
+/*
+ *  Hand the groups to the pool and work on them until all are done
+ */
+void NDRangeExecutor::runGroups(int iGroups, size_t uiLocalMemory, const tGroupRunner& runner) {
+	std::vector<char> vLocalMemory;
+
+	if (iGroups <= 0)
+		return;
+
+	// Nothing to share out
+	if (this->vWorkers.empty() || iGroups == 1) {
+		vLocalMemory.resize(uiLocalMemory);
+		for (int iGroup = 0; iGroup < iGroups; iGroup++)
+			runner(iGroup, vLocalMemory.empty() ? NULL : &vLocalMemory[0]);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(this->mJob);
+		this->pJobRunner = &runner;
+		this->iJobGroups = iGroups;
+		this->uiJobLocalMemory = uiLocalMemory;
+		this->iJobNextGroup = 0;
+		this->uiFinished = 0;
+		this->ulJobCounter++;
+	}
+	this->cvJob.notify_all();
+
+	this->workOnGroups(vLocalMemory);
+
+	// Every worker must have seen the job before the next one is posted
+	std::unique_lock<std::mutex> lock(this->mJob);
+	this->cvDone.wait(lock, [&] { return this->uiFinished == this->vWorkers.size(); });
+	this->pJobRunner = NULL;
+}
+
+void NDRangeExecutor::workOnGroups(std::vector<char>& vLocalMemory) {
+	if (vLocalMemory.size() < this->uiJobLocalMemory)
+		vLocalMemory.resize(this->uiJobLocalMemory);
+
+	int iGroup;
+	while ((iGroup = this->iJobNextGroup.fetch_add(1)) < this->iJobGroups)
+		(*this->pJobRunner)(iGroup, vLocalMemory.empty() ? NULL : &vLocalMemory[0]);
+}
+
+void NDRangeExecutor::workerLoop() {
+	std::vector<char> vLocalMemory;
+	unsigned long long ulSeenJob = 0;
+
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(this->mJob);
+			this->cvJob.wait(lock, [&] { return this->bShutdown || this->ulJobCounter != ulSeenJob; });
+			if (this->bShutdown)
+				return;
+			ulSeenJob = this->ulJobCounter;
+		}
+
+		this->workOnGroups(vLocalMemory);
+
+		{
+			std::lock_guard<std::mutex> lock(this->mJob);
+			if (++this->uiFinished == this->vWorkers.size())
+				this->cvDone.notify_all();
+		}
+	}
+}
@@ -0,0 +1,128 @@
+/*
+ * ------------------------------------------------------------------
+ *  Author: Alaa Mroue - 2023
+ *  This code is licensed under GPLv3. See LICENCE for more information.
+ * ------------------------------------------------------------------
+ */
+
+#pragma once
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include "GlobalHandlerClass.h"
+
+// Runs kernels over a 2D ND-range on a pool of threads.
+// Work-groups are the unit of scheduling: a worker takes a whole group and
+// walks its work-items, so kernels see OpenCL work-item semantics.
+// Groups of a cooperative enqueue run their work-items concurrently so the
+// kernel may call barrier(); use these only where a barrier is needed.
+class NDRangeExecutor {
+public:
+	NDRangeExecutor(unsigned int);
+	~NDRangeExecutor();
+	unsigned int getThreadCount();
+
+	template <typename TKernel>
+	void enqueueNDRange(TKernel kernel, int iGlobalX, int iGlobalY, int iLocalX, int iLocalY, size_t uiLocalMemory = 0, bool bCooperative = false);
+	template <typename TKernel>
+	void enqueueNDRangeOffset(TKernel kernel, int iOffsetX, int iOffsetY, int iGlobalX, int iGlobalY, int iLocalX, int iLocalY);
+
+private:
+	typedef std::function<void(int, void*)> tGroupRunner;
+
+	void runGroups(int, size_t, const tGroupRunner&);
+	void workerLoop();
+	void workOnGroups(std::vector<char>&);
+
+	std::vector<std::thread>	vWorkers;
+	std::mutex					mJob;
+	std::condition_variable		cvJob;
+	std::condition_variable		cvDone;
+	bool						bShutdown;
+	unsigned long long			ulJobCounter;
+	unsigned int				uiFinished;
+
+	const tGroupRunner*			pJobRunner;
+	int							iJobGroups;
+	size_t						uiJobLocalMemory;
+	std::atomic<int>			iJobNextGroup;
+};
+
+/*
+ *  Run the kernel for every work-item of the range and wait for completion.
+ *  The global size is rounded up to whole work-groups, kernels bounds check.
+ */
+template <typename TKernel>
+void NDRangeExecutor::enqueueNDRange(TKernel kernel, int iGlobalX, int iGlobalY, int iLocalX, int iLocalY, size_t uiLocalMemory, bool bCooperative)
+{
+	int iGroupsX = (iGlobalX + iLocalX - 1) / iLocalX;
+	int iGroupsY = (iGlobalY + iLocalY - 1) / iLocalY;
+	int iPaddedX = iGroupsX * iLocalX;
+	int iPaddedY = iGroupsY * iLocalY;
+
+	tGroupRunner runner;
+	if (!bCooperative)
+	{
+		runner = [&](int iGroup, void* pLocalMemory) {
+			GlobalHandlerClass ghc(iGroup % iGroupsX, iGroup / iGroupsX, iPaddedX, iPaddedY, iLocalX, iLocalY);
+			ghc.localMemory = pLocalMemory;
+			int iBaseX = ghc.globalintX;
+			int iBaseY = ghc.globalintY;
+			for (int iY = 0; iY < iLocalY; iY++) {
+				for (int iX = 0; iX < iLocalX; iX++) {
+					ghc.localintX = iX;
+					ghc.localintY = iY;
+					ghc.globalintX = iBaseX + iX;
+					ghc.globalintY = iBaseY + iY;
+					kernel(ghc);
+				}
+			}
+		};
+	}
+	else {
+		// Every work-item gets its own thread so barrier() can block
+		runner = [&](int iGroup, void* pLocalMemory) {
+			int iItems = iLocalX * iLocalY;
+			WorkGroupBarrier groupBarrier(iItems);
+			std::vector<std::thread> vItems;
+			auto runItem = [&](int iItem) {
+				GlobalHandlerClass ghc(iGroup % iGroupsX, iGroup / iGroupsX, iPaddedX, iPaddedY, iLocalX, iLocalY);
+				ghc.localMemory = pLocalMemory;
+				ghc.groupBarrier = &groupBarrier;
+				ghc.localintX = iItem % iLocalX;
+				ghc.localintY = iItem / iLocalX;
+				ghc.globalintX += ghc.localintX;
+				ghc.globalintY += ghc.localintY;
+				kernel(ghc);
+			};
+			for (int iItem = 1; iItem < iItems; iItem++)
+				vItems.push_back(std::thread(runItem, iItem));
+			runItem(0);
+			for (size_t i = 0; i < vItems.size(); i++)
+				vItems[i].join();
+		};
+	}
+
+	this->runGroups(iGroupsX * iGroupsY, uiLocalMemory, runner);
+}
+
+/*
+ *  Run the kernel over a block of the range starting at an offset, as the
+ *  OpenCL global work offset. Work-items past the block are not run, so a
+ *  block can stop short of the domain edge.
+ */
+template <typename TKernel>
+void NDRangeExecutor::enqueueNDRangeOffset(TKernel kernel, int iOffsetX, int iOffsetY, int iGlobalX, int iGlobalY, int iLocalX, int iLocalY)
+{
+	if (iGlobalX <= 0 || iGlobalY <= 0)
+		return;
+
+	this->enqueueNDRange([&](GlobalHandlerClass ghc) {
+		if (ghc.globalintX >= iGlobalX || ghc.globalintY >= iGlobalY)
+			return;
+		ghc.globalintX += iOffsetX;
+		ghc.globalintY += iOffsetY;
+		kernel(ghc);
+	}, iGlobalX, iGlobalY, iLocalX, iLocalY);
+}
@@ -0,0 +1,98 @@
+/*
+ * ------------------------------------------------------------------
+ *  Author: Alaa Mroue - 2023
+ *  This code is licensed under GPLv3. See LICENCE for more information.
+ * ------------------------------------------------------------------
+ */
+
+#pragma once
+#include "definitions.h"
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/*
+ *  Lane operations used by the batched kernels, one structure per instruction set
+ *  select(mask, a, b) returns a where the mask is set and b elsewhere
+ *  sLanesScalar is one lane wide, it runs the same code on remainders and on
+ *  builds without AVX2.
+ */
+struct sLanesScalar {
+	typedef cl_double Value;
+	typedef bool Mask;
+	static const cl_uint Width = 1;
+
+	static Value load(const cl_double* p) { return *p; }
+	static void store(cl_double* p, Value a) { *p = a; }
+	static Value set(cl_double d) { return d; }
+	static Value add(Value a, Value b) { return a + b; }
+	static Value sub(Value a, Value b) { return a - b; }
+	static Value mul(Value a, Value b) { return a * b; }
+	static Value div(Value a, Value b) { return a / b; }
+	static Value sqrt(Value a) { return ::sqrt(a); }
+	static Value abs(Value a) { return fabs(a); }
+	static Value max(Value a, Value b) { return a > b ? a : b; }
+	static Mask lt(Value a, Value b) { return a < b; }
+	static Mask le(Value a, Value b) { return a <= b; }
+	static Mask gt(Value a, Value b) { return a > b; }
+	static Mask ge(Value a, Value b) { return a >= b; }
+	static Mask both(Mask a, Mask b) { return a && b; }
+	static Mask either(Mask a, Mask b) { return a || b; }
+	static Mask butNot(Mask a, Mask b) { return a && !b; }
+	static Value select(Mask m, Value a, Value b) { return m ? a : b; }
+};
+
+#if defined(__AVX512F__)
+struct sLanesAVX512 {
+	typedef __m512d Value;
+	typedef __mmask8 Mask;
+	static const cl_uint Width = 8;
+
+	static Value load(const cl_double* p) { return _mm512_loadu_pd(p); }
+	static void store(cl_double* p, Value a) { _mm512_storeu_pd(p, a); }
+	static Value set(cl_double d) { return _mm512_set1_pd(d); }
+	static Value add(Value a, Value b) { return _mm512_add_pd(a, b); }
+	static Value sub(Value a, Value b) { return _mm512_sub_pd(a, b); }
+	static Value mul(Value a, Value b) { return _mm512_mul_pd(a, b); }
+	static Value div(Value a, Value b) { return _mm512_div_pd(a, b); }
+	static Value sqrt(Value a) { return _mm512_sqrt_pd(a); }
+	static Value abs(Value a) { return _mm512_castsi512_pd(_mm512_and_si512(_mm512_castpd_si512(a), _mm512_set1_epi64(0x7FFFFFFFFFFFFFFFLL))); }
+	static Value max(Value a, Value b) { return _mm512_max_pd(a, b); }
+	static Mask lt(Value a, Value b) { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+	static Mask le(Value a, Value b) { return _mm512_cmp_pd_mask(a, b, _CMP_LE_OQ); }
+	static Mask gt(Value a, Value b) { return _mm512_cmp_pd_mask(a, b, _CMP_GT_OQ); }
+	static Mask ge(Value a, Value b) { return _mm512_cmp_pd_mask(a, b, _CMP_GE_OQ); }
+	static Mask both(Mask a, Mask b) { return (Mask)(a & b); }
+	static Mask either(Mask a, Mask b) { return (Mask)(a | b); }
+	static Mask butNot(Mask a, Mask b) { return (Mask)(a & ~b); }
+	static Value select(Mask m, Value a, Value b) { return _mm512_mask_blend_pd(m, b, a); }
+};
+typedef sLanesAVX512 sLanesNative;
+#elif defined(__AVX2__)
+struct sLanesAVX2 {
+	typedef __m256d Value;
+	typedef __m256d Mask;
+	static const cl_uint Width = 4;
+
+	static Value load(const cl_double* p) { return _mm256_loadu_pd(p); }
+	static void store(cl_double* p, Value a) { _mm256_storeu_pd(p, a); }
+	static Value set(cl_double d) { return _mm256_set1_pd(d); }
+	static Value add(Value a, Value b) { return _mm256_add_pd(a, b); }
+	static Value sub(Value a, Value b) { return _mm256_sub_pd(a, b); }
+	static Value mul(Value a, Value b) { return _mm256_mul_pd(a, b); }
+	static Value div(Value a, Value b) { return _mm256_div_pd(a, b); }
+	static Value sqrt(Value a) { return _mm256_sqrt_pd(a); }
+	static Value abs(Value a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+	static Value max(Value a, Value b) { return _mm256_max_pd(a, b); }
+	static Mask lt(Value a, Value b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+	static Mask le(Value a, Value b) { return _mm256_cmp_pd(a, b, _CMP_LE_OQ); }
+	static Mask gt(Value a, Value b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+	static Mask ge(Value a, Value b) { return _mm256_cmp_pd(a, b, _CMP_GE_OQ); }
+	static Mask both(Mask a, Mask b) { return _mm256_and_pd(a, b); }
+	static Mask either(Mask a, Mask b) { return _mm256_or_pd(a, b); }
+	static Mask butNot(Mask a, Mask b) { return _mm256_andnot_pd(b, a); }
+	static Value select(Mask m, Value a, Value b) { return _mm256_blendv_pd(b, a, m); }
+};
+typedef sLanesAVX2 sLanesNative;
+#endif
@@ -0,0 +1,137 @@
+/*
+ * ------------------------------------------------------------------
+ *  Author: Alaa Mroue - 2023
+ *  This code is licensed under GPLv3. See LICENCE for more information.
+ * ------------------------------------------------------------------
+ */
+
+#include "SubdomainExecutor.h"
+#include <algorithm>
+#include <cstring>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/*
+ *  Split ulRows into uiSubdomains bands of near equal height,
+ *  zero bands means one per hardware thread
+ */
+SubdomainExecutor::SubdomainExecutor(unsigned int uiSubdomains, cl_ulong ulRows)
+	: vPhasesDone(std::max(1u, uiSubdomains == 0 ? std::thread::hardware_concurrency() : uiSubdomains))
+{
+	unsigned int uiCount = (unsigned int)this->vPhasesDone.size();
+	unsigned int uiCores = std::max(1u, std::thread::hardware_concurrency());
+
+	for (unsigned int i = 0; i < uiCount; i++)
+	{
+		sSubdomain pSubdomain;
+		pSubdomain.RowStart = ulRows * i / uiCount;
+		pSubdomain.RowEnd = ulRows * (i + 1) / uiCount;
+		pSubdomain.Core = i % uiCores;
+		this->vSubdomains.push_back(pSubdomain);
+		this->vPhasesDone[i] = 0;
+	}
+
+	for (int i = 0; i < 3; i++)
+	{
+		this->ulReduceValue[i] = 0;
+		this->uiReduceArrived[i] = 0;
+	}
+}
+
+unsigned int SubdomainExecutor::getSubdomainCount() {
+	return (unsigned int)this->vSubdomains.size();
+}
+
+const sSubdomain& SubdomainExecutor::getSubdomain(unsigned int uiSubdomain) {
+	return this->vSubdomains[uiSubdomain];
+}
+
+/*
+ *  Run task(band) on one pinned thread per band and wait for all of them.
+ *  Phase counters restart, so every run starts from phase zero.
+ */
+void SubdomainExecutor::run(const std::function<void(unsigned int)>& task) {
+	std::vector<std::thread> vThreads;
+
+	for (size_t i = 0; i < this->vPhasesDone.size(); i++)
+		this->vPhasesDone[i] = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		this->ulReduceValue[i] = 0;
+		this->uiReduceArrived[i] = 0;
+	}
+
+	for (unsigned int i = 0; i < this->getSubdomainCount(); i++)
+	{
+		// Pin before the task starts, so the rows it first touches land on its node
+		unsigned int uiCore = this->vSubdomains[i].Core;
+		vThreads.push_back(std::thread([&task, i, uiCore]() {
+			#ifdef __linux__
+			cpu_set_t pCores;
+			CPU_ZERO(&pCores);
+			CPU_SET(uiCore, &pCores);
+			pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &pCores);
+			#endif
+			task(i);
+		}));
+	}
+
+	for (size_t i = 0; i < vThreads.size(); i++)
+		vThreads[i].join();
+}
+
+/*
+ *  Wait until the bands above and below have finished ulPhases phases.
+ *  Their edge rows are then final for this phase, and they are done
+ *  reading this band's edge rows from the buffer about to be written.
+ */
+void SubdomainExecutor::waitForHalo(unsigned int uiSubdomain, cl_ulong ulPhases) {
+	if (uiSubdomain > 0)
+		while (this->vPhasesDone[uiSubdomain - 1].load(std::memory_order_acquire) < ulPhases)
+			std::this_thread::yield();
+	if (uiSubdomain + 1 < this->vPhasesDone.size())
+		while (this->vPhasesDone[uiSubdomain + 1].load(std::memory_order_acquire) < ulPhases)
+			std::this_thread::yield();
+}
+
+void SubdomainExecutor::markPhaseDone(unsigned int uiSubdomain, cl_ulong ulPhases) {
+	this->vPhasesDone[uiSubdomain].store(ulPhases, std::memory_order_release);
+}
+
+/*
+ *  Maximum of a non-negative value over every band for reduction ulRound.
+ *  Rounds cycle through three slots: when the last band arrives for a
+ *  round, every band has read the result of the round before, so that
+ *  slot is cleared for the round after next.
+ */
+cl_double SubdomainExecutor::allReduceMax(cl_ulong ulRound, cl_double dValue) {
+	int iSlot = (int)(ulRound % 3);
+	unsigned int uiCount = this->getSubdomainCount();
+	cl_ulong ulBits;
+	cl_double dResult;
+
+	memcpy(&ulBits, &dValue, sizeof(cl_double));
+	if (dValue > 0.0)
+	{
+		cl_ulong ulCurrent = this->ulReduceValue[iSlot].load(std::memory_order_relaxed);
+		while (ulBits > ulCurrent && !this->ulReduceValue[iSlot].compare_exchange_weak(ulCurrent, ulBits, std::memory_order_relaxed))
+			;
+	}
+
+	if (this->uiReduceArrived[iSlot].fetch_add(1, std::memory_order_acq_rel) + 1 == uiCount)
+	{
+		int iPrevious = (int)((ulRound + 2) % 3);
+		this->ulReduceValue[iPrevious].store(0, std::memory_order_relaxed);
+		this->uiReduceArrived[iPrevious].store(0, std::memory_order_release);
+	}
+	else {
+		while (this->uiReduceArrived[iSlot].load(std::memory_order_acquire) < uiCount)
+			std::this_thread::yield();
+	}
+
+	ulBits = this->ulReduceValue[iSlot].load(std::memory_order_relaxed);
+	memcpy(&dResult, &ulBits, sizeof(cl_double));
+	return dResult;
+}
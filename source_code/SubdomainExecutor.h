@@ -0,0 +1,65 @@
+/*
+ * ------------------------------------------------------------------
+ *  Author: Alaa Mroue - 2023
+ *  This code is licensed under GPLv3. See LICENCE for more information.
+ * ------------------------------------------------------------------
+ */
+
+#pragma once
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <CL/opencl.h>
+#include "GlobalHandlerClass.h"
+
+// Band of whole rows owned by one thread
+typedef struct sSubdomain {
+	cl_ulong		RowStart;				// First row owned
+	cl_ulong		RowEnd;					// One past the last row owned
+	unsigned int	Core;					// Logical CPU the owner is pinned to
+} sSubdomain;
+
+// Splits a domain into bands of rows, one per pinned thread. A band only
+// waits for the two bands its one-cell halo comes from, and a thread that
+// first touches its band's rows keeps them on its own NUMA node.
+// allReduceMax is the only point where every band meets.
+class SubdomainExecutor {
+public:
+	SubdomainExecutor(unsigned int, cl_ulong);
+	unsigned int getSubdomainCount();
+	const sSubdomain& getSubdomain(unsigned int);
+
+	void run(const std::function<void(unsigned int)>&);
+	void waitForHalo(unsigned int, cl_ulong);
+	void markPhaseDone(unsigned int, cl_ulong);
+	cl_double allReduceMax(cl_ulong, cl_double);
+
+	template <typename TKernel>
+	void enqueueRows(TKernel kernel, unsigned int uiSubdomain, int iGlobalX, int iGlobalY);
+
+private:
+	std::vector<sSubdomain>			vSubdomains;
+	std::vector<std::atomic<cl_ulong>>	vPhasesDone;
+	std::atomic<cl_ulong>			ulReduceValue[3];
+	std::atomic<unsigned int>		uiReduceArrived[3];
+};
+
+/*
+ *  Run the kernel for every work-item in the rows of one band, on the
+ *  calling thread. Work-items see the ND-range of the whole domain.
+ */
+template <typename TKernel>
+void SubdomainExecutor::enqueueRows(TKernel kernel, unsigned int uiSubdomain, int iGlobalX, int iGlobalY)
+{
+	const sSubdomain& pSubdomain = this->vSubdomains[uiSubdomain];
+	GlobalHandlerClass ghc(0, 0, iGlobalX, iGlobalY, 1, 1);
+
+	for (int iY = (int)pSubdomain.RowStart; iY < (int)pSubdomain.RowEnd && iY < iGlobalY; iY++) {
+		for (int iX = 0; iX < iGlobalX; iX++) {
+			ghc.globalintX = ghc.groupintX = iX;
+			ghc.globalintY = ghc.groupintY = iY;
+			kernel(ghc);
+		}
+	}
+}
@@ -0,0 +1,835 @@
+/*
+ * ------------------------------------------------------------------
+ *  Author: Alaa Mroue - 2023
+ *  This code is licensed under GPLv3. See LICENCE for more information.
+ * ------------------------------------------------------------------
+ */
+
+#include "benchmark.h"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <map>
+#include <new>
+#include <sstream>
+
+using namespace std;
+
+/*
+ *  Square domain of about ulCells cells on a gentle slope with bumps.
+ *  The first dWetFraction of the rows hold moving water, the rest is dry.
+ */
+bool createBenchmarkDomain(cl_ulong ulCells, cl_double dWetFraction, sBenchmarkDomain* pBenchmark)
+{
+	cl_ulong ulSide = std::max((cl_ulong)3, (cl_ulong)llround(sqrt((cl_double)ulCells)));
+
+	pBenchmark->pDomain = createDomain(ulSide, ulSide, DOMAIN_DELTAX, DOMAIN_DELTAY);
+	pBenchmark->dWetFraction = dWetFraction;
+
+	cl_ulong ulCellCount = pBenchmark->pDomain.CellCount;
+	cl_ulong ulWetRows = (cl_ulong)llround(dWetFraction * ulSide);
+
+	try {
+		pBenchmark->dBedElevation.assign(ulCellCount, 0.0);
+		pBenchmark->dManning.assign(ulCellCount, 0.03);
+		pBenchmark->pCellStateSrc.resize(ulCellCount);
+	}
+	catch (const std::bad_alloc&) {
+		cout << "Benchmark error: cannot allocate a domain of " << ulCellCount << " cells" << endl;
+		return false;
+	}
+
+	for (cl_ulong ulIdx = 0; ulIdx < ulCellCount; ulIdx++)
+	{
+		cl_ulong	ulX = ulIdx % ulSide;
+		cl_ulong	ulY = ulIdx / ulSide;
+		cl_double	dBed = 0.001 * ulX + ((ulX + ulY) % 7 == 0 ? 0.05 : 0.0);
+		cl_double	dDepth = ulY < ulWetRows ? 0.3 + 0.01 * (ulX % 5) : 0.0;
+
+		pBenchmark->dBedElevation[ulIdx] = dBed;
+		pBenchmark->pCellStateSrc[ulIdx] = { dBed + dDepth, dBed + dDepth, 0.05 * dDepth, -0.02 * dDepth };
+	}
+
+	try {
+		pBenchmark->pCellStateDst = pBenchmark->pCellStateSrc;
+	}
+	catch (const std::bad_alloc&) {
+		cout << "Benchmark error: cannot allocate a domain of " << ulCellCount << " cells" << endl;
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ *  Mean wall time of one run, after a warm-up run
+ */
+template <typename TRun>
+cl_double timeRuns(TRun run, unsigned int uiRepeats)
+{
+	run();
+
+	auto tStart = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < uiRepeats; i++)
+		run();
+	auto tEnd = std::chrono::steady_clock::now();
+
+	return std::chrono::duration<cl_double>(tEnd - tStart).count() / uiRepeats;
+}
+
+/*
+ *  One gts_cacheDisabled step with the given Riemann solver, and the bed
+ *  maxima of pGeometry when not NULL. With pPrimitives the step fills them
+ *  first, as a run would.
+ */
+template <typename TRiemann>
+cl_double timeScheme(sBenchmarkDomain& pBenchmark, NDRangeExecutor& executor, unsigned int uiRepeats, const sFaceGeometry* pGeometry, cl_double4* pPrimitives)
+{
+	const sDomainConfiguration&	pDomain = pBenchmark.pDomain;
+	cl_double	dTimestep = 0.01;
+
+	return timeRuns([&]() {
+		if (pPrimitives != NULL)
+			executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+				gts_Primitives(pDomain, &pBenchmark.pCellStateSrc[0], &pBenchmark.dBedElevation[0], pPrimitives, ghc);
+			}, (int)pDomain.Cols, (int)pDomain.Rows, GTS_DIM1, GTS_DIM2);
+		executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+			gts_cacheDisabled<sDomainConfiguration, TRiemann>(pDomain, &dTimestep, &pBenchmark.dBedElevation[0], &pBenchmark.pCellStateSrc[0], &pBenchmark.pCellStateDst[0], &pBenchmark.dManning[0], NULL, pGeometry, pPrimitives, NULL, ghc);
+		}, (int)pDomain.Cols, (int)pDomain.Rows, GTS_DIM1, GTS_DIM2);
+	}, uiRepeats);
+}
+
+/*
+ *  East face of every cell with the given Riemann solver, the flux goes to
+ *  the destination state
+ */
+template <typename TRiemann>
+cl_double timeRiemannFaces(sBenchmarkDomain& pBenchmark, NDRangeExecutor& executor, unsigned int uiRepeats)
+{
+	const sDomainConfiguration&	pDomain = pBenchmark.pDomain;
+	cl_double*	dBed = &pBenchmark.dBedElevation[0];
+	cl_double4*	pSrc = &pBenchmark.pCellStateSrc[0];
+	cl_double4*	pDst = &pBenchmark.pCellStateDst[0];
+
+	return timeRuns([&]() {
+		executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+			cl_long lIdxX = ghc.get_global_id(0);
+			cl_long lIdxY = ghc.get_global_id(1);
+			if (lIdxX >= (cl_long)pDomain.Cols - 1 || lIdxY >= (cl_long)pDomain.Rows)
+				return;
+			cl_ulong	ulIdx = getCellID(pDomain, lIdxX, lIdxY);
+			cl_double4	pL = pSrc[ulIdx];
+			cl_double4	pR = pSrc[ulIdx + 1];
+			cl_double8	pLeft = { pL.x, pL.x - dBed[ulIdx], pL.z, pL.w, 0.0, 0.0, dBed[ulIdx], 0.0 };
+			cl_double8	pRight = { pR.x, pR.x - dBed[ulIdx + 1], pR.z, pR.w, 0.0, 0.0, dBed[ulIdx], 0.0 };
+			pDst[ulIdx] = TRiemann::template solve<DOMAIN_DIR_E>(pLeft, pRight, false);
+		}, (int)pDomain.Cols, (int)pDomain.Rows, GTS_DIM1, GTS_DIM2);
+	}, uiRepeats);
+}
+
+/*
+ *  Time one kernel on a domain, false with the cause printed if the kernel
+ *  is unknown or its inputs cannot be built
+ */
+bool benchmarkKernel(const string& sKernel, sBenchmarkDomain& pBenchmark, NDRangeExecutor& executor, unsigned int uiRepeats, sBenchmarkResult* pResult)
+{
+	const sDomainConfiguration&	pDomain = pBenchmark.pDomain;
+	cl_ulong	ulCells = pDomain.CellCount;
+	cl_ulong	ulFaces = pDomain.Rows * (pDomain.Cols - 1);
+	cl_double*	dBed = &pBenchmark.dBedElevation[0];
+	cl_double*	dManning = &pBenchmark.dManning[0];
+	cl_double4*	pSrc = &pBenchmark.pCellStateSrc[0];
+	cl_double4*	pDst = &pBenchmark.pCellStateDst[0];
+	cl_double	dTime = 0.0;
+	cl_double	dTimestep = 0.01;
+	cl_double	dTimeHydrological = TIMESTEP_HYDROLOGICAL;
+	int			iCols = (int)pDomain.Cols;
+	int			iRows = (int)pDomain.Rows;
+
+	pResult->sKernel = sKernel;
+	pResult->ulCells = ulCells;
+	pResult->ulRows = pDomain.Rows;
+	pResult->ulCols = pDomain.Cols;
+	pResult->dWetFraction = pBenchmark.dWetFraction;
+	pResult->uiThreads = executor.getThreadCount();
+	pResult->uiRepeats = uiRepeats;
+
+	if (sKernel == "gts_cacheDisabled" || sKernel == "gts_cacheDisabledHLL" || sKernel == "gts_cacheDisabledRusanov")
+	{
+		pResult->ulUpdates = ulCells;
+		pResult->ulBytes = ulCells * (2 * sizeof(cl_double4) + 2 * sizeof(cl_double));
+		if (sKernel == "gts_cacheDisabledHLL")
+			pResult->dSeconds = timeScheme<sRiemannHLL>(pBenchmark, executor, uiRepeats, NULL, NULL);
+		else if (sKernel == "gts_cacheDisabledRusanov")
+			pResult->dSeconds = timeScheme<sRiemannRusanov>(pBenchmark, executor, uiRepeats, NULL, NULL);
+		else
+			pResult->dSeconds = timeScheme<sRiemannHLLC>(pBenchmark, executor, uiRepeats, NULL, NULL);
+	}
+	else if (sKernel == "gts_cacheDisabledGeometry")
+	{
+		// Same step with the bed maxima of the faces precomputed
+		sFaceGeometry pGeometry;
+		createFaceGeometry(pDomain.Rows, pDomain.Cols, dBed, dManning, FACE_GEOMETRY_FULL, &pGeometry);
+		pResult->ulUpdates = ulCells;
+		pResult->ulBytes = ulCells * (2 * sizeof(cl_double4) + 4 * sizeof(cl_double));
+		pResult->dSeconds = timeScheme<sRiemannHLLC>(pBenchmark, executor, uiRepeats, &pGeometry, NULL);
+		freeFaceGeometry(&pGeometry);
+	}
+	else if (sKernel == "gts_cacheDisabledPrimitives")
+	{
+		// Same step with the depths and velocities divided out once per cell,
+		// the fill reads the state and bed and writes the primitives
+		vector<cl_double4> pPrimitives(ulCells);
+		pResult->ulUpdates = ulCells;
+		pResult->ulBytes = ulCells * (2 * sizeof(cl_double4) + 2 * sizeof(cl_double)) + ulCells * (3 * sizeof(cl_double4) + sizeof(cl_double));
+		pResult->dSeconds = timeScheme<sRiemannHLLC>(pBenchmark, executor, uiRepeats, NULL, &pPrimitives[0]);
+	}
+	else if (sKernel == "gts_cacheDisabledFloat")
+	{
+		// Same step with the state, bed and Manning stored as float
+		vector<cl_float> fBed(dBed, dBed + ulCells), fManning(dManning, dManning + ulCells);
+		vector<cl_float4> pFloatSrc(ulCells), pFloatDst(ulCells);
+		for (cl_ulong ulIdx = 0; ulIdx < ulCells; ulIdx++)
+			pFloatSrc[ulIdx] = sPrecisionFloat::store(pSrc[ulIdx], (cl_double)fBed[ulIdx]);
+		pResult->ulUpdates = ulCells;
+		pResult->ulBytes = ulCells * (2 * sizeof(cl_float4) + 2 * sizeof(cl_float));
+		pResult->dSeconds = timeRuns([&]() {
+			executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+				gts_cacheDisabledPrecision<sDomainConfiguration, sPrecisionFloat>(pDomain, &dTimestep, &fBed[0], &pFloatSrc[0], &pFloatDst[0], &fManning[0], ghc);
+			}, iCols, iRows, GTS_DIM1, GTS_DIM2);
+		}, uiRepeats);
+	}
+	else if (sKernel == "gts_interior")
+	{
+		pResult->ulUpdates = ulCells;
+		pResult->ulBytes = ulCells * (2 * sizeof(cl_double4) + 2 * sizeof(cl_double));
+		pResult->dSeconds = timeRuns([&]() {
+			executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+				gts_interior(pDomain, &dTimestep, dBed, pSrc, pDst, dManning, NULL, ghc);
+			}, 1, iRows, 1, GTS_DIM2);
+		}, uiRepeats);
+	}
+	else if (sKernel == "bdy_GhostRing")
+	{
+		// Ring cells only, each reads the cell next to it
+		cl_ulong ulRing = 2 * (pDomain.Rows + pDomain.Cols) - 8;
+		pResult->ulUpdates = ulRing;
+		pResult->ulBytes = ulRing * (3 * sizeof(cl_double4) + sizeof(cl_double));
+		pResult->dSeconds = timeRuns([&]() {
+			executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+				bdy_GhostRing(pDomain, BOUNDARY_GHOST_REFLECTIVE, pDst, dBed, ghc);
+			}, std::max(iCols, iRows), 1, GTS_DIM1 * GTS_DIM2, 1);
+		}, uiRepeats);
+	}
+	else if (sKernel == "stepSeparate" || sKernel == "gts_fusedStep")
+	{
+		// A whole batch step, rain, scheme, friction, stability check and
+		// reduction. Separately the rain reads and writes the state, the
+		// scheme reads the state, bed and Manning and writes the state, the
+		// friction does the same, the check and reduction read state and bed.
+		// Fused, a tile is read and written once.
+		sBdyUniformConfiguration pConfiguration = { 2, 3600.0, 7200.0, BOUNDARY_UNIFORM_RAIN_INTENSITY };
+		cl_double2 pTimeseries[2] = { { 0.0, 10.0 }, { 3600.0, 10.0 } };
+		cl_uint2 uiTileSize = { GTS_TILE_DIM1, GTS_TILE_DIM2 };
+		cl_double pReductionData[TIMESTEP_WORKERS];
+		std::atomic<cl_uint> uiUnstable(0);
+		std::atomic<cl_ulong> ulMaxSpeed(0);
+		vector<cl_double4> pStepSrc(pSrc, pSrc + ulCells);
+		pResult->ulUpdates = ulCells;
+		if (sKernel == "gts_fusedStep")
+		{
+			pResult->ulBytes = ulCells * (2 * sizeof(cl_double4) + 2 * sizeof(cl_double));
+			pResult->dSeconds = timeRuns([&]() {
+				executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+					gts_fusedStep(pDomain, &dTime, &dTimestep, &dTimeHydrological, &pConfiguration, pTimeseries, NULL, NULL, dBed, &pStepSrc[0], pDst, dManning, uiTileSize, &uiUnstable, &ulMaxSpeed, ghc);
+				}, (iCols + GTS_TILE_DIM1 - 1) / GTS_TILE_DIM1, (iRows + GTS_TILE_DIM2 - 1) / GTS_TILE_DIM2, 1, 1, gts_cacheEnabledScratchSize(uiTileSize));
+				tst_CollectSpeed(&ulMaxSpeed, pReductionData);
+			}, uiRepeats);
+		}
+		else {
+			pResult->ulBytes = ulCells * (2 * sizeof(cl_double4) + sizeof(cl_double)) + 2 * ulCells * (2 * sizeof(cl_double4) + 2 * sizeof(cl_double)) + 2 * ulCells * (sizeof(cl_double4) + sizeof(cl_double));
+			pResult->dSeconds = timeRuns([&]() {
+				executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+					bdy_Uniform(pDomain, &pConfiguration, pTimeseries, &dTime, &dTimestep, &dTimeHydrological, &pStepSrc[0], dBed, dManning, ghc);
+				}, iCols, iRows, GTS_DIM1, GTS_DIM2);
+				executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+					gts_cacheDisabled(pDomain, &dTimestep, dBed, &pStepSrc[0], pDst, dManning, NULL, NULL, NULL, NULL, ghc);
+				}, iCols, iRows, GTS_DIM1, GTS_DIM2);
+				executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+					per_Friction(pDomain, &dTimestep, pDst, dBed, dManning, &dTime, NULL, ghc);
+				}, iCols, iRows, GTS_DIM1, GTS_DIM2);
+				executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+					tst_CheckState(pDomain, &dTimestep, pDst, dBed, &uiUnstable, ghc);
+				}, iCols, iRows, GTS_DIM1, GTS_DIM2);
+				executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+					tst_Reduce(pDomain, pDst, dBed, pReductionData, ghc);
+				}, TIMESTEP_WORKERS * TIMESTEP_GROUPSIZE, 1, TIMESTEP_GROUPSIZE, 1, TIMESTEP_GROUPSIZE * sizeof(cl_double), true);
+			}, uiRepeats);
+		}
+	}
+	else if (sKernel == "gts_cacheEnabled")
+	{
+		cl_uint2 uiTileSize = { GTS_TILE_DIM1, GTS_TILE_DIM2 };
+		pResult->ulUpdates = ulCells;
+		pResult->ulBytes = ulCells * (2 * sizeof(cl_double4) + 2 * sizeof(cl_double));
+		pResult->dSeconds = timeRuns([&]() {
+			executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+				gts_cacheEnabled(pDomain, &dTimestep, dBed, pSrc, pDst, dManning, uiTileSize, NULL, NULL, ghc);
+			}, (iCols + GTS_TILE_DIM1 - 1) / GTS_TILE_DIM1, (iRows + GTS_TILE_DIM2 - 1) / GTS_TILE_DIM2, 1, 1, gts_cacheEnabledScratchSize(uiTileSize));
+		}, uiRepeats);
+	}
+	else if (sKernel == "solverFunctionPromaides" || sKernel == "solverFunctionPromaidesRoughness" || sKernel == "solverFunctionPromaidesGeometry")
+	{
+		// The static face values recomputed, or the averaged roughness and
+		// then also the bed maxima precomputed. Besides the bed, a run reads
+		// Manning or two or four face values per cell.
+		sFaceGeometry pGeometry;
+		cl_uchar ucStorage = sKernel == "solverFunctionPromaidesGeometry" ? FACE_GEOMETRY_FULL : (sKernel == "solverFunctionPromaidesRoughness" ? FACE_GEOMETRY_ROUGHNESS : FACE_GEOMETRY_NONE);
+		const cl_ulong ulStaticValues[] = { 2, 3, 5 };
+		createFaceGeometry(pDomain.Rows, pDomain.Cols, dBed, dManning, ucStorage, &pGeometry);
+		pResult->ulUpdates = ulCells;
+		pResult->ulBytes = ulCells * (2 * sizeof(cl_double4) + ulStaticValues[ucStorage] * sizeof(cl_double));
+		pResult->dSeconds = timeRuns([&]() {
+			executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+				solverFunctionPromaides(pDomain, &dTimestep, dBed, pSrc, pDst, dManning, NULL, ucStorage == FACE_GEOMETRY_NONE ? NULL : &pGeometry, ghc);
+			}, iCols, iRows, GTS_DIM1, GTS_DIM2);
+		}, uiRepeats);
+		freeFaceGeometry(&pGeometry);
+	}
+	else if (sKernel == "promaidesExplicitToEnd" || sKernel == "promaidesImplicitToEnd")
+	{
+		// Wall time to BENCHMARK_DIFFUSIVE_END from the domain state, explicit
+		// steps at their stability limit against implicit steps. Updates
+		// count cell steps, the traffic of a run is not fixed so not counted.
+		// The explicit limit takes three passes of the implicit work arrays,
+		// a run would use a cheaper estimate, so only the steps are timed.
+		// An implicit step halved to converge grows back after the next one.
+		sPromaidesImplicit	pImplicit = allocatePromaidesImplicit(pDomain);
+		vector<cl_double4>	pStateSrc, pStateDst;
+		cl_ulong			ulSteps = 0;
+		cl_double			dLimitSeconds = 0.0;
+		bool				bImplicit = sKernel == "promaidesImplicitToEnd";
+
+		pResult->dSeconds = timeRuns([&]() {
+			cl_double	dSimulated = 0.0;
+			cl_double	dImplicitStep = BENCHMARK_IMPLICIT_TIMESTEP;
+			pStateSrc.assign(pSrc, pSrc + ulCells);
+			pStateDst = pStateSrc;
+			ulSteps = 0;
+			dLimitSeconds = 0.0;
+			while (dSimulated < BENCHMARK_DIFFUSIVE_END)
+			{
+				cl_double	dStep;
+				if (bImplicit)
+				{
+					dStep = std::min(dImplicitStep, BENCHMARK_DIFFUSIVE_END - dSimulated);
+					if (!pim_Step(pDomain, executor, dStep, dBed, &pStateSrc[0], &pStateDst[0], dManning, &pImplicit))
+					{
+						dImplicitStep *= 0.5;
+						continue;
+					}
+					dImplicitStep = std::min(dImplicitStep * 2.0, BENCHMARK_IMPLICIT_TIMESTEP);
+				}
+				else {
+					auto tLimitStart = std::chrono::steady_clock::now();
+					dStep = std::min(pim_ExplicitTimestep(pDomain, executor, dBed, &pStateSrc[0], dManning, &pImplicit), BENCHMARK_DIFFUSIVE_END - dSimulated);
+					dLimitSeconds += std::chrono::duration<cl_double>(std::chrono::steady_clock::now() - tLimitStart).count();
+					executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+						solverFunctionPromaides(pDomain, &dStep, dBed, &pStateSrc[0], &pStateDst[0], dManning, NULL, NULL, ghc);
+					}, iCols, iRows, GTS_DIM1, GTS_DIM2);
+				}
+				std::swap(pStateSrc, pStateDst);
+				dSimulated += dStep;
+				ulSteps++;
+			}
+		}, uiRepeats) - dLimitSeconds;
+		pResult->ulUpdates = ulCells * ulSteps;
+		pResult->ulBytes = 0;
+		freePromaidesImplicit(&pImplicit);
+	}
+	else if (sKernel == "gts_ensemble")
+	{
+		// Updates count member cells, each member starts from the domain state
+		cl_uint			uiMembers = BENCHMARK_ENSEMBLE_MEMBERS;
+		sCellStateSoA	pEnsembleSrc = allocateCellStateSoA(ulCells * uiMembers);
+		sCellStateSoA	pEnsembleDst = allocateCellStateSoA(ulCells * uiMembers);
+		vector<cl_double> dEnsembleManning(ulCells * uiMembers);
+		for (cl_ulong ulIdx = 0; ulIdx < ulCells; ulIdx++)
+		{
+			for (cl_uint m = 0; m < uiMembers; m++)
+			{
+				cl_ulong ulMember = ulIdx * uiMembers + m;
+				pEnsembleSrc.Z[ulMember] = pSrc[ulIdx].x;
+				pEnsembleSrc.Zmax[ulMember] = pSrc[ulIdx].y;
+				pEnsembleSrc.Qx[ulMember] = pSrc[ulIdx].z;
+				pEnsembleSrc.Qy[ulMember] = pSrc[ulIdx].w;
+				dEnsembleManning[ulMember] = dManning[ulIdx] * (0.5 + (m + 0.5) / uiMembers);
+			}
+		}
+		pResult->ulUpdates = ulCells * uiMembers;
+		pResult->ulBytes = ulCells * (uiMembers * (2 * sizeof(cl_double4) + sizeof(cl_double)) + sizeof(cl_double));
+		pResult->dSeconds = timeRuns([&]() {
+			executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+				gts_ensemble(pDomain, &dTimestep, dBed, uiMembers, pEnsembleSrc, pEnsembleDst, &dEnsembleManning[0], ghc);
+			}, iCols, iRows, GTS_DIM1, GTS_DIM2);
+		}, uiRepeats);
+		freeCellStateSoA(&pEnsembleSrc);
+		freeCellStateSoA(&pEnsembleDst);
+	}
+	else if (sKernel == "solverFunctionPromaidesClasses")
+	{
+		// One byte of Manning class per cell instead of a double
+		sManningTable pManningTable;
+		if (!createManningTable(dManning, ulCells, &pManningTable))
+		{
+			cout << "Benchmark error: Manning class table failed for " << sKernel << endl;
+			return false;
+		}
+		pResult->ulUpdates = ulCells;
+		pResult->ulBytes = ulCells * (2 * sizeof(cl_double4) + sizeof(cl_double) + sizeof(cl_uchar));
+		pResult->dSeconds = timeRuns([&]() {
+			executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+				solverFunctionPromaidesClasses(pDomain, &dTimestep, dBed, pSrc, pDst, &pManningTable, NULL, ghc);
+			}, iCols, iRows, GTS_DIM1, GTS_DIM2);
+		}, uiRepeats);
+		freeManningTable(&pManningTable);
+	}
+	else if (sKernel == "solverFunctionPromaidesFlowStates")
+	{
+		// Every cell a diffusive flow element, so every tile takes the flag-free path
+		cl_uint2		uiTileSize = { GTS_TILE_DIM1, GTS_TILE_DIM2 };
+		sFlowStates		pFlowStates;
+		vector<cl_uchar> ucFlags(ulCells, FLOW_ELEMENT);
+		if (!createFlowStates(pDomain, &ucFlags[0], uiTileSize, &pFlowStates))
+		{
+			cout << "Benchmark error: flow state creation failed for " << sKernel << endl;
+			return false;
+		}
+		pResult->ulUpdates = ulCells;
+		pResult->ulBytes = ulCells * (2 * sizeof(cl_double4) + 2 * sizeof(cl_double));
+		pResult->dSeconds = timeRuns([&]() {
+			executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+				solverFunctionPromaidesFlowStates(pDomain, &dTimestep, dBed, pSrc, pDst, dManning, &pFlowStates, ghc);
+			}, (int)pFlowStates.TilesX, (int)pFlowStates.TilesY, 1, 1);
+		}, uiRepeats);
+		freeFlowStates(&pFlowStates);
+	}
+	else if (sKernel == "solverFunctionPromaidesFaces")
+	{
+		// Face pass then cell pass over SoA state, each face computed once
+		sCellStateSoA	pFaceSrc = allocateCellStateSoA(ulCells);
+		sCellStateSoA	pFaceDst = allocateCellStateSoA(ulCells);
+		vector<cl_double> dFluxE(ulCells), dFluxN(ulCells);
+		for (cl_ulong ulIdx = 0; ulIdx < ulCells; ulIdx++)
+		{
+			pFaceSrc.Z[ulIdx] = pSrc[ulIdx].x;
+			pFaceSrc.Zmax[ulIdx] = pSrc[ulIdx].y;
+			pFaceSrc.Qx[ulIdx] = pSrc[ulIdx].z;
+			pFaceSrc.Qy[ulIdx] = pSrc[ulIdx].w;
+		}
+		pResult->ulUpdates = ulCells;
+		pResult->ulBytes = ulCells * (5 + 11) * sizeof(cl_double);
+		pResult->dSeconds = timeRuns([&]() {
+			executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+				solverFunctionPromaidesFaceFluxes(pDomain, &dTimestep, dBed, pFaceSrc, dManning, &dFluxE[0], &dFluxN[0], ghc);
+			}, 1, iRows, 1, GTS_DIM2);
+			executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+				solverFunctionPromaidesFaceUpdate(pDomain, &dTimestep, dBed, pFaceSrc, pFaceDst, &dFluxE[0], &dFluxN[0], ghc);
+			}, 1, iRows, 1, GTS_DIM2);
+		}, uiRepeats);
+		freeCellStateSoA(&pFaceSrc);
+		freeCellStateSoA(&pFaceDst);
+	}
+	else if (sKernel == "gts_faces" || sKernel == "gts_facesRows" || sKernel == "hyb_faces")
+	{
+		// Face pass then cell pass, the hybrid regime classified once from
+		// the domain state. Faces are written once and read twice.
+		sHybridRegime		pRegime = allocateHybridRegime(iRows, iCols, { GTS_TILE_DIM1, GTS_TILE_DIM2 });
+		vector<sFaceFlux>	pFacesE(ulCells), pFacesN(ulCells);
+		int					iTilesX = (int)pRegime.TilesX;
+		int					iTilesY = (int)pRegime.TilesY;
+		bool				bHybrid = sKernel == "hyb_faces";
+		bool				bRows = sKernel == "gts_facesRows";
+		executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+			hyb_Classify(pDomain, &pRegime, pSrc, dBed, dManning, ghc);
+		}, iTilesX, iTilesY, 1, 1);
+		executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+			hyb_Regime(&pRegime, ghc);
+		}, iTilesX, iTilesY, 1, 1);
+		pResult->ulUpdates = ulCells;
+		pResult->ulBytes = ulCells * (2 * sizeof(cl_double4) + 2 * sizeof(cl_double) + 6 * sizeof(sFaceFlux));
+		pResult->dSeconds = timeRuns([&]() {
+			if (bHybrid) {
+				executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+					hyb_FaceFluxes(pDomain, &dTimestep, dBed, pSrc, dManning, &pRegime, &pFacesE[0], &pFacesN[0], ghc);
+				}, iTilesX, iTilesY, 1, 1);
+				executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+					hyb_FaceUpdate(pDomain, &dTimestep, dBed, pSrc, pDst, dManning, &pRegime, &pFacesE[0], &pFacesN[0], ghc);
+				}, iTilesX, iTilesY, 1, 1);
+			}
+			else {
+				if (bRows)
+					executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+						gts_faceFluxesRows(pDomain, &dTimestep, dBed, pSrc, &pFacesE[0], &pFacesN[0], ghc);
+					}, 1, iRows, 1, GTS_DIM2);
+				else
+					executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+						gts_faceFluxes(pDomain, &dTimestep, dBed, pSrc, &pFacesE[0], &pFacesN[0], ghc);
+					}, iCols, iRows, GTS_DIM1, GTS_DIM2);
+				executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+					gts_faceUpdate(pDomain, &dTimestep, dBed, pSrc, pDst, dManning, &pFacesE[0], &pFacesN[0], NULL, ghc);
+				}, iCols, iRows, GTS_DIM1, GTS_DIM2);
+			}
+		}, uiRepeats);
+		freeHybridRegime(&pRegime);
+	}
+	else if (sKernel == "riemannSolver" || sKernel == "riemannSolverHLL" || sKernel == "riemannSolverRusanov")
+	{
+		pResult->ulUpdates = ulFaces;
+		pResult->ulBytes = ulFaces * (2 * sizeof(cl_double4) + 2 * sizeof(cl_double) + sizeof(cl_double4));
+		if (sKernel == "riemannSolverHLL")
+			pResult->dSeconds = timeRiemannFaces<sRiemannHLL>(pBenchmark, executor, uiRepeats);
+		else if (sKernel == "riemannSolverRusanov")
+			pResult->dSeconds = timeRiemannFaces<sRiemannRusanov>(pBenchmark, executor, uiRepeats);
+		else
+			pResult->dSeconds = timeRiemannFaces<sRiemannHLLC>(pBenchmark, executor, uiRepeats);
+	}
+	else if (sKernel == "riemannSolverBatch")
+	{
+		// Same faces as riemannSolver, one row per work-item
+		vector<cl_double> dLeft[5], dRight[5], dFlux[3];
+		for (int i = 0; i < 5; i++) { dLeft[i].resize(ulFaces); dRight[i].resize(ulFaces); }
+		for (int i = 0; i < 3; i++) dFlux[i].resize(ulFaces);
+		for (cl_ulong ulFace = 0; ulFace < ulFaces; ulFace++)
+		{
+			cl_ulong	ulIdx = (ulFace / (pDomain.Cols - 1)) * pDomain.Cols + ulFace % (pDomain.Cols - 1);
+			cl_double4	pL = pSrc[ulIdx];
+			cl_double4	pR = pSrc[ulIdx + 1];
+			dLeft[0][ulFace] = pL.x; dLeft[1][ulFace] = pL.x - dBed[ulIdx]; dLeft[2][ulFace] = pL.z; dLeft[3][ulFace] = pL.w; dLeft[4][ulFace] = dBed[ulIdx];
+			dRight[0][ulFace] = pR.x; dRight[1][ulFace] = pR.x - dBed[ulIdx + 1]; dRight[2][ulFace] = pR.z; dRight[3][ulFace] = pR.w; dRight[4][ulFace] = dBed[ulIdx];
+		}
+		pResult->ulUpdates = ulFaces;
+		pResult->ulBytes = ulFaces * (9 + 3) * sizeof(cl_double);
+		pResult->dSeconds = timeRuns([&]() {
+			executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+				cl_long lRow = ghc.get_global_id(1);
+				if (lRow >= iRows)
+					return;
+				cl_ulong ulFirst = lRow * (pDomain.Cols - 1);
+				sRiemannStateSoA pLeft = { &dLeft[0][ulFirst], &dLeft[1][ulFirst], &dLeft[2][ulFirst], &dLeft[3][ulFirst], &dLeft[4][ulFirst] };
+				sRiemannStateSoA pRight = { &dRight[0][ulFirst], &dRight[1][ulFirst], &dRight[2][ulFirst], &dRight[3][ulFirst], &dRight[4][ulFirst] };
+				sRiemannFluxSoA pFlux = { &dFlux[0][ulFirst], &dFlux[1][ulFirst], &dFlux[2][ulFirst] };
+				riemannSolverBatch(DOMAIN_DIR_E, pLeft, pRight, pFlux, pDomain.Cols - 1);
+			}, 1, iRows, 1, GTS_DIM2);
+		}, uiRepeats);
+	}
+	else if (sKernel == "implicitFriction")
+	{
+		pResult->ulUpdates = ulCells;
+		pResult->ulBytes = ulCells * (2 * sizeof(cl_double4) + 2 * sizeof(cl_double));
+		pResult->dSeconds = timeRuns([&]() {
+			executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+				cl_long lIdxX = ghc.get_global_id(0);
+				cl_long lIdxY = ghc.get_global_id(1);
+				if (lIdxX >= iCols || lIdxY >= iRows)
+					return;
+				cl_ulong ulIdx = getCellID(pDomain, lIdxX, lIdxY);
+				pDst[ulIdx] = implicitFriction(pSrc[ulIdx], dBed[ulIdx], dManning[ulIdx], dTimestep);
+			}, iCols, iRows, GTS_DIM1, GTS_DIM2);
+		}, uiRepeats);
+	}
+	else if (sKernel == "implicitFrictionClasses")
+	{
+		sManningTable pManningTable;
+		if (!createManningTable(dManning, ulCells, &pManningTable))
+		{
+			cout << "Benchmark error: Manning class table failed for " << sKernel << endl;
+			return false;
+		}
+		pResult->ulUpdates = ulCells;
+		pResult->ulBytes = ulCells * (2 * sizeof(cl_double4) + sizeof(cl_double) + sizeof(cl_uchar));
+		pResult->dSeconds = timeRuns([&]() {
+			executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+				cl_long lIdxX = ghc.get_global_id(0);
+				cl_long lIdxY = ghc.get_global_id(1);
+				if (lIdxX >= iCols || lIdxY >= iRows)
+					return;
+				cl_ulong ulIdx = getCellID(pDomain, lIdxX, lIdxY);
+				pDst[ulIdx] = implicitFrictionCoefficient(pSrc[ulIdx], dBed[ulIdx], pManningTable.Coefficients[pManningTable.Class[ulIdx]].GN2, dTimestep);
+			}, iCols, iRows, GTS_DIM1, GTS_DIM2);
+		}, uiRepeats);
+		freeManningTable(&pManningTable);
+	}
+	else if (sKernel == "per_FrictionClasses")
+	{
+		// Friction sweep in place, as run after the scheme
+		sManningTable pManningTable;
+		if (!createManningTable(dManning, ulCells, &pManningTable))
+		{
+			cout << "Benchmark error: Manning class table failed for " << sKernel << endl;
+			return false;
+		}
+		std::copy(pSrc, pSrc + ulCells, pDst);
+		pResult->ulUpdates = ulCells;
+		pResult->ulBytes = ulCells * (2 * sizeof(cl_double4) + sizeof(cl_double) + sizeof(cl_uchar));
+		pResult->dSeconds = timeRuns([&]() {
+			executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+				per_FrictionClasses(pDomain, &dTimestep, pDst, dBed, &pManningTable, ghc);
+			}, iCols, iRows, GTS_DIM1, GTS_DIM2);
+		}, uiRepeats);
+		freeManningTable(&pManningTable);
+	}
+	else if (sKernel == "tst_Reduce")
+	{
+		// Cooperative work-groups, the thread count does not apply
+		cl_double pReductionData[TIMESTEP_WORKERS];
+		pResult->ulUpdates = ulCells;
+		pResult->ulBytes = ulCells * (sizeof(cl_double4) + sizeof(cl_double));
+		pResult->dSeconds = timeRuns([&]() {
+			executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+				tst_Reduce(pDomain, pSrc, dBed, pReductionData, ghc);
+			}, TIMESTEP_WORKERS * TIMESTEP_GROUPSIZE, 1, TIMESTEP_GROUPSIZE, 1, TIMESTEP_GROUPSIZE * sizeof(cl_double), true);
+		}, uiRepeats);
+	}
+	else if (sKernel == "tst_ReduceActive" || sKernel == "per_FrictionActive")
+	{
+		// Only the tiles the activity map of the source state keeps active are read
+		cl_uint2 uiTileSize = { GTS_TILE_DIM1, GTS_TILE_DIM2 };
+		sTileActivity pActivity = allocateTileActivity(pDomain.Rows, pDomain.Cols, uiTileSize);
+		int iTilesX = (int)pActivity.TilesX, iTilesY = (int)pActivity.TilesY;
+		executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+			tac_Mark(pDomain, &pActivity, pSrc, dBed, ghc);
+		}, iTilesX, iTilesY, 1, 1);
+		executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+			tac_Activate(&pActivity, ghc);
+		}, iTilesX, iTilesY, 1, 1);
+		cl_ulong ulActive = (cl_ulong)(getTileActiveFraction(&pActivity) * ulCells);
+		pResult->ulUpdates = ulActive;
+		if (sKernel == "tst_ReduceActive") {
+			cl_double pReductionData[TIMESTEP_WORKERS];
+			pResult->ulBytes = ulActive * (sizeof(cl_double4) + sizeof(cl_double));
+			pResult->dSeconds = timeRuns([&]() {
+				executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+					tst_ReduceActive(pDomain, pSrc, dBed, pReductionData, &pActivity, ghc);
+				}, TIMESTEP_WORKERS * TIMESTEP_GROUPSIZE, 1, TIMESTEP_GROUPSIZE, 1, TIMESTEP_GROUPSIZE * sizeof(cl_double), true);
+			}, uiRepeats);
+		}
+		else {
+			std::copy(pSrc, pSrc + ulCells, pDst);
+			pResult->ulBytes = ulActive * (2 * sizeof(cl_double4) + 2 * sizeof(cl_double));
+			pResult->dSeconds = timeRuns([&]() {
+				executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+					per_Friction(pDomain, &dTimestep, pDst, dBed, dManning, &dTime, &pActivity, ghc);
+				}, iCols, iRows, GTS_DIM1, GTS_DIM2);
+			}, uiRepeats);
+		}
+		freeTileActivity(&pActivity);
+	}
+	else if (sKernel == "tst_ReducePrimitives")
+	{
+		// The primitives are filled by the step before, only their reduction is timed
+		cl_double pReductionData[TIMESTEP_WORKERS];
+		vector<cl_double4> pPrimitives(ulCells);
+		executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+			gts_Primitives(pDomain, pSrc, dBed, &pPrimitives[0], ghc);
+		}, iCols, iRows, GTS_DIM1, GTS_DIM2);
+		pResult->ulUpdates = ulCells;
+		pResult->ulBytes = ulCells * sizeof(cl_double4);
+		pResult->dSeconds = timeRuns([&]() {
+			executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+				tst_ReducePrimitives(pDomain, &pPrimitives[0], pReductionData, ghc);
+			}, TIMESTEP_WORKERS * TIMESTEP_GROUPSIZE, 1, TIMESTEP_GROUPSIZE, 1, TIMESTEP_GROUPSIZE * sizeof(cl_double), true);
+		}, uiRepeats);
+	}
+	else if (sKernel == "bdy_Uniform")
+	{
+		// Boundaries write to the destination so the source stays the same across kernels
+		sBdyUniformConfiguration pConfiguration = { 2, 3600.0, 7200.0, BOUNDARY_UNIFORM_RAIN_INTENSITY };
+		cl_double2 pTimeseries[2] = { { 0.0, 10.0 }, { 3600.0, 10.0 } };
+		pResult->ulUpdates = ulCells;
+		pResult->ulBytes = ulCells * (2 * sizeof(cl_double4) + sizeof(cl_double));
+		pResult->dSeconds = timeRuns([&]() {
+			executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+				bdy_Uniform(pDomain, &pConfiguration, pTimeseries, &dTime, &dTimestep, &dTimeHydrological, pDst, dBed, dManning, ghc);
+			}, iCols, iRows, GTS_DIM1, GTS_DIM2);
+		}, uiRepeats);
+	}
+	else if (sKernel == "bdy_Gridded")
+	{
+		// Rain on a grid ten times coarser than the domain
+		sBdyGriddedConfiguration pConfiguration;
+		pConfiguration.TimeseriesInterval = 3600.0;
+		pConfiguration.GridResolution = 10.0 * pDomain.DeltaX;
+		pConfiguration.GridOffsetX = 0.0;
+		pConfiguration.GridOffsetY = 0.0;
+		pConfiguration.TimeseriesEntries = 1;
+		pConfiguration.Definition = BOUNDARY_GRIDDED_RAIN_INTENSITY;
+		pConfiguration.GridRows = pDomain.Rows / 10 + 1;
+		pConfiguration.GridCols = pDomain.Cols / 10 + 1;
+		vector<cl_double> dGrid((pConfiguration.TimeseriesEntries + 1) * pConfiguration.GridRows * pConfiguration.GridCols, 10.0);
+		pResult->ulUpdates = ulCells;
+		pResult->ulBytes = ulCells * (2 * sizeof(cl_double4) + sizeof(cl_double));
+		pResult->dSeconds = timeRuns([&]() {
+			executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+				bdy_Gridded(pDomain, &pConfiguration, &dGrid[0], &dTime, &dTimestep, &dTimeHydrological, pDst, dBed, dManning, ghc);
+			}, iCols, iRows, GTS_DIM1, GTS_DIM2);
+		}, uiRepeats);
+	}
+	else if (sKernel == "bdy_GriddedTiled")
+	{
+		// Rain on a grid ten times coarser than the domain, one work-item per tile
+		sBdyGriddedConfiguration pConfiguration;
+		pConfiguration.TimeseriesInterval = 3600.0;
+		pConfiguration.GridResolution = 10.0 * pDomain.DeltaX;
+		pConfiguration.GridOffsetX = 0.0;
+		pConfiguration.GridOffsetY = 0.0;
+		pConfiguration.TimeseriesEntries = 1;
+		pConfiguration.Definition = BOUNDARY_GRIDDED_RAIN_INTENSITY;
+		pConfiguration.GridRows = pDomain.Rows / 10 + 1;
+		pConfiguration.GridCols = pDomain.Cols / 10 + 1;
+		vector<cl_double> dGrid((pConfiguration.TimeseriesEntries + 1) * pConfiguration.GridRows * pConfiguration.GridCols, 10.0);
+		cl_uint2 uiTileSize = { GTS_TILE_DIM1, GTS_TILE_DIM2 };
+		sTileActivity pActivity = allocateTileActivity(pDomain.Rows, pDomain.Cols, uiTileSize);
+		pResult->ulUpdates = ulCells;
+		pResult->ulBytes = ulCells * (2 * sizeof(cl_double4) + sizeof(cl_double));
+		pResult->dSeconds = timeRuns([&]() {
+			executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+				bdy_GriddedTiled(pDomain, &pConfiguration, &dGrid[0], &dTime, &dTimestep, &dTimeHydrological, pDst, &pActivity, ghc);
+			}, (int)pActivity.TilesX, (int)pActivity.TilesY, 1, 1);
+		}, uiRepeats);
+		freeTileActivity(&pActivity);
+	}
+	else if (sKernel == "bdy_Cell")
+	{
+		// Inflow along the west edge
+		sBdyCellConfiguration pConfiguration = { 2, 3600.0, 7200.0, pDomain.Rows, BOUNDARY_DEPTH_IGNORE, BOUNDARY_DISCHARGE_IS_DISCHARGE };
+		cl_double4 pTimeseries[2] = { { 0.0, 0.0, 0.5, 0.0 }, { 3600.0, 0.0, 0.5, 0.0 } };
+		vector<cl_ulong> ulRelations(pDomain.Rows);
+		for (cl_ulong ulRow = 0; ulRow < pDomain.Rows; ulRow++)
+			ulRelations[ulRow] = getCellID(pDomain, 0, ulRow);
+		pResult->ulUpdates = pDomain.Rows;
+		pResult->ulBytes = pDomain.Rows * (sizeof(cl_ulong) + 2 * sizeof(cl_double4) + sizeof(cl_double));
+		pResult->dSeconds = timeRuns([&]() {
+			executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+				bdy_Cell(pDomain, &pConfiguration, &ulRelations[0], pTimeseries, &dTime, &dTimestep, &dTimeHydrological, pDst, dBed, dManning, ghc);
+			}, iRows, 1, GTS_DIM1 * GTS_DIM2, 1);
+		}, uiRepeats);
+	}
+	else {
+		cout << "Unknown kernel " << sKernel << endl;
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ *  Comma separated list of numbers, "1e4,1e6" style
+ */
+vector<cl_double> parseList(const char* cList)
+{
+	vector<cl_double> dValues;
+	stringstream ssList(cList);
+	string sItem;
+	while (getline(ssList, sItem, ','))
+		dValues.push_back(strtod(sItem.c_str(), NULL));
+	return dValues;
+}
+
+/*
+ *  Usage: theBenchmark [--cells 1e4,1e5,1e6] [--wet 0.1,0.5,1] [--threads 1,4] [--repeats N] [--kernels a,b]
+ *  Prints one CSV row per kernel, domain size, wet fraction and thread count.
+ *  Speedup is relative to the first thread count of the same configuration.
+ *  1e8 cells needs about 8 GB of memory.
+ *  promaidesExplicitToEnd and promaidesImplicitToEnd run thousands of steps,
+ *  they are left out of the default kernels and named with --kernels.
+ */
+int main(int argc, char* argv[]) {
+
+	vector<cl_double>	dCells = parseList("1e4,1e5,1e6");
+	vector<cl_double>	dWetFractions = parseList("0.1,0.5,1");
+	vector<cl_double>	dThreads;
+	unsigned int		uiRepeats = 5;
+	vector<string>		sKernels = {
+		"gts_cacheDisabled", "gts_cacheDisabledHLL", "gts_cacheDisabledRusanov", "gts_cacheDisabledFloat", "gts_cacheDisabledGeometry", "gts_cacheDisabledPrimitives", "gts_interior", "gts_cacheEnabled", "stepSeparate", "gts_fusedStep", "gts_ensemble", "solverFunctionPromaides", "solverFunctionPromaidesRoughness", "solverFunctionPromaidesGeometry", "solverFunctionPromaidesClasses", "solverFunctionPromaidesFlowStates", "solverFunctionPromaidesFaces", "gts_faces", "gts_facesRows", "hyb_faces",
+		"riemannSolver", "riemannSolverHLL", "riemannSolverRusanov", "riemannSolverBatch",
+		"implicitFriction", "implicitFrictionClasses", "per_FrictionClasses", "tst_Reduce", "tst_ReducePrimitives", "tst_ReduceActive", "per_FrictionActive", "bdy_Uniform", "bdy_Gridded", "bdy_GriddedTiled", "bdy_Cell", "bdy_GhostRing"
+	};
+
+	dThreads.push_back(1);
+	if (std::thread::hardware_concurrency() > 1)
+		dThreads.push_back(std::thread::hardware_concurrency());
+
+	for (int i = 1; i < argc; i++)
+	{
+		string sOption = argv[i];
+		if (i + 1 >= argc)
+		{
+			cout << "Missing value for " << sOption << endl;
+			return 1;
+		}
+		if (sOption == "--cells")
+			dCells = parseList(argv[++i]);
+		else if (sOption == "--wet")
+			dWetFractions = parseList(argv[++i]);
+		else if (sOption == "--threads")
+			dThreads = parseList(argv[++i]);
+		else if (sOption == "--repeats")
+			uiRepeats = std::max(1u, (unsigned int)strtoul(argv[++i], NULL, 10));
+		else if (sOption == "--kernels")
+		{
+			stringstream ssList(argv[++i]);
+			string sItem;
+			sKernels.clear();
+			while (getline(ssList, sItem, ','))
+				sKernels.push_back(sItem);
+		}
+		else {
+			cout << "Unknown option " << sOption << endl;
+			return 1;
+		}
+	}
+
+	cout << "kernel,cells,rows,cols,wet_fraction,threads,repeats,seconds,updates_per_second,bytes_per_run,gigabytes_per_second,speedup" << endl;
+
+	for (size_t iCells = 0; iCells < dCells.size(); iCells++)
+	{
+		for (size_t iWet = 0; iWet < dWetFractions.size(); iWet++)
+		{
+			sBenchmarkDomain pBenchmark;
+			if (!createBenchmarkDomain((cl_ulong)dCells[iCells], dWetFractions[iWet], &pBenchmark))
+				return 1;
+
+			map<string, cl_double> dBaseline;
+			for (size_t iThreads = 0; iThreads < dThreads.size(); iThreads++)
+			{
+				NDRangeExecutor executor((unsigned int)dThreads[iThreads]);
+
+				for (size_t iKernel = 0; iKernel < sKernels.size(); iKernel++)
+				{
+					sBenchmarkResult pResult;
+					if (!benchmarkKernel(sKernels[iKernel], pBenchmark, executor, uiRepeats, &pResult))
+						return 1;
+
+					if (iThreads == 0)
+						dBaseline[pResult.sKernel] = pResult.dSeconds;
+
+					cout << pResult.sKernel << ","
+						<< pResult.ulCells << ","
+						<< pResult.ulRows << ","
+						<< pResult.ulCols << ","
+						<< pResult.dWetFraction << ","
+						<< pResult.uiThreads << ","
+						<< pResult.uiRepeats << ","
+						<< setprecision(6) << pResult.dSeconds << ","
+						<< pResult.ulUpdates / pResult.dSeconds << ","
+						<< pResult.ulBytes << ","
+						<< pResult.ulBytes / pResult.dSeconds / 1e9 << ","
+						<< dBaseline[pResult.sKernel] / pResult.dSeconds << endl;
+				}
+			}
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,49 @@
+/*
+ * ------------------------------------------------------------------
+ *  Author: Alaa Mroue - 2023
+ *  This code is licensed under GPLv3. See LICENCE for more information.
+ * ------------------------------------------------------------------
+ */
+
+#pragma once
+#include "definitions.h"
+#include "2_CLFriction.h"
+#include "3_CLSolverHLLC.h"
+#include "4_CLDynamicTimestep.h"
+#include "5_CLSchemeGodunov.h"
+#include "9_CLSchemePromaidesImplicit.h"
+#include "10_CLSchemeHybrid.h"
+#include <vector>
+#include <string>
+
+// Members of the gts_ensemble run, every member a copy of the domain state
+#define BENCHMARK_ENSEMBLE_MEMBERS	16
+
+// Simulated time of the diffusive runs to an end time, and the timestep the
+// implicit one starts from (s)
+#define BENCHMARK_DIFFUSIVE_END		10.0
+#define BENCHMARK_IMPLICIT_TIMESTEP	2.0
+
+// Synthetic domain the kernels are timed on
+typedef struct sBenchmarkDomain {
+	sDomainConfiguration	pDomain;
+	cl_double				dWetFraction;
+	std::vector<cl_double>	dBedElevation;
+	std::vector<cl_double>	dManning;
+	std::vector<cl_double4>	pCellStateSrc;
+	std::vector<cl_double4>	pCellStateDst;
+} sBenchmarkDomain;
+
+// One timed run of a kernel, written as a CSV row
+typedef struct sBenchmarkResult {
+	std::string		sKernel;
+	cl_ulong		ulCells;
+	cl_ulong		ulRows;
+	cl_ulong		ulCols;
+	cl_double		dWetFraction;
+	unsigned int	uiThreads;
+	unsigned int	uiRepeats;
+	cl_double		dSeconds;				// Mean wall time of one run
+	cl_ulong		ulUpdates;				// Cells, faces or relations processed per run
+	cl_ulong		ulBytes;				// Compulsory memory traffic per run
+} sBenchmarkResult;
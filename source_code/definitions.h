@@ -12,12 +12,14 @@
 
 
 #include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <iomanip>
 #include <CL/opencl.h>
 #include "GlobalHandlerClass.h"
+#include "NDRangeExecutor.h"
+#include "SubdomainExecutor.h"
 #include "normalPlain.h"
-#include "6_CLBoundaries.h"
 
 //For Solver
 #define QUITE_SMALL     1E-9
@@ -30,12 +32,184 @@
 
 
 //Compile time Definitions: for Cartesian Domain
-#define	DOMAIN_CELLCOUNT 100
+//These only size the compile-time fast path (sDomainCompiled), the actual
+//domain is described at runtime by sDomainConfiguration.
+#ifndef DOMAIN_ROWS
 #define	DOMAIN_ROWS      10
+#endif
+#ifndef DOMAIN_COLS
 #define	DOMAIN_COLS      10
+#endif
+#define	DOMAIN_CELLCOUNT (DOMAIN_ROWS * DOMAIN_COLS)
 #define	DOMAIN_DELTAX    1
 #define	DOMAIN_DELTAY    1
 
+// Runtime description of the Cartesian domain, loaded at startup
+// and passed to every kernel
+typedef struct sDomainConfiguration
+{
+	cl_ulong		CellCount;
+	cl_ulong		Rows;
+	cl_ulong		Cols;
+	cl_double		DeltaX;
+	cl_double		DeltaY;
+} sDomainConfiguration;
+
+// Compile time description of the domain. Kernels instantiated with this
+// type see the domain size as constants and fold the index arithmetic.
+template <cl_ulong ulRows, cl_ulong ulCols>
+struct sDomainFixed
+{
+	static const cl_ulong	CellCount = ulRows * ulCols;
+	static const cl_ulong	Rows = ulRows;
+	static const cl_ulong	Cols = ulCols;
+	cl_double		DeltaX;
+	cl_double		DeltaY;
+};
+
+template <cl_ulong ulRows, cl_ulong ulCols> const cl_ulong sDomainFixed<ulRows, ulCols>::CellCount;
+template <cl_ulong ulRows, cl_ulong ulCols> const cl_ulong sDomainFixed<ulRows, ulCols>::Rows;
+template <cl_ulong ulRows, cl_ulong ulCols> const cl_ulong sDomainFixed<ulRows, ulCols>::Cols;
+
+typedef sDomainFixed<DOMAIN_ROWS, DOMAIN_COLS> sDomainCompiled;
+
+// Block of a domain split across ranks: the cells a rank owns and a one
+// cell ring around them. The ring is halo from the neighbouring rank or,
+// at the domain edge, the domain's own outer ring. Indices are local.
+typedef struct sDomainPartition
+{
+	sDomainConfiguration	Local;			// Block and ring, the domain the kernels see
+	cl_ulong		RowOffset;				// Global row of local row 0
+	cl_ulong		ColOffset;				// Global column of local column 0
+	cl_ulong		OwnedRowStart;			// Rows and columns this rank holds the only
+	cl_ulong		OwnedRowEnd;			// up to date copy of, the outer ring included
+	cl_ulong		OwnedColStart;			// at the domain edge
+	cl_ulong		OwnedColEnd;
+	int				Rank;
+	int				RanksX;
+	int				RanksY;
+	int				Neighbours[4];			// Rank across each DOMAIN_DIR_, -1 at the domain edge
+} sDomainPartition;
+
+// Structure-of-arrays cell state, the same data as the cl_double4
+// {Z, Zmax, Qx, Qy} array split into contiguous, aligned components
+#define CELLSTATE_ALIGNMENT		64
+
+typedef struct sCellStateSoA
+{
+	cl_double*		Z;
+	cl_double*		Zmax;
+	cl_double*		Qx;
+	cl_double*		Qy;
+} sCellStateSoA;
+
+// Ensemble state, every member of a cell stored next to each other in an
+// sCellStateSoA (member-minor, cell * Members + member), over one bed.
+// Members of a chunk have their faces solved together, one per SIMD lane.
+#define ENSEMBLE_CHUNK			32
+
+// Manning land-use classes, a byte per cell indexing a table of the
+// coefficients the kernels need, computed once for every class
+#define MANNING_CLASSES			256
+
+typedef struct sManningClass
+{
+	cl_double		N;						// Manning coefficient
+	cl_double		InvN;					// 1 / n
+	cl_double		GN2;					// GRAVITY * n * n
+} sManningClass;
+
+typedef struct sManningTable
+{
+	cl_uchar*		Class;					// Class of every cell
+	sManningClass*	Coefficients;			// MANNING_CLASSES entries, ClassCount used
+	cl_uint			ClassCount;
+} sManningTable;
+
+// Flow state of a diffusive (Promaides) cell, one byte per cell. A cell
+// without FLOW_ELEMENT is not updated, the others take the diffusive law
+// on their faces unless blocked or switched to the polder/weir law.
+#define FLOW_ELEMENT			0x01
+#define FLOW_NOFLOW_X			0x02
+#define FLOW_NOFLOW_Y			0x04
+#define FLOW_POLDER_X			0x08
+#define FLOW_POLDER_Y			0x10
+
+// Code path of a tile of the flow state map, from the cells it holds
+#define FLOWTILE_NONE			0		// No flow elements, copied
+#define FLOWTILE_DIFFUSIVE		1		// Flow elements with the diffusive law only
+#define FLOWTILE_GENERAL		2		// Any mix, the flags are read per cell
+
+typedef struct sFlowStates
+{
+	cl_uchar*		Cell;					// FLOW_ flags of every cell
+	cl_uint2		TileSize;
+	cl_ulong		TilesX;
+	cl_ulong		TilesY;
+	cl_uchar*		Tile;					// FLOWTILE_ path of every tile
+} sFlowStates;
+
+// Static geometry of the faces, precomputed once from the bed and Manning
+// values. The east and north face of a cell are stored at its ID, as in the
+// face pass. Keeping the averaged roughness saves divisions, keeping the bed
+// maximum only a comparison for as much memory again.
+#define FACE_GEOMETRY_NONE		0		// Recomputed every step
+#define FACE_GEOMETRY_ROUGHNESS	1		// Averaged 1/n, 16 bytes per cell
+#define FACE_GEOMETRY_FULL		2		// Averaged 1/n and bed maximum, 32 bytes per cell
+
+typedef struct sFaceGeometry
+{
+	cl_uchar		Storage;				// FACE_GEOMETRY_ of the arrays held
+	cl_double*		InvManningE;			// 0.5 * (1/n + 1/n of the east cell)
+	cl_double*		InvManningN;			// 0.5 * (1/n + 1/n of the north cell)
+	cl_double*		BedMaxE;				// Higher bed of the cell and the east cell, NULL unless FULL
+	cl_double*		BedMaxN;				// Higher bed of the cell and the north cell, NULL unless FULL
+} sFaceGeometry;
+
+// Storage precision of the state, bed and Manning. Kernels instantiated with
+// a policy convert on load and store only, the flux sums and the Zmax update
+// stay in double. Float keeps the depth over the cell's bed rather than the
+// level, so a small rain increment is not lost against a high bed.
+#define PRECISION_DOUBLE		0
+#define PRECISION_FLOAT			1
+
+struct sPrecisionDouble {
+	static const cl_uchar Type = PRECISION_DOUBLE;
+	typedef cl_double	Real;
+	typedef cl_double4	State;
+	static cl_double4 load(const cl_double4& pState, cl_double /*dBed*/) { return pState; }
+	static cl_double4 store(const cl_double4& pState, cl_double /*dBed*/) { return pState; }
+};
+
+struct sPrecisionFloat {
+	static const cl_uchar Type = PRECISION_FLOAT;
+	typedef cl_float	Real;
+	typedef cl_float4	State;
+	// The disabled marker level is kept as it is, Zmax stays a level
+	static cl_double4 load(const cl_float4& pState, cl_double dBed) {
+		return { pState.x == -9999.0f ? -9999.0 : dBed + pState.x, pState.y, pState.z, pState.w };
+	}
+	static cl_float4 store(const cl_double4& pState, cl_double dBed) {
+		return { pState.x == -9999.0 ? -9999.0f : (cl_float)(pState.x - dBed), (cl_float)pState.y, (cl_float)pState.z, (cl_float)pState.w };
+	}
+};
+
+// Tile activity map, the domain split into tiles of TileSize cells with one
+// state per tile. Dry tiles have no wet cell in or next to them.
+#define TILE_DRY						0		// Skipped, both buffers hold the same state
+#define TILE_DRAINED					1		// Dry since this step, copied once
+#define TILE_ACTIVE						2		// Updated by the scheme
+
+typedef struct sTileActivity
+{
+	cl_uint2		TileSize;
+	cl_ulong		TilesX;
+	cl_ulong		TilesY;
+	cl_ulong		TileCount;
+	cl_uchar*		State;					// TILE_DRY, TILE_DRAINED or TILE_ACTIVE
+	cl_uchar*		Wet;					// Tile holds a wet cell
+} sTileActivity;
+
 //Dynamic Timesteps
 #define TIMESTEP_EARLY_LIMIT			0.1
 #define TIMESTEP_EARLY_LIMIT_DURATION	60.0
@@ -77,24 +251,43 @@
 #define BOUNDARY_GRIDDED_RAIN_ACCUMUL	1
 #define BOUNDARY_GRIDDED_MASS_FLUX		2
 
+// Ghost ring, the outer ring of cells the schemes read but never update
+#define BOUNDARY_GHOST_FROZEN			0		// Keeps its state
+#define BOUNDARY_GHOST_REFLECTIVE		1		// Adjacent cell mirrored, closed wall
+#define BOUNDARY_GHOST_OPEN				2		// Adjacent cell copied, free outflow
+
 
-#define TIMESTEP_GROUPSIZE 12
+// Work-group size of tst_Reduce, a power of two for the funnel reduction
+#define TIMESTEP_GROUPSIZE 16
 
 #define COURANT_NUMBER 1
 #define TIMESTEP_WORKERS 1
 
 
 //Godnuov
-#define GTS_DIM1 1
-#define GTS_DIM2 1
+// Work-group size used to enqueue the cell kernels
+#define GTS_DIM1 16
+#define GTS_DIM2 16
+
+// Default tile of gts_cacheEnabled, tile and halo fit in a 32 KB L1 cache
+#define GTS_TILE_DIM1 32
+#define GTS_TILE_DIM2 16
 
-cl_ulong	getCellID(cl_long lIdxX, cl_long lIdxY);
-cl_ulong	getNeighbourByIndices(cl_long lIdxX, cl_long lIdxY, cl_uchar ucDirection);
+template <typename TDomain> cl_ulong	getCellID(const TDomain&, cl_long lIdxX, cl_long lIdxY);
+template <typename TDomain> cl_ulong	getNeighbourByIndices(const TDomain&, cl_long lIdxX, cl_long lIdxY, cl_uchar ucDirection);
 
 cl_double4 riemannSolver(cl_uchar	ucDirection, cl_double8 pLeft, cl_double8 pRight, bool bDebug);
 
-void gts_cacheDisabled(cl_double*,cl_double*,cl_double4*,cl_double4*,cl_double*, GlobalHandlerClass);
-void solverFunctionPromaides(cl_double*, cl_double*, cl_double4*, cl_double4*, cl_double*, GlobalHandlerClass);
+struct sRiemannHLLC;
+
+template <typename TDomain, typename TRiemann = sRiemannHLLC> void gts_cacheDisabled(const TDomain&, cl_double*,cl_double*,cl_double4*,cl_double4*,cl_double*, const sTileActivity*, const sFaceGeometry*, const cl_double4*, std::atomic<cl_ulong>*, GlobalHandlerClass);
+template <typename TDomain> void gts_cacheDisabledSoA(const TDomain&, cl_double*, cl_double*, sCellStateSoA, sCellStateSoA, cl_double*, std::atomic<cl_ulong>*, GlobalHandlerClass);
+template <typename TDomain> void gts_ensemble(const TDomain&, cl_double*, cl_double*, cl_uint, sCellStateSoA, sCellStateSoA, cl_double*, GlobalHandlerClass);
+template <typename TDomain> void solverFunctionPromaides(const TDomain&, cl_double*, cl_double*, cl_double4*, cl_double4*, cl_double*, const sTileActivity*, const sFaceGeometry*, GlobalHandlerClass);
+template <typename TDomain> void solverFunctionPromaidesClasses(const TDomain&, cl_double*, cl_double*, cl_double4*, cl_double4*, const sManningTable*, const sTileActivity*, GlobalHandlerClass);
+template <typename TDomain> void solverFunctionPromaidesFlowStates(const TDomain&, cl_double*, cl_double*, cl_double4*, cl_double4*, cl_double*, const sFlowStates*, GlobalHandlerClass);
+template <typename TDomain> void solverFunctionPromaidesFaceFluxes(const TDomain&, cl_double*, cl_double*, sCellStateSoA, cl_double*, cl_double*, cl_double*, GlobalHandlerClass);
+template <typename TDomain> void solverFunctionPromaidesFaceUpdate(const TDomain&, cl_double*, cl_double*, sCellStateSoA, sCellStateSoA, cl_double*, cl_double*, GlobalHandlerClass);
 void rp(cl_double8, cl_double8);
 cl_double8 d(cl_double, cl_double, cl_double, cl_double, cl_double, cl_double, cl_double, cl_double);
 
@@ -110,4 +303,8 @@ cl_uchar reconstructInterface(
 
 cl_double4 riemannSolver(cl_uchar	ucDirection, cl_double8 pLeft, cl_double8 pRight, bool bDebug);
 void rp(cl_double8 d1, cl_double8 d2);
-cl_double8 d(cl_double x1, cl_double x2, cl_double x3, cl_double x4, cl_double U, cl_double V, cl_double Zb, cl_double _);
\ No newline at end of file
+cl_double8 d(cl_double x1, cl_double x2, cl_double x3, cl_double x4, cl_double U, cl_double V, cl_double Zb, cl_double _);
+
+#include "1_CLDomainCartesian.h"
+#include "6_CLBoundaries.h"
+#include "8_CLTileActivity.h"
@@ -7,17 +7,33 @@
 
 #include "main.h"
 #include <iostream>
+#include <cstdlib>
 
 using namespace std;
 
-int main() {
+template <typename TDomain, typename TRiemann>
+int runSimulation(const TDomain& pDomain, NDRangeExecutor& executor, sRunOptions pOptions) {
+
+	bool bStructureOfArrays = pOptions.bStructureOfArrays;
+	bool bFacePass = pOptions.bFacePass;
+	bool bHybrid = pOptions.bHybrid;
+	bool bTiled = pOptions.uiTileSize.s[0] > 0;
+	bool bActivityMap = pOptions.bActivityMap;
+	bool bInterior = pOptions.bInterior;
+	bool bSubdomains = pOptions.uiSubdomains > 0;
+	bool bBatch = pOptions.uiBatchSteps > 0;
+	cl_uchar ucGhostRing = pOptions.ucGhostRing;
+	bool bPrimitives = pOptions.bPrimitives;
+	bool bFused = pOptions.bFused;
+	bool bManningClasses = pOptions.bManningClasses;
 
 	// Initializations
 	unsigned long long iterationToPerform = 100;
 	unsigned long long nextBatchIterations = iterationToPerform;
-	cl_double dTimestep = 0.0001;
+	cl_double dTimestep = pOptions.dTimestep;
 	cl_double pTimeHydrological = 0;
 	cl_double pTime = 0;
+	cl_ulong ulCellCount = pDomain.CellCount;
 
 	/* Testing riemannSolver
 	cl_double8 left = d(158.227507, 0.000007, 0.000000, 0.000000, 0.000000, 0.000000, 158.227500, 0.0);
@@ -28,8 +44,8 @@ int main() {
 	*/
 
 	// Define a uniform grid with mountain-like terrain
-	normalPlain np = normalPlain(10, 10);
-	normalPlain np2 = normalPlain(10, 10);
+	normalPlain np = normalPlain((int)pDomain.Rows, (int)pDomain.Cols);
+	normalPlain np2 = normalPlain((int)pDomain.Rows, (int)pDomain.Cols);
 	np.SetBedElevationMountain();
 
 	// Define Boundary Conditions
@@ -45,65 +61,882 @@ int main() {
 	pTimeseries[1] = { 360000,11.5 };
 
 	// Define water levels
-	cl_double* dBedElevation = new cl_double[100];
-	cl_double4* pCellStateSrc = new cl_double4[100];
-	cl_double4* pCellStateDst = new cl_double4[100];
-	cl_double* dManning = new cl_double[100];
-	for (int i = 0; i < 100; i++){ 
-		dBedElevation[i] = np.getBedElevation(i);
-		pCellStateSrc[i] = { np.getBedElevation(i) + 0.1,0,0,0 };
+	cl_double* dBedElevation = new cl_double[ulCellCount];
+	cl_double4* pCellStateSrc = new cl_double4[ulCellCount];
+	cl_double4* pCellStateDst = new cl_double4[ulCellCount];
+	cl_double* dManning = new cl_double[ulCellCount];
+	for (cl_ulong i = 0; i < ulCellCount; i++){ 
+		dBedElevation[i] = np.getBedElevation((int)i);
+		pCellStateSrc[i] = { np.getBedElevation((int)i) + 0.1,0,0,0 };
 		pCellStateDst[i] = pCellStateSrc[i];
 		dManning[i] = 100;
 	
 	}
 
-	np.outputShape();
+	// Structure-of-arrays copy of the state
+	sCellStateSoA pCellStateSrcSoA = { NULL, NULL, NULL, NULL };
+	sCellStateSoA pCellStateDstSoA = { NULL, NULL, NULL, NULL };
+	if (bStructureOfArrays) {
+		pCellStateSrcSoA = allocateCellStateSoA(ulCellCount);
+		pCellStateDstSoA = allocateCellStateSoA(ulCellCount);
+		copyCellStateToSoA(pCellStateSrc, pCellStateSrcSoA, ulCellCount);
+		copyCellStateToSoA(pCellStateDst, pCellStateDstSoA, ulCellCount);
+	}
+
+	// Tiles the scheme skips while they and their neighbours are dry
+	cl_uint2 uiActivityTileSize = bTiled ? pOptions.uiTileSize : cl_uint2({ GTS_TILE_DIM1, GTS_TILE_DIM2 });
+	sTileActivity pActivity = { uiActivityTileSize, 0, 0, 0, NULL, NULL };
+	sTileActivity* pActivityMap = NULL;
+	int iTilesX = 0, iTilesY = 0;
+	if (bActivityMap) {
+		pActivity = allocateTileActivity(pDomain.Rows, pDomain.Cols, uiActivityTileSize);
+		pActivityMap = &pActivity;
+		iTilesX = (int)pActivity.TilesX;
+		iTilesY = (int)pActivity.TilesY;
+	}
+
+	// Bands of rows stepped by pinned threads. Each thread first touches the
+	// rows it owns so they are placed on its NUMA node.
+	SubdomainExecutor subdomains(bSubdomains ? pOptions.uiSubdomains : 1, pDomain.Rows);
+	if (bSubdomains) {
+		cl_double* dBandBedElevation = (cl_double*)allocateAligned(ulCellCount * sizeof(cl_double));
+		cl_double* dBandManning = (cl_double*)allocateAligned(ulCellCount * sizeof(cl_double));
+		cl_double4* pBandCellStateSrc = (cl_double4*)allocateAligned(ulCellCount * sizeof(cl_double4));
+		cl_double4* pBandCellStateDst = (cl_double4*)allocateAligned(ulCellCount * sizeof(cl_double4));
+		subdomains.run([&](unsigned int uiSubdomain) {
+			const sSubdomain& pBand = subdomains.getSubdomain(uiSubdomain);
+			for (cl_ulong i = pBand.RowStart * pDomain.Cols; i < pBand.RowEnd * pDomain.Cols; i++) {
+				dBandBedElevation[i] = dBedElevation[i];
+				dBandManning[i] = dManning[i];
+				pBandCellStateSrc[i] = pCellStateSrc[i];
+				pBandCellStateDst[i] = pCellStateDst[i];
+			}
+		});
+		delete[] dBedElevation;
+		delete[] dManning;
+		delete[] pCellStateSrc;
+		delete[] pCellStateDst;
+		dBedElevation = dBandBedElevation;
+		dManning = dBandManning;
+		pCellStateSrc = pBandCellStateSrc;
+		pCellStateDst = pBandCellStateDst;
+	}
+
+	// Batch counters kept by the timestep kernels, and the state a batch
+	// rolls back to. A dynamic timestep is only capped by the limit.
+	cl_double dTimeSync = SCHEME_ENDTIME;
+	cl_double dBatchTimesteps = 0.0;
+	cl_uint uiBatchSuccessful = 0;
+	cl_uint uiBatchSkipped = 0;
+	cl_double pReductionData[TIMESTEP_WORKERS] = { 0.0 };
+	#ifdef TIMESTEP_DYNAMIC
+	cl_double dTimestepCeiling = TIMESTEP_MAXIMUM;
+	#else
+	cl_double dTimestepCeiling = pOptions.dTimestep;
+	#endif
+	cl_double dTimestepLimit = dTimestepCeiling;
+	std::atomic<cl_uint> uiUnstable(0);
+	std::atomic<cl_ulong> ulMaxSpeed(0);
+	std::atomic<cl_ulong>* pMaxSpeed = NULL;
+	#ifdef TIMESTEP_DYNAMIC
+	pMaxSpeed = &ulMaxSpeed;
+	#endif
+	cl_uint2 uiFusedTileSize = { GTS_TILE_DIM1, GTS_TILE_DIM2 };
+	unsigned long long ulRollbacks = 0;
+	cl_double4* pCellStateGood = NULL;
+	if (bBatch)
+		pCellStateGood = new cl_double4[ulCellCount];
+
+	// Fluxes through the east and north face of every cell
+	sFaceFlux* pFacesE = NULL;
+	sFaceFlux* pFacesN = NULL;
+	if (bFacePass) {
+		pFacesE = new sFaceFlux[ulCellCount];
+		pFacesN = new sFaceFlux[ulCellCount];
+	}
+
+	// Static face values of the bed and Manning, precomputed once
+	sFaceGeometry pGeometry;
+	sFaceGeometry* pFaceGeometry = NULL;
+	if (!createFaceGeometry(pDomain.Rows, pDomain.Cols, dBedElevation, dManning, pOptions.ucFaceGeometry, &pGeometry))
+		return 1;
+	if (pGeometry.Storage != FACE_GEOMETRY_NONE)
+		pFaceGeometry = &pGeometry;
+
+	// Land-use class of every cell, friction reads its coefficients from the table
+	sManningTable pManningTable = { NULL, NULL, 0 };
+	if (bManningClasses && !createManningTable(dManning, ulCellCount, &pManningTable))
+		return 1;
+
+	// Depths and velocities of the state a step reads
+	cl_double4* pPrimitives = NULL;
+	if (bPrimitives)
+		pPrimitives = (cl_double4*)allocateAligned(ulCellCount * sizeof(cl_double4));
+
+	// Regime of every tile, classified every HYBRID_CLASSIFY_STEPS steps
+	sHybridRegime pRegime = { { GTS_TILE_DIM1, GTS_TILE_DIM2 }, 0, 0, 0, NULL, NULL, NULL };
+	unsigned long long ulHybridSteps = 0;
+	if (bHybrid)
+		pRegime = allocateHybridRegime(pDomain.Rows, pDomain.Cols, pRegime.TileSize);
+
+	// Only print grids that fit on a terminal
+	bool bOutputShape = pDomain.Cols <= 40;
+	if (bOutputShape)
+		np.outputShape();
 	
 	//Main Program Loops
 
 	while(iterationToPerform > 0 ){
 
-		//Apply Rain
-		GlobalHandlerClass ghc1 = GlobalHandlerClass(0, 0);
-		for (int i = 0; i < 10; i++) {
-			for (int j = 0; j < 10; j++) {
-				bdy_Uniform(&pConfiguration,pTimeseries, &pTime,&dTimestep,&pTimeHydrological,pCellStateSrc,dBedElevation,dManning,ghc1);
-				ghc1.globalintY++;
+		if (bSubdomains) {
+			//Run the whole batch, bands only wait for their neighbours' halo rows
+			cl_ulong ulSteps = iterationToPerform;
+			subdomains.run([&](unsigned int uiSubdomain) {
+				cl_double4* pBandSrc = pCellStateSrc;
+				cl_double4* pBandDst = pCellStateDst;
+				cl_double dBandTime = pTime;
+				cl_double dBandTimestep = dTimestep;
+				cl_double dBandTimeHydrological = pTimeHydrological;
+				cl_double dBandTimeSync = SCHEME_ENDTIME;
+				cl_double dBandBatchTimesteps = 0.0;
+				cl_uint uiBandBatchSuccessful = 0;
+				cl_uint uiBandBatchSkipped = 0;
+				cl_double pBandReductionData[TIMESTEP_WORKERS] = { 0.0 };
+				std::atomic<cl_ulong> ulBandMaxSpeed(0);
+				std::atomic<cl_ulong>* pBandMaxSpeed = NULL;
+				#ifdef TIMESTEP_DYNAMIC
+				pBandMaxSpeed = &ulBandMaxSpeed;
+				#endif
+				int iCols = (int)pDomain.Cols;
+				int iRows = (int)pDomain.Rows;
+
+				//Apply Rain for the first step
+				subdomains.enqueueRows([&](GlobalHandlerClass ghc) {
+					bdy_Uniform(pDomain, &pConfiguration, pTimeseries, &dBandTime, &dBandTimestep, &dBandTimeHydrological, pBandSrc, dBedElevation, dManning, ghc);
+				}, uiSubdomain, iCols, iRows);
+				subdomains.markPhaseDone(uiSubdomain, 1);
+
+				for (cl_ulong ulStep = 0; ulStep < ulSteps; ulStep++) {
+					subdomains.waitForHalo(uiSubdomain, ulStep + 1);
+
+					//Apply Scheme and Friction
+					subdomains.enqueueRows([&](GlobalHandlerClass ghc) {
+						gts_cacheDisabled<TDomain, TRiemann>(pDomain, &dBandTimestep, dBedElevation, pBandSrc, pBandDst, dManning, NULL, pFaceGeometry, NULL, pBandMaxSpeed, ghc);
+					}, uiSubdomain, iCols, iRows);
+					subdomains.enqueueRows([&](GlobalHandlerClass ghc) {
+						if (bManningClasses)
+							per_FrictionClasses(pDomain, &dBandTimestep, pBandDst, dBedElevation, &pManningTable, ghc);
+						else
+							per_Friction(pDomain, &dBandTimestep, pBandDst, dBedElevation, dManning, &dBandTime, NULL, ghc);
+					}, uiSubdomain, iCols, iRows);
+
+					//Reduce the timestep from the speeds the scheme folded, only a dynamic timestep needs every band
+					#ifdef TIMESTEP_DYNAMIC
+					tst_CollectSpeed(&ulBandMaxSpeed, pBandReductionData);
+					pBandReductionData[0] = subdomains.allReduceMax(ulStep, pBandReductionData[0]);
+					#endif
+
+					//Advance Time, every band computes the same values
+					tst_Advance_Normal(pDomain, &dBandTime, &dBandTimestep, &dBandTimeHydrological, pBandReductionData, pBandDst, dBedElevation, &dBandTimeSync, &dBandBatchTimesteps, &uiBandBatchSuccessful, &uiBandBatchSkipped);
+
+					//Apply Rain for the next step
+					if (ulStep + 1 < ulSteps)
+						subdomains.enqueueRows([&](GlobalHandlerClass ghc) {
+							bdy_Uniform(pDomain, &pConfiguration, pTimeseries, &dBandTime, &dBandTimestep, &dBandTimeHydrological, pBandDst, dBedElevation, dManning, ghc);
+						}, uiSubdomain, iCols, iRows);
+
+					std::swap(pBandSrc, pBandDst);
+					subdomains.markPhaseDone(uiSubdomain, ulStep + 2);
+				}
+
+				if (uiSubdomain == 0) {
+					pTime = dBandTime;
+					dTimestep = dBandTimestep;
+					pTimeHydrological = dBandTimeHydrological;
+				}
+			});
+
+			if (ulSteps % 2 == 1)
+				std::swap(pCellStateSrc, pCellStateDst);
+			iterationToPerform = 1;
+		}
+		else if (bBatch) {
+			//Run the steps in batches the driver only checks at the end
+			cl_ulong ulSteps = iterationToPerform;
+			for (cl_ulong ulDone = 0; ulDone < ulSteps; ) {
+				cl_ulong ulBatch = std::min((cl_ulong)pOptions.uiBatchSteps, ulSteps - ulDone);
+				cl_double dGoodTime = pTime;
+				cl_double dGoodTimeHydrological = pTimeHydrological;
+				cl_double dGoodTimestep = dTimestep;
+				#ifdef TIMESTEP_DYNAMIC
+				cl_double dGoodReductionData[TIMESTEP_WORKERS];
+				std::copy(pReductionData, pReductionData + TIMESTEP_WORKERS, dGoodReductionData);
+				#endif
+
+				std::copy(pCellStateSrc, pCellStateSrc + ulCellCount, pCellStateGood);
+				uiUnstable = 0;
+				tst_ResetCounters(&dBatchTimesteps, &uiBatchSuccessful, &uiBatchSkipped);
+
+				for (cl_ulong ulStep = 0; ulStep < ulBatch; ulStep++) {
+					if (bFused) {
+						//Apply Rain, Scheme, Friction, the check and the reduction a tile at a time
+						executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+							gts_fusedStep<TDomain, TRiemann>(pDomain, &pTime, &dTimestep, &pTimeHydrological, &pConfiguration, pTimeseries, NULL, NULL, dBedElevation, pCellStateSrc, pCellStateDst, dManning, uiFusedTileSize, &uiUnstable, pMaxSpeed, ghc);
+						}, (int)((pDomain.Cols + uiFusedTileSize.s[0] - 1) / uiFusedTileSize.s[0]), (int)((pDomain.Rows + uiFusedTileSize.s[1] - 1) / uiFusedTileSize.s[1]), 1, 1, gts_cacheEnabledScratchSize(uiFusedTileSize));
+						#ifdef TIMESTEP_DYNAMIC
+						tst_CollectSpeed(&ulMaxSpeed, pReductionData);
+						#endif
+					}
+					else {
+						//Apply Rain
+						executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+							bdy_Uniform(pDomain, &pConfiguration, pTimeseries, &pTime, &dTimestep, &pTimeHydrological, pCellStateSrc, dBedElevation, dManning, ghc);
+						}, (int)pDomain.Cols, (int)pDomain.Rows, GTS_DIM1, GTS_DIM2);
+
+						//Apply Scheme and Friction, both skip a suspended step
+						executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+							gts_cacheDisabled<TDomain, TRiemann>(pDomain, &dTimestep, dBedElevation, pCellStateSrc, pCellStateDst, dManning, NULL, pFaceGeometry, NULL, pMaxSpeed, ghc);
+						}, (int)pDomain.Cols, (int)pDomain.Rows, GTS_DIM1, GTS_DIM2);
+						executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+							if (bManningClasses)
+								per_FrictionClasses(pDomain, &dTimestep, pCellStateDst, dBedElevation, &pManningTable, ghc);
+							else
+								per_Friction(pDomain, &dTimestep, pCellStateDst, dBedElevation, dManning, &pTime, NULL, ghc);
+						}, (int)pDomain.Cols, (int)pDomain.Rows, GTS_DIM1, GTS_DIM2);
+
+						//Flag the new state if the step was unstable
+						executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+							tst_CheckState(pDomain, &dTimestep, pCellStateDst, dBedElevation, &uiUnstable, ghc);
+						}, (int)pDomain.Cols, (int)pDomain.Rows, GTS_DIM1, GTS_DIM2);
+
+						//Reduce the timestep from the speeds the scheme folded
+						#ifdef TIMESTEP_DYNAMIC
+						tst_CollectSpeed(&ulMaxSpeed, pReductionData);
+						#endif
+					}
+
+					//Advance Time, the rest of an unstable batch is suspended
+					tst_Advance_Normal(pDomain, &pTime, &dTimestep, &pTimeHydrological, pReductionData, pCellStateDst, dBedElevation, &dTimeSync, &dBatchTimesteps, &uiBatchSuccessful, &uiBatchSkipped);
+					tst_LimitTimestep(&dTimestep, &dTimestepLimit, &uiUnstable);
+
+					std::swap(pCellStateSrc, pCellStateDst);
+				}
+
+				if (uiUnstable != 0) {
+					//Roll back to the start of the batch and retry with half the timestep
+					std::copy(pCellStateGood, pCellStateGood + ulCellCount, pCellStateSrc);
+					std::copy(pCellStateGood, pCellStateGood + ulCellCount, pCellStateDst);
+					pTime = dGoodTime;
+					pTimeHydrological = dGoodTimeHydrological;
+					dTimestepLimit = fabs(dGoodTimestep) / 2.0;
+					dTimestep = dTimestepLimit;
+					ulRollbacks++;
+
+					//The restored state may need less still, its speeds were folded by the step that made it
+					#ifdef TIMESTEP_DYNAMIC
+					std::copy(dGoodReductionData, dGoodReductionData + TIMESTEP_WORKERS, pReductionData);
+					tst_UpdateTimestep(pDomain, &pTime, &dTimestep, pReductionData, &dTimeSync, &dBatchTimesteps);
+					#endif
+
+					if (dTimestepLimit < TIMESTEP_MINIMUM) {
+						cout << endl << "Batch at " << pTime << " s is unstable at the minimum timestep" << endl;
+						return 1;
+					}
+					continue;
+				}
+
+				//A clean batch lets the timestep grow back
+				dTimestepLimit = std::min(dTimestepLimit * 2.0, dTimestepCeiling);
+				#ifndef TIMESTEP_DYNAMIC
+				if (dTimestep > 0.0)
+					dTimestep = dTimestepLimit;
+				#endif
+				ulDone += ulBatch;
 			}
-			ghc1.globalintY = 0;
-			ghc1.globalintX++;
+
+			iterationToPerform = 1;
 		}
+		else if (bStructureOfArrays) {
+			//Apply Rain
+			executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+				bdy_UniformSoA(pDomain, &pConfiguration, pTimeseries, &pTime, &dTimestep, &pTimeHydrological, pCellStateSrcSoA, dBedElevation, ghc);
+			}, (int)pDomain.Cols, (int)pDomain.Rows, GTS_DIM1, GTS_DIM2);
 
+			//Apply Scheme
+			executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+				gts_cacheDisabledSoA(pDomain, &dTimestep, dBedElevation, pCellStateSrcSoA, pCellStateDstSoA, dManning, pMaxSpeed, ghc);
+			}, (int)pDomain.Cols, (int)pDomain.Rows, GTS_DIM1, GTS_DIM2);
 
-		//Apply Scheme
-		GlobalHandlerClass ghc2 = GlobalHandlerClass(0, 0);
-		for (int i = 0; i < 10; i++) {
-			for (int j = 0; j < 10; j++) {
-				gts_cacheDisabled(&dTimestep, dBedElevation, pCellStateSrc, pCellStateDst, dManning, ghc2);
-				//solverFunctionPromaides(&dTimestep, dBedElevation, pCellStateSrc, pCellStateDst, dManning, ghc2);
-				ghc2.globalintY++;
+			std::swap(pCellStateSrcSoA, pCellStateDstSoA);
+		}
+		else if (bActivityMap) {
+			//Apply Rain
+			executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+				bdy_UniformTiled(pDomain, &pConfiguration, pTimeseries, &pTime, &dTimestep, &pTimeHydrological, pCellStateSrc, dBedElevation, pActivityMap, ghc);
+			}, iTilesX, iTilesY, 1, 1);
+
+			//Find the tiles to update
+			executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+				tac_Activate(pActivityMap, ghc);
+			}, iTilesX, iTilesY, 1, 1);
+
+			//Apply Scheme
+			if (bTiled) {
+				cl_uint2 uiTileSize = pOptions.uiTileSize;
+				executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+					gts_cacheEnabled(pDomain, &dTimestep, dBedElevation, pCellStateSrc, pCellStateDst, dManning, uiTileSize, pActivityMap, pMaxSpeed, ghc);
+				}, iTilesX, iTilesY, 1, 1, gts_cacheEnabledScratchSize(uiTileSize));
+			}
+			else executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+				gts_cacheDisabled<TDomain, TRiemann>(pDomain, &dTimestep, dBedElevation, pCellStateSrc, pCellStateDst, dManning, pActivityMap, pFaceGeometry, NULL, pMaxSpeed, ghc);
+			}, (int)pDomain.Cols, (int)pDomain.Rows, GTS_DIM1, GTS_DIM2);
+
+			//Flag the wet tiles of the new state
+			executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+				tac_Mark(pDomain, pActivityMap, pCellStateDst, dBedElevation, ghc);
+			}, iTilesX, iTilesY, 1, 1);
+
+			std::swap(pCellStateSrc, pCellStateDst);
+		}
+		else {
+			//Apply Rain
+			executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+				bdy_Uniform(pDomain, &pConfiguration, pTimeseries, &pTime, &dTimestep, &pTimeHydrological, pCellStateSrc, dBedElevation, dManning, ghc);
+			}, (int)pDomain.Cols, (int)pDomain.Rows, GTS_DIM1, GTS_DIM2);
+
+			//Fill the ghost ring
+			if (ucGhostRing != BOUNDARY_GHOST_FROZEN)
+				executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+					bdy_GhostRing(pDomain, ucGhostRing, pCellStateSrc, dBedElevation, ghc);
+				}, (int)std::max(pDomain.Cols, pDomain.Rows), 1, GTS_DIM1 * GTS_DIM2, 1);
+
+			//Apply Scheme
+			if (bInterior) {
+				executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+					gts_interior<TDomain, TRiemann>(pDomain, &dTimestep, dBedElevation, pCellStateSrc, pCellStateDst, dManning, pMaxSpeed, ghc);
+				}, 1, (int)pDomain.Rows, 1, GTS_DIM2);
+			}
+			else if (bHybrid) {
+				//Classify the tiles, the diffusive ones cap the timestep
+				if (ulHybridSteps++ % HYBRID_CLASSIFY_STEPS == 0) {
+					executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+						hyb_Classify(pDomain, &pRegime, pCellStateSrc, dBedElevation, dManning, ghc);
+					}, (int)pRegime.TilesX, (int)pRegime.TilesY, 1, 1);
+					executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+						hyb_Regime(&pRegime, ghc);
+					}, (int)pRegime.TilesX, (int)pRegime.TilesY, 1, 1);
+					if (dTimestep > 0.0)
+						dTimestep = std::min(pOptions.dTimestep, getHybridTimestep(&pRegime));
+				}
+				executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+					hyb_FaceFluxes(pDomain, &dTimestep, dBedElevation, pCellStateSrc, dManning, &pRegime, pFacesE, pFacesN, ghc);
+				}, (int)pRegime.TilesX, (int)pRegime.TilesY, 1, 1);
+				executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+					hyb_FaceUpdate(pDomain, &dTimestep, dBedElevation, pCellStateSrc, pCellStateDst, dManning, &pRegime, pFacesE, pFacesN, ghc);
+				}, (int)pRegime.TilesX, (int)pRegime.TilesY, 1, 1);
+			}
+			else if (bFacePass) {
+				executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+					gts_faceFluxesRows(pDomain, &dTimestep, dBedElevation, pCellStateSrc, pFacesE, pFacesN, ghc);
+				}, 1, (int)pDomain.Rows, 1, GTS_DIM2);
+				executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+					gts_faceUpdate(pDomain, &dTimestep, dBedElevation, pCellStateSrc, pCellStateDst, dManning, pFacesE, pFacesN, pMaxSpeed, ghc);
+				}, (int)pDomain.Cols, (int)pDomain.Rows, GTS_DIM1, GTS_DIM2);
+			}
+			else if (bTiled) {
+				cl_uint2 uiTileSize = pOptions.uiTileSize;
+				executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+					gts_cacheEnabled(pDomain, &dTimestep, dBedElevation, pCellStateSrc, pCellStateDst, dManning, uiTileSize, NULL, pMaxSpeed, ghc);
+				}, (int)((pDomain.Cols + uiTileSize.s[0] - 1) / uiTileSize.s[0]), (int)((pDomain.Rows + uiTileSize.s[1] - 1) / uiTileSize.s[1]), 1, 1, gts_cacheEnabledScratchSize(uiTileSize));
+			}
+			else {
+				//Depths and velocities of the state after the boundaries
+				if (bPrimitives)
+					executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+						gts_Primitives(pDomain, pCellStateSrc, dBedElevation, pPrimitives, ghc);
+					}, (int)pDomain.Cols, (int)pDomain.Rows, GTS_DIM1, GTS_DIM2);
+
+				executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+					gts_cacheDisabled<TDomain, TRiemann>(pDomain, &dTimestep, dBedElevation, pCellStateSrc, pCellStateDst, dManning, NULL, pFaceGeometry, pPrimitives, pMaxSpeed, ghc);
+					//solverFunctionPromaides(pDomain, &dTimestep, dBedElevation, pCellStateSrc, pCellStateDst, dManning, NULL, NULL, ghc);
+				}, (int)pDomain.Cols, (int)pDomain.Rows, GTS_DIM1, GTS_DIM2);
+			}
+
+			//Set Results, the kernels write every cell they read so the buffers swap
+			std::swap(pCellStateSrc, pCellStateDst);
+		}
+
+		//Advance Time, the bands and batches keep their own time
+		if (!bSubdomains && !bBatch) {
+			//The schemes folded the speeds of the new state, the hybrid tiles set their own timestep
+			#ifdef TIMESTEP_DYNAMIC
+			if (!bHybrid) {
+				tst_CollectSpeed(&ulMaxSpeed, pReductionData);
+				tst_Advance_Normal(pDomain, &pTime, &dTimestep, &pTimeHydrological, pReductionData, pCellStateSrc, dBedElevation, &dTimeSync, &dBatchTimesteps, &uiBatchSuccessful, &uiBatchSkipped);
+			}
+			else
+			#endif
+			{
+				pTime += dTimestep;
+				pTimeHydrological += dTimestep;
+			}
+		}
+
+		//Output progress
+		if (iterationToPerform % 876 ==0) {
+			cout << "\rIteration Left:" << iterationToPerform << "      Time Spent: " << pTime << " s";
+			if (bActivityMap)
+				cout << "      Active tiles: " << 100.0 * getTileActiveFraction(pActivityMap) << " %";
+		}
+		iterationToPerform--;
+
+		//Output Results
+		if (iterationToPerform == 0) {
+			cout << "\rAfter " << nextBatchIterations << " Iterations, Spent: " << pTime << " s                          " << endl;
+			if (bActivityMap)
+				cout << "Active tiles: " << 100.0 * getTileActiveFraction(pActivityMap) << " %" << endl;
+			if (bHybrid)
+				cout << "Diffusive tiles: " << 100.0 * getHybridDiffusiveFraction(&pRegime) << " %      Timestep: " << dTimestep << " s" << endl;
+			if (bBatch)
+				cout << "Rollbacks: " << ulRollbacks << "      Timestep: " << dTimestep << " s" << endl;
+			if (bOutputShape) {
+				if (bStructureOfArrays)
+					copyCellStateFromSoA(pCellStateSrcSoA, pCellStateSrc, ulCellCount);
+				np2.setBedElevation(pCellStateSrc);
+				np2.outputShape();
+			}
+			cout << "How many Iterations to perform?: ";
+			cin >> nextBatchIterations;
+			iterationToPerform = nextBatchIterations;
+			cout << endl;
+		}
+	}
+
+	if (bStructureOfArrays) {
+		freeCellStateSoA(&pCellStateSrcSoA);
+		freeCellStateSoA(&pCellStateDstSoA);
+	}
+	if (bActivityMap)
+		freeTileActivity(&pActivity);
+	if (bHybrid)
+		freeHybridRegime(&pRegime);
+	freeFaceGeometry(&pGeometry);
+	if (bManningClasses)
+		freeManningTable(&pManningTable);
+	if (bPrimitives)
+		freeAligned(pPrimitives);
+	if (bSubdomains) {
+		freeAligned(dBedElevation);
+		freeAligned(dManning);
+		freeAligned(pCellStateSrc);
+		freeAligned(pCellStateDst);
+	}
+	delete[] pFacesE;
+	delete[] pFacesN;
+	delete[] pCellStateGood;
+
+	return 0;
+}
+
+/*
+ *  Step this rank's block of a domain split across ranks. The halo is
+ *  exchanged while the cells away from it are updated, and the timestep
+ *  is reduced over every rank.
+ */
+template <typename TRiemann>
+int runPartition(const sDomainConfiguration& pGlobal, HaloTransport* pTransport, unsigned int uiThreads, cl_double dRequestedTimestep) {
+
+	sDomainPartition pPartition;
+	if (!createDomainPartition(pGlobal, pTransport->getRankCount(), pTransport->getRank(), &pPartition))
+		return 1;
+
+	const sDomainConfiguration& pDomain = pPartition.Local;
+	bool bRoot = pTransport->getRank() == 0;
+	NDRangeExecutor executor(uiThreads);
+	HaloExchange exchange(pPartition, pTransport);
+
+	// Initializations
+	unsigned long long iterationToPerform = 100;
+	unsigned long long nextBatchIterations = iterationToPerform;
+	cl_double dTimestep = dRequestedTimestep;
+	cl_double pTimeHydrological = 0;
+	cl_double pTime = 0;
+	cl_double dTimeSync = SCHEME_ENDTIME;
+	cl_double dBatchTimesteps = 0.0;
+	cl_uint uiBatchSuccessful = 0;
+	cl_uint uiBatchSkipped = 0;
+	cl_double pReductionData[TIMESTEP_WORKERS] = { 0.0 };
+	cl_ulong ulCellCount = pDomain.CellCount;
+	int iCols = (int)pDomain.Cols;
+	int iRows = (int)pDomain.Rows;
+
+	// Same terrain as a single rank run, each rank keeps its block
+	normalPlain np = normalPlain((int)pGlobal.Rows, (int)pGlobal.Cols);
+	normalPlain np2 = normalPlain((int)pGlobal.Rows, (int)pGlobal.Cols);
+	np.SetBedElevationMountain();
+
+	// Define Boundary Conditions
+	sBdyUniformConfiguration pConfiguration;
+	pConfiguration.TimeseriesEntries = 2;
+	pConfiguration.TimeseriesInterval = 1000;
+	pConfiguration.TimeseriesLength = 1000000.00;
+	pConfiguration.Definition = 0;
+
+	// Define Time series 
+	cl_double2* pTimeseries = new cl_double2[2];
+	pTimeseries[0] = { 0,11.5 };
+	pTimeseries[1] = { 360000,11.5 };
+
+	// Define water levels of the block and its ring
+	cl_double* dBedElevation = new cl_double[ulCellCount];
+	cl_double4* pCellStateSrc = new cl_double4[ulCellCount];
+	cl_double4* pCellStateDst = new cl_double4[ulCellCount];
+	cl_double* dManning = new cl_double[ulCellCount];
+	for (cl_ulong i = 0; i < ulCellCount; i++) {
+		int iGlobal = (int)((pPartition.RowOffset + i / pDomain.Cols) * pGlobal.Cols + pPartition.ColOffset + i % pDomain.Cols);
+		dBedElevation[i] = np.getBedElevation(iGlobal);
+		pCellStateSrc[i] = { np.getBedElevation(iGlobal) + 0.1,0,0,0 };
+		pCellStateDst[i] = pCellStateSrc[i];
+		dManning[i] = 100;
+	}
+
+	// Only print grids that fit on a terminal, rank 0 gathers them
+	bool bOutputShape = pGlobal.Cols <= 40;
+	cl_double4* pGlobalState = NULL;
+	if (bOutputShape && bRoot) {
+		pGlobalState = new cl_double4[pGlobal.CellCount];
+		np.outputShape();
+	}
+
+	auto updateCells = [&](int iOffsetX, int iOffsetY, int iSizeX, int iSizeY) {
+		executor.enqueueNDRangeOffset([&](GlobalHandlerClass ghc) {
+			gts_cacheDisabled<sDomainConfiguration, TRiemann>(pDomain, &dTimestep, dBedElevation, pCellStateSrc, pCellStateDst, dManning, NULL, NULL, NULL, NULL, ghc);
+		}, iOffsetX, iOffsetY, iSizeX, iSizeY, std::min(iSizeX, GTS_DIM1), std::min(iSizeY, GTS_DIM2));
+	};
+
+	//Main Program Loops
+
+	while (iterationToPerform > 0) {
+
+		//Apply Rain for the first step
+		executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+			bdy_Uniform(pDomain, &pConfiguration, pTimeseries, &pTime, &dTimestep, &pTimeHydrological, pCellStateSrc, dBedElevation, dManning, ghc);
+		}, iCols, iRows, GTS_DIM1, GTS_DIM2);
+
+		for (unsigned long long ulStep = 0; ulStep < iterationToPerform; ulStep++) {
+
+			//Exchange the halo while updating the cells that do not read it
+			exchange.begin(pCellStateSrc);
+			updateCells(2, 2, iCols - 4, iRows - 4);
+			exchange.finish(pCellStateSrc);
+
+			//Update the cells next to the ring
+			updateCells(0, 1, iCols, 1);
+			if (iRows > 3)
+				updateCells(0, iRows - 2, iCols, 1);
+			updateCells(1, 2, 1, iRows - 4);
+			if (iCols > 3)
+				updateCells(iCols - 2, 2, 1, iRows - 4);
+
+			//Apply Friction
+			executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+				per_Friction(pDomain, &dTimestep, pCellStateDst, dBedElevation, dManning, &pTime, NULL, ghc);
+			}, iCols, iRows, GTS_DIM1, GTS_DIM2);
+
+			//Reduce the timestep over the cells every rank owns
+			#ifdef TIMESTEP_DYNAMIC
+			pReductionData[0] = pTransport->allReduceMax(tst_ReduceBlock(pDomain, pCellStateDst, dBedElevation, pPartition.OwnedRowStart, pPartition.OwnedRowEnd, pPartition.OwnedColStart, pPartition.OwnedColEnd));
+			#endif
+
+			//Advance Time, every rank computes the same values
+			tst_Advance_Normal(pDomain, &pTime, &dTimestep, &pTimeHydrological, pReductionData, pCellStateDst, dBedElevation, &dTimeSync, &dBatchTimesteps, &uiBatchSuccessful, &uiBatchSkipped);
+
+			//Apply Rain for the next step
+			if (ulStep + 1 < iterationToPerform)
+				executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+					bdy_Uniform(pDomain, &pConfiguration, pTimeseries, &pTime, &dTimestep, &pTimeHydrological, pCellStateDst, dBedElevation, dManning, ghc);
+				}, iCols, iRows, GTS_DIM1, GTS_DIM2);
+
+			std::swap(pCellStateSrc, pCellStateDst);
+		}
+
+		//Output Results
+		if (bOutputShape)
+			gatherPartitions(pTransport, pGlobal, pPartition, pCellStateSrc, pGlobalState);
+		if (bRoot) {
+			cout << "\rAfter " << nextBatchIterations << " Iterations, Spent: " << pTime << " s                          " << endl;
+			if (bOutputShape) {
+				np2.setBedElevation(pGlobalState);
+				np2.outputShape();
 			}
-			ghc2.globalintY = 0;
-			ghc2.globalintX++;
+			cout << "How many Iterations to perform?: ";
+			cin >> nextBatchIterations;
+			cout << endl;
+		}
+		nextBatchIterations = broadcastCount(pTransport, nextBatchIterations);
+		iterationToPerform = nextBatchIterations;
+	}
+
+	delete[] pTimeseries;
+	delete[] dBedElevation;
+	delete[] pCellStateSrc;
+	delete[] pCellStateDst;
+	delete[] dManning;
+	delete[] pGlobalState;
+
+	return 0;
+}
+
+/*
+ *  Step an ensemble of members over one bed, each with its own rainfall
+ *  and Manning value. The members of a cell are stored next to each other,
+ *  so one sweep over the bed updates all of them.
+ */
+template <typename TDomain>
+int runEnsemble(const TDomain& pDomain, NDRangeExecutor& executor, cl_uint uiMembers, cl_double dRequestedTimestep) {
+
+	// Initializations
+	unsigned long long iterationToPerform = 100;
+	unsigned long long nextBatchIterations = iterationToPerform;
+	cl_double dTimestep = dRequestedTimestep;
+	cl_double pTimeHydrological = 0;
+	cl_double pTime = 0;
+	cl_ulong ulCellCount = pDomain.CellCount;
+	cl_ulong ulMemberCount = ulCellCount * uiMembers;
+
+	// Define a uniform grid with mountain-like terrain
+	normalPlain np = normalPlain((int)pDomain.Rows, (int)pDomain.Cols);
+	normalPlain np2 = normalPlain((int)pDomain.Rows, (int)pDomain.Cols);
+	np.SetBedElevationMountain();
+
+	// Define Boundary Conditions, shared by the members
+	sBdyUniformConfiguration pConfiguration;
+	pConfiguration.TimeseriesEntries = 2;
+	pConfiguration.TimeseriesInterval = 1000;
+	pConfiguration.TimeseriesLength = 1000000.00;
+	pConfiguration.Definition = 0;
+
+	// Define Time series, member m rains 0.5 to 1.5 times the single run and
+	// has 1.5 to 0.5 times its Manning value
+	cl_double2* pTimeseries = new cl_double2[2 * uiMembers];
+	cl_double* dMemberManning = new cl_double[uiMembers];
+	for (cl_uint m = 0; m < uiMembers; m++) {
+		cl_double dSpread = (m + 0.5) / uiMembers;
+		pTimeseries[m] = { 0, 11.5 * (0.5 + dSpread) };
+		pTimeseries[uiMembers + m] = { 360000, 11.5 * (0.5 + dSpread) };
+		dMemberManning[m] = 100 * (1.5 - dSpread);
+	}
+
+	// Define water levels, one bed for every member
+	cl_double* dBedElevation = new cl_double[ulCellCount];
+	cl_double4* pCellState = new cl_double4[ulCellCount];
+	cl_double* dManning = (cl_double*)allocateAligned(ulMemberCount * sizeof(cl_double));
+	sCellStateSoA pCellStateSrc = allocateCellStateSoA(ulMemberCount);
+	sCellStateSoA pCellStateDst = allocateCellStateSoA(ulMemberCount);
+	for (cl_ulong i = 0; i < ulCellCount; i++) {
+		dBedElevation[i] = np.getBedElevation((int)i);
+		for (cl_uint m = 0; m < uiMembers; m++) {
+			cl_ulong ulMember = i * uiMembers + m;
+			pCellStateSrc.Z[ulMember] = pCellStateDst.Z[ulMember] = np.getBedElevation((int)i) + 0.1;
+			pCellStateSrc.Zmax[ulMember] = pCellStateDst.Zmax[ulMember] = 0;
+			pCellStateSrc.Qx[ulMember] = pCellStateDst.Qx[ulMember] = 0;
+			pCellStateSrc.Qy[ulMember] = pCellStateDst.Qy[ulMember] = 0;
+			dManning[ulMember] = dMemberManning[m];
 		}
+	}
+
+	// Only print grids that fit on a terminal, the mean of the members
+	bool bOutputShape = pDomain.Cols <= 40;
+	if (bOutputShape)
+		np.outputShape();
+
+	cout << "Ensemble: " << uiMembers << " members, solved " << std::min(uiMembers, (cl_uint)ENSEMBLE_CHUNK) << " at a time over " << riemannSolverBatchWidth() << " lanes" << endl;
+
+	//Main Program Loops
+
+	while (iterationToPerform > 0) {
+
+		//Apply Rain
+		executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+			bdy_UniformEnsemble(pDomain, &pConfiguration, pTimeseries, &pTime, &dTimestep, &pTimeHydrological, uiMembers, pCellStateSrc, dBedElevation, ghc);
+		}, (int)pDomain.Cols, (int)pDomain.Rows, GTS_DIM1, GTS_DIM2);
+
+		//Apply Scheme
+		executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+			gts_ensemble(pDomain, &dTimestep, dBedElevation, uiMembers, pCellStateSrc, pCellStateDst, dManning, ghc);
+		}, (int)pDomain.Cols, (int)pDomain.Rows, GTS_DIM1, GTS_DIM2);
+
+		//Apply Friction
+		executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+			per_FrictionEnsemble(pDomain, &dTimestep, uiMembers, pCellStateDst, dBedElevation, dManning, ghc);
+		}, (int)pDomain.Cols, (int)pDomain.Rows, GTS_DIM1, GTS_DIM2);
+
+		std::swap(pCellStateSrc, pCellStateDst);
 
 		//Advance Time
 		pTime += dTimestep;
 		pTimeHydrological += dTimestep;
 
-		//Set Results
-		pCellStateSrc = pCellStateDst;
+		//Output progress
+		if (iterationToPerform % 876 == 0)
+			cout << "\rIteration Left:" << iterationToPerform << "      Time Spent: " << pTime << " s";
+		iterationToPerform--;
+
+		//Output Results
+		if (iterationToPerform == 0) {
+			cout << "\rAfter " << nextBatchIterations << " Iterations, Spent: " << pTime << " s                          " << endl;
+			if (bOutputShape) {
+				for (cl_ulong i = 0; i < ulCellCount; i++) {
+					pCellState[i] = { 0, 0, 0, 0 };
+					for (cl_uint m = 0; m < uiMembers; m++)
+						pCellState[i].x += pCellStateSrc.Z[i * uiMembers + m];
+					pCellState[i].x /= uiMembers;
+				}
+				np2.setBedElevation(pCellState);
+				np2.outputShape();
+			}
+			cout << "How many Iterations to perform?: ";
+			cin >> nextBatchIterations;
+			iterationToPerform = nextBatchIterations;
+			cout << endl;
+		}
+	}
+
+	delete[] pTimeseries;
+	delete[] dMemberManning;
+	delete[] dBedElevation;
+	delete[] pCellState;
+	freeAligned(dManning);
+	freeCellStateSoA(&pCellStateSrc);
+	freeCellStateSoA(&pCellStateDst);
+
+	return 0;
+}
+
+/*
+ *  Step the cell kernel with the state, bed and Manning stored in the
+ *  precision of TPrecision. When validating, an all-double run is stepped
+ *  alongside and the largest deviation from it is printed.
+ */
+template <typename TDomain, typename TPrecision>
+int runPrecision(const TDomain& pDomain, NDRangeExecutor& executor, cl_double dRequestedTimestep, bool bValidate) {
+
+	typedef typename TPrecision::Real Real;
+	typedef typename TPrecision::State State;
+
+	// Initializations
+	unsigned long long iterationToPerform = 100;
+	unsigned long long nextBatchIterations = iterationToPerform;
+	cl_double dTimestep = dRequestedTimestep;
+	cl_double pTimeHydrological = 0;
+	cl_double pTime = 0;
+	cl_ulong ulCellCount = pDomain.CellCount;
+
+	// Define a uniform grid with mountain-like terrain
+	normalPlain np = normalPlain((int)pDomain.Rows, (int)pDomain.Cols);
+	normalPlain np2 = normalPlain((int)pDomain.Rows, (int)pDomain.Cols);
+	np.SetBedElevationMountain();
+
+	// Define Boundary Conditions
+	sBdyUniformConfiguration pConfiguration;
+	pConfiguration.TimeseriesEntries = 2;
+	pConfiguration.TimeseriesInterval = 1000;
+	pConfiguration.TimeseriesLength = 1000000.00;
+	pConfiguration.Definition = 0;
+
+	// Define Time series 
+	cl_double2* pTimeseries = new cl_double2[2];
+	pTimeseries[0] = { 0,11.5 };
+	pTimeseries[1] = { 360000,11.5 };
+
+	// Define water levels in the storage precision, and in double for the reference
+	Real* dBedElevation = new Real[ulCellCount];
+	State* pCellStateSrc = new State[ulCellCount];
+	State* pCellStateDst = new State[ulCellCount];
+	Real* dManning = new Real[ulCellCount];
+	cl_double* dReferenceBed = new cl_double[ulCellCount];
+	cl_double4* pReferenceSrc = new cl_double4[ulCellCount];
+	cl_double4* pReferenceDst = new cl_double4[ulCellCount];
+	cl_double* dReferenceManning = new cl_double[ulCellCount];
+	cl_double4* pCellState = new cl_double4[ulCellCount];
+	for (cl_ulong i = 0; i < ulCellCount; i++) {
+		dReferenceBed[i] = np.getBedElevation((int)i);
+		pReferenceSrc[i] = { np.getBedElevation((int)i) + 0.1,0,0,0 };
+		pReferenceDst[i] = pReferenceSrc[i];
+		dReferenceManning[i] = 100;
+		dBedElevation[i] = (Real)dReferenceBed[i];
+		pCellStateSrc[i] = TPrecision::store(pReferenceSrc[i], (cl_double)dBedElevation[i]);
+		pCellStateDst[i] = pCellStateSrc[i];
+		dManning[i] = (Real)dReferenceManning[i];
+	}
+
+	// Only print grids that fit on a terminal
+	bool bOutputShape = pDomain.Cols <= 40;
+	if (bOutputShape)
+		np.outputShape();
+
+	cout << "Storage: " << (TPrecision::Type == PRECISION_FLOAT ? "float" : "double") << ", " << 2 * sizeof(State) + 2 * sizeof(Real) << " bytes per cell" << endl;
+
+	//Main Program Loops
+
+	while (iterationToPerform > 0) {
+
+		//Apply Rain
+		executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+			bdy_UniformPrecision<TDomain, TPrecision>(pDomain, &pConfiguration, pTimeseries, &pTime, &dTimestep, &pTimeHydrological, pCellStateSrc, dBedElevation, ghc);
+		}, (int)pDomain.Cols, (int)pDomain.Rows, GTS_DIM1, GTS_DIM2);
+
+		//Apply Scheme
+		executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+			gts_cacheDisabledPrecision<TDomain, TPrecision>(pDomain, &dTimestep, dBedElevation, pCellStateSrc, pCellStateDst, dManning, ghc);
+		}, (int)pDomain.Cols, (int)pDomain.Rows, GTS_DIM1, GTS_DIM2);
+
+		std::swap(pCellStateSrc, pCellStateDst);
+
+		//Step the all-double reference
+		if (bValidate) {
+			executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+				bdy_Uniform(pDomain, &pConfiguration, pTimeseries, &pTime, &dTimestep, &pTimeHydrological, pReferenceSrc, dReferenceBed, dReferenceManning, ghc);
+			}, (int)pDomain.Cols, (int)pDomain.Rows, GTS_DIM1, GTS_DIM2);
+			executor.enqueueNDRange([&](GlobalHandlerClass ghc) {
+				gts_cacheDisabled<TDomain>(pDomain, &dTimestep, dReferenceBed, pReferenceSrc, pReferenceDst, dReferenceManning, NULL, NULL, NULL, NULL, ghc);
+			}, (int)pDomain.Cols, (int)pDomain.Rows, GTS_DIM1, GTS_DIM2);
+
+			std::swap(pReferenceSrc, pReferenceDst);
+		}
+
+		//Advance Time
+		pTime += dTimestep;
+		pTimeHydrological += dTimestep;
 
 		//Output progress
-		if (iterationToPerform % 876 ==0)
+		if (iterationToPerform % 876 == 0)
 			cout << "\rIteration Left:" << iterationToPerform << "      Time Spent: " << pTime << " s";
 		iterationToPerform--;
 
 		//Output Results
 		if (iterationToPerform == 0) {
-			np2.setBedElevation(pCellStateDst);
 			cout << "\rAfter " << nextBatchIterations << " Iterations, Spent: " << pTime << " s                          " << endl;
-			np2.outputShape();
+			for (cl_ulong i = 0; i < ulCellCount; i++)
+				pCellState[i] = TPrecision::load(pCellStateSrc[i], (cl_double)dBedElevation[i]);
+			if (bValidate) {
+				cl_double dDepthDeviation = 0.0;
+				cl_double dLevelDeviation = 0.0;
+				cl_double dVolume = 0.0;
+				cl_double dReferenceVolume = 0.0;
+				for (cl_ulong i = 0; i < ulCellCount; i++) {
+					dLevelDeviation = std::max(dLevelDeviation, fabs(pCellState[i].x - pReferenceSrc[i].x));
+					dDepthDeviation = std::max(dDepthDeviation, fabs((pCellState[i].x - dBedElevation[i]) - (pReferenceSrc[i].x - dReferenceBed[i])));
+					dVolume += (pCellState[i].x - dBedElevation[i]) * pDomain.DeltaX * pDomain.DeltaY;
+					dReferenceVolume += (pReferenceSrc[i].x - dReferenceBed[i]) * pDomain.DeltaX * pDomain.DeltaY;
+				}
+				cout << std::scientific << "Max depth deviation: " << dDepthDeviation << " m      Max level deviation: " << dLevelDeviation << " m" << std::defaultfloat << endl;
+				cout << std::scientific << "Volume: " << dVolume << " m3      Reference: " << dReferenceVolume << " m3      Mass balance error: " << (dVolume - dReferenceVolume) / dReferenceVolume << std::defaultfloat << endl;
+			}
+			if (bOutputShape) {
+				np2.setBedElevation(pCellState);
+				np2.outputShape();
+			}
 			cout << "How many Iterations to perform?: ";
 			cin >> nextBatchIterations;
 			iterationToPerform = nextBatchIterations;
@@ -111,9 +944,437 @@ int main() {
 		}
 	}
 
+	delete[] pTimeseries;
+	delete[] dBedElevation;
+	delete[] pCellStateSrc;
+	delete[] pCellStateDst;
+	delete[] dManning;
+	delete[] dReferenceBed;
+	delete[] pReferenceSrc;
+	delete[] pReferenceDst;
+	delete[] dReferenceManning;
+	delete[] pCellState;
+
 	return 0;
 }
 
+/*
+ *  Instantiate the run with the storage precision picked for it
+ */
+template <typename TDomain>
+int runPrecision(const TDomain& pDomain, NDRangeExecutor& executor, sRunOptions pOptions) {
+
+	if (pOptions.ucPrecision == PRECISION_FLOAT)
+		return runPrecision<TDomain, sPrecisionFloat>(pDomain, executor, pOptions.dTimestep, pOptions.bValidatePrecision);
+	return runPrecision<TDomain, sPrecisionDouble>(pDomain, executor, pOptions.dTimestep, pOptions.bValidatePrecision);
+}
+
+/*
+ *  Instantiate the partitioned run with the Riemann solver picked for it
+ */
+int runPartition(const sDomainConfiguration& pGlobal, HaloTransport* pTransport, unsigned int uiThreads, sRunOptions pOptions) {
+
+	switch (pOptions.ucRiemannSolver)
+	{
+	case RIEMANN_SOLVER_HLL:
+		return runPartition<sRiemannHLL>(pGlobal, pTransport, uiThreads, pOptions.dTimestep);
+	case RIEMANN_SOLVER_RUSANOV:
+		return runPartition<sRiemannRusanov>(pGlobal, pTransport, uiThreads, pOptions.dTimestep);
+	default:
+		return runPartition<sRiemannHLLC>(pGlobal, pTransport, uiThreads, pOptions.dTimestep);
+	}
+}
+
+/*
+ *  Instantiate the simulation with the Riemann solver picked for this run
+ */
+template <typename TDomain>
+int runSimulation(const TDomain& pDomain, NDRangeExecutor& executor, sRunOptions pOptions) {
+
+	switch (pOptions.ucRiemannSolver)
+	{
+	case RIEMANN_SOLVER_HLL:
+		return runSimulation<TDomain, sRiemannHLL>(pDomain, executor, pOptions);
+	case RIEMANN_SOLVER_RUSANOV:
+		return runSimulation<TDomain, sRiemannRusanov>(pDomain, executor, pOptions);
+	default:
+		return runSimulation<TDomain, sRiemannHLLC>(pDomain, executor, pOptions);
+	}
+}
+
+/*
+ *  Usage: theExecutable [--threads N] [--soa | --faces | --hybrid | --tile X Y] [--active | --interior | --subdomains N | --ranks N | --mpi | --batch N | --ensemble N] [--precision double|float [--validate]] [--timestep DT] [--riemann hllc|hll|rusanov] [--ghost frozen|reflective|open] [--geometry none|roughness|full] [--primitives] [--fused] [--classes] [domain file | rows cols [deltaX deltaY]]
+ *  The domain file holds "rows cols deltaX deltaY".
+ *  --soa keeps the cell state as separate Z, Zmax, Qx, Qy arrays.
+ *  --faces solves every interface once in a face pass before updating the cells.
+ *  --hybrid is --faces with the diffusive wave in tiles of slow, gently sloping flow,
+ *    the timestep then also kept within their explicit stability limit.
+ *  --tile updates X by Y cell tiles from a cached copy, "--tile 0 0" uses the default size.
+ *  --active skips tiles that are dry along with their neighbours, alone or with --tile.
+ *  --interior sweeps rows of interior cells, the outer ring being ghost cells.
+ *  --subdomains steps N bands of rows on pinned threads through scheme, friction,
+ *    reduction and time advance, a whole batch at a time.
+ *  --ranks splits the domain into blocks over N ranks in this process, each with its
+ *    own copy of its block, exchanging halos through shared memory.
+ *  --mpi does the same over the processes of an MPI run, builds with USE_MPI only.
+ *    --threads is then per rank.
+ *  --batch runs N steps at a time with the time advanced by the timestep kernels. A batch
+ *    that leaves a negative depth or a NaN is rolled back and retried with half the
+ *    timestep.
+ *  --ensemble runs N members over the same bed, with rainfall from 0.5 to 1.5 times and
+ *    Manning values from 1.5 to 0.5 times the single run, and prints their mean.
+ *  --precision stores the state, bed and Manning as float or double, the cell kernel computes
+ *    in double either way. Float stores depths rather than levels. --validate steps an
+ *    all-double run alongside and prints the largest depth and level deviation from it,
+ *    and the volume held by both runs.
+ *  --timestep sets the timestep, 0.0001 s by default, a batch may try a large one.
+ *  --riemann picks the Riemann solver of the cell kernel, HLLC by default.
+ *  --ghost fills the outer ring from the cells next to it, it keeps its state by default.
+ *  --geometry precomputes the static face values the cell kernel reads, the bed maximum
+ *    with full, for 32 bytes per cell. Recomputed every step by default, roughness keeps
+ *    the averaged Manning values only, for 16 bytes per cell.
+ *  --primitives divides out the depth and velocities of every cell once per step, before
+ *    the cell kernel reads them, for 32 bytes per cell.
+ *  --fused steps a --batch run one tile at a time through rain, scheme, friction, the
+ *    stability check and the timestep reduction, instead of a sweep of the grid for each.
+ *  --classes gives every distinct Manning value a land-use class, the friction sweep of
+ *    --subdomains or --batch then reads a byte per cell and the table of its class.
+ */
+int main(int argc, char* argv[]) {
+
+	sDomainConfiguration pDomain = createDomain(10, 10, DOMAIN_DELTAX, DOMAIN_DELTAY);
+	unsigned int uiThreads = 0;
+	sRunOptions pOptions = { false, false, false, { 0, 0 }, false, RIEMANN_SOLVER_HLLC, false, BOUNDARY_GHOST_FROZEN, 0, 0, false, 0, 0.0001, 0, PRECISION_DOUBLE, false, FACE_GEOMETRY_NONE, false, false, false };
+
+	// Strip the options, what is left describes the domain
+	while (argc >= 2 && string(argv[1]).compare(0, 2, "--") == 0)
+	{
+		string sOption = argv[1];
+		if (sOption == "--threads" && argc >= 3)
+		{
+			uiThreads = (unsigned int)strtoul(argv[2], NULL, 10);
+			argv++;
+			argc--;
+		}
+		else if (sOption == "--soa")
+		{
+			pOptions.bStructureOfArrays = true;
+		}
+		else if (sOption == "--faces")
+		{
+			pOptions.bFacePass = true;
+		}
+		else if (sOption == "--hybrid")
+		{
+			pOptions.bFacePass = true;
+			pOptions.bHybrid = true;
+		}
+		else if (sOption == "--active")
+		{
+			pOptions.bActivityMap = true;
+		}
+		else if (sOption == "--interior")
+		{
+			pOptions.bInterior = true;
+		}
+		else if (sOption == "--primitives")
+		{
+			pOptions.bPrimitives = true;
+		}
+		else if (sOption == "--fused")
+		{
+			pOptions.bFused = true;
+		}
+		else if (sOption == "--classes")
+		{
+			pOptions.bManningClasses = true;
+		}
+		else if (sOption == "--subdomains" && argc >= 3)
+		{
+			pOptions.uiSubdomains = (unsigned int)strtoul(argv[2], NULL, 10);
+			if (pOptions.uiSubdomains == 0)
+			{
+				cout << "--subdomains needs at least one band" << endl;
+				return 1;
+			}
+			argv++;
+			argc--;
+		}
+		else if (sOption == "--batch" && argc >= 3)
+		{
+			pOptions.uiBatchSteps = (unsigned int)strtoul(argv[2], NULL, 10);
+			if (pOptions.uiBatchSteps == 0)
+			{
+				cout << "--batch needs at least one step" << endl;
+				return 1;
+			}
+			argv++;
+			argc--;
+		}
+		else if (sOption == "--timestep" && argc >= 3)
+		{
+			pOptions.dTimestep = atof(argv[2]);
+			if (!(pOptions.dTimestep > 0.0))
+			{
+				cout << "--timestep must be positive" << endl;
+				return 1;
+			}
+			argv++;
+			argc--;
+		}
+		else if (sOption == "--ensemble" && argc >= 3)
+		{
+			pOptions.uiMembers = (unsigned int)strtoul(argv[2], NULL, 10);
+			if (pOptions.uiMembers == 0)
+			{
+				cout << "--ensemble needs at least one member" << endl;
+				return 1;
+			}
+			argv++;
+			argc--;
+		}
+		else if (sOption == "--precision" && argc >= 3)
+		{
+			string sPrecision = argv[2];
+			if (sPrecision == "double")
+				pOptions.ucPrecision = PRECISION_DOUBLE;
+			else if (sPrecision == "float")
+				pOptions.ucPrecision = PRECISION_FLOAT;
+			else {
+				cout << "Unknown precision " << sPrecision << endl;
+				return 1;
+			}
+			argv++;
+			argc--;
+		}
+		else if (sOption == "--validate")
+		{
+			pOptions.bValidatePrecision = true;
+		}
+		else if (sOption == "--ranks" && argc >= 3)
+		{
+			pOptions.uiRanks = (unsigned int)strtoul(argv[2], NULL, 10);
+			if (pOptions.uiRanks == 0)
+			{
+				cout << "--ranks needs at least one rank" << endl;
+				return 1;
+			}
+			argv++;
+			argc--;
+		}
+		else if (sOption == "--mpi")
+		{
+			#ifdef USE_MPI
+			pOptions.bMPI = true;
+			#else
+			cout << "--mpi needs a build with USE_MPI" << endl;
+			return 1;
+			#endif
+		}
+		else if (sOption == "--ghost" && argc >= 3)
+		{
+			string sGhost = argv[2];
+			if (sGhost == "frozen")
+				pOptions.ucGhostRing = BOUNDARY_GHOST_FROZEN;
+			else if (sGhost == "reflective")
+				pOptions.ucGhostRing = BOUNDARY_GHOST_REFLECTIVE;
+			else if (sGhost == "open")
+				pOptions.ucGhostRing = BOUNDARY_GHOST_OPEN;
+			else {
+				cout << "Unknown ghost ring " << sGhost << endl;
+				return 1;
+			}
+			argv++;
+			argc--;
+		}
+		else if (sOption == "--geometry" && argc >= 3)
+		{
+			string sGeometry = argv[2];
+			if (sGeometry == "none")
+				pOptions.ucFaceGeometry = FACE_GEOMETRY_NONE;
+			else if (sGeometry == "roughness")
+				pOptions.ucFaceGeometry = FACE_GEOMETRY_ROUGHNESS;
+			else if (sGeometry == "full")
+				pOptions.ucFaceGeometry = FACE_GEOMETRY_FULL;
+			else {
+				cout << "Unknown face geometry " << sGeometry << endl;
+				return 1;
+			}
+			argv++;
+			argc--;
+		}
+		else if (sOption == "--riemann" && argc >= 3)
+		{
+			string sSolver = argv[2];
+			if (sSolver == "hllc")
+				pOptions.ucRiemannSolver = RIEMANN_SOLVER_HLLC;
+			else if (sSolver == "hll")
+				pOptions.ucRiemannSolver = RIEMANN_SOLVER_HLL;
+			else if (sSolver == "rusanov")
+				pOptions.ucRiemannSolver = RIEMANN_SOLVER_RUSANOV;
+			else {
+				cout << "Unknown Riemann solver " << sSolver << endl;
+				return 1;
+			}
+			argv++;
+			argc--;
+		}
+		else if (sOption == "--tile" && argc >= 4)
+		{
+			pOptions.uiTileSize.s[0] = (cl_uint)strtoul(argv[2], NULL, 10);
+			pOptions.uiTileSize.s[1] = (cl_uint)strtoul(argv[3], NULL, 10);
+			if (pOptions.uiTileSize.s[0] == 0 || pOptions.uiTileSize.s[1] == 0)
+				pOptions.uiTileSize = { GTS_TILE_DIM1, GTS_TILE_DIM2 };
+			argv += 2;
+			argc -= 2;
+		}
+		else {
+			cout << "Unknown option " << sOption << endl;
+			return 1;
+		}
+		argv++;
+		argc--;
+	}
+
+	if (argc == 2)
+	{
+		if (!readDomainConfiguration(argv[1], &pDomain))
+			return 1;
+	}
+	else if (argc >= 3)
+	{
+		pDomain = createDomain(
+			strtoull(argv[1], NULL, 10),
+			strtoull(argv[2], NULL, 10),
+			argc >= 5 ? atof(argv[3]) : DOMAIN_DELTAX,
+			argc >= 5 ? atof(argv[4]) : DOMAIN_DELTAY
+		);
+		if (pDomain.Rows < 3 || pDomain.Cols < 3)
+		{
+			cout << "Domain must be at least 3x3 cells" << endl;
+			return 1;
+		}
+	}
+
+	if ((int)pOptions.bStructureOfArrays + (int)pOptions.bFacePass + (int)(pOptions.uiTileSize.s[0] > 0) + (int)pOptions.bInterior > 1)
+	{
+		cout << "Only one of --soa, --faces, --tile and --interior can be used" << endl;
+		return 1;
+	}
+	if (pOptions.bActivityMap && (pOptions.bStructureOfArrays || pOptions.bFacePass || pOptions.bInterior))
+	{
+		cout << "--active cannot be combined with --soa, --faces or --interior" << endl;
+		return 1;
+	}
+
+	if (pOptions.ucRiemannSolver != RIEMANN_SOLVER_HLLC && (pOptions.bStructureOfArrays || pOptions.bFacePass || pOptions.uiTileSize.s[0] > 0))
+	{
+		cout << "--riemann only applies to the cell and interior kernels, not --soa, --faces or --tile" << endl;
+		return 1;
+	}
+	if (pOptions.uiSubdomains > 0 && (pOptions.bStructureOfArrays || pOptions.bFacePass || pOptions.uiTileSize.s[0] > 0 || pOptions.bInterior || pOptions.bActivityMap || pOptions.ucGhostRing != BOUNDARY_GHOST_FROZEN))
+	{
+		cout << "--subdomains runs the cell kernel and can only be combined with --riemann and --threads" << endl;
+		return 1;
+	}
+	if (pOptions.uiBatchSteps > 0 && (pOptions.bStructureOfArrays || pOptions.bFacePass || pOptions.uiTileSize.s[0] > 0 || pOptions.bInterior || pOptions.bActivityMap || pOptions.uiSubdomains > 0 || pOptions.uiRanks > 0 || pOptions.bMPI || pOptions.ucGhostRing != BOUNDARY_GHOST_FROZEN))
+	{
+		cout << "--batch runs the cell kernel and can only be combined with --riemann, --timestep and --threads" << endl;
+		return 1;
+	}
+	if ((pOptions.uiRanks > 0 || pOptions.bMPI) && (pOptions.bStructureOfArrays || pOptions.bFacePass || pOptions.uiTileSize.s[0] > 0 || pOptions.bInterior || pOptions.bActivityMap || pOptions.uiSubdomains > 0 || pOptions.ucGhostRing != BOUNDARY_GHOST_FROZEN || (pOptions.uiRanks > 0 && pOptions.bMPI)))
+	{
+		cout << "--ranks and --mpi run the cell kernel and can only be combined with --riemann and --threads" << endl;
+		return 1;
+	}
+	if (pOptions.uiMembers > 0 && (pOptions.bStructureOfArrays || pOptions.bFacePass || pOptions.uiTileSize.s[0] > 0 || pOptions.bInterior || pOptions.bActivityMap || pOptions.uiSubdomains > 0 || pOptions.uiRanks > 0 || pOptions.bMPI || pOptions.uiBatchSteps > 0 || pOptions.ucRiemannSolver != RIEMANN_SOLVER_HLLC || pOptions.ucGhostRing != BOUNDARY_GHOST_FROZEN))
+	{
+		cout << "--ensemble runs its own HLLC kernel and can only be combined with --timestep and --threads" << endl;
+		return 1;
+	}
+	if ((pOptions.ucPrecision != PRECISION_DOUBLE || pOptions.bValidatePrecision) && (pOptions.bStructureOfArrays || pOptions.bFacePass || pOptions.uiTileSize.s[0] > 0 || pOptions.bInterior || pOptions.bActivityMap || pOptions.uiSubdomains > 0 || pOptions.uiRanks > 0 || pOptions.bMPI || pOptions.uiBatchSteps > 0 || pOptions.uiMembers > 0 || pOptions.ucRiemannSolver != RIEMANN_SOLVER_HLLC || pOptions.ucGhostRing != BOUNDARY_GHOST_FROZEN))
+	{
+		cout << "--precision and --validate run the HLLC cell kernel and can only be combined with --timestep and --threads" << endl;
+		return 1;
+	}
+	if (pOptions.ucGhostRing != BOUNDARY_GHOST_FROZEN && (pOptions.bStructureOfArrays || pOptions.bActivityMap))
+	{
+		cout << "--ghost cannot be combined with --soa or --active" << endl;
+		return 1;
+	}
+	if (pOptions.ucFaceGeometry != FACE_GEOMETRY_NONE && (pOptions.bStructureOfArrays || pOptions.bFacePass || pOptions.uiTileSize.s[0] > 0 || pOptions.bInterior || pOptions.uiRanks > 0 || pOptions.bMPI || pOptions.uiMembers > 0 || pOptions.ucPrecision != PRECISION_DOUBLE || pOptions.bValidatePrecision))
+	{
+		cout << "--geometry only applies to the cell kernel, alone or with --active, --subdomains or --batch" << endl;
+		return 1;
+	}
+	if (pOptions.bPrimitives && (pOptions.bStructureOfArrays || pOptions.bFacePass || pOptions.uiTileSize.s[0] > 0 || pOptions.bActivityMap || pOptions.bInterior || pOptions.uiSubdomains > 0 || pOptions.uiRanks > 0 || pOptions.bMPI || pOptions.uiBatchSteps > 0 || pOptions.uiMembers > 0 || pOptions.ucPrecision != PRECISION_DOUBLE || pOptions.bValidatePrecision))
+	{
+		cout << "--primitives only applies to the cell kernel, alone or with --riemann, --ghost or --geometry" << endl;
+		return 1;
+	}
+	if (pOptions.bFused && (pOptions.uiBatchSteps == 0 || pOptions.ucFaceGeometry != FACE_GEOMETRY_NONE))
+	{
+		cout << "--fused only applies to --batch, and cannot be combined with --geometry" << endl;
+		return 1;
+	}
+	if (pOptions.bManningClasses && ((pOptions.uiSubdomains == 0 && pOptions.uiBatchSteps == 0) || pOptions.bFused))
+	{
+		cout << "--classes only applies to the friction sweep of --subdomains or --batch, and cannot be combined with --fused" << endl;
+		return 1;
+	}
+
+	// Blocks on ranks, every rank runs its own executor
+	#ifdef USE_MPI
+	if (pOptions.bMPI) {
+		MPI_Init(&argc, &argv);
+		MPITransport transport(MPI_COMM_WORLD);
+		if (transport.getRank() == 0)
+			cout << "Domain: " << pDomain.Rows << " x " << pDomain.Cols << " cells over " << transport.getRankCount() << " MPI ranks" << endl;
+		int iResult = runPartition(pDomain, &transport, uiThreads, pOptions);
+		MPI_Finalize();
+		return iResult;
+	}
+	#endif
+	if (pOptions.uiRanks > 0) {
+		SharedMemoryWorld world((int)pOptions.uiRanks);
+		std::vector<std::thread> vRanks;
+		std::vector<int> vResults(pOptions.uiRanks, 0);
+		cout << "Domain: " << pDomain.Rows << " x " << pDomain.Cols << " cells over " << pOptions.uiRanks << " shared memory ranks" << endl;
+		for (unsigned int i = 0; i < pOptions.uiRanks; i++)
+			vRanks.push_back(std::thread([&, i]() {
+				SharedMemoryTransport transport(&world, (int)i);
+				vResults[i] = runPartition(pDomain, &transport, uiThreads, pOptions);
+			}));
+		for (unsigned int i = 0; i < pOptions.uiRanks; i++)
+			vRanks[i].join();
+		return *std::max_element(vResults.begin(), vResults.end());
+	}
+
+	NDRangeExecutor executor(uiThreads);
+
+	cout << "Domain: " << pDomain.Rows << " x " << pDomain.Cols << " cells on " << executor.getThreadCount() << " threads" << endl;
+
+	// Members of an ensemble share the bed and the sweep over it
+	if (pOptions.uiMembers > 0) {
+		if (isDomainCompiled(pDomain))
+			return runEnsemble(getDomainCompiled(pDomain), executor, pOptions.uiMembers, pOptions.dTimestep);
+		return runEnsemble(pDomain, executor, pOptions.uiMembers, pOptions.dTimestep);
+	}
+
+	// State, bed and Manning stored in another precision, or checked against double
+	if (pOptions.ucPrecision != PRECISION_DOUBLE || pOptions.bValidatePrecision) {
+		if (isDomainCompiled(pDomain))
+			return runPrecision(getDomainCompiled(pDomain), executor, pOptions);
+		return runPrecision(pDomain, executor, pOptions);
+	}
+
+	// Use the kernels instantiated with constant sizes when the domain matches
+	if (isDomainCompiled(pDomain))
+		return runSimulation(getDomainCompiled(pDomain), executor, pOptions);
+
+	return runSimulation(pDomain, executor, pOptions);
+}
+
 /*
 
 Input of gts_cacheDisabled:
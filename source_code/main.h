@@ -5,4 +5,36 @@
  * ------------------------------------------------------------------
  */
 
-#include "definitions.h"
\ No newline at end of file
+#include "definitions.h"
+#include "5_CLSchemeGodunov.h"
+#include "10_CLSchemeHybrid.h"
+#include "2_CLFriction.h"
+#include "4_CLDynamicTimestep.h"
+#include "HaloTransport.h"
+#ifdef USE_MPI
+#include "HaloTransportMPI.h"
+#endif
+
+// Variant of the scheme selected on the command line
+typedef struct sRunOptions {
+	bool		bStructureOfArrays;		// Separate Z, Zmax, Qx, Qy arrays
+	bool		bFacePass;				// Face pass followed by a cell pass
+	bool		bHybrid;				// Face pass with the diffusive wave in slow tiles
+	cl_uint2	uiTileSize;				// Tiled kernel when non-zero
+	bool		bActivityMap;			// Skip tiles that are dry
+	cl_uchar	ucRiemannSolver;		// RIEMANN_SOLVER_HLLC, _HLL or _RUSANOV
+	bool		bInterior;				// Interior kernel, one work-item per row
+	cl_uchar	ucGhostRing;			// BOUNDARY_GHOST_FROZEN, _REFLECTIVE or _OPEN
+	unsigned int	uiSubdomains;		// Bands of rows on pinned threads when non-zero
+	unsigned int	uiRanks;			// Blocks on shared memory ranks when non-zero
+	bool		bMPI;					// Blocks on the ranks of an MPI run
+	unsigned int	uiBatchSteps;		// Steps run between driver checks, rolled back when unstable, when non-zero
+	cl_double	dTimestep;				// Requested timestep
+	unsigned int	uiMembers;			// Ensemble members over one bed when non-zero
+	cl_uchar	ucPrecision;			// PRECISION_DOUBLE or _FLOAT storage
+	bool		bValidatePrecision;		// Report the deviation from an all-double run
+	cl_uchar	ucFaceGeometry;			// FACE_GEOMETRY_NONE, _ROUGHNESS or _FULL
+	bool		bPrimitives;			// Depths and velocities computed once per step for the cell kernel
+	bool		bFused;					// Batch steps as one sweep per tile
+	bool		bManningClasses;		// Friction reads the coefficients of a land-use class table
+} sRunOptions;
@@ -25,7 +25,7 @@ int normalPlain::getSize() {
 }
 
 double normalPlain::getBedElevation(int index) {
-	return this->bedElevation[(int) floor(index/10)][index % 10];
+	return this->bedElevation[index / this->sizey][index % this->sizey];
 }
 
 float normalPlain::getBedElevation(int indexX, int indexY) {
@@ -37,36 +37,36 @@ void normalPlain::setBedElevation(int indexX, int indexY, float value) {
 }
 
 void normalPlain::setBedElevation(cl_double4* src) {
-	for (int i = 0; i < 10; i++) {
-		for (int j = 0; j < 10; j++) {
-			this->setBedElevation(i, j, src[i * 10 + j].s[0]);
+	for (int i = 0; i < this->sizex; i++) {
+		for (int j = 0; j < this->sizey; j++) {
+			this->setBedElevation(i, j, src[i * this->sizey + j].s[0]);
 		}
 	}
 }
 
 void normalPlain::SetBedElevationMountain() {
-	int const SIZE = this->getSize()/10;
-	for (int i = 0; i < SIZE; i++) {
-		for (int j = 0; j < SIZE; j++) {
-			this->setBedElevation(i, j, 0);
+	for (int i = 0; i < this->sizex; i++) {
+		for (int j = 0; j < this->sizey; j++) {
 			this->setBedElevation(i, j, 0);
 		}
 	}
-	this->setBedElevation(6, 6, 0.16);
-	this->setBedElevation(6, 7, 0.16);
-	this->setBedElevation(7, 6, 0.16);
-	this->setBedElevation(7, 7, 0.16);
+
+	// Square mound spanning 60%-80% of each side (cells 6-7 on a 10x10 grid)
+	for (int i = this->sizex * 6 / 10; i < this->sizex * 8 / 10; i++) {
+		for (int j = this->sizey * 6 / 10; j < this->sizey * 8 / 10; j++) {
+			this->setBedElevation(i, j, 0.16);
+		}
+	}
 }
 
 void normalPlain::outputShape() {
-	int size = this->getSize()/10;
 	double value;
 	std::cout << std::fixed;
 	std::cout << std::setprecision(2);
 	std::cout << std::endl;
 
-	for (int i = size-1; i > -1 ; i--) {
-		for (int j = 0; j < size; j++) {
+	for (int i = this->sizex-1; i > -1 ; i--) {
+		for (int j = 0; j < this->sizey; j++) {
 			value = this->getBedElevation(i, j);
 			if (value-2 > 100+i*10+j) {
 				std::cout <<  value << " ";